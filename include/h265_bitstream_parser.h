@@ -50,6 +50,15 @@ class H265BitstreamParser {
       const uint8_t* data, size_t length,
       ParsingOptions parsing_options) noexcept;
 
+  // Parse a NAL unit (escaped, starting with its header) in resilient
+  // mode, updating the health record in `bitstream_parser_state`.
+  // `offset` is the NAL unit offset in the stream. Returns nullptr for
+  // NAL units that cannot be parsed at all.
+  static std::unique_ptr<H265NalUnitParser::NalUnitState>
+  ParseNalUnitResilient(const uint8_t* data, size_t length, size_t offset,
+                        H265BitstreamParserState* bitstream_parser_state,
+                        ParsingOptions parsing_options) noexcept;
+
   struct NaluIndex {
     // Start index of NALU, including start sequence.
     size_t start_offset;
@@ -63,6 +72,18 @@ class H265BitstreamParser {
                                                 size_t length) noexcept;
   static std::vector<NaluIndex> FindNaluIndicesExplicitFraming(
       const uint8_t* data, size_t length) noexcept;
+  // Returns the NALU indices in a buffer where each NALU is preceded by
+  // its size, in `length_size` (1, 2, or 4) bytes.
+  static std::vector<NaluIndex> FindNaluIndicesExplicitFraming(
+      const uint8_t* data, size_t length, size_t length_size) noexcept;
+
+  // Unpack RBSP and parse the NAL units at `nalu_indices` in the supplied
+  // buffer (e.g. the ones found in an MP4 file).
+  static std::unique_ptr<BitstreamState> ParseBitstream(
+      const uint8_t* data, size_t length,
+      const std::vector<NaluIndex>& nalu_indices,
+      H265BitstreamParserState* bitstream_parser_state,
+      ParsingOptions parsing_options) noexcept;
 };
 
 }  // namespace h265nal
@@ -8,13 +8,44 @@
 
 #include <map>
 #include <memory>
+#include <vector>
 
+#include "h265_error_reporter.h"
 #include "h265_pps_parser.h"
 #include "h265_sps_parser.h"
 #include "h265_vps_parser.h"
 
 namespace h265nal {
 
+class H265ParameterSetInterner;
+struct H265SliceHeaderParsePlan;
+struct H265TileGeometry;
+
+// The health record of a stream parsed in resilient mode.
+struct H265StreamHealth {
+#ifdef FDUMP_DEFINE
+  void fdump(FILE* outfp, int indent_level) const;
+#endif  // FDUMP_DEFINE
+
+  uint64_t num_nal_units = 0;
+  // NAL units whose parsing failed (any type)
+  uint64_t num_failed_nal_units = 0;
+  uint64_t num_failed_parameter_sets = 0;
+  uint64_t num_failed_slices = 0;
+  // slices recovered by using the last-known-good parameter sets
+  uint64_t num_parameter_set_fallbacks = 0;
+  // VCL NAL units over ParsingOptions::resilient_max_nal_unit_size
+  uint64_t num_capped_nal_units = 0;
+  // slices parsed while waiting for the next IRAP picture
+  uint64_t num_affected_slices = 0;
+  // IRAP pictures ending a corrupt section
+  uint64_t num_resyncs = 0;
+  // a parse failure happened since the last IRAP picture
+  bool resync_pending = false;
+  // offset of the last failed NAL unit
+  size_t last_failure_offset = 0;
+};
+
 // A class for keeping the state of a H265 Bitstream.
 // The parsed state of the bitstream.
 struct H265BitstreamParserState {
@@ -32,11 +63,44 @@ struct H265BitstreamParserState {
   std::map<uint32_t, std::shared_ptr<struct H265SpsParser::SpsState>> sps;
   // PPS state
   std::map<uint32_t, std::shared_ptr<struct H265PpsParser::PpsState>> pps;
+  // active SPS (as last activated by a slice segment), used by the SEI
+  // messages that depend on it (pic_timing)
+  std::shared_ptr<struct H265SpsParser::SpsState> active_sps;
+  // structured error reporter (optional, not owned)
+  H265ErrorReporter* error_reporter = nullptr;
+  // parameter-set intern table (optional, not owned): parsed parameter
+  // sets are replaced by the interned ones with the same RBSP
+  H265ParameterSetInterner* parameter_set_interner = nullptr;
+  // resilient mode: parameter sets replaced by a newer version with the
+  // same id, and the stream health record
+  std::map<uint32_t, std::shared_ptr<struct H265SpsParser::SpsState>>
+      last_good_sps;
+  std::map<uint32_t, std::shared_ptr<struct H265PpsParser::PpsState>>
+      last_good_pps;
+  H265StreamHealth health;
+  // slice segment header parse plans, indexed by PPS id (see
+  // H265SliceHeaderParsePlan)
+  std::vector<std::shared_ptr<const struct H265SliceHeaderParsePlan>>
+      slice_header_parse_plans;
+  // tile geometries, indexed by PPS id (see H265TileGeometry)
+  std::vector<std::shared_ptr<const struct H265TileGeometry>> tile_geometries;
 
   // some accessors
   std::shared_ptr<struct H265VpsParser::VpsState> GetVps(uint32_t vps_id) const;
   std::shared_ptr<struct H265SpsParser::SpsState> GetSps(uint32_t sps_id) const;
   std::shared_ptr<struct H265PpsParser::PpsState> GetPps(uint32_t pps_id) const;
+
+  // Serialize the parameter sets (and the active SPS) into a compact
+  // binary checkpoint: the RBSPs of the VPSs, SPSs, and PPSs. Returns
+  // false if a parameter set was not parsed by H265NalUnitParser (and
+  // therefore has no RBSP). Map entries without a parameter set (nullptr)
+  // are skipped.
+  bool Checkpoint(std::vector<uint8_t>* checkpoint) const;
+  // Replace the parameter sets with the ones in a checkpoint. Only the
+  // parameter sets are parsed, which is much cheaper than rescanning the
+  // stream for them. Returns false (and leaves the state untouched) if
+  // the checkpoint is invalid.
+  bool Restore(const uint8_t* data, size_t length);
 };
 
 }  // namespace h265nal
@@ -102,6 +102,21 @@ const uint32_t VPS_MAX_LAYER_ID_MAX = 62;
 // "The value of vps_num_layer_sets_minus1 shall be in the range of
 // 0 to 1023, inclusive."
 const uint32_t VPS_NUM_LAYER_SETS_MINUS1_MAX = 1023;
+
+// Rec. ITU-T H.265 Section 7.4.3.3
+// "The value of pps_pic_parameter_set_id shall be in the range of 0 to 63,
+// inclusive."
+const uint32_t PPS_PIC_PARAMETER_SET_ID_MAX = 63;
+
+// Rec. ITU-T H.265 Section D.3
+// "The value of num_sets_in_message_minus1 shall be in the range of 0 to
+// 255, inclusive."
+const uint32_t NUM_SETS_IN_MESSAGE_MINUS1_MAX = 255;
+
+// Rec. ITU-T H.265 Section 7.4.7.1
+// "The value of num_ref_idx_l0_active_minus1 shall be in the range of 0 to
+// 14, inclusive."
+const uint32_t NUM_REF_IDX_ACTIVE_MINUS1_MAX = 14;
 }  // namespace h265limits
 
 // Slice detector
@@ -123,12 +138,28 @@ bool IsNalUnitTypeUnspecified(uint32_t nal_unit_type);
 // packet-stream format packetization (e.g. RTP payloads).
 std::vector<uint8_t> UnescapeRbsp(const uint8_t *data, size_t length);
 
+// Copy a byte range of the RBSP contained in an escaped buffer. The range
+// (`rbsp_offset` and `rbsp_length`) is expressed in RBSP (unescaped) bytes,
+// so that ranges recorded while parsing an unescaped copy can be
+// materialized from the original buffer. Returns false if the range goes
+// beyond the end of the buffer.
+bool UnescapeRbspRange(const uint8_t *data, size_t length, size_t rbsp_offset,
+                       size_t rbsp_length, std::vector<uint8_t> *out);
+
+// Add the emulation prevention bytes to a buffer (the reverse of
+// UnescapeRbsp()), appending the escaped bytes to `out`.
+void EscapeRbsp(const uint8_t *data, size_t length, std::vector<uint8_t> *out);
+
 // Syntax functions and descriptors) (Section 7.2)
 bool byte_aligned(rtc::BitBuffer *bit_buffer);
 int get_current_offset(rtc::BitBuffer *bit_buffer);
 bool more_rbsp_data(rtc::BitBuffer *bit_buffer);
 bool rbsp_trailing_bits(rtc::BitBuffer *bit_buffer);
 
+// Ceil(Log2(value)) (Section 5.7), computed with integer arithmetic
+// (0 for values 0 and 1).
+uint32_t ceil_log2(uint32_t value);
+
 #if defined(FDUMP_DEFINE)
 // fdump() indentation help
 int indent_level_incr(int indent_level);
@@ -143,12 +174,25 @@ struct ParsingOptions {
   bool add_parsed_length;
   bool add_checksum;
   bool add_resolution;
+  // keep SEI payloads as views (offset and length) into the parsed buffer
+  // instead of copying their bytes
+  bool sei_payload_as_view;
+  // resilient mode: keep the last-known-good parameter sets, mark the
+  // slices between a parse failure and the next IRAP picture, and keep a
+  // per-stream health record (H265BitstreamParserState::health)
+  bool resilient;
+  // resilient mode: only the first bytes of larger VCL NAL units are
+  // parsed (non-VCL NAL units are always parsed in full)
+  size_t resilient_max_nal_unit_size;
   ParsingOptions()
       : add_offset(true),
         add_length(true),
         add_parsed_length(true),
         add_checksum(true),
-        add_resolution(true) {}
+        add_resolution(true),
+        sei_payload_as_view(false),
+        resilient(false),
+        resilient_max_nal_unit_size(64 * 1024) {}
 };
 
 class NaluChecksum {
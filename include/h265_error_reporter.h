@@ -0,0 +1,152 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <array>
+#include <chrono>
+#include <functional>
+
+#include "h265_ring_buffer.h"
+#include "rtc_base/bit_buffer.h"
+
+namespace h265nal {
+
+// Parse error codes.
+enum class ParseErrorCode : uint32_t {
+  kNone = 0,
+  // the NAL unit ended before the syntax structure did
+  kTruncated = 1,
+  // a syntax element has a value outside its spec range
+  kOutOfRange = 2,
+  // a referenced parameter set has not been received
+  kMissingParameterSet = 3,
+  // a syntax structure is not supported by the parser
+  kUnsupported = 4,
+  kNumParseErrorCodes = 5,
+};
+
+// Returns a printable name for a ParseErrorCode.
+const char* ParseErrorCodeToString(ParseErrorCode code);
+
+// A structured parse error.
+struct ParseError {
+#ifdef FDUMP_DEFINE
+  void fdump(FILE* outfp, int indent_level) const;
+#endif  // FDUMP_DEFINE
+
+  ParseErrorCode code = ParseErrorCode::kNone;
+  // failing syntax element or structure (a string literal)
+  const char* syntax_element = "";
+  // offending value (for kOutOfRange and kMissingParameterSet)
+  int64_t value = 0;
+  // bit offset in the NAL unit RBSP (starting at the NAL unit header)
+  size_t bit_offset = 0;
+  uint32_t nal_unit_type = 0;
+  // index of the NAL unit among the ones parsed with this reporter
+  uint64_t nal_unit_index = 0;
+};
+
+// A class for collecting structured parse errors. A reporter is attached to
+// a stream through H265BitstreamParserState::error_reporter. It keeps
+// per-code counters and the last kErrorHistorySize errors, and can forward
+// errors to a rate-limited callback. Errors are only formatted by the
+// caller, if ever.
+class H265ErrorReporter {
+ public:
+  // Number of errors kept in the error history.
+  static constexpr size_t kErrorHistorySize = 64;
+  typedef H265RingBuffer<ParseError, kErrorHistorySize> ErrorHistory;
+  typedef std::function<void(const ParseError&)> Callback;
+
+  H265ErrorReporter() = default;
+  ~H265ErrorReporter() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265ErrorReporter(const H265ErrorReporter&) = delete;
+  H265ErrorReporter(H265ErrorReporter&&) = delete;
+  H265ErrorReporter& operator=(const H265ErrorReporter&) = delete;
+  H265ErrorReporter& operator=(H265ErrorReporter&&) = delete;
+
+  // Set a callback invoked for (at most) `max_callbacks_per_second` errors
+  // per second. Errors over the limit are still recorded.
+  void SetCallback(Callback callback,
+                   uint32_t max_callbacks_per_second) noexcept;
+
+  // Record an error in the context of the current NAL unit.
+  void Report(ParseErrorCode code, const char* syntax_element, int64_t value,
+              size_t bit_offset) noexcept;
+
+  // Last errors (Get(0) is the last one).
+  const ErrorHistory& errors() const { return errors_; }
+  uint64_t num_errors() const { return num_errors_; }
+  uint64_t num_errors(ParseErrorCode code) const {
+    return num_errors_per_code_[static_cast<size_t>(code) %
+                                num_errors_per_code_.size()];
+  }
+  // Errors not forwarded to the callback because of the rate limit.
+  uint64_t num_suppressed_callbacks() const {
+    return num_suppressed_callbacks_;
+  }
+  uint64_t num_nal_units() const { return num_nal_units_; }
+  void Clear() noexcept;
+
+  // The active reporter of the calling thread (nullptr if none).
+  static H265ErrorReporter* active() noexcept;
+
+  // RAII helper making a reporter the active one in the calling thread
+  // while a NAL unit is parsed. Scopes can be nested (e.g. for RTP
+  // aggregation packets): the previous one is restored on destruction.
+  class Scope {
+   public:
+    Scope(H265ErrorReporter* error_reporter, uint32_t nal_unit_type) noexcept;
+    ~Scope();
+    // disable copy ctor, move ctor, and copy&move assignments
+    Scope(const Scope&) = delete;
+    Scope(Scope&&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    Scope& operator=(Scope&&) = delete;
+
+    // Number of errors reported in this scope.
+    uint64_t num_errors() const;
+
+   private:
+    H265ErrorReporter* const error_reporter_;
+    H265ErrorReporter* const previous_active_;
+    // context of the enclosing scope
+    const uint32_t previous_nal_unit_type_;
+    const uint64_t previous_nal_unit_index_;
+    const uint64_t first_error_;
+  };
+
+ private:
+  ErrorHistory errors_;
+  uint64_t num_errors_ = 0;
+  std::array<uint64_t, static_cast<size_t>(
+                           ParseErrorCode::kNumParseErrorCodes)>
+      num_errors_per_code_ = {};
+  uint64_t num_nal_units_ = 0;
+
+  // rate-limited callback
+  Callback callback_;
+  uint32_t max_callbacks_per_second_ = 0;
+  std::chrono::steady_clock::time_point callback_window_start_;
+  uint32_t num_callbacks_in_window_ = 0;
+  uint64_t num_suppressed_callbacks_ = 0;
+
+  // NAL unit context of the active scope
+  uint32_t nal_unit_type_ = 0;
+  uint64_t nal_unit_index_ = 0;
+};
+
+// Report a parse error to the active error reporter of the calling thread.
+// When there is none, the error is dropped (or printed in FPRINT_ERRORS
+// builds). `bit_buffer` (if not nullptr) provides the bit offset.
+void ReportParseError(ParseErrorCode code, const char* syntax_element,
+                      int64_t value, rtc::BitBuffer* bit_buffer) noexcept;
+
+}  // namespace h265nal
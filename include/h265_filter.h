@@ -0,0 +1,100 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "h265_nal_unit_header_parser.h"
+#include "h265_nal_unit_parser.h"
+
+namespace h265nal {
+
+// A predicate over parsed NAL units, compiled once from a filter
+// expression like "nal_unit_type==CRA_NUT || slice_qp_delta>10".
+//
+// Grammar:
+//   expr       := and_expr ( "||" and_expr )*
+//   and_expr   := unary ( "&&" unary )*
+//   unary      := "!" unary | "(" expr ")" | comparison
+//   comparison := operand ( ( "==" | "!=" | "<" | "<=" | ">" | ">=" )
+//                 operand )?
+//   operand    := field | constant | [-]integer
+//
+// Fields are NAL unit header, slice segment header, and parameter set
+// syntax elements (see GetFieldNames()). Constants are the NalUnitType
+// names (e.g. IDR_W_RADL) and the slice types (B, P, I). A field that
+// is not present in a NAL unit (e.g. slice_qp_delta in an SPS) makes any
+// comparison using it false. A lone operand is true when non-zero.
+class H265Filter {
+ public:
+  // Syntax structures a filter reads its fields from.
+  enum FieldSource : uint32_t {
+    kSourceHeader = 1 << 0,
+    kSourceSliceHeader = 1 << 1,
+    kSourceVps = 1 << 2,
+    kSourceSps = 1 << 3,
+    kSourcePps = 1 << 4,
+  };
+
+  // Result of evaluating a filter on a NAL unit header only.
+  enum class Match { kFalse, kTrue, kUnknown };
+
+  ~H265Filter();
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265Filter(const H265Filter&) = delete;
+  H265Filter(H265Filter&&) = delete;
+  H265Filter& operator=(const H265Filter&) = delete;
+  H265Filter& operator=(H265Filter&&) = delete;
+
+  // Compile a filter expression. Returns nullptr (and sets `error`, if
+  // not nullptr) on syntax errors.
+  static std::unique_ptr<H265Filter> Compile(const std::string& expression,
+                                             std::string* error) noexcept;
+
+  // Evaluate the filter using only the NAL unit header. Returns kUnknown
+  // when the result depends on payload fields, so callers can skip
+  // parsing the payload of NAL units that cannot match.
+  Match EvaluateHeader(
+      const H265NalUnitHeaderParser::NalUnitHeaderState& header) const;
+  // Evaluate the filter on a parsed NAL unit.
+  bool Evaluate(const H265NalUnitParser::NalUnitState& nal_unit) const;
+
+  // Bitmask of FieldSource values referenced by the filter.
+  uint32_t sources() const { return sources_; }
+  // Whether the payload of NAL units of type `nal_unit_type` must be
+  // parsed when using this filter, either to evaluate it, or to keep the
+  // parameter sets the slice header fields depend on. Note that callers
+  // that use the payload of the matching slices (e.g. to dump them) must
+  // parse the parameter sets anyway.
+  bool NeedsPayload(uint32_t nal_unit_type) const;
+
+  // Names of the supported fields.
+  static std::vector<std::string> GetFieldNames();
+
+ private:
+  struct Node;
+  class Compiler;
+  H265Filter();
+
+  // Returns 0 (false), 1 (true), or -1 (unknown, header-only mode).
+  int EvaluateNode(int node, const H265NalUnitParser::NalUnitState* nal_unit,
+                   const H265NalUnitHeaderParser::NalUnitHeaderState& header)
+      const;
+  // Returns false if the operand value is not available.
+  bool GetOperand(int node, const H265NalUnitParser::NalUnitState* nal_unit,
+                  const H265NalUnitHeaderParser::NalUnitHeaderState& header,
+                  bool* unknown, int64_t* value) const;
+
+  std::vector<Node> nodes_;
+  int root_ = -1;
+  uint32_t sources_ = 0;
+};
+
+}  // namespace h265nal
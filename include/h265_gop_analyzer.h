@@ -0,0 +1,178 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <array>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_ring_buffer.h"
+
+namespace h265nal {
+
+// A class for a one-pass analysis of the GOP structure and the frame sizes
+// of a stream. It only looks at NAL unit headers and at the first syntax
+// elements of the slice segment headers. Per-frame and per-GOP results are
+// kept in fixed-size sliding windows, and aggregated stats are reported
+// every `report_interval` seconds of stream time.
+//
+// A GOP starts at an IRAP picture and lasts until the next one. Frames
+// before the first IRAP picture are not part of any GOP.
+class H265GopAnalyzer {
+ public:
+  // Number of frames kept in the frame window.
+  static constexpr size_t kFrameWindowSize = 256;
+  // Number of GOPs kept in the GOP history.
+  static constexpr size_t kGopHistorySize = 16;
+  // B, P, and I (Table 7-7)
+  static constexpr size_t kNumSliceTypes = 3;
+
+  // count/min/avg/max accumulator.
+  struct SizeStats {
+    uint32_t count = 0;
+    uint64_t sum = 0;
+    uint64_t min = 0;
+    uint64_t max = 0;
+
+    void Add(uint64_t value) noexcept {
+      min = (count == 0 || value < min) ? value : min;
+      max = (count == 0 || value > max) ? value : max;
+      sum += value;
+      count++;
+    }
+    double Average() const noexcept {
+      return (count == 0) ? 0.0 : static_cast<double>(sum) / count;
+    }
+  };
+
+  // A frame (all the slice segments of a picture).
+  struct FrameInfo {
+    // frame index, in decoding order
+    uint64_t frame_index = 0;
+    // nal_unit_type of the slice segments
+    uint32_t nal_unit_type = 0;
+    uint32_t temporal_id = 0;
+    // lowest slice_type of the frame (i.e. B if any slice is B, P if any
+    // slice is P, I otherwise)
+    uint32_t slice_type = 0;
+    // size of the slice segment NAL units (including their headers)
+    uint64_t size_bytes = 0;
+  };
+
+  // A GOP.
+  struct GopInfo {
+    // frame index of the IRAP picture starting the GOP
+    uint64_t first_frame_index = 0;
+    uint32_t irap_nal_unit_type = 0;
+    uint32_t num_frames = 0;
+    uint32_t num_rasl_frames = 0;
+    uint32_t num_radl_frames = 0;
+    // highest TemporalId in the GOP. This is the depth of the temporal
+    // (e.g. hierarchical-B) prediction structure minus 1.
+    uint32_t max_temporal_id = 0;
+    uint64_t size_bytes = 0;
+    // frame sizes per frame slice_type
+    std::array<SizeStats, kNumSliceTypes> frame_size = {};
+
+    // An open GOP starts with a CRA or BLA picture that has associated
+    // RASL pictures, which reference pictures from the previous GOP.
+    bool IsOpen() const noexcept;
+  };
+
+  // The stats of a report interval.
+  struct Report {
+    uint32_t report_index = 0;
+    // stream time, in seconds
+    double start_time = 0.0;
+    double end_time = 0.0;
+    uint32_t num_frames = 0;
+    uint64_t size_bytes = 0;
+    // GOPs that ended in the interval
+    uint32_t num_gops = 0;
+    uint32_t num_open_gops = 0;
+    uint32_t num_closed_gops = 0;
+    SizeStats gop_length;
+    uint32_t max_temporal_id = 0;
+    // frame sizes per frame slice_type
+    std::array<SizeStats, kNumSliceTypes> frame_size = {};
+
+    double GetBitrate() const noexcept;
+#ifdef FDUMP_DEFINE
+    void fdump(FILE* outfp, int indent_level) const;
+#endif  // FDUMP_DEFINE
+  };
+
+  typedef H265RingBuffer<FrameInfo, kFrameWindowSize> FrameWindow;
+  typedef H265RingBuffer<GopInfo, kGopHistorySize> GopHistory;
+
+  // The analyzer uses (and updates) the parameter sets in
+  // `bitstream_parser_state`. The frame duration comes from the VUI timing
+  // info, or from `default_frame_rate` when the SPS has none.
+  H265GopAnalyzer(H265BitstreamParserState* bitstream_parser_state,
+                  double report_interval, double default_frame_rate)
+      : bitstream_parser_state_(bitstream_parser_state),
+        report_interval_(report_interval),
+        default_frame_rate_(default_frame_rate) {}
+  ~H265GopAnalyzer() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265GopAnalyzer(const H265GopAnalyzer&) = delete;
+  H265GopAnalyzer(H265GopAnalyzer&&) = delete;
+  H265GopAnalyzer& operator=(const H265GopAnalyzer&) = delete;
+  H265GopAnalyzer& operator=(H265GopAnalyzer&&) = delete;
+
+  // Process a NAL unit (starting with its header). Returns true (and fills
+  // up `report`) when a report interval ends.
+  bool ProcessNalUnit(const uint8_t* data, size_t length,
+                      Report* report) noexcept;
+  // Process all the NAL units in an Annex B buffer, appending the
+  // completed reports to `reports`.
+  void ProcessBitstream(const uint8_t* data, size_t length,
+                        std::vector<Report>* reports) noexcept;
+  // Close the current frame and GOP. Returns true (and fills up `report`)
+  // if there is an incomplete report interval.
+  bool Flush(Report* report) noexcept;
+
+  // Frames in decoding order (Get(0) is the last one).
+  const FrameWindow& frames() const { return frames_; }
+  // Completed GOPs (Get(0) is the last one).
+  const GopHistory& gops() const { return gops_; }
+  uint64_t num_frames() const { return num_frames_; }
+  uint64_t num_gops() const { return num_gops_; }
+
+ private:
+  void CloseFrame() noexcept;
+  void CloseGop() noexcept;
+  // Copy the current report into `report` (if not nullptr) and start a new
+  // one.
+  void EndReport(Report* report) noexcept;
+  double GetFrameDuration(uint32_t pps_id) const noexcept;
+
+  H265BitstreamParserState* const bitstream_parser_state_;
+  const double report_interval_;
+  const double default_frame_rate_;
+
+  // RBSP scratch buffer, reused across slices
+  std::vector<uint8_t> rbsp_buffer_;
+
+  bool has_current_frame_ = false;
+  FrameInfo current_frame_;
+  double current_frame_duration_ = 0.0;
+  uint64_t num_frames_ = 0;
+
+  bool has_current_gop_ = false;
+  GopInfo current_gop_;
+  uint64_t num_gops_ = 0;
+
+  double time_ = 0.0;
+  Report current_report_;
+
+  FrameWindow frames_;
+  GopHistory gops_;
+};
+
+}  // namespace h265nal
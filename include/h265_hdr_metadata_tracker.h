@@ -0,0 +1,70 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+
+#include "h265_sei_parser.h"
+
+namespace h265nal {
+
+// A class for tracking the HDR static metadata (mastering display colour
+// volume and content light level information SEIs) of a single stream.
+// Encoders repeat these SEIs at every IRAP picture, so the tracker keeps
+// the last seen values and reports only actual changes.
+class H265HdrMetadataTracker {
+ public:
+  // Bits of the change mask returned by the Process*() functions.
+  enum ChangeFlag : uint32_t {
+    kNoChange = 0,
+    kMasteringDisplayColourVolumeChanged = 1 << 0,
+    kContentLightLevelInfoChanged = 1 << 1,
+  };
+
+  H265HdrMetadataTracker() = default;
+  ~H265HdrMetadataTracker() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265HdrMetadataTracker(const H265HdrMetadataTracker&) = delete;
+  H265HdrMetadataTracker(H265HdrMetadataTracker&&) = delete;
+  H265HdrMetadataTracker& operator=(const H265HdrMetadataTracker&) = delete;
+  H265HdrMetadataTracker& operator=(H265HdrMetadataTracker&&) = delete;
+
+  // Update the tracked values from an already-parsed SEI RBSP. Returns a
+  // mask of ChangeFlag bits (kNoChange when the values are the same as the
+  // ones already tracked).
+  uint32_t ProcessSeiRbsp(
+      const H265SeiRbspParser::SeiRbspState& sei_rbsp) noexcept;
+  // Unpack RBSP, parse only the HDR SEI messages from the supplied SEI
+  // RBSP (NAL unit payload, without the NAL unit header), and update the
+  // tracked values.
+  uint32_t ProcessSeiRbsp(const uint8_t* data, size_t length) noexcept;
+
+  // Forget the tracked values (e.g. on a stream switch).
+  void Reset() noexcept;
+
+  // Last seen values (nullptr if never seen).
+  const H265SeiMasteringDisplayColourVolumeParser::
+      H265SeiMasteringDisplayColourVolumeState*
+      mastering_display_colour_volume() const {
+    return mastering_display_colour_volume_.get();
+  }
+  const H265SeiContentLightLevelInfoParser::H265SeiContentLightLevelInfoState*
+  content_light_level_info() const {
+    return content_light_level_info_.get();
+  }
+
+ private:
+  std::unique_ptr<H265SeiMasteringDisplayColourVolumeParser::
+                      H265SeiMasteringDisplayColourVolumeState>
+      mastering_display_colour_volume_;
+  std::unique_ptr<
+      H265SeiContentLightLevelInfoParser::H265SeiContentLightLevelInfoState>
+      content_light_level_info_;
+};
+
+}  // namespace h265nal
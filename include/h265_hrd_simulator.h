@@ -0,0 +1,149 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+
+#include "h265_sei_parser.h"
+#include "h265_sps_parser.h"
+
+namespace h265nal {
+
+// A streaming hypothetical reference decoder (Annex C). It models the CPB
+// (arrival and removal of access units) and the picture output side of the
+// DPB for the first delivery schedule (SchedSelIdx 0) of the highest
+// sub-layer, at the access unit level (no decoding unit operation).
+class H265HrdSimulator {
+ public:
+  // The HRD configuration.
+  struct HrdConfig {
+    // BitRate[SchedSelIdx] (Equation E-77), in bits per second
+    double bit_rate = 0;
+    // CpbSize[SchedSelIdx] (Equation E-78), in bits
+    double cpb_size = 0;
+    // cbr_flag[SchedSelIdx]
+    bool cbr = false;
+    // ClockTick (Equation C-1), in seconds
+    double clock_tick = 0;
+    // sps_max_dec_pic_buffering_minus1[HighestTid] + 1 (0 to disable the
+    // DPB overflow check)
+    uint32_t dpb_size = 0;
+  };
+
+  // An access unit, in decoding order. The first access unit must carry a
+  // buffering period SEI, and every access unit a picture timing SEI.
+  struct AccessUnit {
+    // size of the access unit, in bits (all the NAL units for a Type II
+    // bitstream conformance check, or only the VCL and filler data NAL
+    // units for a Type I one)
+    uint64_t size_bits = 0;
+    const H265SeiBufferingPeriodParser::H265SeiBufferingPeriodState*
+        buffering_period = nullptr;
+    const H265SeiPicTimingParser::H265SeiPicTimingState* pic_timing = nullptr;
+  };
+
+  // The simulated timing of an access unit. Times are in seconds.
+  struct AccessUnitTiming {
+    // access unit index, in decoding order
+    uint64_t index = 0;
+    double initial_arrival_time = 0;
+    double final_arrival_time = 0;
+    double removal_time = 0;
+    double dpb_output_time = 0;
+    // CPB fullness just before the removal of the access unit, in bits
+    double cpb_fullness = 0;
+    // number of decoded pictures waiting for output after decoding the
+    // access unit (including itself)
+    uint32_t dpb_fullness = 0;
+    bool cpb_overflow = false;
+    bool cpb_underflow = false;
+    bool dpb_overflow = false;
+  };
+
+  // Aggregated results.
+  struct Stats {
+    uint64_t num_access_units = 0;
+    uint64_t num_cpb_overflows = 0;
+    uint64_t num_cpb_underflows = 0;
+    uint64_t num_dpb_overflows = 0;
+    double max_cpb_fullness = 0;
+    uint32_t max_dpb_fullness = 0;
+  };
+
+  // A simulator with an invalid configuration (see IsValidConfig())
+  // rejects all the access units.
+  H265HrdSimulator(const HrdConfig& config, bool use_vcl_hrd)
+      : config_(config),
+        use_vcl_hrd_(use_vcl_hrd),
+        valid_(IsValidConfig(config)) {}
+  ~H265HrdSimulator() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265HrdSimulator(const H265HrdSimulator&) = delete;
+  H265HrdSimulator(H265HrdSimulator&&) = delete;
+  H265HrdSimulator& operator=(const H265HrdSimulator&) = delete;
+  H265HrdSimulator& operator=(H265HrdSimulator&&) = delete;
+
+  // Create a simulator using the NAL (or VCL) HRD parameters of an SPS.
+  // Returns nullptr if the SPS has no HRD or timing information.
+  static std::unique_ptr<H265HrdSimulator> Create(
+      const H265SpsParser::SpsState& sps, bool use_vcl_hrd) noexcept;
+  // Create a simulator with an explicit configuration. Returns nullptr if
+  // the configuration is not valid.
+  static std::unique_ptr<H265HrdSimulator> Create(const HrdConfig& config,
+                                                  bool use_vcl_hrd) noexcept;
+  // A configuration is valid if its bit rate and CPB size are positive,
+  // and its clock tick is not negative.
+  static bool IsValidConfig(const HrdConfig& config) noexcept;
+
+  // Add the next access unit. The timing of the access units whose CPB
+  // fullness is known (i.e. no later access unit can start arriving before
+  // their removal) is appended to `timing`. Returns false if the access unit
+  // lacks the required SEI messages, or if the configuration is not valid.
+  bool AddAccessUnit(const AccessUnit& access_unit,
+                     std::vector<AccessUnitTiming>* timing) noexcept;
+  // Append the timing of all the pending access units to `timing`.
+  void Flush(std::vector<AccessUnitTiming>* timing) noexcept;
+
+  const HrdConfig& config() const { return config_; }
+  bool valid() const { return valid_; }
+  const Stats& stats() const { return stats_; }
+
+ private:
+  // Compute the CPB/DPB state at the removal of the oldest pending access
+  // unit and move it to `timing`.
+  void FinalizeAccessUnit(std::vector<AccessUnitTiming>* timing) noexcept;
+
+  const HrdConfig config_;
+  const bool use_vcl_hrd_;
+  const bool valid_;
+  Stats stats_;
+
+  uint64_t num_access_units_ = 0;
+  // InitCpbRemovalDelay and InitCpbRemovalDelayOffset of the current
+  // buffering period, in seconds
+  double init_cpb_removal_delay_ = 0;
+  double init_cpb_removal_delay_offset_ = 0;
+  // nominal removal time of the first access unit of the current buffering
+  // period (baseTime), and of the previous access unit
+  double base_time_ = 0;
+  double prev_removal_time_ = 0;
+  double prev_final_arrival_time_ = 0;
+
+  // access units whose removal has not been evaluated yet, and their sizes
+  std::deque<AccessUnitTiming> pending_;
+  std::deque<uint64_t> pending_size_bits_;
+  // output times of the decoded pictures waiting for output
+  std::priority_queue<double, std::vector<double>, std::greater<double>>
+      dpb_output_times_;
+};
+
+}  // namespace h265nal
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <memory>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+
+namespace h265nal {
+
+// A class for parsing out (and generating) an
+// HEVCDecoderConfigurationRecord (the contents of an mp4 hvcC box), as
+// described in Section 8.3.3.1 of ISO/IEC 14496-15.
+class H265HvccParser {
+ public:
+  // An array of NAL units of the same type.
+  struct HvccArrayState {
+    HvccArrayState() = default;
+    ~HvccArrayState() = default;
+    // disable copy ctor, move ctor, and copy&move assignments
+    HvccArrayState(const HvccArrayState&) = delete;
+    HvccArrayState(HvccArrayState&&) = delete;
+    HvccArrayState& operator=(const HvccArrayState&) = delete;
+    HvccArrayState& operator=(HvccArrayState&&) = delete;
+
+#ifdef FDUMP_DEFINE
+    void fdump(FILE* outfp, int indent_level) const;
+#endif  // FDUMP_DEFINE
+
+    uint32_t array_completeness = 0;
+    uint32_t NAL_unit_type = 0;
+    uint32_t numNalus = 0;
+    // nalUnit contents (escaped, including the NAL unit header)
+    std::vector<std::vector<uint8_t>> nal_units;
+  };
+
+  // The parsed state of the hvcC.
+  struct HvccState {
+    HvccState() = default;
+    ~HvccState() = default;
+    // disable copy ctor, move ctor, and copy&move assignments
+    HvccState(const HvccState&) = delete;
+    HvccState(HvccState&&) = delete;
+    HvccState& operator=(const HvccState&) = delete;
+    HvccState& operator=(HvccState&&) = delete;
+
+#ifdef FDUMP_DEFINE
+    void fdump(FILE* outfp, int indent_level) const;
+#endif  // FDUMP_DEFINE
+
+    uint32_t configurationVersion = 1;
+    uint32_t general_profile_space = 0;
+    uint32_t general_tier_flag = 0;
+    uint32_t general_profile_idc = 0;
+    uint32_t general_profile_compatibility_flags = 0;
+    uint64_t general_constraint_indicator_flags = 0;
+    uint32_t general_level_idc = 0;
+    uint32_t min_spatial_segmentation_idc = 0;
+    uint32_t parallelismType = 0;
+    uint32_t chromaFormat = 0;
+    uint32_t bitDepthLumaMinus8 = 0;
+    uint32_t bitDepthChromaMinus8 = 0;
+    uint32_t avgFrameRate = 0;
+    uint32_t constantFrameRate = 0;
+    uint32_t numTemporalLayers = 0;
+    uint32_t temporalIdNested = 0;
+    uint32_t lengthSizeMinusOne = 3;
+    uint32_t numOfArrays = 0;
+    std::vector<std::unique_ptr<struct HvccArrayState>> arrays;
+  };
+
+  // Parse an hvcC from the supplied buffer. The NAL units of its arrays
+  // are parsed into `bitstream_parser_state` (so that the stream can be
+  // parsed without in-band parameter sets).
+  static std::unique_ptr<HvccState> ParseHvcc(
+      const uint8_t* data, size_t length,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      ParsingOptions parsing_options) noexcept;
+
+  // Generate an hvcC from the parsed parameter sets in
+  // `bitstream_parser_state` (the first SPS, its VPS, and the PPSs), and
+  // the NAL units to carry in its arrays (VPS, SPS, PPS, and SEI NAL units,
+  // escaped and including the NAL unit header). Returns nullptr if there
+  // is no SPS.
+  static std::unique_ptr<HvccState> GenerateHvcc(
+      const struct H265BitstreamParserState& bitstream_parser_state,
+      const std::vector<std::vector<uint8_t>>& nal_units,
+      uint32_t length_size) noexcept;
+
+  // Serialize an hvcC into `buffer`. Returns false if a value does not
+  // fit its field.
+  static bool SerializeHvcc(const HvccState& hvcc,
+                            std::vector<uint8_t>* buffer) noexcept;
+};
+
+}  // namespace h265nal
@@ -0,0 +1,136 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_pps_parser.h"
+#include "h265_slice_parser.h"
+#include "h265_sps_parser.h"
+#include "h265_tile_geometry.h"
+
+namespace h265nal {
+
+// A class for extracting motion-constrained tile sets (MCTS): it splits a
+// tiled bitstream into one sub-bitstream per tile, where each
+// sub-bitstream is a standalone bitstream whose pictures are the tile.
+// For each tile:
+// - the SPS is rewritten with the tile size (and the part of the
+//   conformance window that falls in the tile),
+// - the PPS is rewritten without tiles,
+// - the slice segment headers are rewritten with their address in the
+//   tile (and without the tile entry points),
+// - the slice segment data is not copied: the sub-bitstreams reference it
+//   in the input buffer.
+// The VPS and the AUD, EOS, and EOB NAL units are kept as they are. The
+// SEI NAL units are dropped, as they describe the full picture.
+//
+// Every slice segment must be contained in a single tile. Note that the
+// extracted tiles are only decodable if they are motion-constrained, i.e.
+// if their inter prediction does not reference samples from other tiles
+// (see the temporal_motion_constrained_tile_sets SEI), and match the
+// original tiles if the in-loop filters do not cross the tile boundaries
+// (loop_filter_across_tiles_enabled_flag equal to 0).
+class H265MctsExtractor {
+ public:
+  // A byte range of a sub-bitstream: either a range of the input (`data`
+  // set), or a range of the sub-bitstream `buffer` (`data` is nullptr).
+  struct Chunk {
+    const uint8_t* data = nullptr;
+    size_t offset = 0;
+    size_t length = 0;
+  };
+
+  // The sub-bitstream of a tile (an Annex B byte stream).
+  struct SubBitstream {
+    SubBitstream() = default;
+    ~SubBitstream() = default;
+    // disable copy ctor, move ctor, and copy&move assignments
+    SubBitstream(const SubBitstream&) = delete;
+    SubBitstream(SubBitstream&&) = delete;
+    SubBitstream& operator=(const SubBitstream&) = delete;
+    SubBitstream& operator=(SubBitstream&&) = delete;
+
+    // Size of the sub-bitstream, in bytes.
+    size_t size() const noexcept;
+    // Copy the sub-bitstream into `out`.
+    void Write(std::vector<uint8_t>* out) const noexcept;
+
+    uint32_t tile_id = 0;
+    H265TileGeometry::TileRect tile_rect;
+    // start codes and rewritten NAL units
+    std::vector<uint8_t> buffer;
+    std::vector<Chunk> chunks;
+    // parameter sets the last rewritten SPS and PPS were produced from
+    std::shared_ptr<struct H265SpsParser::SpsState> sps;
+    std::shared_ptr<struct H265PpsParser::PpsState> pps;
+  };
+
+  H265MctsExtractor() = default;
+  ~H265MctsExtractor() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265MctsExtractor(const H265MctsExtractor&) = delete;
+  H265MctsExtractor(H265MctsExtractor&&) = delete;
+  H265MctsExtractor& operator=(const H265MctsExtractor&) = delete;
+  H265MctsExtractor& operator=(H265MctsExtractor&&) = delete;
+
+  // Process a NAL unit (escaped, starting with its header). The NAL unit
+  // bytes are referenced by the sub-bitstreams, so they must outlive
+  // them. Returns false if the NAL unit cannot be extracted (e.g. a slice
+  // segment spanning several tiles, or a change in the number of tiles).
+  bool ProcessNalUnit(const uint8_t* data, size_t length) noexcept;
+  // Check that the last picture is complete. Returns false otherwise.
+  bool Finish() noexcept;
+
+  // Extract the tiles of an Annex B byte stream. Returns nullptr if the
+  // stream cannot be extracted.
+  static std::unique_ptr<H265MctsExtractor> Extract(const uint8_t* data,
+                                                    size_t length) noexcept;
+
+  // One sub-bitstream per tile (in tile id order).
+  const std::vector<std::unique_ptr<SubBitstream>>& sub_bitstreams() const {
+    return sub_bitstreams_;
+  }
+  // Whether a temporal_motion_constrained_tile_sets SEI declared every
+  // tile as a motion-constrained tile set.
+  bool each_tile_one_tile_set() const { return each_tile_one_tile_set_; }
+
+ private:
+  bool ProcessSliceSegment(const uint8_t* data, size_t length,
+                           uint32_t nal_unit_type) noexcept;
+  // Check that the slice segments of the current picture so far, and the
+  // one starting at `ctb_addr_ts` (or the end of the picture), are each
+  // contained in a single tile.
+  bool CheckSliceSegmentEnd(uint32_t ctb_addr_ts) const noexcept;
+  // Write the VPS, and the SPS and PPS rewritten for the tile.
+  bool WriteParameterSets(
+      const std::shared_ptr<struct H265SpsParser::SpsState>& sps,
+      const std::shared_ptr<struct H265PpsParser::PpsState>& pps,
+      SubBitstream* sub_bitstream) noexcept;
+
+  H265BitstreamParserState bitstream_parser_state_;
+  // last parameter set NAL units, by id
+  std::map<uint32_t, std::pair<const uint8_t*, size_t>> vps_nal_units_;
+  std::map<uint32_t, std::pair<const uint8_t*, size_t>> sps_nal_units_;
+  std::map<uint32_t, std::pair<const uint8_t*, size_t>> pps_nal_units_;
+  std::vector<std::unique_ptr<SubBitstream>> sub_bitstreams_;
+  bool each_tile_one_tile_set_ = false;
+  // current picture: tile geometry, and tile and tile scan address of the
+  // last slice segment
+  std::shared_ptr<const H265TileGeometry> geometry_;
+  int last_tile_id_ = -1;
+  uint32_t last_ctb_addr_ts_ = 0;
+  // scratch buffers
+  std::vector<uint8_t> rbsp_buffer_;
+  std::vector<uint8_t> nal_unit_buffer_;
+};
+
+}  // namespace h265nal
@@ -0,0 +1,99 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+
+namespace h265nal {
+
+// A minimal ISO-BMFF (MP4) demuxer for H265 tracks. It reads the sample
+// tables of the first hvc1/hev1 track (moov/trak/stbl, including
+// stsz/stz2, stsc, stco/co64, stts, ctts, and stss) and the movie
+// fragments (moof/traf/trun). Nothing is copied: samples and hvcC
+// parameter sets are views (offset and size) into the caller's buffer
+// (e.g. an mmap'd file), which must outlive the demuxer.
+class H265Mp4Demuxer {
+ public:
+  // A sample (access unit): a series of NAL units, each preceded by its
+  // size (in TrackInfo::length_size bytes).
+  struct Sample {
+    // sample offset and size in the file
+    size_t offset = 0;
+    size_t size = 0;
+    // timing, in track timescale units
+    uint64_t decode_time = 0;
+    uint32_t duration = 0;
+    int64_t composition_offset = 0;
+    bool is_sync = false;
+  };
+
+  // The H265 track.
+  struct TrackInfo {
+#ifdef FDUMP_DEFINE
+    void fdump(FILE* outfp, int indent_level) const;
+#endif  // FDUMP_DEFINE
+
+    uint32_t track_id = 0;
+    uint32_t timescale = 0;
+    // sample entry ("hvc1" or "hev1") and its dimensions
+    char sample_entry[5] = {};
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // hvcC values: size of the NAL unit length fields (lengthSizeMinusOne
+    // + 1), and the NAL units of the parameter-set arrays
+    uint32_t length_size = 4;
+    std::vector<H265BitstreamParser::NaluIndex> parameter_sets;
+    // whether the file has movie fragments
+    bool fragmented = false;
+  };
+
+  ~H265Mp4Demuxer() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265Mp4Demuxer(const H265Mp4Demuxer&) = delete;
+  H265Mp4Demuxer(H265Mp4Demuxer&&) = delete;
+  H265Mp4Demuxer& operator=(const H265Mp4Demuxer&) = delete;
+  H265Mp4Demuxer& operator=(H265Mp4Demuxer&&) = delete;
+
+  // Whether the buffer starts like an ISO-BMFF file (with an ftyp box).
+  static bool IsMp4(const uint8_t* data, size_t length) noexcept;
+
+  // Read the box structure of the file in `data`. Returns nullptr if the
+  // file has no H265 track.
+  static std::unique_ptr<H265Mp4Demuxer> Open(const uint8_t* data,
+                                              size_t length) noexcept;
+
+  const TrackInfo& track() const { return track_; }
+  // samples, in decode order
+  const std::vector<Sample>& samples() const { return samples_; }
+  const uint8_t* GetSampleData(const Sample& sample) const {
+    return data_ + sample.offset;
+  }
+  // NAL units of a sample (offsets in the file).
+  std::vector<H265BitstreamParser::NaluIndex> GetSampleNaluIndices(
+      const Sample& sample) const noexcept;
+  // NAL units of the whole track (offsets in the file): the hvcC
+  // parameter sets, followed by the NAL units of each sample. These can
+  // be fed to H265BitstreamParser::ParseBitstream() directly.
+  std::vector<H265BitstreamParser::NaluIndex> GetNaluIndices() const noexcept;
+
+ private:
+  class BoxReader;
+  H265Mp4Demuxer(const uint8_t* data, size_t length)
+      : data_(data), length_(length) {}
+
+  const uint8_t* data_;
+  size_t length_;
+  TrackInfo track_;
+  std::vector<Sample> samples_;
+};
+
+}  // namespace h265nal
@@ -42,6 +42,9 @@ class H265NalUnitParser {
     size_t parsed_length;
     // NAL Unit checksum
     std::shared_ptr<NaluChecksum> checksum;
+    // resilient mode: the NAL unit is a slice segment between a parse
+    // failure and the next IRAP picture (its references may be corrupt)
+    bool affected = false;
 
     std::unique_ptr<struct H265NalUnitHeaderParser::NalUnitHeaderState>
         nal_unit_header;
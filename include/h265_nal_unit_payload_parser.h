@@ -44,7 +44,9 @@ class H265NalUnitPayloadParser {
     std::unique_ptr<struct H265AudParser::AudState> aud;
     std::unique_ptr<struct H265SliceSegmentLayerParser::SliceSegmentLayerState>
         slice_segment_layer;
-    std::unique_ptr<struct H265SeiMessageParser::SeiMessageState> sei;
+    std::unique_ptr<struct H265SeiRbspParser::SeiRbspState> sei_rbsp;
+    // deprecated (use sei_rbsp): the first SEI message of sei_rbsp
+    std::shared_ptr<struct H265SeiMessageParser::SeiMessageState> sei;
   };
 
   // Unpack RBSP and parse NAL unit payload state from the supplied buffer.
@@ -53,7 +55,21 @@ class H265NalUnitPayloadParser {
       struct H265BitstreamParserState* bitstream_parser_state) noexcept;
   static std::unique_ptr<NalUnitPayloadState> ParseNalUnitPayload(
       rtc::BitBuffer* bit_buffer, uint32_t nal_unit_type,
-      struct H265BitstreamParserState* bitstream_parser_state) noexcept;
+      struct H265BitstreamParserState* bitstream_parser_state,
+      ParsingOptions parsing_options) noexcept;
+  static std::unique_ptr<NalUnitPayloadState> ParseNalUnitPayload(
+      rtc::BitBuffer* bit_buffer, uint32_t nal_unit_type,
+      struct H265BitstreamParserState* bitstream_parser_state) noexcept {
+    ParsingOptions parsing_options;
+    return ParseNalUnitPayload(bit_buffer, nal_unit_type,
+                               bitstream_parser_state, parsing_options);
+  }
+
+  // Returns the name of the payload syntax structure of a NAL unit when its
+  // parsing failed, or nullptr.
+  static const char* GetFailedPayloadStructure(
+      uint32_t nal_unit_type,
+      const NalUnitPayloadState& nal_unit_payload) noexcept;
 };
 
 }  // namespace h265nal
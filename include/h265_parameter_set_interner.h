@@ -0,0 +1,81 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "h265_pps_parser.h"
+#include "h265_sps_parser.h"
+#include "h265_vps_parser.h"
+
+namespace h265nal {
+
+// An intern table for parsed parameter sets, shared by many bitstream
+// parser states (e.g. a process-wide one for a service handling many
+// streams from the same encoder configurations). Parameter sets with the
+// same RBSP share a single parsed state, so each stream only keeps a few
+// pointers. Interned states are shared across streams, and must not be
+// modified.
+//
+// The table only holds weak references: a parameter set is dropped once
+// no bitstream parser state uses it. All methods are thread-safe.
+class H265ParameterSetInterner {
+ public:
+  H265ParameterSetInterner() = default;
+  ~H265ParameterSetInterner() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265ParameterSetInterner(const H265ParameterSetInterner&) = delete;
+  H265ParameterSetInterner(H265ParameterSetInterner&&) = delete;
+  H265ParameterSetInterner& operator=(const H265ParameterSetInterner&) =
+      delete;
+  H265ParameterSetInterner& operator=(H265ParameterSetInterner&&) = delete;
+
+  // The process-wide intern table.
+  static H265ParameterSetInterner* GetGlobal() noexcept;
+
+  // Return the interned parameter set with the same RBSP as the given one
+  // (or intern the given one). Parameter sets without an RBSP are
+  // returned unchanged.
+  std::shared_ptr<struct H265VpsParser::VpsState> Intern(
+      const std::shared_ptr<struct H265VpsParser::VpsState>& vps) noexcept;
+  std::shared_ptr<struct H265SpsParser::SpsState> Intern(
+      const std::shared_ptr<struct H265SpsParser::SpsState>& sps) noexcept;
+  std::shared_ptr<struct H265PpsParser::PpsState> Intern(
+      const std::shared_ptr<struct H265PpsParser::PpsState>& pps) noexcept;
+
+  // number of live interned parameter sets
+  size_t size() const noexcept;
+  // lookups that found a live parameter set
+  uint64_t num_hits() const noexcept;
+  uint64_t num_misses() const noexcept;
+
+ private:
+  template <typename State>
+  using Table = std::unordered_map<std::string, std::weak_ptr<State>>;
+
+  template <typename State>
+  std::shared_ptr<State> InternInTable(Table<State>* table,
+                                       const std::shared_ptr<State>& state);
+  // Drop the expired entries (once the tables have doubled in size since
+  // the last time). Must be called with the mutex held.
+  void MaybePrune();
+
+  mutable std::mutex mutex_;
+  Table<struct H265VpsParser::VpsState> vps_;
+  Table<struct H265SpsParser::SpsState> sps_;
+  Table<struct H265PpsParser::PpsState> pps_;
+  // table size after the last prune
+  size_t pruned_size_ = 0;
+  uint64_t num_hits_ = 0;
+  uint64_t num_misses_ = 0;
+};
+
+}  // namespace h265nal
@@ -87,6 +87,11 @@ class H265PpsParser {
     // pps_3d_extension( )
     // pps_scc_extension( )
     uint32_t pps_extension_data_flag = 0;
+
+    // the NAL unit this was parsed from (RBSP, including the NAL unit
+    // header), as set by H265NalUnitParser (used to checkpoint the
+    // bitstream parser state)
+    std::vector<uint8_t> rbsp;
   };
 
   // Unpack RBSP and parse PPS state from the supplied buffer.
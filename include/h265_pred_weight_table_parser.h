@@ -7,8 +7,8 @@
 #include <stdio.h>
 
 #include <memory>
-#include <vector>
 
+#include "h265_common.h"
 #include "rtc_base/bit_buffer.h"
 
 namespace h265nal {
@@ -18,6 +18,10 @@ namespace h265nal {
 // standard) from an H265 NALU.
 class H265PredWeightTableParser {
  public:
+  // maximum number of entries per reference picture list
+  static constexpr uint32_t kMaxNumRefIdx =
+      h265limits::NUM_REF_IDX_ACTIVE_MINUS1_MAX + 1;
+
   // The parsed state of the PredWeightTable.
   struct PredWeightTableState {
     PredWeightTableState() = default;
@@ -36,22 +40,24 @@ class H265PredWeightTableParser {
     uint32_t ChromaArrayType = 0;
     uint32_t num_ref_idx_l0_active_minus1 = 0;
 
-    // contents
+    // contents (indexed by reference index, and by chroma component for
+    // the chroma weights). The entries of the references without explicit
+    // weights are 0.
     uint32_t luma_log2_weight_denom = 0;
     int32_t delta_chroma_log2_weight_denom = 0;
-    std::vector<uint32_t> luma_weight_l0_flag;
-    std::vector<uint32_t> chroma_weight_l0_flag;
-    std::vector<uint32_t> delta_luma_weight_l0;
-    std::vector<uint32_t> luma_offset_l0;
-    std::vector<std::vector<uint32_t>> delta_chroma_weight_l0;
-    std::vector<std::vector<uint32_t>> delta_chroma_offset_l0;
+    uint8_t luma_weight_l0_flag[kMaxNumRefIdx] = {};
+    uint8_t chroma_weight_l0_flag[kMaxNumRefIdx] = {};
+    int8_t delta_luma_weight_l0[kMaxNumRefIdx] = {};
+    int16_t luma_offset_l0[kMaxNumRefIdx] = {};
+    int8_t delta_chroma_weight_l0[kMaxNumRefIdx][2] = {};
+    int32_t delta_chroma_offset_l0[kMaxNumRefIdx][2] = {};
 
-    std::vector<uint32_t> luma_weight_l1_flag;
-    std::vector<uint32_t> chroma_weight_l1_flag;
-    std::vector<uint32_t> delta_luma_weight_l1;
-    std::vector<uint32_t> luma_offset_l1;
-    std::vector<std::vector<uint32_t>> delta_chroma_weight_l1;
-    std::vector<std::vector<uint32_t>> delta_chroma_offset_l1;
+    uint8_t luma_weight_l1_flag[kMaxNumRefIdx] = {};
+    uint8_t chroma_weight_l1_flag[kMaxNumRefIdx] = {};
+    int8_t delta_luma_weight_l1[kMaxNumRefIdx] = {};
+    int16_t luma_offset_l1[kMaxNumRefIdx] = {};
+    int8_t delta_chroma_weight_l1[kMaxNumRefIdx][2] = {};
+    int32_t delta_chroma_offset_l1[kMaxNumRefIdx][2] = {};
   };
 
   // Unpack RBSP and parse PredWeightTable state from the supplied buffer.
@@ -0,0 +1,174 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <array>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_pps_parser.h"
+#include "h265_ring_buffer.h"
+#include "h265_slice_parser.h"
+#include "h265_sps_parser.h"
+
+namespace h265nal {
+
+// A class for collecting streaming slice QP telemetry. Slices are parsed
+// only up to their QP offsets, and the QP values are aggregated per frame,
+// per slice type, and per temporal layer. The aggregation uses fixed-size
+// storage only.
+class H265QpTelemetry {
+ public:
+  // Number of frames kept in the frame histories.
+  static constexpr size_t kFrameHistorySize = 64;
+  // nuh_temporal_id_plus1 is a u(3)
+  static constexpr size_t kMaxTemporalLayers = 7;
+  // B, P, and I (Table 7-7)
+  static constexpr size_t kNumSliceTypes = 3;
+
+  // min/avg/max accumulator.
+  struct QpStats {
+    uint32_t count = 0;
+    int64_t sum = 0;
+    int32_t min = 0;
+    int32_t max = 0;
+
+    void Add(int32_t qp) noexcept {
+      min = (count == 0 || qp < min) ? qp : min;
+      max = (count == 0 || qp > max) ? qp : max;
+      sum += qp;
+      count++;
+    }
+    double Average() const noexcept {
+      return (count == 0) ? 0.0 : static_cast<double>(sum) / count;
+    }
+  };
+
+  // The QP values of a slice segment.
+  struct SliceQp {
+    uint32_t slice_type = 0;
+    uint32_t temporal_id = 0;
+    uint32_t first_slice_segment_in_pic_flag = 0;
+    uint32_t dependent_slice_segment_flag = 0;
+    // SliceQpY (Equation 7-54)
+    int32_t qp_y = 0;
+    // QpCb and QpCr (Section 8.6.1) of a coding unit without CU-level
+    // QP or chroma offsets
+    int32_t qp_cb = 0;
+    int32_t qp_cr = 0;
+  };
+
+  // A parser for the QP values of the slice segments of a stream. It keeps
+  // the parameter sets in `bitstream_parser_state` up to date, and reuses
+  // its scratch storage (the RBSP buffer and the slice segment header)
+  // across NAL units, so it does not allocate per slice.
+  class SliceQpParser {
+   public:
+    explicit SliceQpParser(H265BitstreamParserState* bitstream_parser_state)
+        : bitstream_parser_state_(bitstream_parser_state) {}
+    ~SliceQpParser() = default;
+    // disable copy ctor, move ctor, and copy&move assignments
+    SliceQpParser(const SliceQpParser&) = delete;
+    SliceQpParser(SliceQpParser&&) = delete;
+    SliceQpParser& operator=(const SliceQpParser&) = delete;
+    SliceQpParser& operator=(SliceQpParser&&) = delete;
+
+    // Parse a NAL unit (starting with its header). Parameter sets are
+    // parsed with H265NalUnitParser, and stored in the bitstream parser
+    // state. Returns true (and fills up `slice_qp`) for slice segments
+    // whose QP is known.
+    bool ParseNalUnit(const uint8_t* data, size_t length,
+                      SliceQp* slice_qp) noexcept;
+
+   private:
+    H265BitstreamParserState* const bitstream_parser_state_;
+
+    // scratch storage, reused across slices
+    std::vector<uint8_t> rbsp_buffer_;
+    H265SliceSegmentHeaderParser::SliceSegmentHeaderState
+        slice_segment_header_;
+    // QP of the last independent slice segment (inherited by the dependent
+    // ones)
+    bool has_last_slice_qp_ = false;
+    SliceQp last_slice_qp_;
+  };
+
+  // The QP values of a frame.
+  struct FrameQp {
+    // frame index, in decoding order
+    uint64_t frame_index = 0;
+    uint32_t temporal_id = 0;
+    QpStats qp_y;
+    QpStats qp_cb;
+    QpStats qp_cr;
+    // QpY per slice type (indexed by slice_type)
+    std::array<QpStats, kNumSliceTypes> qp_y_per_slice_type = {};
+  };
+
+  typedef H265RingBuffer<FrameQp, kFrameHistorySize> FrameHistory;
+
+  // The telemetry uses (and updates) the parameter sets in
+  // `bitstream_parser_state`.
+  explicit H265QpTelemetry(H265BitstreamParserState* bitstream_parser_state)
+      : slice_qp_parser_(bitstream_parser_state) {}
+  ~H265QpTelemetry() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265QpTelemetry(const H265QpTelemetry&) = delete;
+  H265QpTelemetry(H265QpTelemetry&&) = delete;
+  H265QpTelemetry& operator=(const H265QpTelemetry&) = delete;
+  H265QpTelemetry& operator=(H265QpTelemetry&&) = delete;
+
+  // Process a NAL unit (starting with its header). Parameter sets are
+  // stored in the bitstream parser state. Returns true (and fills up
+  // `slice_qp` if not nullptr) for slice segments whose QP is known.
+  bool ProcessNalUnit(const uint8_t* data, size_t length,
+                      SliceQp* slice_qp) noexcept;
+  // Process all the NAL units in an Annex B buffer.
+  void ProcessBitstream(const uint8_t* data, size_t length) noexcept;
+  // Close the frame being aggregated, if any.
+  void Flush() noexcept;
+
+  // Frames in decoding order (Get(0) is the last one).
+  const FrameHistory& frames() const { return frames_; }
+  // Frames of a given temporal layer.
+  const FrameHistory& temporal_layer_frames(uint32_t temporal_id) const {
+    return temporal_layer_frames_[temporal_id % kMaxTemporalLayers];
+  }
+  // Stream-wide QpY stats per slice type and per temporal layer.
+  const QpStats& slice_type_stats(uint32_t slice_type) const {
+    return slice_type_stats_[slice_type % kNumSliceTypes];
+  }
+  const QpStats& temporal_layer_stats(uint32_t temporal_id) const {
+    return temporal_layer_stats_[temporal_id % kMaxTemporalLayers];
+  }
+  uint64_t num_frames() const { return num_frames_; }
+
+  // Equation 7-54.
+  static int32_t GetSliceQpY(
+      const H265SliceSegmentHeaderParser::SliceSegmentHeaderState&
+          slice_segment_header,
+      const H265PpsParser::PpsState& pps) noexcept;
+  // Section 8.6.1 (Table 8-10) chroma QP derivation from a luma QP and the
+  // PPS and slice chroma offsets.
+  static int32_t GetChromaQp(int32_t qp_y, int32_t qp_offset,
+                             const H265SpsParser::SpsState& sps) noexcept;
+
+ private:
+  SliceQpParser slice_qp_parser_;
+
+  bool has_current_frame_ = false;
+  FrameQp current_frame_;
+  uint64_t num_frames_ = 0;
+
+  FrameHistory frames_;
+  std::array<FrameHistory, kMaxTemporalLayers> temporal_layer_frames_;
+  std::array<QpStats, kNumSliceTypes> slice_type_stats_ = {};
+  std::array<QpStats, kMaxTemporalLayers> temporal_layer_stats_ = {};
+};
+
+}  // namespace h265nal
@@ -0,0 +1,41 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include <array>
+
+namespace h265nal {
+
+// A fixed-size ring buffer keeping the last N pushed elements.
+template <typename T, size_t N>
+class H265RingBuffer {
+ public:
+  void Push(const T& value) noexcept {
+    data_[head_] = value;
+    head_ = (head_ + 1) % N;
+    if (size_ < N) {
+      size_++;
+    }
+  }
+  // Get the i-th most recent element (0 is the last pushed one).
+  const T& Get(size_t i) const noexcept {
+    return data_[(head_ + N - 1 - i) % N];
+  }
+  size_t size() const noexcept { return size_; }
+  static constexpr size_t capacity() noexcept { return N; }
+  void Clear() noexcept {
+    head_ = 0;
+    size_ = 0;
+  }
+
+ private:
+  std::array<T, N> data_ = {};
+  size_t head_ = 0;
+  size_t size_ = 0;
+};
+
+}  // namespace h265nal
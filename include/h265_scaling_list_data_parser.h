@@ -7,7 +7,7 @@
 #include <stdio.h>
 
 #include <memory>
-#include <vector>
+#include <mutex>
 
 #include "rtc_base/bit_buffer.h"
 
@@ -18,6 +18,33 @@ namespace h265nal {
 // of the 2018-02 standard) from an H265 NALU.
 class H265ScalingListDataParser {
  public:
+  // The ScalingFactor arrays (Section 7.4.5) derived from a scaling list
+  // data.
+  struct ScalingFactorState {
+    ScalingFactorState() = default;
+    ~ScalingFactorState() = default;
+    // disable copy ctor, move ctor, and copy&move assignments
+    ScalingFactorState(const ScalingFactorState&) = delete;
+    ScalingFactorState(ScalingFactorState&&) = delete;
+    ScalingFactorState& operator=(const ScalingFactorState&) = delete;
+    ScalingFactorState& operator=(ScalingFactorState&&) = delete;
+
+    // The (4 << sizeId)x(4 << sizeId) matrix ScalingFactor[sizeId][matrixId]
+    // in raster order, i.e. ScalingFactor[sizeId][matrixId][x][y] is at
+    // index (y * (4 << sizeId) + x). The sizeId 3 chroma matrices are the
+    // ones used when ChromaArrayType is equal to 3. Returns nullptr for
+    // invalid indices.
+    const uint8_t* getScalingFactor(uint32_t sizeId,
+                                    uint32_t matrixId) const noexcept;
+
+    // the lists the arrays were derived from
+    uint8_t ScalingList[4][6][64] = {};
+    int16_t scaling_list_dc_coef_minus8[2][6] = {};
+    uint64_t lists_hash = 0;
+    // the 4x4, 8x8, 16x16, and 32x32 matrices, each one 6 times
+    uint8_t ScalingFactor[6 * (16 + 64 + 256 + 1024)] = {};
+  };
+
   // The parsed state of the ScalingListData.
   struct ScalingListDataState {
     ScalingListDataState() = default;
@@ -32,11 +59,29 @@ class H265ScalingListDataParser {
     void fdump(FILE* outfp, int indent_level) const;
 #endif  // FDUMP_DEFINE
 
-    // contents
-    std::vector<std::vector<uint32_t>> scaling_list_pred_mode_flag;
-    std::vector<std::vector<uint32_t>> scaling_list_pred_matrix_id_delta;
-    std::vector<std::vector<int32_t>> scaling_list_dc_coef_minus8;
-    std::vector<std::vector<std::vector<uint32_t>>> ScalingList;
+    // The ScalingFactor arrays derived from the lists (Section 7.4.5).
+    // They are computed on first use, and shared by all the scaling list
+    // data states with the same lists.
+    std::shared_ptr<const ScalingFactorState> getScalingFactor()
+        const noexcept;
+    // Whether both states have the same lists (after prediction).
+    bool hasSameLists(const ScalingListDataState& other) const noexcept;
+
+    // contents (indexed by [sizeId][matrixId])
+    uint8_t scaling_list_pred_mode_flag[4][6] = {};
+    uint8_t scaling_list_pred_matrix_id_delta[4][6] = {};
+    // indexed by [sizeId - 2][matrixId] (inferred when predicted)
+    int16_t scaling_list_dc_coef_minus8[2][6] = {};
+    // the lists in up-right diagonal order (16 coefficients for sizeId 0,
+    // 64 otherwise), including the predicted ones. The sizeId 3 chroma
+    // lists (matrixId 1, 2, 4, and 5) are not coded, and are left as 0.
+    uint8_t ScalingList[4][6][64] = {};
+    // hash of the lists (ScalingList and scaling_list_dc_coef_minus8)
+    uint64_t lists_hash = 0;
+
+   private:
+    mutable std::once_flag scaling_factor_once_;
+    mutable std::shared_ptr<const ScalingFactorState> scaling_factor_;
   };
 
   // Unpack RBSP and parse ScalingListData state from the supplied buffer.
@@ -44,6 +89,12 @@ class H265ScalingListDataParser {
       const uint8_t* data, size_t length) noexcept;
   static std::unique_ptr<ScalingListDataState> ParseScalingListData(
       rtc::BitBuffer* bit_buffer) noexcept;
+
+  // The ScalingFactor arrays of the default lists (Tables 7-5 and 7-6),
+  // used when scaling_list_enabled_flag is 1 and neither the SPS nor the
+  // PPS carry scaling list data.
+  static std::shared_ptr<const ScalingFactorState>
+  GetDefaultScalingFactor() noexcept;
 };
 
 }  // namespace h265nal
@@ -0,0 +1,45 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+
+namespace h265nal {
+
+// A class for reading the out-of-band parameter sets of an RTP session
+// (the sprop-vps, sprop-sps, and sprop-pps media type parameters of
+// RFC 7798, as found in an SDP fmtp attribute) into a bitstream parser
+// state. This allows parsing the first packets of a session before the
+// in-band parameter sets show up.
+class H265SdpParser {
+ public:
+  // Decode a base64 string (Section 4 of RFC 4648). Padding is optional.
+  static bool DecodeBase64(const std::string& value,
+                           std::vector<uint8_t>* data) noexcept;
+
+  // Decode a sprop-vps, sprop-sps, or sprop-pps value: a comma-separated
+  // list of base64-encoded NAL units (Section 7.1 of RFC 7798).
+  static bool DecodeSpropParameterSets(
+      const std::string& value,
+      std::vector<std::vector<uint8_t>>* nal_units) noexcept;
+
+  // Parse the parameter sets of an SDP fmtp attribute (either the full
+  // "a=fmtp:<pt> <parameters>" line or just its semicolon-separated
+  // parameters) into `bitstream_parser_state`. The VPSs are parsed first,
+  // then the SPSs, and then the PPSs. Returns the number of parameter sets
+  // loaded, or -1 (leaving `bitstream_parser_state` untouched) if a sprop
+  // value is malformed or does not parse.
+  static int ParseFmtp(const std::string& fmtp,
+                       struct H265BitstreamParserState* bitstream_parser_state,
+                       ParsingOptions parsing_options) noexcept;
+};
+
+}  // namespace h265nal
@@ -6,9 +6,15 @@
 
 #include <stdio.h>
 
+#include <array>
 #include <memory>
+#include <set>
+#include <utility>
 #include <vector>
 
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_sps_parser.h"
 #include "rtc_base/bit_buffer.h"
 
 namespace h265nal {
@@ -86,6 +92,18 @@ enum class SeiType {
 // classes for parsing out a supplemental enhancement information (SEI) data
 // from an H265 NALU.
 
+// A view of the bytes of an SEI payload. The offset is counted in RBSP
+// bytes from the start of the parsed buffer (which includes the NAL unit
+// header when parsing full NAL units).
+struct H265SeiPayloadView {
+  size_t offset = 0;
+  size_t length = 0;
+
+  // Copy the viewed bytes out of the (escaped) buffer that was parsed.
+  bool Materialize(const uint8_t* data, size_t data_length,
+                   std::vector<uint8_t>* out) const noexcept;
+};
+
 class H265SeiPayloadParser {
  public:
   H265SeiPayloadParser() = default;
@@ -114,6 +132,9 @@ class H265SeiPayloadParser {
 
 class H265SeiUserDataRegisteredItuTT35Parser : public H265SeiPayloadParser {
  public:
+  explicit H265SeiUserDataRegisteredItuTT35Parser(bool payload_as_view = false)
+      : payload_as_view_(payload_as_view) {}
+
   struct H265SeiUserDataRegisteredItuTT35State
       : public H265SeiPayloadParser::H265SeiPayloadState {
     H265SeiUserDataRegisteredItuTT35State() = default;
@@ -133,14 +154,22 @@ class H265SeiUserDataRegisteredItuTT35Parser : public H265SeiPayloadParser {
 #endif  // FDUMP_DEFINE
     uint8_t itu_t_t35_country_code = 0;
     uint8_t itu_t_t35_country_code_extension_byte = 0;
+    // payload bytes (only copied when not parsing the payload as a view)
     std::vector<uint8_t> payload;
+    H265SeiPayloadView payload_view;
   };
   virtual std::unique_ptr<H265SeiPayloadState> parse_payload(
       rtc::BitBuffer* bit_buffer, uint32_t payload_size);
+
+ private:
+  const bool payload_as_view_;
 };
 
 class H265SeiUserDataUnregisteredParser : public H265SeiPayloadParser {
  public:
+  explicit H265SeiUserDataUnregisteredParser(bool payload_as_view = false)
+      : payload_as_view_(payload_as_view) {}
+
   struct H265SeiUserDataUnregisteredState
       : public H265SeiPayloadParser::H265SeiPayloadState {
     H265SeiUserDataUnregisteredState() = default;
@@ -160,7 +189,274 @@ class H265SeiUserDataUnregisteredParser : public H265SeiPayloadParser {
 #endif  // FDUMP_DEFINE
     uint64_t uuid_iso_iec_11578_1 = 0;
     uint64_t uuid_iso_iec_11578_2 = 0;
+    // payload bytes (only copied when not parsing the payload as a view)
     std::vector<uint8_t> payload;
+    H265SeiPayloadView payload_view;
+  };
+  virtual std::unique_ptr<H265SeiPayloadState> parse_payload(
+      rtc::BitBuffer* bit_buffer, uint32_t payload_size);
+
+ private:
+  const bool payload_as_view_;
+};
+
+class H265SeiBufferingPeriodParser : public H265SeiPayloadParser {
+ public:
+  // The buffering period syntax depends on the HRD parameters of the SPS
+  // it refers to, which is looked up in the bitstream parser state.
+  explicit H265SeiBufferingPeriodParser(
+      const H265BitstreamParserState* bitstream_parser_state)
+      : bitstream_parser_state_(bitstream_parser_state) {}
+  struct H265SeiBufferingPeriodState
+      : public H265SeiPayloadParser::H265SeiPayloadState {
+    H265SeiBufferingPeriodState() = default;
+    virtual ~H265SeiBufferingPeriodState() = default;
+    // disable copy ctor, move ctor, and copy&move assignments
+    H265SeiBufferingPeriodState(const H265SeiBufferingPeriodState&) = delete;
+    H265SeiBufferingPeriodState(H265SeiBufferingPeriodState&&) = delete;
+    H265SeiBufferingPeriodState& operator=(
+        const H265SeiBufferingPeriodState&) = delete;
+    H265SeiBufferingPeriodState& operator=(H265SeiBufferingPeriodState&&) =
+        delete;
+
+#ifdef FDUMP_DEFINE
+    virtual void fdump(FILE* outfp, int indent_level) const;
+#endif  // FDUMP_DEFINE
+    uint32_t bp_seq_parameter_set_id = 0;
+    uint32_t irap_cpb_params_present_flag = 0;
+    uint32_t cpb_delay_offset = 0;
+    uint32_t dpb_delay_offset = 0;
+    uint32_t concatenation_flag = 0;
+    uint32_t au_cpb_removal_delay_delta_minus1 = 0;
+    std::vector<uint32_t> nal_initial_cpb_removal_delay;
+    std::vector<uint32_t> nal_initial_cpb_removal_offset;
+    std::vector<uint32_t> nal_initial_alt_cpb_removal_delay;
+    std::vector<uint32_t> nal_initial_alt_cpb_removal_offset;
+    std::vector<uint32_t> vcl_initial_cpb_removal_delay;
+    std::vector<uint32_t> vcl_initial_cpb_removal_offset;
+    std::vector<uint32_t> vcl_initial_alt_cpb_removal_delay;
+    std::vector<uint32_t> vcl_initial_alt_cpb_removal_offset;
+    uint32_t use_alt_cpb_params_flag = 0;
+  };
+  virtual std::unique_ptr<H265SeiPayloadState> parse_payload(
+      rtc::BitBuffer* bit_buffer, uint32_t payload_size);
+
+ private:
+  const H265BitstreamParserState* const bitstream_parser_state_;
+};
+
+class H265SeiPicTimingParser : public H265SeiPayloadParser {
+ public:
+  // The picture timing syntax depends on the VUI and HRD parameters of the
+  // active SPS.
+  explicit H265SeiPicTimingParser(const H265SpsParser::SpsState* sps)
+      : sps_(sps) {}
+  struct H265SeiPicTimingState
+      : public H265SeiPayloadParser::H265SeiPayloadState {
+    H265SeiPicTimingState() = default;
+    virtual ~H265SeiPicTimingState() = default;
+    // disable copy ctor, move ctor, and copy&move assignments
+    H265SeiPicTimingState(const H265SeiPicTimingState&) = delete;
+    H265SeiPicTimingState(H265SeiPicTimingState&&) = delete;
+    H265SeiPicTimingState& operator=(const H265SeiPicTimingState&) = delete;
+    H265SeiPicTimingState& operator=(H265SeiPicTimingState&&) = delete;
+
+#ifdef FDUMP_DEFINE
+    virtual void fdump(FILE* outfp, int indent_level) const;
+#endif  // FDUMP_DEFINE
+    uint32_t pic_struct = 0;
+    uint32_t source_scan_type = 0;
+    uint32_t duplicate_flag = 0;
+    uint32_t au_cpb_removal_delay_minus1 = 0;
+    uint32_t pic_dpb_output_delay = 0;
+    uint32_t pic_dpb_output_du_delay = 0;
+    uint32_t num_decoding_units_minus1 = 0;
+    uint32_t du_common_cpb_removal_delay_flag = 0;
+    uint32_t du_common_cpb_removal_delay_increment_minus1 = 0;
+    std::vector<uint32_t> num_nalus_in_du_minus1;
+    std::vector<uint32_t> du_cpb_removal_delay_increment_minus1;
+  };
+  virtual std::unique_ptr<H265SeiPayloadState> parse_payload(
+      rtc::BitBuffer* bit_buffer, uint32_t payload_size);
+
+ private:
+  const H265SpsParser::SpsState* const sps_;
+};
+
+class H265SeiTimeCodeParser : public H265SeiPayloadParser {
+ public:
+  struct H265SeiTimeCodeState
+      : public H265SeiPayloadParser::H265SeiPayloadState {
+    H265SeiTimeCodeState() = default;
+    virtual ~H265SeiTimeCodeState() = default;
+    // disable copy ctor, move ctor, and copy&move assignments
+    H265SeiTimeCodeState(const H265SeiTimeCodeState&) = delete;
+    H265SeiTimeCodeState(H265SeiTimeCodeState&&) = delete;
+    H265SeiTimeCodeState& operator=(const H265SeiTimeCodeState&) = delete;
+    H265SeiTimeCodeState& operator=(H265SeiTimeCodeState&&) = delete;
+
+#ifdef FDUMP_DEFINE
+    virtual void fdump(FILE* outfp, int indent_level) const;
+#endif  // FDUMP_DEFINE
+    uint32_t num_clock_ts = 0;
+    std::vector<uint32_t> clock_timestamp_flag;
+    std::vector<uint32_t> units_field_based_flag;
+    std::vector<uint32_t> counting_type;
+    std::vector<uint32_t> full_timestamp_flag;
+    std::vector<uint32_t> discontinuity_flag;
+    std::vector<uint32_t> cnt_dropped_flag;
+    std::vector<uint32_t> n_frames;
+    std::vector<uint32_t> seconds_flag;
+    std::vector<uint32_t> seconds_value;
+    std::vector<uint32_t> minutes_flag;
+    std::vector<uint32_t> minutes_value;
+    std::vector<uint32_t> hours_flag;
+    std::vector<uint32_t> hours_value;
+    std::vector<uint32_t> time_offset_length;
+    std::vector<int32_t> time_offset_value;
+  };
+  virtual std::unique_ptr<H265SeiPayloadState> parse_payload(
+      rtc::BitBuffer* bit_buffer, uint32_t payload_size);
+};
+
+class H265SeiMasteringDisplayColourVolumeParser : public H265SeiPayloadParser {
+ public:
+  struct H265SeiMasteringDisplayColourVolumeState
+      : public H265SeiPayloadParser::H265SeiPayloadState {
+    H265SeiMasteringDisplayColourVolumeState() = default;
+    virtual ~H265SeiMasteringDisplayColourVolumeState() = default;
+    // disable copy ctor, move ctor, and copy&move assignments
+    H265SeiMasteringDisplayColourVolumeState(
+        const H265SeiMasteringDisplayColourVolumeState&) = delete;
+    H265SeiMasteringDisplayColourVolumeState(
+        H265SeiMasteringDisplayColourVolumeState&&) = delete;
+    H265SeiMasteringDisplayColourVolumeState& operator=(
+        const H265SeiMasteringDisplayColourVolumeState&) = delete;
+    H265SeiMasteringDisplayColourVolumeState& operator=(
+        H265SeiMasteringDisplayColourVolumeState&&) = delete;
+
+#ifdef FDUMP_DEFINE
+    virtual void fdump(FILE* outfp, int indent_level) const;
+#endif  // FDUMP_DEFINE
+    std::array<uint32_t, 3> display_primaries_x = {};
+    std::array<uint32_t, 3> display_primaries_y = {};
+    uint32_t white_point_x = 0;
+    uint32_t white_point_y = 0;
+    uint32_t max_display_mastering_luminance = 0;
+    uint32_t min_display_mastering_luminance = 0;
+  };
+  virtual std::unique_ptr<H265SeiPayloadState> parse_payload(
+      rtc::BitBuffer* bit_buffer, uint32_t payload_size);
+};
+
+class H265SeiContentLightLevelInfoParser : public H265SeiPayloadParser {
+ public:
+  struct H265SeiContentLightLevelInfoState
+      : public H265SeiPayloadParser::H265SeiPayloadState {
+    H265SeiContentLightLevelInfoState() = default;
+    virtual ~H265SeiContentLightLevelInfoState() = default;
+    // disable copy ctor, move ctor, and copy&move assignments
+    H265SeiContentLightLevelInfoState(
+        const H265SeiContentLightLevelInfoState&) = delete;
+    H265SeiContentLightLevelInfoState(H265SeiContentLightLevelInfoState&&) =
+        delete;
+    H265SeiContentLightLevelInfoState& operator=(
+        const H265SeiContentLightLevelInfoState&) = delete;
+    H265SeiContentLightLevelInfoState& operator=(
+        H265SeiContentLightLevelInfoState&&) = delete;
+
+#ifdef FDUMP_DEFINE
+    virtual void fdump(FILE* outfp, int indent_level) const;
+#endif  // FDUMP_DEFINE
+    uint32_t max_content_light_level = 0;
+    uint32_t max_pic_average_light_level = 0;
+  };
+  virtual std::unique_ptr<H265SeiPayloadState> parse_payload(
+      rtc::BitBuffer* bit_buffer, uint32_t payload_size);
+};
+
+class H265SeiTemporalMotionConstrainedTileSetsParser
+    : public H265SeiPayloadParser {
+ public:
+  struct H265SeiTemporalMotionConstrainedTileSetsState
+      : public H265SeiPayloadParser::H265SeiPayloadState {
+    H265SeiTemporalMotionConstrainedTileSetsState() = default;
+    virtual ~H265SeiTemporalMotionConstrainedTileSetsState() = default;
+    // disable copy ctor, move ctor, and copy&move assignments
+    H265SeiTemporalMotionConstrainedTileSetsState(
+        const H265SeiTemporalMotionConstrainedTileSetsState&) = delete;
+    H265SeiTemporalMotionConstrainedTileSetsState(
+        H265SeiTemporalMotionConstrainedTileSetsState&&) = delete;
+    H265SeiTemporalMotionConstrainedTileSetsState& operator=(
+        const H265SeiTemporalMotionConstrainedTileSetsState&) = delete;
+    H265SeiTemporalMotionConstrainedTileSetsState& operator=(
+        H265SeiTemporalMotionConstrainedTileSetsState&&) = delete;
+
+#ifdef FDUMP_DEFINE
+    virtual void fdump(FILE* outfp, int indent_level) const;
+#endif  // FDUMP_DEFINE
+    uint32_t mc_all_tiles_exact_sample_value_match_flag = 0;
+    uint32_t each_tile_one_tile_set_flag = 0;
+    uint32_t limited_tile_set_display_flag = 0;
+    uint32_t num_sets_in_message_minus1 = 0;
+    // per tile set (unset values are kept as 0 so all the vectors have
+    // num_sets_in_message_minus1 + 1 elements)
+    std::vector<uint32_t> mcts_id;
+    std::vector<uint32_t> display_tile_set_flag;
+    std::vector<uint32_t> num_tile_rects_in_set_minus1;
+    std::vector<std::vector<uint32_t>> top_left_tile_index;
+    std::vector<std::vector<uint32_t>> bottom_right_tile_index;
+    std::vector<uint32_t> mc_exact_sample_value_match_flag;
+    std::vector<uint32_t> mcts_tier_level_idc_present_flag;
+    std::vector<uint32_t> mcts_tier_flag;
+    std::vector<uint32_t> mcts_level_idc;
+    // each_tile_one_tile_set_flag case
+    uint32_t max_mcts_tier_level_idc_present_flag = 0;
+    uint32_t max_mcts_tier_flag = 0;
+    uint32_t max_mcts_level_idc = 0;
+  };
+  virtual std::unique_ptr<H265SeiPayloadState> parse_payload(
+      rtc::BitBuffer* bit_buffer, uint32_t payload_size);
+};
+
+class H265SeiMctsExtractionInfoSetsParser : public H265SeiPayloadParser {
+ public:
+  struct H265SeiMctsExtractionInfoSetsState
+      : public H265SeiPayloadParser::H265SeiPayloadState {
+    H265SeiMctsExtractionInfoSetsState() = default;
+    virtual ~H265SeiMctsExtractionInfoSetsState() = default;
+    // disable copy ctor, move ctor, and copy&move assignments
+    H265SeiMctsExtractionInfoSetsState(
+        const H265SeiMctsExtractionInfoSetsState&) = delete;
+    H265SeiMctsExtractionInfoSetsState(H265SeiMctsExtractionInfoSetsState&&) =
+        delete;
+    H265SeiMctsExtractionInfoSetsState& operator=(
+        const H265SeiMctsExtractionInfoSetsState&) = delete;
+    H265SeiMctsExtractionInfoSetsState& operator=(
+        H265SeiMctsExtractionInfoSetsState&&) = delete;
+
+#ifdef FDUMP_DEFINE
+    virtual void fdump(FILE* outfp, int indent_level) const;
+#endif  // FDUMP_DEFINE
+    uint32_t num_info_sets_minus1 = 0;
+    // per extraction information set
+    std::vector<uint32_t> num_mcts_sets_minus1;
+    std::vector<std::vector<uint32_t>> num_mcts_in_set_minus1;
+    std::vector<std::vector<std::vector<uint32_t>>> idx_of_mcts_in_set;
+    std::vector<uint32_t> slice_reordering_enabled_flag;
+    std::vector<uint32_t> num_slice_segments_minus1;
+    std::vector<std::vector<uint32_t>> output_slice_segment_address;
+    std::vector<uint32_t> num_vps_in_info_set_minus1;
+    std::vector<std::vector<uint32_t>> vps_rbsp_data_length;
+    std::vector<uint32_t> num_sps_in_info_set_minus1;
+    std::vector<std::vector<uint32_t>> sps_rbsp_data_length;
+    std::vector<uint32_t> num_pps_in_info_set_minus1;
+    std::vector<std::vector<uint32_t>> pps_nuh_temporal_id_plus1;
+    std::vector<std::vector<uint32_t>> pps_rbsp_data_length;
+    // the replacement parameter sets (RBSPs, without NAL unit header)
+    std::vector<std::vector<std::vector<uint8_t>>> vps_rbsp_data_byte;
+    std::vector<std::vector<std::vector<uint8_t>>> sps_rbsp_data_byte;
+    std::vector<std::vector<std::vector<uint8_t>>> pps_rbsp_data_byte;
   };
   virtual std::unique_ptr<H265SeiPayloadState> parse_payload(
       rtc::BitBuffer* bit_buffer, uint32_t payload_size);
@@ -168,6 +464,9 @@ class H265SeiUserDataUnregisteredParser : public H265SeiPayloadParser {
 
 class H265SeiUnknownParser : public H265SeiPayloadParser {
  public:
+  explicit H265SeiUnknownParser(bool payload_as_view = false)
+      : payload_as_view_(payload_as_view) {}
+
   struct H265SeiUnknownState
       : public H265SeiPayloadParser::H265SeiPayloadState {
     H265SeiUnknownState() = default;
@@ -181,10 +480,15 @@ class H265SeiUnknownParser : public H265SeiPayloadParser {
 #ifdef FDUMP_DEFINE
     virtual void fdump(FILE* outfp, int indent_level) const;
 #endif  // FDUMP_DEFINE
+    // payload bytes (only copied when not parsing the payload as a view)
     std::vector<uint8_t> payload;
+    H265SeiPayloadView payload_view;
   };
   virtual std::unique_ptr<H265SeiPayloadState> parse_payload(
       rtc::BitBuffer* bit_buffer, uint32_t payload_size);
+
+ private:
+  const bool payload_as_view_;
 };
 
 class H265SeiMessageParser {
@@ -208,10 +512,155 @@ class H265SeiMessageParser {
     std::unique_ptr<H265SeiPayloadParser::H265SeiPayloadState> payload_state;
   };
 
+  // Parse the sei_payload() of a message with known type and size.
+  // The messages that depend on the active parameter sets (buffering_period,
+  // pic_timing) are only parsed when `bitstream_parser_state` is provided.
+  // Parsing them never changes the active SPS (only slice segments
+  // activate it).
+  static std::unique_ptr<H265SeiPayloadParser::H265SeiPayloadState>
+  ParseSeiPayload(rtc::BitBuffer* bit_buffer, uint32_t payload_type,
+                  uint32_t payload_size,
+                  H265BitstreamParserState* bitstream_parser_state,
+                  ParsingOptions parsing_options) noexcept {
+    return ParseSeiPayload(bit_buffer, payload_type, payload_size,
+                           bitstream_parser_state, nullptr, parsing_options);
+  }
+  // Same as above, but a pic_timing message uses `sps` (e.g. the SPS
+  // referred to by a preceding buffering_period message) instead of the
+  // active SPS, unless it is nullptr.
+  static std::unique_ptr<H265SeiPayloadParser::H265SeiPayloadState>
+  ParseSeiPayload(rtc::BitBuffer* bit_buffer, uint32_t payload_type,
+                  uint32_t payload_size,
+                  H265BitstreamParserState* bitstream_parser_state,
+                  const struct H265SpsParser::SpsState* sps,
+                  ParsingOptions parsing_options) noexcept;
+  static std::unique_ptr<H265SeiPayloadParser::H265SeiPayloadState>
+  ParseSeiPayload(rtc::BitBuffer* bit_buffer, uint32_t payload_type,
+                  uint32_t payload_size,
+                  ParsingOptions parsing_options) noexcept {
+    return ParseSeiPayload(bit_buffer, payload_type, payload_size, nullptr,
+                           parsing_options);
+  }
+
+  static std::unique_ptr<H265SeiMessageParser::SeiMessageState> ParseSei(
+      rtc::BitBuffer* bit_buffer,
+      H265BitstreamParserState* bitstream_parser_state,
+      ParsingOptions parsing_options) noexcept;
+  static std::unique_ptr<H265SeiMessageParser::SeiMessageState> ParseSei(
+      const uint8_t* data, size_t length,
+      H265BitstreamParserState* bitstream_parser_state,
+      ParsingOptions parsing_options) noexcept;
+  static std::unique_ptr<H265SeiMessageParser::SeiMessageState> ParseSei(
+      rtc::BitBuffer* bit_buffer, ParsingOptions parsing_options) noexcept {
+    return ParseSei(bit_buffer, nullptr, parsing_options);
+  }
   static std::unique_ptr<H265SeiMessageParser::SeiMessageState> ParseSei(
-      rtc::BitBuffer* bit_buffer) noexcept;
+      const uint8_t* data, size_t length,
+      ParsingOptions parsing_options) noexcept {
+    return ParseSei(data, length, nullptr, parsing_options);
+  }
   static std::unique_ptr<H265SeiMessageParser::SeiMessageState> ParseSei(
-      const uint8_t* data, size_t length) noexcept;
+      rtc::BitBuffer* bit_buffer) noexcept {
+    ParsingOptions parsing_options;
+    return ParseSei(bit_buffer, parsing_options);
+  }
+  static std::unique_ptr<H265SeiMessageParser::SeiMessageState> ParseSei(
+      const uint8_t* data, size_t length) noexcept {
+    ParsingOptions parsing_options;
+    return ParseSei(data, length, parsing_options);
+  }
+};
+
+// A filter selecting which SEI messages in an sei_rbsp() get parsed.
+// Messages that do not match the filter are skipped using their payload
+// size, without reading their payload bytes.
+class H265SeiMessageFilter {
+ public:
+  H265SeiMessageFilter() = default;
+  ~H265SeiMessageFilter() = default;
+
+  // Select all messages of a given payloadType.
+  void AddPayloadType(SeiType payload_type) noexcept {
+    payload_types_.insert(static_cast<uint32_t>(payload_type));
+  }
+  // Select the user_data_unregistered messages with a given UUID.
+  void AddUuid(uint64_t uuid_iso_iec_11578_1,
+               uint64_t uuid_iso_iec_11578_2) noexcept {
+    uuids_.insert(std::make_pair(uuid_iso_iec_11578_1, uuid_iso_iec_11578_2));
+  }
+
+  bool MatchesPayloadType(uint32_t payload_type) const noexcept {
+    return payload_types_.find(payload_type) != payload_types_.end();
+  }
+  bool HasUuids() const noexcept { return !uuids_.empty(); }
+  bool MatchesUuid(uint64_t uuid_iso_iec_11578_1,
+                   uint64_t uuid_iso_iec_11578_2) const noexcept {
+    return uuids_.find(std::make_pair(uuid_iso_iec_11578_1,
+                                      uuid_iso_iec_11578_2)) != uuids_.end();
+  }
+
+ private:
+  std::set<uint32_t> payload_types_;
+  std::set<std::pair<uint64_t, uint64_t>> uuids_;
+};
+
+// A class for parsing out a full SEI RBSP (sei_rbsp()), which carries
+// one or more SEI messages.
+class H265SeiRbspParser {
+ public:
+  // The parsed state of the SEI RBSP.
+  struct SeiRbspState {
+    SeiRbspState() = default;
+    ~SeiRbspState() = default;
+    // disable copy ctor, move ctor, and copy&move assignments
+    SeiRbspState(const SeiRbspState&) = delete;
+    SeiRbspState(SeiRbspState&&) = delete;
+    SeiRbspState& operator=(const SeiRbspState&) = delete;
+    SeiRbspState& operator=(SeiRbspState&&) = delete;
+
+#ifdef FDUMP_DEFINE
+    void fdump(FILE* outfp, int indent_level) const;
+#endif  // FDUMP_DEFINE
+
+    // parsed (i.e. not filtered out) SEI messages
+    std::vector<std::shared_ptr<struct H265SeiMessageParser::SeiMessageState>>
+        sei_message;
+    // number of SEI messages skipped by the filter
+    uint32_t num_skipped_sei_messages = 0;
+  };
+
+  // Unpack RBSP and parse SEI RBSP state from the supplied buffer. Only the
+  // messages selected by `filter` are parsed (all of them when `filter`
+  // is nullptr).
+  static std::unique_ptr<SeiRbspState> ParseSeiRbsp(
+      const uint8_t* data, size_t length,
+      H265BitstreamParserState* bitstream_parser_state,
+      ParsingOptions parsing_options,
+      const H265SeiMessageFilter* filter) noexcept;
+  static std::unique_ptr<SeiRbspState> ParseSeiRbsp(
+      rtc::BitBuffer* bit_buffer,
+      H265BitstreamParserState* bitstream_parser_state,
+      ParsingOptions parsing_options,
+      const H265SeiMessageFilter* filter) noexcept;
+  static std::unique_ptr<SeiRbspState> ParseSeiRbsp(
+      const uint8_t* data, size_t length, ParsingOptions parsing_options,
+      const H265SeiMessageFilter* filter) noexcept {
+    return ParseSeiRbsp(data, length, nullptr, parsing_options, filter);
+  }
+  static std::unique_ptr<SeiRbspState> ParseSeiRbsp(
+      rtc::BitBuffer* bit_buffer, ParsingOptions parsing_options,
+      const H265SeiMessageFilter* filter) noexcept {
+    return ParseSeiRbsp(bit_buffer, nullptr, parsing_options, filter);
+  }
+  static std::unique_ptr<SeiRbspState> ParseSeiRbsp(
+      const uint8_t* data, size_t length) noexcept {
+    ParsingOptions parsing_options;
+    return ParseSeiRbsp(data, length, parsing_options, nullptr);
+  }
+  static std::unique_ptr<SeiRbspState> ParseSeiRbsp(
+      rtc::BitBuffer* bit_buffer, ParsingOptions parsing_options) noexcept {
+    return ParseSeiRbsp(bit_buffer, parsing_options, nullptr);
+  }
 };
 
 }  // namespace h265nal
@@ -0,0 +1,74 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_pps_parser.h"
+#include "h265_sps_parser.h"
+
+namespace h265nal {
+
+// The parts of the slice segment header syntax that only depend on the
+// (SPS, PPS) pair referenced by a slice: which optional fields are present,
+// and the lengths of the u(v) fields. It is computed once per pair, so
+// that parsing a slice segment header only reads bits.
+//
+// Plans are cached per PPS id in the bitstream parser state, like
+// H265TileGeometry, and keep a reference to the parameter sets they were
+// computed from. A cached plan is recomputed as soon as either parameter
+// set is replaced (including when it is re-sent unchanged). Parameter
+// sets must not be modified once stored in the state.
+struct H265SliceHeaderParsePlan {
+  H265SliceHeaderParsePlan() = default;
+  ~H265SliceHeaderParsePlan() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265SliceHeaderParsePlan(const H265SliceHeaderParsePlan&) = delete;
+  H265SliceHeaderParsePlan(H265SliceHeaderParsePlan&&) = delete;
+  H265SliceHeaderParsePlan& operator=(const H265SliceHeaderParsePlan&) =
+      delete;
+  H265SliceHeaderParsePlan& operator=(H265SliceHeaderParsePlan&&) = delete;
+
+  // Compute the plan for a parameter-set pair.
+  static std::shared_ptr<const H265SliceHeaderParsePlan> Create(
+      const std::shared_ptr<struct H265SpsParser::SpsState>& sps,
+      const std::shared_ptr<struct H265PpsParser::PpsState>& pps) noexcept;
+  // Get the plan for a parameter-set pair from the cache in
+  // `bitstream_parser_state` (computing it if needed). The plan is shared
+  // with the cache, so it stays valid after the cache replaces it.
+  // Returns nullptr if the PPS id is out of range.
+  static std::shared_ptr<const H265SliceHeaderParsePlan> Get(
+      struct H265BitstreamParserState* bitstream_parser_state,
+      uint32_t pps_id,
+      const std::shared_ptr<struct H265SpsParser::SpsState>& sps,
+      const std::shared_ptr<struct H265PpsParser::PpsState>& pps) noexcept;
+
+  // the parameter sets the plan was computed from
+  std::shared_ptr<struct H265SpsParser::SpsState> sps;
+  std::shared_ptr<struct H265PpsParser::PpsState> pps;
+
+  // PicSizeInCtbsY, and the length of slice_segment_address
+  // (Ceil(Log2(PicSizeInCtbsY)))
+  uint32_t PicSizeInCtbsY = 0;
+  uint32_t slice_segment_address_len = 0;
+  // length of slice_pic_order_cnt_lsb and poc_lsb_lt[i]
+  uint32_t slice_pic_order_cnt_lsb_len = 0;
+  // length of short_term_ref_pic_set_idx
+  // (Ceil(Log2(num_short_term_ref_pic_sets)))
+  uint32_t short_term_ref_pic_set_idx_len = 0;
+  // length of lt_idx_sps[i] (Ceil(Log2(num_long_term_ref_pics_sps)))
+  uint32_t lt_idx_sps_len = 0;
+  // maximum number of pictures in an st_ref_pic_set() (if available)
+  bool max_num_pics_valid = false;
+  uint32_t max_num_pics = 0;
+  // whether num_entry_point_offsets is present, and its maximum value
+  bool entry_points_present = false;
+  uint32_t max_num_entry_point_offsets = 0;
+};
+
+}  // namespace h265nal
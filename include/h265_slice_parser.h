@@ -35,38 +35,27 @@ class H265SliceSegmentHeaderParser {
     SliceSegmentHeaderState& operator=(const SliceSegmentHeaderState&) = delete;
     SliceSegmentHeaderState& operator=(SliceSegmentHeaderState&&) = delete;
 
+    // Set all the fields back to their default values, so that the state
+    // can be reused to parse another slice segment header.
+    void Reset() noexcept;
+
 #ifdef FDUMP_DEFINE
     void fdump(FILE* outfp, int indent_level) const;
 #endif  // FDUMP_DEFINE
 
+    // Values derived from the referenced parameter sets.
+    uint32_t getChromaArrayType() const noexcept;
+    uint32_t getMotionVectorResolutionControlIdc() const noexcept;
+    uint32_t getPpsSliceActQpOffsetsPresentFlag() const noexcept;
+
     // input parameters
     uint32_t nal_unit_type = 0;
-    uint32_t dependent_slice_segments_enabled_flag = 0;
-    uint32_t num_extra_slice_header_bits = 0;
-    uint32_t output_flag_present_flag = 0;
-    uint32_t separate_colour_plane_flag = 0;
-    uint32_t log2_max_pic_order_cnt_lsb_minus4 = 0;
-    uint32_t num_short_term_ref_pic_sets = 0;
-    uint32_t long_term_ref_pics_present_flag = 0;
-    uint32_t num_long_term_ref_pics_sps = 0;
-    uint32_t sps_temporal_mvp_enabled_flag = 0;
-    uint32_t sample_adaptive_offset_enabled_flag = 0;
-    uint32_t ChromaArrayType = 0;
-    uint32_t chroma_format_idc = 0;
-    uint32_t lists_modification_present_flag = 0;
     uint32_t NumPicTotalCurr = 0;
-    uint32_t cabac_init_present_flag = 0;
-    uint32_t weighted_pred_flag = 0;
-    uint32_t weighted_bipred_flag = 0;
-    uint32_t motion_vector_resolution_control_idc = 0;
-    uint32_t pps_slice_chroma_qp_offsets_present_flag = 0;
-    uint32_t pps_slice_act_qp_offsets_present_flag = 0;
-    uint32_t chroma_qp_offset_list_enabled_flag = 0;
-    uint32_t deblocking_filter_override_enabled_flag = 0;
-    uint32_t pps_loop_filter_across_slices_enabled_flag = 0;
-    uint32_t tiles_enabled_flag = 0;
-    uint32_t entropy_coding_sync_enabled_flag = 0;
-    uint32_t slice_segment_header_extension_present_flag = 0;
+    // The parameter sets active when the slice segment header was parsed.
+    // They are shared with the bitstream parser state (and stay valid if
+    // the state later replaces them), instead of copying their fields.
+    std::shared_ptr<const struct H265SpsParser::SpsState> sps;
+    std::shared_ptr<const struct H265PpsParser::PpsState> pps;
 
     // contents
     uint32_t first_slice_segment_in_pic_flag = 0;
@@ -123,12 +112,6 @@ class H265SliceSegmentHeaderParser {
     std::vector<uint32_t> entry_point_offset_minus1;
     uint32_t slice_segment_header_extension_length = 0;
     std::vector<uint32_t> slice_segment_header_extension_data_byte;
-
-    // Limits Check
-    bool isValidNumEntryPointOffsets(
-        uint32_t num_entry_point_offsets_value,
-        std::shared_ptr<struct H265SpsParser::SpsState> sps,
-        std::shared_ptr<struct H265PpsParser::PpsState> pps) noexcept;
   };
 
   // Unpack RBSP and parse slice state from the supplied buffer.
@@ -137,7 +120,41 @@ class H265SliceSegmentHeaderParser {
       struct H265BitstreamParserState* bitstream_parser_state) noexcept;
   static std::unique_ptr<SliceSegmentHeaderState> ParseSliceSegmentHeader(
       rtc::BitBuffer* bit_buffer, uint32_t nal_unit_type,
-      struct H265BitstreamParserState* bitstream_parser_state) noexcept;
+      struct H265BitstreamParserState* bitstream_parser_state) noexcept {
+    return ParseSliceSegmentHeader(bit_buffer, nal_unit_type,
+                                   bitstream_parser_state, false);
+  }
+  // Parse the slice segment header, optionally stopping right after the
+  // QP-related fields (slice_qp_delta and the slice QP offsets) and the
+  // in-loop filter fields of an independent slice segment, i.e., before the
+  // entry points and the header extension.
+  static std::unique_ptr<SliceSegmentHeaderState> ParseSliceSegmentHeader(
+      rtc::BitBuffer* bit_buffer, uint32_t nal_unit_type,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      bool stop_after_qp_offsets) noexcept;
+  // Same as above, but parse into the caller-owned `slice_segment_header`,
+  // which must be in its default state (see Reset()). Returns false on
+  // error (leaving `slice_segment_header` partially filled).
+  static bool ParseSliceSegmentHeader(
+      rtc::BitBuffer* bit_buffer, uint32_t nal_unit_type,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      bool stop_after_qp_offsets,
+      SliceSegmentHeaderState* slice_segment_header) noexcept;
+  // Unpack RBSP and parse the slice segment header up to its QP offsets
+  // (see above) from the supplied NAL unit payload, unescaping only its
+  // first bytes unless the header is longer. `rbsp_buffer` is a scratch
+  // buffer that can be reused across calls.
+  static std::unique_ptr<SliceSegmentHeaderState> ParseSliceSegmentHeaderPrefix(
+      const uint8_t* data, size_t length, uint32_t nal_unit_type,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      std::vector<uint8_t>* rbsp_buffer) noexcept;
+  // Same as above, but parse into the caller-owned `slice_segment_header`
+  // (which is reset first), so that it can be reused across calls.
+  static bool ParseSliceSegmentHeaderPrefix(
+      const uint8_t* data, size_t length, uint32_t nal_unit_type,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      std::vector<uint8_t>* rbsp_buffer,
+      SliceSegmentHeaderState* slice_segment_header) noexcept;
 };
 
 // A class for parsing out a slice segment layer data from
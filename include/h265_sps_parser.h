@@ -140,25 +140,69 @@ class H265SpsParser {
         sps_scc_extension;
     uint32_t sps_extension_data_flag = 0;
 
+    // the NAL unit this was parsed from (RBSP, including the NAL unit
+    // header), as set by H265NalUnitParser (used to checkpoint the
+    // bitstream parser state)
+    std::vector<uint8_t> rbsp;
+
+    // The picture geometry variables (Sections 6.2 and 7.4.3.2.1),
+    // computed once by computeDerived().
+    struct DerivedValues {
+      uint8_t MinCbLog2SizeY = 0;
+      uint8_t CtbLog2SizeY = 0;
+      // -1 for an invalid chroma_format_idc
+      int8_t SubWidthC = -1;
+      int8_t SubHeightC = -1;
+      uint32_t MinCbSizeY = 0;
+      uint32_t CtbSizeY = 0;
+      uint32_t PicWidthInMinCbsY = 0;
+      uint32_t PicHeightInMinCbsY = 0;
+      uint32_t PicWidthInCtbsY = 0;
+      uint32_t PicHeightInCtbsY = 0;
+      uint32_t PicSizeInMinCbsY = 0;
+      uint32_t PicSizeInCtbsY = 0;
+      uint32_t PicSizeInSamplesY = 0;
+      // resolution after the conformance window cropping
+      int32_t width = 0;
+      int32_t height = 0;
+    };
+    DerivedValues derived;
+    // Compute the derived values from the parsed fields (with integer
+    // arithmetic). Called by ParseSps(): a state filled in by other means
+    // must call it before using the getters below.
+    void computeDerived() noexcept;
+
     // derived values
     bool getMaxNumPics(uint32_t* max_num_pics) const noexcept;
-    uint32_t getMinCbLog2SizeY() const noexcept;
-    uint32_t getCtbLog2SizeY() const noexcept;
-    uint32_t getMinCbSizeY() const noexcept;
-    uint32_t getCtbSizeY() const noexcept;
-    uint32_t getPicWidthInMinCbsY() const noexcept;
-    uint32_t getPicWidthInCtbsY() const noexcept;
-    uint32_t getPicHeightInMinCbsY() const noexcept;
-    uint32_t getPicHeightInCtbsY() const noexcept;
-    uint32_t getPicSizeInMinCbsY() const noexcept;
-    uint32_t getPicSizeInCtbsY() const noexcept;
-    uint32_t getPicSizeInSamplesY() const noexcept;
-#if 0
-    uint32_t getPicWidthInSamplesC() const noexcept;
-    uint32_t getPicHeightInSamplesC() const noexcept;
-#endif
-    int getSubWidthC() const noexcept;
-    int getSubHeightC() const noexcept;
+    uint32_t getMinCbLog2SizeY() const noexcept {
+      return derived.MinCbLog2SizeY;
+    }
+    uint32_t getCtbLog2SizeY() const noexcept { return derived.CtbLog2SizeY; }
+    uint32_t getMinCbSizeY() const noexcept { return derived.MinCbSizeY; }
+    uint32_t getCtbSizeY() const noexcept { return derived.CtbSizeY; }
+    uint32_t getPicWidthInMinCbsY() const noexcept {
+      return derived.PicWidthInMinCbsY;
+    }
+    uint32_t getPicWidthInCtbsY() const noexcept {
+      return derived.PicWidthInCtbsY;
+    }
+    uint32_t getPicHeightInMinCbsY() const noexcept {
+      return derived.PicHeightInMinCbsY;
+    }
+    uint32_t getPicHeightInCtbsY() const noexcept {
+      return derived.PicHeightInCtbsY;
+    }
+    uint32_t getPicSizeInMinCbsY() const noexcept {
+      return derived.PicSizeInMinCbsY;
+    }
+    uint32_t getPicSizeInCtbsY() const noexcept {
+      return derived.PicSizeInCtbsY;
+    }
+    uint32_t getPicSizeInSamplesY() const noexcept {
+      return derived.PicSizeInSamplesY;
+    }
+    int getSubWidthC() const noexcept { return derived.SubWidthC; }
+    int getSubHeightC() const noexcept { return derived.SubHeightC; }
     int getResolution(int* width, int* height) const noexcept;
   };
 
@@ -0,0 +1,105 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "h265_profile_tier_level_parser.h"
+
+namespace h265nal {
+
+// A class for quickly probing the codec info of an H265 Annex B stream.
+// The probe scans NAL units only until it has found the parameter sets
+// (VPS, SPS, and PPS), and optionally the first prefix SEI. It never
+// parses slices, and it gives up after a byte budget.
+class H265StreamProbe {
+ public:
+  // RFC 6381 codecs string buffer size. The longest string is
+  // "hvc1.C255.FFFFFFFF.H255.FF.FF.FF.FF.FF.FF" (41 characters).
+  static constexpr size_t kCodecsStringSize = 48;
+
+  struct ProbeOptions {
+    // maximum number of bytes to scan
+    size_t max_bytes = 64 * 1024;
+    // keep scanning after the parameter sets, until the first prefix SEI
+    // (or the first VCL NAL unit), to get the HDR static metadata
+    bool wait_for_sei = false;
+    // sample entry used in the codecs string ("hvc1" or "hev1")
+    const char* sample_entry = "hvc1";
+  };
+
+  // The probe result. A plain struct that can be copied around freely.
+  struct ProbeResult {
+#ifdef FDUMP_DEFINE
+    void fdump(FILE* outfp, int indent_level) const;
+#endif  // FDUMP_DEFINE
+
+    // whether the VPS, SPS, and PPS were found
+    bool complete = false;
+    bool has_vps = false;
+    bool has_sps = false;
+    bool has_pps = false;
+    bool has_sei = false;
+    // number of bytes scanned
+    size_t bytes_scanned = 0;
+
+    // SPS values
+    int width = 0;
+    int height = 0;
+    uint32_t chroma_format_idc = 0;
+    uint32_t bit_depth_luma = 0;
+    uint32_t bit_depth_chroma = 0;
+    // general profile_tier_level values
+    uint32_t profile_space = 0;
+    uint32_t tier_flag = 0;
+    uint32_t profile_idc = 0;
+    uint32_t profile_compatibility_flags = 0;
+    uint32_t level_idc = 0;
+    // the 48 bits starting with general_progressive_source_flag
+    uint8_t constraint_indicator_flags[6] = {0};
+
+    // VUI timing info
+    bool has_frame_rate = false;
+    uint32_t num_units_in_tick = 0;
+    uint32_t time_scale = 0;
+    double frame_rate = 0.0;
+    // VUI colour description (2 means unspecified, Section E.3.1)
+    uint32_t colour_primaries = 2;
+    uint32_t transfer_characteristics = 2;
+    uint32_t matrix_coeffs = 2;
+    // transfer_characteristics is PQ (16) or HLG (18)
+    bool hdr = false;
+
+    // HDR static metadata SEIs (only with wait_for_sei)
+    bool has_mastering_display_colour_volume = false;
+    uint32_t max_display_mastering_luminance = 0;
+    uint32_t min_display_mastering_luminance = 0;
+    bool has_content_light_level_info = false;
+    uint32_t max_content_light_level = 0;
+    uint32_t max_pic_average_light_level = 0;
+
+    // RFC 6381 codecs parameter (ISO/IEC 14496-15, Annex E.3)
+    char codecs[kCodecsStringSize] = {0};
+  };
+
+  // Probe an Annex B buffer.
+  static ProbeResult Probe(const uint8_t* data, size_t length,
+                           const ProbeOptions& options) noexcept;
+  static ProbeResult Probe(const uint8_t* data, size_t length) noexcept {
+    ProbeOptions options;
+    return Probe(data, length, options);
+  }
+
+  // Write the RFC 6381 codecs parameter of a profile_tier_level into
+  // `codecs` (of size `size`). Returns the string length, or -1 on error.
+  static int GetCodecsString(
+      const H265ProfileTierLevelParser::ProfileTierLevelState&
+          profile_tier_level,
+      const char* sample_entry, char* codecs, size_t size) noexcept;
+};
+
+}  // namespace h265nal
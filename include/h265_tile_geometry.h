@@ -0,0 +1,103 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_pps_parser.h"
+#include "h265_sps_parser.h"
+
+namespace h265nal {
+
+// The tile geometry of a picture (Section 6.5.1): the column and row
+// boundaries of the tiles, and the conversion tables between the CTB
+// raster scan and tile scan addresses. It depends on an (SPS, PPS) pair,
+// and is built lazily (on the first Get() call for the pair), and cached
+// per PPS id in the bitstream parser state, like H265SliceHeaderParsePlan.
+// A PPS without tiles is a single tile covering the picture.
+struct H265TileGeometry {
+  H265TileGeometry() = default;
+  ~H265TileGeometry() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265TileGeometry(const H265TileGeometry&) = delete;
+  H265TileGeometry(H265TileGeometry&&) = delete;
+  H265TileGeometry& operator=(const H265TileGeometry&) = delete;
+  H265TileGeometry& operator=(H265TileGeometry&&) = delete;
+
+  // The position of a tile, in CTBs and in luma samples (cropped to the
+  // picture size).
+  struct TileRect {
+    uint32_t tile_id = 0;
+    uint32_t column = 0;
+    uint32_t row = 0;
+    uint32_t ctb_x = 0;
+    uint32_t ctb_y = 0;
+    uint32_t ctb_width = 0;
+    uint32_t ctb_height = 0;
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+  };
+
+  // Build the tile geometry for a parameter-set pair. Returns nullptr if
+  // the tile syntax does not fit the picture.
+  static std::shared_ptr<const H265TileGeometry> Create(
+      const std::shared_ptr<struct H265SpsParser::SpsState>& sps,
+      const std::shared_ptr<struct H265PpsParser::PpsState>& pps) noexcept;
+  // Get the tile geometry for a parameter-set pair from the cache in
+  // `bitstream_parser_state` (building it if needed). The geometry is
+  // shared with the cache, so it stays valid after the cache replaces it
+  // (e.g. when the PPS is repeated). Returns nullptr if the PPS id is out
+  // of range or the tile syntax is invalid.
+  static std::shared_ptr<const H265TileGeometry> Get(
+      struct H265BitstreamParserState* bitstream_parser_state,
+      uint32_t pps_id,
+      const std::shared_ptr<struct H265SpsParser::SpsState>& sps,
+      const std::shared_ptr<struct H265PpsParser::PpsState>& pps) noexcept;
+
+  // Tile index (TileId) of the CTB with raster scan address
+  // `ctb_addr_rs`, e.g. a slice_segment_address. Returns -1 if the
+  // address is outside the picture.
+  int getTileId(uint32_t ctb_addr_rs) const noexcept;
+  // Position of a tile. Returns false if there is no such tile.
+  bool getTileRect(uint32_t tile_id, TileRect* tile_rect) const noexcept;
+  // Position of the tile containing a slice segment. Returns false if
+  // slice_segment_address is outside the picture.
+  bool getSliceSegmentTileRect(uint32_t slice_segment_address,
+                               TileRect* tile_rect) const noexcept;
+
+  uint32_t getNumTiles() const noexcept {
+    return num_tile_columns * num_tile_rows;
+  }
+
+  // the parameter sets the geometry was built from
+  std::shared_ptr<struct H265SpsParser::SpsState> sps;
+  std::shared_ptr<struct H265PpsParser::PpsState> pps;
+
+  uint32_t PicWidthInCtbsY = 0;
+  uint32_t PicHeightInCtbsY = 0;
+  uint32_t num_tile_columns = 0;
+  uint32_t num_tile_rows = 0;
+  // Equations (6-3) to (6-6): width and height of the tile columns and
+  // rows, and their boundaries (in CTBs, with a final entry for the
+  // picture width or height)
+  std::vector<uint16_t> colWidth;
+  std::vector<uint16_t> rowHeight;
+  std::vector<uint16_t> colBd;
+  std::vector<uint16_t> rowBd;
+  // Equations (6-7) to (6-9), indexed by CTB address (PicSizeInCtbsY
+  // entries each)
+  std::vector<uint32_t> CtbAddrRsToTs;
+  std::vector<uint32_t> CtbAddrTsToRs;
+  // indexed by tile scan address
+  std::vector<uint16_t> TileId;
+};
+
+}  // namespace h265nal
@@ -0,0 +1,80 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+#include <vector>
+
+namespace h265nal {
+
+// A class mapping the time codes (time_code SEI) of an Annex B bitstream
+// to the byte offsets of their access units. Lookups are O(log n).
+class H265TimeCodeIndex {
+ public:
+  // An index entry.
+  struct Entry {
+    // time code (Section D.3.27), with the values not present in the SEI
+    // inferred from the previous time code
+    uint32_t hours = 0;
+    uint32_t minutes = 0;
+    uint32_t seconds = 0;
+    uint32_t n_frames = 0;
+    uint32_t discontinuity_flag = 0;
+    // byte offset of the access unit (first start code) carrying the
+    // time code
+    size_t offset = 0;
+    // byte offset of the closest IRAP access unit at or before this one
+    // (valid only if has_irap is set)
+    size_t irap_offset = 0;
+    bool has_irap = false;
+
+    // A key preserving the time code order.
+    uint64_t key() const {
+      return TimeCodeKey(hours, minutes, seconds, n_frames);
+    }
+  };
+
+  H265TimeCodeIndex() = default;
+  ~H265TimeCodeIndex() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265TimeCodeIndex(const H265TimeCodeIndex&) = delete;
+  H265TimeCodeIndex(H265TimeCodeIndex&&) = delete;
+  H265TimeCodeIndex& operator=(const H265TimeCodeIndex&) = delete;
+  H265TimeCodeIndex& operator=(H265TimeCodeIndex&&) = delete;
+
+  // Build the index of an Annex B bitstream. Only the NAL unit headers,
+  // the first slice segment flag of the VCL NAL units, and the time_code
+  // SEI messages are parsed.
+  static std::unique_ptr<H265TimeCodeIndex> Build(const uint8_t* data,
+                                                  size_t length) noexcept;
+
+  // Get the entry with the exact time code (nullptr if none).
+  const Entry* Find(uint32_t hours, uint32_t minutes, uint32_t seconds,
+                    uint32_t n_frames) const noexcept;
+  // Get the entry with the largest time code that is not after the given
+  // one (nullptr if none).
+  const Entry* FindFloor(uint32_t hours, uint32_t minutes, uint32_t seconds,
+                         uint32_t n_frames) const noexcept;
+
+  // Entries, sorted by time code (entries with the same time code are kept
+  // in bitstream order).
+  const std::vector<Entry>& entries() const { return entries_; }
+
+  static uint64_t TimeCodeKey(uint32_t hours, uint32_t minutes,
+                              uint32_t seconds, uint32_t n_frames) {
+    // n_frames is a u(9)
+    return (((static_cast<uint64_t>(hours) * 60 + minutes) * 60 + seconds)
+            << 9) |
+           (n_frames & 0x1ff);
+  }
+
+ private:
+  std::vector<Entry> entries_;
+};
+
+}  // namespace h265nal
@@ -0,0 +1,113 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace h265nal {
+
+// A minimal MPEG-2 transport stream (ISO/IEC 13818-1) demuxer for HEVC
+// elementary streams (stream_type 0x24). It follows the PAT and the PMTs,
+// reassembles the PES packets of the HEVC PIDs, and hands each PES payload
+// (an Annex B access unit) to a callback, with its PTS and DTS.
+//
+// The input can be pushed in chunks of any size. A PES packet contained in
+// a single TS packet is handed out as a view into the input; other ones are
+// reassembled in a per-PID buffer that is reused across PES packets. PSI
+// sections must fit in one TS packet, and their CRCs are not checked.
+class H265TsDemuxer {
+ public:
+  static constexpr size_t kTsPacketSize = 188;
+  static constexpr uint8_t kSyncByte = 0x47;
+  // Table 2-34 of ISO/IEC 13818-1: HEVC video stream
+  static constexpr uint8_t kStreamTypeHevc = 0x24;
+
+  // An access unit (the payload of a PES packet). `data` is only valid
+  // during the callback.
+  struct AccessUnit {
+    uint16_t pid = 0;
+    bool has_pts = false;
+    bool has_dts = false;
+    // 90 kHz timestamps (dts is pts when the PES has no DTS)
+    uint64_t pts = 0;
+    uint64_t dts = 0;
+    const uint8_t* data = nullptr;
+    size_t length = 0;
+  };
+  typedef std::function<void(const AccessUnit&)> Callback;
+
+  explicit H265TsDemuxer(Callback callback) : callback_(callback) {}
+  ~H265TsDemuxer() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265TsDemuxer(const H265TsDemuxer&) = delete;
+  H265TsDemuxer(H265TsDemuxer&&) = delete;
+  H265TsDemuxer& operator=(const H265TsDemuxer&) = delete;
+  H265TsDemuxer& operator=(H265TsDemuxer&&) = delete;
+
+  // Whether the buffer starts like a transport stream (3 sync bytes, one
+  // per packet).
+  static bool IsTs(const uint8_t* data, size_t length) noexcept;
+
+  // Demux a chunk of a transport stream. Chunks need not be aligned to
+  // TS packets.
+  void ProcessData(const uint8_t* data, size_t length) noexcept;
+  // Hand out the pending (unbounded) PES packets.
+  void Flush() noexcept;
+
+  // HEVC PIDs found in the PMTs
+  std::vector<uint16_t> hevc_pids() const;
+  uint64_t num_packets() const { return num_packets_; }
+  // bytes skipped to find the next sync byte
+  uint64_t num_sync_losses() const { return num_sync_losses_; }
+  // PES packets dropped because of a continuity_counter gap
+  uint64_t num_continuity_errors() const { return num_continuity_errors_; }
+
+ private:
+  // The PES packet being reassembled for a PID.
+  struct PesState {
+    bool started = false;
+    int continuity_counter = -1;
+    // PES_packet_length (0 if unbounded)
+    size_t pes_packet_length = 0;
+    // bytes of the PES packet received (counted from after the
+    // PES_packet_length field)
+    size_t pes_received = 0;
+    AccessUnit access_unit;
+    // view into the input (if the payload is still in a single packet)
+    const uint8_t* view = nullptr;
+    size_t view_length = 0;
+    // reassembly buffer (capacity is kept across PES packets)
+    std::vector<uint8_t> buffer;
+  };
+
+  void ProcessPacket(const uint8_t* packet, bool allow_views) noexcept;
+  void ProcessPat(const uint8_t* payload, size_t length) noexcept;
+  void ProcessPmt(const uint8_t* payload, size_t length) noexcept;
+  void ProcessPes(PesState* pes, const uint8_t* payload, size_t length,
+                  bool payload_unit_start, bool allow_views) noexcept;
+  void EmitPes(PesState* pes) noexcept;
+  // Copy a pending view into the reassembly buffer.
+  void MaterializeView(PesState* pes) noexcept;
+
+  Callback callback_;
+  // PMT PIDs
+  std::map<uint16_t, bool> pmt_pids_;
+  // HEVC PIDs
+  std::map<uint16_t, PesState> pes_states_;
+  // a packet split across ProcessData() calls
+  uint8_t partial_packet_[kTsPacketSize];
+  size_t partial_packet_size_ = 0;
+
+  uint64_t num_packets_ = 0;
+  uint64_t num_sync_losses_ = 0;
+  uint64_t num_continuity_errors_ = 0;
+};
+
+}  // namespace h265nal
@@ -25,6 +25,8 @@ class H265Utils {
       std::unique_ptr<struct H265RtpParser::RtpState> const& rtp,
       const H265BitstreamParserState* bitstream_parser_state) noexcept;
 #endif  // RTP_DEFINE
+  // Get the slice QP for the Y component of all the slice segments in an
+  // Annex B buffer. See H265QpTelemetry for streaming QP statistics.
   static std::vector<int32_t> GetSliceQpY(
       const uint8_t* data, size_t length,
       H265BitstreamParserState* bitstream_parser_state) noexcept;
@@ -74,6 +74,11 @@ class H265VpsParser {
     std::vector<uint32_t> cprms_present_flag;
     uint32_t vps_extension_flag = 0;
     uint32_t vps_extension_data_flag = 0;
+
+    // the NAL unit this was parsed from (RBSP, including the NAL unit
+    // header), as set by H265NalUnitParser (used to checkpoint the
+    // bitstream parser state)
+    std::vector<uint8_t> rbsp;
   };
 
   // Unpack RBSP and parse VPS state from the supplied buffer.
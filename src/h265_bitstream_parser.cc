@@ -7,7 +7,9 @@
 #include <arpa/inet.h>
 #include <stdio.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -92,6 +94,176 @@ H265BitstreamParser::FindNaluIndicesExplicitFraming(const uint8_t* data,
   return sequences;
 }
 
+std::vector<H265BitstreamParser::NaluIndex>
+H265BitstreamParser::FindNaluIndicesExplicitFraming(
+    const uint8_t* data, size_t length, size_t length_size) noexcept {
+  std::vector<NaluIndex> sequences;
+  if (length_size != 1 && length_size != 2 && length_size != 4) {
+    return sequences;
+  }
+  for (size_t i = 0; i + length_size <= length;) {
+    // read a nal_unit_size (big-endian)
+    size_t nal_unit_size = 0;
+    for (size_t j = 0; j < length_size; j++) {
+      nal_unit_size = (nal_unit_size << 8) | data[i + j];
+    }
+    // a truncated NAL unit ends at the end of the buffer
+    nal_unit_size = std::min(nal_unit_size, length - i - length_size);
+    NaluIndex index = {i, i + length_size, nal_unit_size};
+    sequences.push_back(index);
+    i += (length_size + nal_unit_size);
+  }
+
+  return sequences;
+}
+
+std::unique_ptr<H265NalUnitParser::NalUnitState>
+H265BitstreamParser::ParseNalUnitResilient(
+    const uint8_t* data, size_t length, size_t offset,
+    H265BitstreamParserState* bitstream_parser_state,
+    ParsingOptions parsing_options) noexcept {
+  H265StreamHealth& health = bitstream_parser_state->health;
+  health.num_nal_units++;
+  if (length < 2) {
+    health.num_failed_nal_units++;
+    health.last_failure_offset = offset;
+    return nullptr;
+  }
+  uint32_t nal_unit_type = (data[0] >> 1) & 0x3f;
+
+  // cap the work spent on a single slice segment: it only needs its
+  // header, which is at its beginning (non-VCL NAL units, e.g. large SEI
+  // messages, are always parsed in full)
+  if (IsNalUnitTypeVcl(nal_unit_type) &&
+      length > parsing_options.resilient_max_nal_unit_size) {
+    health.num_capped_nal_units++;
+    length = parsing_options.resilient_max_nal_unit_size;
+  }
+
+  // parse a parameter set into an empty map, so that the one it replaces
+  // (if any) can be kept as the last-known-good one
+  std::map<uint32_t, std::shared_ptr<struct H265SpsParser::SpsState>>
+      parsed_sps;
+  std::map<uint32_t, std::shared_ptr<struct H265PpsParser::PpsState>>
+      parsed_pps;
+  if (nal_unit_type == SPS_NUT) {
+    bitstream_parser_state->sps.swap(parsed_sps);
+  } else if (nal_unit_type == PPS_NUT) {
+    bitstream_parser_state->pps.swap(parsed_pps);
+  }
+
+  auto nal_unit = H265NalUnitParser::ParseNalUnit(
+      data, length, bitstream_parser_state, parsing_options);
+  bool failed =
+      (nal_unit == nullptr ||
+       H265NalUnitPayloadParser::GetFailedPayloadStructure(
+           nal_unit_type, *(nal_unit->nal_unit_payload)) != nullptr);
+
+  if (nal_unit_type == SPS_NUT) {
+    bitstream_parser_state->sps.swap(parsed_sps);
+    for (const auto& it : parsed_sps) {
+      auto& sps = bitstream_parser_state->sps[it.first];
+      if (!failed && sps != nullptr && sps != it.second) {
+        bitstream_parser_state->last_good_sps[it.first] = sps;
+      }
+      sps = it.second;
+    }
+  } else if (nal_unit_type == PPS_NUT) {
+    bitstream_parser_state->pps.swap(parsed_pps);
+    for (const auto& it : parsed_pps) {
+      auto& pps = bitstream_parser_state->pps[it.first];
+      if (!failed && pps != nullptr && pps != it.second) {
+        bitstream_parser_state->last_good_pps[it.first] = pps;
+      }
+      pps = it.second;
+    }
+  }
+
+  if (failed && IsSliceSegment(nal_unit_type) &&
+      (!bitstream_parser_state->last_good_sps.empty() ||
+       !bitstream_parser_state->last_good_pps.empty())) {
+    // the slice may refer to a corrupt parameter set: retry with the
+    // last-known-good ones
+    std::map<uint32_t, std::shared_ptr<struct H265SpsParser::SpsState>>
+        current_sps;
+    std::map<uint32_t, std::shared_ptr<struct H265PpsParser::PpsState>>
+        current_pps;
+    for (const auto& it : bitstream_parser_state->last_good_sps) {
+      auto& sps = bitstream_parser_state->sps[it.first];
+      current_sps[it.first] = sps;
+      sps = it.second;
+    }
+    for (const auto& it : bitstream_parser_state->last_good_pps) {
+      auto& pps = bitstream_parser_state->pps[it.first];
+      current_pps[it.first] = pps;
+      pps = it.second;
+    }
+    auto retry_nal_unit = H265NalUnitParser::ParseNalUnit(
+        data, length, bitstream_parser_state, parsing_options);
+    bool recovered =
+        (retry_nal_unit != nullptr &&
+         H265NalUnitPayloadParser::GetFailedPayloadStructure(
+             nal_unit_type, *(retry_nal_unit->nal_unit_payload)) == nullptr);
+    if (recovered) {
+      health.num_parameter_set_fallbacks++;
+      nal_unit = std::move(retry_nal_unit);
+      failed = false;
+    }
+    // put the current parameter sets back: the last-known-good ones only
+    // replace them for good if they refer to a missing parameter set (a
+    // valid parameter set change must survive a corrupt slice)
+    for (const auto& it : current_sps) {
+      if (recovered && (it.second == nullptr ||
+                        bitstream_parser_state->GetVps(
+                            it.second->sps_video_parameter_set_id) ==
+                            nullptr)) {
+        bitstream_parser_state->last_good_sps.erase(it.first);
+      } else {
+        bitstream_parser_state->sps[it.first] = it.second;
+      }
+    }
+    for (const auto& it : current_pps) {
+      if (recovered && (it.second == nullptr ||
+                        bitstream_parser_state->GetSps(
+                            it.second->pps_seq_parameter_set_id) ==
+                            nullptr)) {
+        bitstream_parser_state->last_good_pps.erase(it.first);
+      } else {
+        bitstream_parser_state->pps[it.first] = it.second;
+      }
+    }
+  }
+
+  if (failed) {
+    health.num_failed_nal_units++;
+    health.last_failure_offset = offset;
+    if (nal_unit_type == VPS_NUT || nal_unit_type == SPS_NUT ||
+        nal_unit_type == PPS_NUT) {
+      health.num_failed_parameter_sets++;
+      health.resync_pending = true;
+    } else if (IsSliceSegment(nal_unit_type)) {
+      health.num_failed_slices++;
+      health.resync_pending = true;
+    }
+    if (nal_unit != nullptr && IsSliceSegment(nal_unit_type)) {
+      nal_unit->affected = true;
+    }
+    return nal_unit;
+  }
+
+  if (IsSliceSegment(nal_unit_type) && health.resync_pending) {
+    if (nal_unit_type >= BLA_W_LP && nal_unit_type <= RSV_IRAP_VCL23) {
+      // an IRAP picture does not depend on any previous (corrupt) picture
+      health.resync_pending = false;
+      health.num_resyncs++;
+    } else {
+      nal_unit->affected = true;
+      health.num_affected_slices++;
+    }
+  }
+  return nal_unit;
+}
+
 // Parse a raw (RBSP) buffer with explicit NAL unit separator (3- or 4-byte
 // sequence start code prefix). Function splits the stream in NAL units,
 // and then parses each NAL unit. For that, it unpacks the RBSP inside
@@ -103,17 +275,38 @@ H265BitstreamParser::ParseBitstream(
     const uint8_t* data, size_t length,
     H265BitstreamParserState* bitstream_parser_state,
     ParsingOptions parsing_options) noexcept {
-  auto bitstream = std::make_unique<BitstreamState>();
-
   // (1) split the input string into a vector of NAL units
   std::vector<NaluIndex> nalu_indices = FindNaluIndices(data, length);
 
+  return ParseBitstream(data, length, nalu_indices, bitstream_parser_state,
+                        parsing_options);
+}
+
+std::unique_ptr<H265BitstreamParser::BitstreamState>
+H265BitstreamParser::ParseBitstream(
+    const uint8_t* data, size_t length,
+    const std::vector<NaluIndex>& nalu_indices,
+    H265BitstreamParserState* bitstream_parser_state,
+    ParsingOptions parsing_options) noexcept {
+  auto bitstream = std::make_unique<BitstreamState>();
+
   // process each of the NAL units
   for (const NaluIndex& nalu_index : nalu_indices) {
+    if (nalu_index.payload_start_offset + nalu_index.payload_size > length) {
+      continue;
+    }
     // (2) parse the NAL units, and add them to the vector
-    auto nal_unit = H265NalUnitParser::ParseNalUnit(
-        &data[nalu_index.payload_start_offset], nalu_index.payload_size,
-        bitstream_parser_state, parsing_options);
+    std::unique_ptr<H265NalUnitParser::NalUnitState> nal_unit;
+    if (parsing_options.resilient) {
+      nal_unit = ParseNalUnitResilient(
+          &data[nalu_index.payload_start_offset], nalu_index.payload_size,
+          nalu_index.payload_start_offset, bitstream_parser_state,
+          parsing_options);
+    } else {
+      nal_unit = H265NalUnitParser::ParseNalUnit(
+          &data[nalu_index.payload_start_offset], nalu_index.payload_size,
+          bitstream_parser_state, parsing_options);
+    }
     if (nal_unit == nullptr) {
       // cannot parse the NalUnit
 #ifdef FPRINT_ERRORS
@@ -5,11 +5,15 @@
 #include "h265_bitstream_parser_state.h"
 
 #include <stdio.h>
+#include <string.h>
 
+#include <cinttypes>
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "h265_common.h"
+#include "h265_nal_unit_parser.h"
 #include "h265_pps_parser.h"
 #include "h265_sps_parser.h"
 #include "h265_vps_parser.h"
@@ -21,6 +25,12 @@ typedef std::shared_ptr<struct h265nal::H265SpsParser::SpsState>
     SharedPtrSpsState;
 typedef std::shared_ptr<struct h265nal::H265PpsParser::PpsState>
     SharedPtrPpsState;
+
+const uint8_t kCheckpointMagic[] = {'h', '2', '6', '5'};
+const uint8_t kCheckpointVersion = 1;
+const uint8_t kCheckpointNoActiveSps = 0xff;
+// magic, version, active SPS id, and number of parameter sets
+const size_t kCheckpointHeaderSize = 8;
 }  // namespace
 
 namespace h265nal {
@@ -59,4 +69,147 @@ H265BitstreamParserState::GetPps(uint32_t pps_id) const {
   return SharedPtrPpsState(it->second);
 }
 
+// Checkpoint format (version 1, big-endian): "h265" magic (4 bytes),
+// version (1 byte), active SPS id (1 byte, 0xff if none), number of
+// parameter sets (2 bytes), and for each parameter set (VPSs, then SPSs,
+// then PPSs) its RBSP length (4 bytes) and RBSP (including the NAL unit
+// header).
+bool H265BitstreamParserState::Checkpoint(
+    std::vector<uint8_t>* checkpoint) const {
+  // empty map entries hold no parameter set, and are skipped
+  std::vector<const std::vector<uint8_t>*> rbsps;
+  for (const auto& it : vps) {
+    if (it.second != nullptr) {
+      rbsps.push_back(&it.second->rbsp);
+    }
+  }
+  for (const auto& it : sps) {
+    if (it.second != nullptr) {
+      rbsps.push_back(&it.second->rbsp);
+    }
+  }
+  for (const auto& it : pps) {
+    if (it.second != nullptr) {
+      rbsps.push_back(&it.second->rbsp);
+    }
+  }
+  size_t size = kCheckpointHeaderSize;
+  for (const auto* rbsp : rbsps) {
+    // a parameter set without RBSP cannot be restored
+    if (rbsp->empty()) {
+      return false;
+    }
+    size += 4 + rbsp->size();
+  }
+
+  checkpoint->clear();
+  checkpoint->reserve(size);
+  checkpoint->insert(checkpoint->end(), kCheckpointMagic,
+                     kCheckpointMagic + 4);
+  checkpoint->push_back(kCheckpointVersion);
+  checkpoint->push_back((active_sps != nullptr)
+                            ? active_sps->sps_seq_parameter_set_id
+                            : kCheckpointNoActiveSps);
+  checkpoint->push_back(rbsps.size() >> 8);
+  checkpoint->push_back(rbsps.size() & 0xff);
+  for (const auto* rbsp : rbsps) {
+    uint32_t rbsp_size = rbsp->size();
+    for (int shift = 24; shift >= 0; shift -= 8) {
+      checkpoint->push_back((rbsp_size >> shift) & 0xff);
+    }
+    checkpoint->insert(checkpoint->end(), rbsp->begin(), rbsp->end());
+  }
+  return true;
+}
+
+bool H265BitstreamParserState::Restore(const uint8_t* data, size_t length) {
+  if (length < kCheckpointHeaderSize ||
+      memcmp(data, kCheckpointMagic, 4) != 0 ||
+      data[4] != kCheckpointVersion) {
+    return false;
+  }
+  uint32_t active_sps_id = data[5];
+  uint32_t num_parameter_sets = (data[6] << 8) | data[7];
+
+  // parse into a scratch state, so that a bad checkpoint has no effect
+  H265BitstreamParserState restored;
+  restored.parameter_set_interner = parameter_set_interner;
+  ParsingOptions parsing_options;
+  parsing_options.add_checksum = false;
+  size_t offset = kCheckpointHeaderSize;
+  for (uint32_t i = 0; i < num_parameter_sets; i++) {
+    if (length - offset < 4) {
+      return false;
+    }
+    size_t rbsp_size = (static_cast<size_t>(data[offset]) << 24) |
+                       (data[offset + 1] << 16) | (data[offset + 2] << 8) |
+                       data[offset + 3];
+    offset += 4;
+    if (length - offset < rbsp_size) {
+      return false;
+    }
+    auto nal_unit = H265NalUnitParser::ParseNalUnitUnescaped(
+        data + offset, rbsp_size, &restored, parsing_options);
+    if (nal_unit == nullptr || nal_unit->nal_unit_payload == nullptr ||
+        (nal_unit->nal_unit_payload->vps == nullptr &&
+         nal_unit->nal_unit_payload->sps == nullptr &&
+         nal_unit->nal_unit_payload->pps == nullptr)) {
+      return false;
+    }
+    offset += rbsp_size;
+  }
+
+  vps.swap(restored.vps);
+  sps.swap(restored.sps);
+  pps.swap(restored.pps);
+  active_sps = (active_sps_id == kCheckpointNoActiveSps)
+                   ? nullptr
+                   : GetSps(active_sps_id);
+  last_good_sps.clear();
+  last_good_pps.clear();
+  slice_header_parse_plans.clear();
+  tile_geometries.clear();
+  return true;
+}
+
+#ifdef FDUMP_DEFINE
+void H265StreamHealth::fdump(FILE* outfp, int indent_level) const {
+  fprintf(outfp, "stream_health {");
+  indent_level = indent_level_incr(indent_level);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "num_nal_units: %" PRIu64 "", num_nal_units);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "num_failed_nal_units: %" PRIu64 "", num_failed_nal_units);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "num_failed_parameter_sets: %" PRIu64 "",
+          num_failed_parameter_sets);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "num_failed_slices: %" PRIu64 "", num_failed_slices);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "num_parameter_set_fallbacks: %" PRIu64 "",
+          num_parameter_set_fallbacks);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "num_capped_nal_units: %" PRIu64 "", num_capped_nal_units);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "num_affected_slices: %" PRIu64 "", num_affected_slices);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "num_resyncs: %" PRIu64 "", num_resyncs);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "resync_pending: %i", resync_pending);
+
+  indent_level = indent_level_decr(indent_level);
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "}");
+}
+#endif  // FDUMP_DEFINE
+
 }  // namespace h265nal
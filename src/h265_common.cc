@@ -178,6 +178,48 @@ std::vector<uint8_t> UnescapeRbsp(const uint8_t *data, size_t length) {
   return out;
 }
 
+bool UnescapeRbspRange(const uint8_t *data, size_t length, size_t rbsp_offset,
+                       size_t rbsp_length, std::vector<uint8_t> *out) {
+  out->clear();
+  out->reserve(rbsp_length);
+  const size_t rbsp_end = rbsp_offset + rbsp_length;
+  size_t rbsp_i = 0;
+  size_t zero_count = 0;
+  for (size_t i = 0; i < length && rbsp_i < rbsp_end; ++i) {
+    if (zero_count >= 2 && data[i] == 0x03) {
+      // Skip the emulation byte.
+      zero_count = 0;
+      continue;
+    }
+    zero_count = (data[i] == 0x00) ? (zero_count + 1) : 0;
+    if (rbsp_i >= rbsp_offset) {
+      out->push_back(data[i]);
+    }
+    rbsp_i++;
+  }
+  return (rbsp_i == rbsp_end);
+}
+
+void EscapeRbsp(const uint8_t *data, size_t length,
+                std::vector<uint8_t> *out) {
+  out->reserve(out->size() + length + length / 64);
+  size_t zero_count = 0;
+  for (size_t i = 0; i < length; ++i) {
+    // Section 7.4.2: 00 00 followed by 00, 01, 02, or 03 gets an
+    // emulation byte
+    if (zero_count >= 2 && data[i] <= 0x03) {
+      out->push_back(0x03);
+      zero_count = 0;
+    }
+    out->push_back(data[i]);
+    zero_count = (data[i] == 0x00) ? (zero_count + 1) : 0;
+  }
+  // a final 00 byte (cabac_zero_word) is also followed by an emulation byte
+  if (length > 0 && data[length - 1] == 0x00) {
+    out->push_back(0x03);
+  }
+}
+
 // Syntax functions and descriptors) (Section 7.2)
 bool byte_aligned(rtc::BitBuffer *bit_buffer) {
   // If the current position in the bitstream is on a byte boundary, i.e.,
@@ -274,6 +316,14 @@ bool rbsp_trailing_bits(rtc::BitBuffer *bit_buffer) {
   return true;
 }
 
+uint32_t ceil_log2(uint32_t value) {
+  uint32_t log2 = 0;
+  while (log2 < 32 && (static_cast<uint64_t>(1) << log2) < value) {
+    log2++;
+  }
+  return log2;
+}
+
 #if defined(FDUMP_DEFINE)
 int indent_level_incr(int indent_level) {
   return (indent_level == -1) ? -1 : (indent_level + 1);
@@ -0,0 +1,171 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_error_reporter.h"
+
+#include <stdio.h>
+
+#include <cinttypes>
+
+#include "h265_common.h"
+
+namespace h265nal {
+
+namespace {
+// active reporter of each thread
+thread_local H265ErrorReporter* g_active_error_reporter = nullptr;
+}  // namespace
+
+const char* ParseErrorCodeToString(ParseErrorCode code) {
+  switch (code) {
+    case ParseErrorCode::kNone:
+      return "none";
+    case ParseErrorCode::kTruncated:
+      return "truncated";
+    case ParseErrorCode::kOutOfRange:
+      return "out_of_range";
+    case ParseErrorCode::kMissingParameterSet:
+      return "missing_parameter_set";
+    case ParseErrorCode::kUnsupported:
+      return "unsupported";
+    default:
+      return "unknown";
+  }
+}
+
+void H265ErrorReporter::SetCallback(
+    Callback callback, uint32_t max_callbacks_per_second) noexcept {
+  callback_ = callback;
+  max_callbacks_per_second_ = max_callbacks_per_second;
+  callback_window_start_ = std::chrono::steady_clock::now();
+  num_callbacks_in_window_ = 0;
+}
+
+void H265ErrorReporter::Report(ParseErrorCode code,
+                               const char* syntax_element, int64_t value,
+                               size_t bit_offset) noexcept {
+  ParseError error;
+  error.code = code;
+  error.syntax_element = syntax_element;
+  error.value = value;
+  error.bit_offset = bit_offset;
+  error.nal_unit_type = nal_unit_type_;
+  error.nal_unit_index = nal_unit_index_;
+  errors_.Push(error);
+  num_errors_++;
+  num_errors_per_code_[static_cast<size_t>(code) %
+                       num_errors_per_code_.size()]++;
+
+  if (!callback_) {
+    return;
+  }
+  // fixed 1-second windows
+  auto now = std::chrono::steady_clock::now();
+  if (now - callback_window_start_ >= std::chrono::seconds(1)) {
+    callback_window_start_ = now;
+    num_callbacks_in_window_ = 0;
+  }
+  if (num_callbacks_in_window_ >= max_callbacks_per_second_) {
+    num_suppressed_callbacks_++;
+    return;
+  }
+  num_callbacks_in_window_++;
+  callback_(error);
+}
+
+void H265ErrorReporter::Clear() noexcept {
+  errors_.Clear();
+  num_errors_ = 0;
+  num_errors_per_code_.fill(0);
+  num_nal_units_ = 0;
+  num_callbacks_in_window_ = 0;
+  num_suppressed_callbacks_ = 0;
+}
+
+H265ErrorReporter* H265ErrorReporter::active() noexcept {
+  return g_active_error_reporter;
+}
+
+H265ErrorReporter::Scope::Scope(H265ErrorReporter* error_reporter,
+                                uint32_t nal_unit_type) noexcept
+    : error_reporter_(error_reporter),
+      previous_active_(g_active_error_reporter),
+      previous_nal_unit_type_(error_reporter ? error_reporter->nal_unit_type_
+                                             : 0),
+      previous_nal_unit_index_(error_reporter ? error_reporter->nal_unit_index_
+                                              : 0),
+      first_error_(error_reporter ? error_reporter->num_errors_ : 0) {
+  // a scope without a reporter keeps the enclosing one active
+  if (error_reporter_ == nullptr) {
+    return;
+  }
+  error_reporter_->nal_unit_type_ = nal_unit_type;
+  error_reporter_->nal_unit_index_ = error_reporter_->num_nal_units_++;
+  g_active_error_reporter = error_reporter_;
+}
+
+H265ErrorReporter::Scope::~Scope() {
+  if (error_reporter_ == nullptr) {
+    return;
+  }
+  error_reporter_->nal_unit_type_ = previous_nal_unit_type_;
+  error_reporter_->nal_unit_index_ = previous_nal_unit_index_;
+  g_active_error_reporter = previous_active_;
+}
+
+uint64_t H265ErrorReporter::Scope::num_errors() const {
+  return (error_reporter_ == nullptr)
+             ? 0
+             : (error_reporter_->num_errors_ - first_error_);
+}
+
+void ReportParseError(ParseErrorCode code, const char* syntax_element,
+                      int64_t value, rtc::BitBuffer* bit_buffer) noexcept {
+  size_t bit_offset = 0;
+  if (bit_buffer != nullptr) {
+    size_t out_byte_offset, out_bit_offset;
+    bit_buffer->GetCurrentOffset(&out_byte_offset, &out_bit_offset);
+    bit_offset = out_byte_offset * 8 + out_bit_offset;
+  }
+  H265ErrorReporter* error_reporter = g_active_error_reporter;
+  if (error_reporter != nullptr) {
+    error_reporter->Report(code, syntax_element, value, bit_offset);
+    return;
+  }
+#ifdef FPRINT_ERRORS
+  fprintf(stderr, "error: %s %s (value: %" PRId64 ", bit_offset: %zu)\n",
+          ParseErrorCodeToString(code), syntax_element, value, bit_offset);
+#endif  // FPRINT_ERRORS
+}
+
+#ifdef FDUMP_DEFINE
+void ParseError::fdump(FILE* outfp, int indent_level) const {
+  fprintf(outfp, "parse_error {");
+  indent_level = indent_level_incr(indent_level);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "code: %s", ParseErrorCodeToString(code));
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "syntax_element: %s", syntax_element);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "value: %" PRId64 "", value);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "bit_offset: %zu", bit_offset);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "nal_unit_type: %i", nal_unit_type);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "nal_unit_index: %" PRIu64 "", nal_unit_index);
+
+  indent_level = indent_level_decr(indent_level);
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "}");
+}
+#endif  // FDUMP_DEFINE
+
+}  // namespace h265nal
@@ -0,0 +1,496 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_filter.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_nal_unit_payload_parser.h"
+#include "h265_pps_parser.h"
+#include "h265_slice_parser.h"
+#include "h265_sps_parser.h"
+#include "h265_vps_parser.h"
+
+namespace h265nal {
+
+namespace {
+typedef H265NalUnitParser::NalUnitState NalUnitState;
+typedef H265NalUnitHeaderParser::NalUnitHeaderState NalUnitHeaderState;
+
+const H265SliceSegmentHeaderParser::SliceSegmentHeaderState* GetSliceHeader(
+    const NalUnitState& nal_unit) {
+  if (nal_unit.nal_unit_payload == nullptr ||
+      nal_unit.nal_unit_payload->slice_segment_layer == nullptr) {
+    return nullptr;
+  }
+  return nal_unit.nal_unit_payload->slice_segment_layer->slice_segment_header
+      .get();
+}
+
+const H265VpsParser::VpsState* GetVps(const NalUnitState& nal_unit) {
+  return (nal_unit.nal_unit_payload == nullptr)
+             ? nullptr
+             : nal_unit.nal_unit_payload->vps.get();
+}
+
+const H265SpsParser::SpsState* GetSps(const NalUnitState& nal_unit) {
+  return (nal_unit.nal_unit_payload == nullptr)
+             ? nullptr
+             : nal_unit.nal_unit_payload->sps.get();
+}
+
+const H265PpsParser::PpsState* GetPps(const NalUnitState& nal_unit) {
+  return (nal_unit.nal_unit_payload == nullptr)
+             ? nullptr
+             : nal_unit.nal_unit_payload->pps.get();
+}
+
+// A filter field: header fields are read using `header_getter`, payload
+// fields using `payload_getter` (which returns false when the field is
+// not present in the NAL unit).
+struct Field {
+  const char* name;
+  uint32_t source;
+  int64_t (*header_getter)(const NalUnitHeaderState& header);
+  bool (*payload_getter)(const NalUnitState& nal_unit, int64_t* value);
+};
+
+#define HEADER_FIELD(name)                                \
+  {                                                       \
+    #name, H265Filter::kSourceHeader,                     \
+        [](const NalUnitHeaderState& header) -> int64_t { \
+          return header.name;                             \
+        },                                                \
+        nullptr                                           \
+  }
+#define PAYLOAD_FIELD(name, source, getter)                        \
+  {                                                                \
+    #name, source, nullptr,                                        \
+        [](const NalUnitState& nal_unit, int64_t* value) -> bool { \
+          auto state = getter(nal_unit);                           \
+          if (state == nullptr) {                                  \
+            return false;                                          \
+          }                                                        \
+          *value = state->name;                                    \
+          return true;                                             \
+        }                                                          \
+  }
+#define SLICE_FIELD(name) \
+  PAYLOAD_FIELD(name, H265Filter::kSourceSliceHeader, GetSliceHeader)
+
+const Field kFields[] = {
+    HEADER_FIELD(nal_unit_type),
+    HEADER_FIELD(nuh_layer_id),
+    HEADER_FIELD(nuh_temporal_id_plus1),
+    SLICE_FIELD(first_slice_segment_in_pic_flag),
+    SLICE_FIELD(slice_pic_parameter_set_id),
+    SLICE_FIELD(dependent_slice_segment_flag),
+    SLICE_FIELD(slice_segment_address),
+    SLICE_FIELD(slice_type),
+    SLICE_FIELD(slice_pic_order_cnt_lsb),
+    SLICE_FIELD(slice_qp_delta),
+    SLICE_FIELD(slice_cb_qp_offset),
+    SLICE_FIELD(slice_cr_qp_offset),
+    SLICE_FIELD(num_entry_point_offsets),
+    PAYLOAD_FIELD(vps_video_parameter_set_id, H265Filter::kSourceVps, GetVps),
+    PAYLOAD_FIELD(sps_seq_parameter_set_id, H265Filter::kSourceSps, GetSps),
+    PAYLOAD_FIELD(chroma_format_idc, H265Filter::kSourceSps, GetSps),
+    PAYLOAD_FIELD(pic_width_in_luma_samples, H265Filter::kSourceSps, GetSps),
+    PAYLOAD_FIELD(pic_height_in_luma_samples, H265Filter::kSourceSps, GetSps),
+    PAYLOAD_FIELD(bit_depth_luma_minus8, H265Filter::kSourceSps, GetSps),
+    PAYLOAD_FIELD(pps_pic_parameter_set_id, H265Filter::kSourcePps, GetPps),
+    PAYLOAD_FIELD(pps_seq_parameter_set_id, H265Filter::kSourcePps, GetPps),
+    PAYLOAD_FIELD(init_qp_minus26, H265Filter::kSourcePps, GetPps),
+};
+
+#undef SLICE_FIELD
+#undef PAYLOAD_FIELD
+#undef HEADER_FIELD
+
+struct Constant {
+  const char* name;
+  int64_t value;
+};
+
+const Constant kConstants[] = {
+    {"TRAIL_N", TRAIL_N},
+    {"TRAIL_R", TRAIL_R},
+    {"TSA_N", TSA_N},
+    {"TSA_R", TSA_R},
+    {"STSA_N", STSA_N},
+    {"STSA_R", STSA_R},
+    {"RADL_N", RADL_N},
+    {"RADL_R", RADL_R},
+    {"RASL_N", RASL_N},
+    {"RASL_R", RASL_R},
+    {"BLA_W_LP", BLA_W_LP},
+    {"BLA_W_RADL", BLA_W_RADL},
+    {"BLA_N_LP", BLA_N_LP},
+    {"IDR_W_RADL", IDR_W_RADL},
+    {"IDR_N_LP", IDR_N_LP},
+    {"CRA_NUT", CRA_NUT},
+    {"VPS_NUT", VPS_NUT},
+    {"SPS_NUT", SPS_NUT},
+    {"PPS_NUT", PPS_NUT},
+    {"AUD_NUT", AUD_NUT},
+    {"EOS_NUT", EOS_NUT},
+    {"EOB_NUT", EOB_NUT},
+    {"FD_NUT", FD_NUT},
+    {"PREFIX_SEI_NUT", PREFIX_SEI_NUT},
+    {"SUFFIX_SEI_NUT", SUFFIX_SEI_NUT},
+    // Table 7-7
+    {"B", SliceType_B},
+    {"P", SliceType_P},
+    {"I", SliceType_I},
+};
+}  // namespace
+
+struct H265Filter::Node {
+  enum Op {
+    kConstant,
+    kField,
+    kNot,
+    kAnd,
+    kOr,
+    kEq,
+    kNe,
+    kLt,
+    kLe,
+    kGt,
+    kGe,
+  };
+  Op op = kConstant;
+  // kConstant value
+  int64_t value = 0;
+  // kField index (in kFields)
+  int field = -1;
+  // operands
+  int lhs = -1;
+  int rhs = -1;
+};
+
+// A recursive-descent compiler. Nodes are appended to the filter node
+// list, and referenced by index.
+class H265Filter::Compiler {
+ public:
+  Compiler(const std::string& expression, H265Filter* filter)
+      : expression_(expression), filter_(filter) {}
+
+  bool Compile(std::string* error) {
+    filter_->root_ = ParseOr();
+    SkipSpaces();
+    if (filter_->root_ >= 0 && pos_ != expression_.size()) {
+      SetError("unexpected input");
+    }
+    if (!error_.empty()) {
+      if (error != nullptr) {
+        *error = error_ + " at position " + std::to_string(pos_);
+      }
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  void SkipSpaces() {
+    while (pos_ < expression_.size() && isspace(expression_[pos_])) {
+      pos_++;
+    }
+  }
+
+  // Consume `token` if it is next in the input.
+  bool Accept(const char* token) {
+    SkipSpaces();
+    size_t len = strlen(token);
+    if (expression_.compare(pos_, len, token) != 0) {
+      return false;
+    }
+    pos_ += len;
+    return true;
+  }
+
+  void SetError(const std::string& error) {
+    if (error_.empty()) {
+      error_ = error;
+    }
+  }
+
+  int AddNode(Node::Op op, int lhs, int rhs) {
+    Node node;
+    node.op = op;
+    node.lhs = lhs;
+    node.rhs = rhs;
+    filter_->nodes_.push_back(node);
+    return static_cast<int>(filter_->nodes_.size()) - 1;
+  }
+
+  int ParseOr() {
+    int lhs = ParseAnd();
+    while (lhs >= 0 && Accept("||")) {
+      int rhs = ParseAnd();
+      if (rhs < 0) {
+        return -1;
+      }
+      lhs = AddNode(Node::kOr, lhs, rhs);
+    }
+    return lhs;
+  }
+
+  int ParseAnd() {
+    int lhs = ParseUnary();
+    while (lhs >= 0 && Accept("&&")) {
+      int rhs = ParseUnary();
+      if (rhs < 0) {
+        return -1;
+      }
+      lhs = AddNode(Node::kAnd, lhs, rhs);
+    }
+    return lhs;
+  }
+
+  int ParseUnary() {
+    // "!=" is a comparison operator, not a negation
+    SkipSpaces();
+    if (expression_.compare(pos_, 2, "!=") != 0 && Accept("!")) {
+      int operand = ParseUnary();
+      return (operand < 0) ? -1 : AddNode(Node::kNot, operand, -1);
+    }
+    if (Accept("(")) {
+      int expr = ParseOr();
+      if (expr >= 0 && !Accept(")")) {
+        SetError("missing ')'");
+        return -1;
+      }
+      return expr;
+    }
+    return ParseComparison();
+  }
+
+  int ParseComparison() {
+    int lhs = ParseOperand();
+    if (lhs < 0) {
+      return -1;
+    }
+    // longer operators first
+    static const struct {
+      const char* token;
+      Node::Op op;
+    } kOperators[] = {
+        {"==", Node::kEq}, {"!=", Node::kNe}, {"<=", Node::kLe},
+        {">=", Node::kGe}, {"<", Node::kLt},  {">", Node::kGt},
+    };
+    for (const auto& op : kOperators) {
+      if (Accept(op.token)) {
+        int rhs = ParseOperand();
+        return (rhs < 0) ? -1 : AddNode(op.op, lhs, rhs);
+      }
+    }
+    return lhs;
+  }
+
+  int ParseOperand() {
+    SkipSpaces();
+    size_t start = pos_;
+    if (pos_ < expression_.size() && expression_[pos_] == '-') {
+      pos_++;
+    }
+    if (pos_ < expression_.size() && isdigit(expression_[pos_])) {
+      // integer literal
+      while (pos_ < expression_.size() && isdigit(expression_[pos_])) {
+        pos_++;
+      }
+      int node = AddNode(Node::kConstant, -1, -1);
+      filter_->nodes_[node].value =
+          strtoll(expression_.substr(start, pos_ - start).c_str(), nullptr, 10);
+      return node;
+    }
+    pos_ = start;
+    while (pos_ < expression_.size() &&
+           (isalnum(expression_[pos_]) || expression_[pos_] == '_')) {
+      pos_++;
+    }
+    std::string name = expression_.substr(start, pos_ - start);
+    if (name.empty()) {
+      SetError("expected a field, a constant, or an integer");
+      return -1;
+    }
+    for (size_t i = 0; i < sizeof(kFields) / sizeof(kFields[0]); i++) {
+      if (name == kFields[i].name) {
+        int node = AddNode(Node::kField, -1, -1);
+        filter_->nodes_[node].field = static_cast<int>(i);
+        filter_->sources_ |= kFields[i].source;
+        return node;
+      }
+    }
+    for (const auto& constant : kConstants) {
+      if (name == constant.name) {
+        int node = AddNode(Node::kConstant, -1, -1);
+        filter_->nodes_[node].value = constant.value;
+        return node;
+      }
+    }
+    pos_ = start;
+    SetError("unknown field or constant \"" + name + "\"");
+    return -1;
+  }
+
+  const std::string& expression_;
+  H265Filter* filter_;
+  size_t pos_ = 0;
+  std::string error_;
+};
+
+H265Filter::H265Filter() = default;
+H265Filter::~H265Filter() = default;
+
+std::unique_ptr<H265Filter> H265Filter::Compile(const std::string& expression,
+                                                std::string* error) noexcept {
+  // make_unique cannot use the private ctor
+  std::unique_ptr<H265Filter> filter(new H265Filter());
+  Compiler compiler(expression, filter.get());
+  if (!compiler.Compile(error)) {
+    return nullptr;
+  }
+  return filter;
+}
+
+std::vector<std::string> H265Filter::GetFieldNames() {
+  std::vector<std::string> names;
+  for (const auto& field : kFields) {
+    names.push_back(field.name);
+  }
+  return names;
+}
+
+bool H265Filter::NeedsPayload(uint32_t nal_unit_type) const {
+  uint32_t sources = sources_;
+  // slice headers can only be parsed with their parameter sets
+  if (sources & kSourceSliceHeader) {
+    sources |= kSourceVps | kSourceSps | kSourcePps;
+  }
+  if (sources & kSourcePps) {
+    sources |= kSourceSps;
+  }
+  switch (nal_unit_type) {
+    case VPS_NUT:
+      return (sources & kSourceVps) != 0;
+    case SPS_NUT:
+      return (sources & kSourceSps) != 0;
+    case PPS_NUT:
+      return (sources & kSourcePps) != 0;
+    default:
+      return IsSliceSegment(nal_unit_type) &&
+             (sources & kSourceSliceHeader) != 0;
+  }
+}
+
+bool H265Filter::GetOperand(int node, const NalUnitState* nal_unit,
+                            const NalUnitHeaderState& header, bool* unknown,
+                            int64_t* value) const {
+  const Node& operand = nodes_[node];
+  if (operand.op == Node::kConstant) {
+    *value = operand.value;
+    return true;
+  }
+  const Field& field = kFields[operand.field];
+  if (field.header_getter != nullptr) {
+    *value = field.header_getter(header);
+    return true;
+  }
+  if (nal_unit == nullptr) {
+    *unknown = true;
+    return false;
+  }
+  return field.payload_getter(*nal_unit, value);
+}
+
+int H265Filter::EvaluateNode(int node, const NalUnitState* nal_unit,
+                             const NalUnitHeaderState& header) const {
+  const Node& n = nodes_[node];
+  switch (n.op) {
+    case Node::kNot: {
+      int result = EvaluateNode(n.lhs, nal_unit, header);
+      return (result < 0) ? -1 : !result;
+    }
+    case Node::kAnd:
+    case Node::kOr: {
+      // short-circuit on the value that decides the result
+      int decisive = (n.op == Node::kAnd) ? 0 : 1;
+      int lhs = EvaluateNode(n.lhs, nal_unit, header);
+      if (lhs == decisive) {
+        return decisive;
+      }
+      int rhs = EvaluateNode(n.rhs, nal_unit, header);
+      if (rhs == decisive) {
+        return decisive;
+      }
+      return (lhs < 0 || rhs < 0) ? -1 : !decisive;
+    }
+    case Node::kConstant:
+    case Node::kField: {
+      bool unknown = false;
+      int64_t value = 0;
+      if (!GetOperand(node, nal_unit, header, &unknown, &value)) {
+        return unknown ? -1 : 0;
+      }
+      return value != 0;
+    }
+    default:
+      break;
+  }
+
+  // comparisons
+  bool unknown = false;
+  int64_t lhs = 0;
+  int64_t rhs = 0;
+  bool lhs_present = GetOperand(n.lhs, nal_unit, header, &unknown, &lhs);
+  bool rhs_present = GetOperand(n.rhs, nal_unit, header, &unknown, &rhs);
+  if (unknown) {
+    return -1;
+  }
+  if (!lhs_present || !rhs_present) {
+    return 0;
+  }
+  switch (n.op) {
+    case Node::kEq:
+      return lhs == rhs;
+    case Node::kNe:
+      return lhs != rhs;
+    case Node::kLt:
+      return lhs < rhs;
+    case Node::kLe:
+      return lhs <= rhs;
+    case Node::kGt:
+      return lhs > rhs;
+    case Node::kGe:
+      return lhs >= rhs;
+    default:
+      return 0;
+  }
+}
+
+H265Filter::Match H265Filter::EvaluateHeader(
+    const NalUnitHeaderState& header) const {
+  int result = EvaluateNode(root_, nullptr, header);
+  if (result < 0) {
+    return Match::kUnknown;
+  }
+  return result ? Match::kTrue : Match::kFalse;
+}
+
+bool H265Filter::Evaluate(const NalUnitState& nal_unit) const {
+  if (nal_unit.nal_unit_header == nullptr) {
+    return false;
+  }
+  return EvaluateNode(root_, &nal_unit, *(nal_unit.nal_unit_header)) == 1;
+}
+
+}  // namespace h265nal
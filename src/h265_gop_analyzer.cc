@@ -0,0 +1,273 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_gop_analyzer.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <memory>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "h265_nal_unit_payload_parser.h"
+#include "h265_slice_parser.h"
+
+namespace h265nal {
+
+// General note: this is based off the 2016/12 version of the H.265 standard.
+// You can find it on this page:
+// http://www.itu.int/rec/T-REC-H.265
+
+namespace {
+// Tolerance used when comparing accumulated stream times.
+const double kTimeEpsilon = 1e-9;
+
+bool IsIrap(uint32_t nal_unit_type) {
+  // Section 3.73: IRAP pictures have nal_unit_type in the range
+  // BLA_W_LP..RSV_IRAP_VCL23
+  return nal_unit_type >= BLA_W_LP && nal_unit_type <= RSV_IRAP_VCL23;
+}
+}  // namespace
+
+bool H265GopAnalyzer::GopInfo::IsOpen() const noexcept {
+  // IDR pictures, and BLA_W_RADL/BLA_N_LP pictures, cannot have RASL
+  // pictures associated (Table 7-1)
+  return (irap_nal_unit_type == CRA_NUT || irap_nal_unit_type == BLA_W_LP) &&
+         num_rasl_frames > 0;
+}
+
+double H265GopAnalyzer::Report::GetBitrate() const noexcept {
+  double duration = end_time - start_time;
+  return (duration <= 0.0) ? 0.0 : (size_bytes * 8) / duration;
+}
+
+double H265GopAnalyzer::GetFrameDuration(uint32_t pps_id) const noexcept {
+  double default_duration =
+      (default_frame_rate_ > 0.0) ? (1.0 / default_frame_rate_) : 0.0;
+  auto pps = bitstream_parser_state_->GetPps(pps_id);
+  if (pps == nullptr) {
+    return default_duration;
+  }
+  auto sps = bitstream_parser_state_->GetSps(pps->pps_seq_parameter_set_id);
+  if (sps == nullptr || !sps->vui_parameters_present_flag ||
+      sps->vui_parameters == nullptr) {
+    return default_duration;
+  }
+  const auto& vui = *(sps->vui_parameters);
+  if (!vui.vui_timing_info_present_flag || vui.vui_time_scale == 0) {
+    return default_duration;
+  }
+  // Section E.3.1: a clock tick is num_units_in_tick / time_scale seconds
+  return static_cast<double>(vui.vui_num_units_in_tick) / vui.vui_time_scale;
+}
+
+bool H265GopAnalyzer::ProcessNalUnit(const uint8_t* data, size_t length,
+                                     Report* report) noexcept {
+  // nal_unit_header()
+  if (length < 2) {
+    return false;
+  }
+  uint32_t nal_unit_type = (data[0] >> 1) & 0x3f;
+  uint32_t nuh_temporal_id_plus1 = data[1] & 0x07;
+  const uint8_t* payload = data + 2;
+  size_t payload_length = length - 2;
+
+  if (nal_unit_type == VPS_NUT || nal_unit_type == SPS_NUT ||
+      nal_unit_type == PPS_NUT) {
+    // keep the parameter sets up to date
+    H265NalUnitPayloadParser::ParseNalUnitPayload(
+        payload, payload_length, nal_unit_type, bitstream_parser_state_);
+    return false;
+  }
+  if (!IsSliceSegment(nal_unit_type)) {
+    return false;
+  }
+
+  // parse the slice segment header up to the QP offsets
+  auto slice_segment_header =
+      H265SliceSegmentHeaderParser::ParseSliceSegmentHeaderPrefix(
+          payload, payload_length, nal_unit_type, bitstream_parser_state_,
+          &rbsp_buffer_);
+  if (slice_segment_header == nullptr) {
+    return false;
+  }
+
+  bool report_ready = false;
+  if (slice_segment_header->first_slice_segment_in_pic_flag) {
+    CloseFrame();
+    if (current_report_.num_frames > 0 &&
+        time_ + kTimeEpsilon >=
+            current_report_.start_time + report_interval_) {
+      EndReport(report);
+      report_ready = true;
+    }
+    current_frame_ = FrameInfo();
+    current_frame_.frame_index = num_frames_;
+    current_frame_.nal_unit_type = nal_unit_type;
+    current_frame_.temporal_id =
+        (nuh_temporal_id_plus1 > 0) ? (nuh_temporal_id_plus1 - 1) : 0;
+    current_frame_.slice_type = slice_segment_header->slice_type;
+    current_frame_duration_ =
+        GetFrameDuration(slice_segment_header->slice_pic_parameter_set_id);
+    has_current_frame_ = true;
+  } else if (!has_current_frame_) {
+    // the first slice segment of the picture was lost
+    return false;
+  }
+
+  // dependent slice segments inherit slice_type (Section 7.4.7.1)
+  if (!slice_segment_header->dependent_slice_segment_flag) {
+    current_frame_.slice_type =
+        std::min(current_frame_.slice_type, slice_segment_header->slice_type);
+  }
+  current_frame_.size_bytes += length;
+  return report_ready;
+}
+
+void H265GopAnalyzer::ProcessBitstream(const uint8_t* data, size_t length,
+                                       std::vector<Report>* reports) noexcept {
+  auto nalu_indices = H265BitstreamParser::FindNaluIndices(data, length);
+  Report report;
+  for (const auto& nalu_index : nalu_indices) {
+    if (ProcessNalUnit(data + nalu_index.payload_start_offset,
+                       nalu_index.payload_size, &report)) {
+      reports->push_back(report);
+    }
+  }
+}
+
+void H265GopAnalyzer::CloseFrame() noexcept {
+  if (!has_current_frame_) {
+    return;
+  }
+  has_current_frame_ = false;
+  const FrameInfo& frame = current_frame_;
+  uint32_t slice_type = frame.slice_type % kNumSliceTypes;
+
+  // GOP accounting
+  if (IsIrap(frame.nal_unit_type)) {
+    CloseGop();
+    current_gop_ = GopInfo();
+    current_gop_.first_frame_index = frame.frame_index;
+    current_gop_.irap_nal_unit_type = frame.nal_unit_type;
+    has_current_gop_ = true;
+  }
+  if (has_current_gop_) {
+    current_gop_.num_frames++;
+    if (frame.nal_unit_type == RASL_N || frame.nal_unit_type == RASL_R) {
+      current_gop_.num_rasl_frames++;
+    } else if (frame.nal_unit_type == RADL_N ||
+               frame.nal_unit_type == RADL_R) {
+      current_gop_.num_radl_frames++;
+    }
+    current_gop_.max_temporal_id =
+        std::max(current_gop_.max_temporal_id, frame.temporal_id);
+    current_gop_.size_bytes += frame.size_bytes;
+    current_gop_.frame_size[slice_type].Add(frame.size_bytes);
+  }
+  frames_.Push(frame);
+  num_frames_++;
+
+  // report accounting
+  current_report_.num_frames++;
+  current_report_.size_bytes += frame.size_bytes;
+  current_report_.max_temporal_id =
+      std::max(current_report_.max_temporal_id, frame.temporal_id);
+  current_report_.frame_size[slice_type].Add(frame.size_bytes);
+  time_ += current_frame_duration_;
+}
+
+void H265GopAnalyzer::EndReport(Report* report) noexcept {
+  current_report_.end_time = time_;
+  if (report != nullptr) {
+    *report = current_report_;
+  }
+  uint32_t report_index = current_report_.report_index;
+  current_report_ = Report();
+  current_report_.report_index = report_index + 1;
+  current_report_.start_time = time_;
+}
+
+void H265GopAnalyzer::CloseGop() noexcept {
+  if (!has_current_gop_) {
+    return;
+  }
+  has_current_gop_ = false;
+  gops_.Push(current_gop_);
+  num_gops_++;
+  current_report_.num_gops++;
+  if (current_gop_.IsOpen()) {
+    current_report_.num_open_gops++;
+  } else {
+    current_report_.num_closed_gops++;
+  }
+  current_report_.gop_length.Add(current_gop_.num_frames);
+}
+
+bool H265GopAnalyzer::Flush(Report* report) noexcept {
+  CloseFrame();
+  CloseGop();
+  if (current_report_.num_frames == 0 && current_report_.num_gops == 0) {
+    return false;
+  }
+  EndReport(report);
+  return true;
+}
+
+#ifdef FDUMP_DEFINE
+void H265GopAnalyzer::Report::fdump(FILE* outfp, int indent_level) const {
+  fprintf(outfp, "gop_report {");
+  indent_level = indent_level_incr(indent_level);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "report_index: %i", report_index);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "start_time: %f", start_time);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "end_time: %f", end_time);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "num_frames: %i", num_frames);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "bitrate: %f", GetBitrate());
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "num_gops: %i", num_gops);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "num_open_gops: %i", num_open_gops);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "num_closed_gops: %i", num_closed_gops);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "gop_length { min: %" PRIu64 " avg: %f max: %" PRIu64 " }",
+          gop_length.min, gop_length.Average(), gop_length.max);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "max_temporal_id: %i", max_temporal_id);
+
+  static const char* kSliceTypeNames[kNumSliceTypes] = {"b", "p", "i"};
+  for (size_t i = 0; i < kNumSliceTypes; ++i) {
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp,
+            "%s_frame_size { count: %i min: %" PRIu64 " avg: %f max: %" PRIu64
+            " }",
+            kSliceTypeNames[i], frame_size[i].count, frame_size[i].min,
+            frame_size[i].Average(), frame_size[i].max);
+  }
+
+  indent_level = indent_level_decr(indent_level);
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "}");
+}
+#endif  // FDUMP_DEFINE
+
+}  // namespace h265nal
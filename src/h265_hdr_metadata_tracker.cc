@@ -0,0 +1,114 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_hdr_metadata_tracker.h"
+
+#include <stdio.h>
+
+#include <memory>
+
+#include "h265_common.h"
+#include "h265_sei_parser.h"
+
+namespace h265nal {
+
+namespace {
+
+typedef H265SeiMasteringDisplayColourVolumeParser::
+    H265SeiMasteringDisplayColourVolumeState MdcvState;
+typedef H265SeiContentLightLevelInfoParser::H265SeiContentLightLevelInfoState
+    CllState;
+
+// The payloads are small (24 and 4 bytes), so the values are compared
+// directly instead of hashing the raw payload bytes.
+bool SameValues(const MdcvState& a, const MdcvState& b) {
+  return a.display_primaries_x == b.display_primaries_x &&
+         a.display_primaries_y == b.display_primaries_y &&
+         a.white_point_x == b.white_point_x &&
+         a.white_point_y == b.white_point_y &&
+         a.max_display_mastering_luminance ==
+             b.max_display_mastering_luminance &&
+         a.min_display_mastering_luminance ==
+             b.min_display_mastering_luminance;
+}
+
+bool SameValues(const CllState& a, const CllState& b) {
+  return a.max_content_light_level == b.max_content_light_level &&
+         a.max_pic_average_light_level == b.max_pic_average_light_level;
+}
+
+void CopyValues(const MdcvState& from, MdcvState* to) {
+  to->display_primaries_x = from.display_primaries_x;
+  to->display_primaries_y = from.display_primaries_y;
+  to->white_point_x = from.white_point_x;
+  to->white_point_y = from.white_point_y;
+  to->max_display_mastering_luminance = from.max_display_mastering_luminance;
+  to->min_display_mastering_luminance = from.min_display_mastering_luminance;
+}
+
+void CopyValues(const CllState& from, CllState* to) {
+  to->max_content_light_level = from.max_content_light_level;
+  to->max_pic_average_light_level = from.max_pic_average_light_level;
+}
+
+}  // namespace
+
+uint32_t H265HdrMetadataTracker::ProcessSeiRbsp(
+    const H265SeiRbspParser::SeiRbspState& sei_rbsp) noexcept {
+  uint32_t changes = kNoChange;
+  for (const auto& sei_message : sei_rbsp.sei_message) {
+    if (sei_message == nullptr || sei_message->payload_state == nullptr) {
+      continue;
+    }
+    if (sei_message->payload_type == SeiType::mastering_display_colour_volume) {
+      const auto* mdcv =
+          static_cast<const MdcvState*>(sei_message->payload_state.get());
+      if (mastering_display_colour_volume_ != nullptr &&
+          SameValues(*mastering_display_colour_volume_, *mdcv)) {
+        continue;
+      }
+      if (mastering_display_colour_volume_ == nullptr) {
+        mastering_display_colour_volume_ = std::make_unique<MdcvState>();
+      }
+      CopyValues(*mdcv, mastering_display_colour_volume_.get());
+      changes |= kMasteringDisplayColourVolumeChanged;
+
+    } else if (sei_message->payload_type ==
+               SeiType::content_light_level_info) {
+      const auto* cll =
+          static_cast<const CllState*>(sei_message->payload_state.get());
+      if (content_light_level_info_ != nullptr &&
+          SameValues(*content_light_level_info_, *cll)) {
+        continue;
+      }
+      if (content_light_level_info_ == nullptr) {
+        content_light_level_info_ = std::make_unique<CllState>();
+      }
+      CopyValues(*cll, content_light_level_info_.get());
+      changes |= kContentLightLevelInfoChanged;
+    }
+  }
+  return changes;
+}
+
+uint32_t H265HdrMetadataTracker::ProcessSeiRbsp(const uint8_t* data,
+                                                size_t length) noexcept {
+  H265SeiMessageFilter filter;
+  filter.AddPayloadType(SeiType::mastering_display_colour_volume);
+  filter.AddPayloadType(SeiType::content_light_level_info);
+  ParsingOptions parsing_options;
+  auto sei_rbsp =
+      H265SeiRbspParser::ParseSeiRbsp(data, length, parsing_options, &filter);
+  if (sei_rbsp == nullptr) {
+    return kNoChange;
+  }
+  return ProcessSeiRbsp(*sei_rbsp);
+}
+
+void H265HdrMetadataTracker::Reset() noexcept {
+  mastering_display_colour_volume_.reset();
+  content_light_level_info_.reset();
+}
+
+}  // namespace h265nal
@@ -0,0 +1,255 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_hrd_simulator.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "h265_hrd_parameters_parser.h"
+#include "h265_sei_parser.h"
+#include "h265_sps_parser.h"
+
+namespace h265nal {
+
+// General note: this is based off the 2016/12 version of the H.265 standard.
+// You can find it on this page:
+// http://www.itu.int/rec/T-REC-H.265
+
+namespace {
+// initial_cpb_removal_delay and initial_cpb_removal_offset are in units of a
+// 90 kHz clock (Section D.3.2).
+const double kInitialCpbRemovalDelayClock = 90000.0;
+}  // namespace
+
+std::unique_ptr<H265HrdSimulator> H265HrdSimulator::Create(
+    const H265SpsParser::SpsState& sps, bool use_vcl_hrd) noexcept {
+  if (!sps.vui_parameters_present_flag || sps.vui_parameters == nullptr) {
+    return nullptr;
+  }
+  const auto& vui = *sps.vui_parameters;
+  if (!vui.vui_timing_info_present_flag || vui.vui_time_scale == 0 ||
+      !vui.vui_hrd_parameters_present_flag || vui.hrd_parameters == nullptr) {
+    return nullptr;
+  }
+  const auto& hrd = *vui.hrd_parameters;
+  if (!(use_vcl_hrd ? hrd.vcl_hrd_parameters_present_flag
+                    : hrd.nal_hrd_parameters_present_flag)) {
+    return nullptr;
+  }
+
+  // sub_layer_hrd_parameters() are stored in syntax order: for each
+  // sub-layer, the NAL one (if present) and then the VCL one (if present)
+  uint32_t HighestTid = sps.sps_max_sub_layers_minus1;
+  size_t index = 0;
+  for (uint32_t i = 0; i < HighestTid; i++) {
+    index += hrd.nal_hrd_parameters_present_flag ? 1 : 0;
+    index += hrd.vcl_hrd_parameters_present_flag ? 1 : 0;
+  }
+  if (use_vcl_hrd && hrd.nal_hrd_parameters_present_flag) {
+    index++;
+  }
+  if (index >= hrd.sub_layer_hrd_parameters_vector.size()) {
+    return nullptr;
+  }
+  const auto& sub_layer_hrd = *hrd.sub_layer_hrd_parameters_vector[index];
+  if (sub_layer_hrd.bit_rate_value_minus1.empty() ||
+      sub_layer_hrd.cpb_size_value_minus1.empty() ||
+      sub_layer_hrd.cbr_flag.empty()) {
+    return nullptr;
+  }
+
+  HrdConfig config;
+  // Equation E-77
+  config.bit_rate =
+      static_cast<double>(
+          static_cast<uint64_t>(sub_layer_hrd.bit_rate_value_minus1[0]) + 1) *
+      static_cast<double>(1ULL << (6 + hrd.bit_rate_scale));
+  // Equation E-78
+  config.cpb_size =
+      static_cast<double>(
+          static_cast<uint64_t>(sub_layer_hrd.cpb_size_value_minus1[0]) + 1) *
+      static_cast<double>(1ULL << (4 + hrd.cpb_size_scale));
+  config.cbr = sub_layer_hrd.cbr_flag[0];
+  // Equation C-1
+  config.clock_tick = static_cast<double>(vui.vui_num_units_in_tick) /
+                      static_cast<double>(vui.vui_time_scale);
+  if (HighestTid < sps.sps_max_dec_pic_buffering_minus1.size()) {
+    config.dpb_size = sps.sps_max_dec_pic_buffering_minus1[HighestTid] + 1;
+  }
+  return Create(config, use_vcl_hrd);
+}
+
+std::unique_ptr<H265HrdSimulator> H265HrdSimulator::Create(
+    const HrdConfig& config, bool use_vcl_hrd) noexcept {
+  if (!IsValidConfig(config)) {
+    return nullptr;
+  }
+  return std::make_unique<H265HrdSimulator>(config, use_vcl_hrd);
+}
+
+bool H265HrdSimulator::IsValidConfig(const HrdConfig& config) noexcept {
+  // the arrival times are divided by the bit rate (Equation C-7), and a
+  // non-positive CPB size would always overflow (also rejects NaNs)
+  return config.bit_rate > 0 && config.cpb_size > 0 &&
+         config.clock_tick >= 0;
+}
+
+bool H265HrdSimulator::AddAccessUnit(
+    const AccessUnit& access_unit,
+    std::vector<AccessUnitTiming>* timing) noexcept {
+  const auto* buffering_period = access_unit.buffering_period;
+  const auto* pic_timing = access_unit.pic_timing;
+  if (!valid_ || pic_timing == nullptr ||
+      (num_access_units_ == 0 && buffering_period == nullptr)) {
+    return false;
+  }
+
+  // Section C.2.2: timing of CPB removal
+  double removal_time = 0;
+  if (buffering_period != nullptr) {
+    const auto& initial_cpb_removal_delay =
+        use_vcl_hrd_ ? buffering_period->vcl_initial_cpb_removal_delay
+                     : buffering_period->nal_initial_cpb_removal_delay;
+    const auto& initial_cpb_removal_offset =
+        use_vcl_hrd_ ? buffering_period->vcl_initial_cpb_removal_offset
+                     : buffering_period->nal_initial_cpb_removal_offset;
+    if (initial_cpb_removal_delay.empty() ||
+        initial_cpb_removal_offset.empty()) {
+      return false;
+    }
+    if (num_access_units_ == 0) {
+      // Equation C-9: the first access unit is removed after
+      // InitCpbRemovalDelay
+      removal_time =
+          initial_cpb_removal_delay[0] / kInitialCpbRemovalDelayClock;
+    } else {
+      // Equations C-10 and C-11
+      double au_cpb_removal_delay_val =
+          pic_timing->au_cpb_removal_delay_minus1 + 1.0;
+      removal_time =
+          base_time_ + config_.clock_tick * au_cpb_removal_delay_val;
+      if (buffering_period->concatenation_flag) {
+        double tmp_nominal_removal_time =
+            prev_removal_time_ +
+            config_.clock_tick *
+                (buffering_period->au_cpb_removal_delay_delta_minus1 + 1.0);
+        removal_time = std::max(removal_time, tmp_nominal_removal_time);
+      }
+    }
+    init_cpb_removal_delay_ =
+        initial_cpb_removal_delay[0] / kInitialCpbRemovalDelayClock;
+    init_cpb_removal_delay_offset_ =
+        initial_cpb_removal_offset[0] / kInitialCpbRemovalDelayClock;
+    base_time_ = removal_time;
+  } else {
+    // Equation C-12
+    removal_time = base_time_ + config_.clock_tick *
+                                    (pic_timing->au_cpb_removal_delay_minus1 +
+                                     1.0);
+  }
+
+  // Section C.2.1: timing of bitstream arrival
+  double initial_arrival_time = 0;
+  if (num_access_units_ > 0) {
+    if (config_.cbr) {
+      // Equation C-3
+      initial_arrival_time = prev_final_arrival_time_;
+    } else {
+      // Equations C-4 to C-6
+      double earliest_arrival_time =
+          removal_time - init_cpb_removal_delay_ -
+          (buffering_period != nullptr ? 0 : init_cpb_removal_delay_offset_);
+      initial_arrival_time =
+          std::max(prev_final_arrival_time_, earliest_arrival_time);
+    }
+  }
+  // Equation C-7
+  double final_arrival_time =
+      initial_arrival_time + access_unit.size_bits / config_.bit_rate;
+
+  AccessUnitTiming au_timing;
+  au_timing.index = num_access_units_;
+  au_timing.initial_arrival_time = initial_arrival_time;
+  au_timing.final_arrival_time = final_arrival_time;
+  au_timing.removal_time = removal_time;
+  // Equation C-16
+  au_timing.dpb_output_time =
+      removal_time + config_.clock_tick * pic_timing->pic_dpb_output_delay;
+  pending_.push_back(au_timing);
+  pending_size_bits_.push_back(access_unit.size_bits);
+
+  num_access_units_++;
+  prev_removal_time_ = removal_time;
+  prev_final_arrival_time_ = final_arrival_time;
+
+  // later access units start arriving after this one has fully arrived, so
+  // every pending access unit removed before that is final
+  while (!pending_.empty() &&
+         pending_.front().removal_time <= final_arrival_time) {
+    FinalizeAccessUnit(timing);
+  }
+  return true;
+}
+
+void H265HrdSimulator::Flush(std::vector<AccessUnitTiming>* timing) noexcept {
+  while (!pending_.empty()) {
+    FinalizeAccessUnit(timing);
+  }
+}
+
+void H265HrdSimulator::FinalizeAccessUnit(
+    std::vector<AccessUnitTiming>* timing) noexcept {
+  AccessUnitTiming au_timing = pending_.front();
+  double removal_time = au_timing.removal_time;
+
+  // CPB fullness just before the removal: all the previous access units
+  // have been removed, so only the bits of this one and the following ones
+  // that arrived so far are in the CPB
+  double cpb_fullness = 0;
+  for (size_t i = 0; i < pending_.size(); i++) {
+    if (pending_[i].initial_arrival_time >= removal_time) {
+      break;
+    }
+    double arrived_bits =
+        (std::min(removal_time, pending_[i].final_arrival_time) -
+         pending_[i].initial_arrival_time) *
+        config_.bit_rate;
+    cpb_fullness += std::min(arrived_bits,
+                             static_cast<double>(pending_size_bits_[i]));
+  }
+  au_timing.cpb_fullness = cpb_fullness;
+  au_timing.cpb_overflow = cpb_fullness > config_.cpb_size;
+  // Section C.4: the access unit must be fully in the CPB at removal time
+  au_timing.cpb_underflow = au_timing.final_arrival_time > removal_time;
+
+  // Section C.3.3: pictures are output when their output time is reached
+  while (!dpb_output_times_.empty() &&
+         dpb_output_times_.top() <= removal_time) {
+    dpb_output_times_.pop();
+  }
+  dpb_output_times_.push(au_timing.dpb_output_time);
+  au_timing.dpb_fullness = dpb_output_times_.size();
+  au_timing.dpb_overflow =
+      config_.dpb_size > 0 && au_timing.dpb_fullness > config_.dpb_size;
+
+  stats_.num_access_units++;
+  stats_.num_cpb_overflows += au_timing.cpb_overflow ? 1 : 0;
+  stats_.num_cpb_underflows += au_timing.cpb_underflow ? 1 : 0;
+  stats_.num_dpb_overflows += au_timing.dpb_overflow ? 1 : 0;
+  stats_.max_cpb_fullness = std::max(stats_.max_cpb_fullness, cpb_fullness);
+  stats_.max_dpb_fullness =
+      std::max(stats_.max_dpb_fullness, au_timing.dpb_fullness);
+
+  pending_.pop_front();
+  pending_size_bits_.pop_front();
+  if (timing != nullptr) {
+    timing->push_back(au_timing);
+  }
+}
+
+}  // namespace h265nal
@@ -0,0 +1,503 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_hvcc_parser.h"
+
+#include <stdio.h>
+
+#include <cinttypes>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+#include "h265_pps_parser.h"
+#include "h265_profile_tier_level_parser.h"
+#include "h265_sps_parser.h"
+#include "h265_vps_parser.h"
+#include "rtc_base/bit_buffer.h"
+
+namespace h265nal {
+
+// General note: this is based off the 2017/02 version of the ISO/IEC
+// 14496-15 standard (Section 8.3.3.1, "HEVC decoder configuration
+// record").
+
+namespace {
+// NAL unit types in hvcC arrays, in the order they are written
+const uint32_t kArrayNalUnitTypes[] = {
+    NalUnitType::VPS_NUT, NalUnitType::SPS_NUT, NalUnitType::PPS_NUT,
+    NalUnitType::PREFIX_SEI_NUT, NalUnitType::SUFFIX_SEI_NUT};
+
+bool HasProfileCompatibility(
+    const H265ProfileInfoParser::ProfileInfoState& general,
+    uint32_t profile_idc) {
+  return general.profile_idc == profile_idc ||
+         general.profile_compatibility_flag[profile_idc] == 1;
+}
+
+// Pack the 48 bits that follow general_profile_compatibility_flag in
+// profile_tier_level() (Section 7.3.3 of the H.265 standard), as in
+// H265ProfileInfoParser::ParseProfileInfo().
+uint64_t PackConstraintIndicatorFlags(
+    const H265ProfileInfoParser::ProfileInfoState& general) {
+  uint8_t bytes[6] = {};
+  rtc::BitBufferWriter writer(bytes, sizeof(bytes));
+  writer.WriteBits(general.progressive_source_flag, 1);
+  writer.WriteBits(general.interlaced_source_flag, 1);
+  writer.WriteBits(general.non_packed_constraint_flag, 1);
+  writer.WriteBits(general.frame_only_constraint_flag, 1);
+  if (HasProfileCompatibility(general, 4) ||
+      HasProfileCompatibility(general, 5) ||
+      HasProfileCompatibility(general, 6) ||
+      HasProfileCompatibility(general, 7) ||
+      HasProfileCompatibility(general, 8) ||
+      HasProfileCompatibility(general, 9) ||
+      HasProfileCompatibility(general, 10)) {
+    writer.WriteBits(general.max_12bit_constraint_flag, 1);
+    writer.WriteBits(general.max_10bit_constraint_flag, 1);
+    writer.WriteBits(general.max_8bit_constraint_flag, 1);
+    writer.WriteBits(general.max_422chroma_constraint_flag, 1);
+    writer.WriteBits(general.max_420chroma_constraint_flag, 1);
+    writer.WriteBits(general.max_monochrome_constraint_flag, 1);
+    writer.WriteBits(general.intra_constraint_flag, 1);
+    writer.WriteBits(general.one_picture_only_constraint_flag, 1);
+    writer.WriteBits(general.lower_bit_rate_constraint_flag, 1);
+    if (HasProfileCompatibility(general, 5) ||
+        HasProfileCompatibility(general, 9) ||
+        HasProfileCompatibility(general, 10)) {
+      writer.WriteBits(general.max_14bit_constraint_flag, 1);
+      writer.WriteBits(general.reserved_zero_33bits, 33);
+    } else {
+      writer.WriteBits(general.reserved_zero_34bits, 34);
+    }
+  } else if (HasProfileCompatibility(general, 2)) {
+    writer.WriteBits(general.reserved_zero_7bits, 7);
+    writer.WriteBits(general.one_picture_only_constraint_flag, 1);
+    writer.WriteBits(general.reserved_zero_35bits, 35);
+  } else {
+    writer.WriteBits(general.reserved_zero_43bits, 43);
+  }
+  // inbld_flag and reserved_zero_bit share the same position
+  writer.WriteBits(general.inbld_flag | general.reserved_zero_bit, 1);
+  uint64_t flags = 0;
+  for (uint8_t byte : bytes) {
+    flags = (flags << 8) | byte;
+  }
+  return flags;
+}
+
+// avgFrameRate ("in units of frames/(256 seconds)") from a picture rate of
+// time_scale / num_units_in_tick.
+uint32_t GetAvgFrameRate(uint32_t num_units_in_tick, uint32_t time_scale,
+                         uint32_t field_seq_flag) {
+  if (num_units_in_tick == 0 || time_scale == 0) {
+    return 0;
+  }
+  // field-coded pictures: two pictures per frame
+  uint64_t divisor =
+      static_cast<uint64_t>(num_units_in_tick) * (field_seq_flag ? 2 : 1);
+  uint64_t avg_frame_rate =
+      (256ull * time_scale + divisor / 2) / divisor;
+  return (avg_frame_rate > 0xffff) ? 0 : static_cast<uint32_t>(avg_frame_rate);
+}
+}  // namespace
+
+std::unique_ptr<H265HvccParser::HvccState> H265HvccParser::ParseHvcc(
+    const uint8_t* data, size_t length,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    ParsingOptions parsing_options) noexcept {
+  rtc::BitBuffer bit_buffer(data, length);
+  auto hvcc = std::make_unique<HvccState>();
+  uint32_t bits_tmp;
+
+  // configurationVersion  u(8)
+  if (!bit_buffer.ReadBits(8, hvcc->configurationVersion) ||
+      hvcc->configurationVersion != 1) {
+    return nullptr;
+  }
+  // general_profile_space  u(2)
+  if (!bit_buffer.ReadBits(2, hvcc->general_profile_space)) {
+    return nullptr;
+  }
+  // general_tier_flag  u(1)
+  if (!bit_buffer.ReadBits(1, hvcc->general_tier_flag)) {
+    return nullptr;
+  }
+  // general_profile_idc  u(5)
+  if (!bit_buffer.ReadBits(5, hvcc->general_profile_idc)) {
+    return nullptr;
+  }
+  // general_profile_compatibility_flags  u(32)
+  if (!bit_buffer.ReadBits(32, hvcc->general_profile_compatibility_flags)) {
+    return nullptr;
+  }
+  // general_constraint_indicator_flags  u(48)
+  if (!bit_buffer.ReadBits(48, hvcc->general_constraint_indicator_flags)) {
+    return nullptr;
+  }
+  // general_level_idc  u(8)
+  if (!bit_buffer.ReadBits(8, hvcc->general_level_idc)) {
+    return nullptr;
+  }
+  // reserved  u(4)  min_spatial_segmentation_idc  u(12)
+  if (!bit_buffer.ReadBits(4, bits_tmp) ||
+      !bit_buffer.ReadBits(12, hvcc->min_spatial_segmentation_idc)) {
+    return nullptr;
+  }
+  // reserved  u(6)  parallelismType  u(2)
+  if (!bit_buffer.ReadBits(6, bits_tmp) ||
+      !bit_buffer.ReadBits(2, hvcc->parallelismType)) {
+    return nullptr;
+  }
+  // reserved  u(6)  chromaFormat  u(2)
+  if (!bit_buffer.ReadBits(6, bits_tmp) ||
+      !bit_buffer.ReadBits(2, hvcc->chromaFormat)) {
+    return nullptr;
+  }
+  // reserved  u(5)  bitDepthLumaMinus8  u(3)
+  if (!bit_buffer.ReadBits(5, bits_tmp) ||
+      !bit_buffer.ReadBits(3, hvcc->bitDepthLumaMinus8)) {
+    return nullptr;
+  }
+  // reserved  u(5)  bitDepthChromaMinus8  u(3)
+  if (!bit_buffer.ReadBits(5, bits_tmp) ||
+      !bit_buffer.ReadBits(3, hvcc->bitDepthChromaMinus8)) {
+    return nullptr;
+  }
+  // avgFrameRate  u(16)
+  if (!bit_buffer.ReadBits(16, hvcc->avgFrameRate)) {
+    return nullptr;
+  }
+  // constantFrameRate  u(2)
+  if (!bit_buffer.ReadBits(2, hvcc->constantFrameRate)) {
+    return nullptr;
+  }
+  // numTemporalLayers  u(3)
+  if (!bit_buffer.ReadBits(3, hvcc->numTemporalLayers)) {
+    return nullptr;
+  }
+  // temporalIdNested  u(1)
+  if (!bit_buffer.ReadBits(1, hvcc->temporalIdNested)) {
+    return nullptr;
+  }
+  // lengthSizeMinusOne  u(2)
+  if (!bit_buffer.ReadBits(2, hvcc->lengthSizeMinusOne)) {
+    return nullptr;
+  }
+  // numOfArrays  u(8)
+  if (!bit_buffer.ReadBits(8, hvcc->numOfArrays)) {
+    return nullptr;
+  }
+
+  for (uint32_t j = 0; j < hvcc->numOfArrays; j++) {
+    auto array = std::make_unique<HvccArrayState>();
+    // array_completeness  u(1)  reserved  u(1)  NAL_unit_type  u(6)
+    if (!bit_buffer.ReadBits(1, array->array_completeness) ||
+        !bit_buffer.ReadBits(1, bits_tmp) ||
+        !bit_buffer.ReadBits(6, array->NAL_unit_type)) {
+      return nullptr;
+    }
+    // numNalus  u(16)
+    if (!bit_buffer.ReadBits(16, array->numNalus)) {
+      return nullptr;
+    }
+    for (uint32_t i = 0; i < array->numNalus; i++) {
+      // nalUnitLength  u(16)
+      uint32_t nal_unit_length;
+      if (!bit_buffer.ReadBits(16, nal_unit_length)) {
+        return nullptr;
+      }
+      // nalUnit  u(8 * nalUnitLength)
+      size_t byte_offset;
+      size_t bit_offset;
+      bit_buffer.GetCurrentOffset(&byte_offset, &bit_offset);
+      if (nal_unit_length > length - byte_offset ||
+          !bit_buffer.ConsumeBytes(nal_unit_length)) {
+        return nullptr;
+      }
+      array->nal_units.emplace_back(data + byte_offset,
+                                    data + byte_offset + nal_unit_length);
+    }
+    hvcc->arrays.push_back(std::move(array));
+  }
+
+  // parse the parameter sets into the bitstream parser state
+  if (bitstream_parser_state != nullptr) {
+    for (const auto& array : hvcc->arrays) {
+      for (const auto& nal_unit : array->nal_units) {
+        H265NalUnitParser::ParseNalUnit(nal_unit.data(), nal_unit.size(),
+                                        bitstream_parser_state,
+                                        parsing_options);
+      }
+    }
+  }
+
+  return hvcc;
+}
+
+std::unique_ptr<H265HvccParser::HvccState> H265HvccParser::GenerateHvcc(
+    const struct H265BitstreamParserState& bitstream_parser_state,
+    const std::vector<std::vector<uint8_t>>& nal_units,
+    uint32_t length_size) noexcept {
+  if (bitstream_parser_state.sps.empty() || length_size < 1 ||
+      length_size > 4 || length_size == 3) {
+    return nullptr;
+  }
+  const auto& sps = bitstream_parser_state.sps.begin()->second;
+  if (sps == nullptr || sps->profile_tier_level == nullptr ||
+      sps->profile_tier_level->general == nullptr) {
+    return nullptr;
+  }
+  const auto& general = *(sps->profile_tier_level->general);
+  auto hvcc = std::make_unique<HvccState>();
+
+  // profile, tier, and level
+  hvcc->general_profile_space = general.profile_space;
+  hvcc->general_tier_flag = general.tier_flag;
+  hvcc->general_profile_idc = general.profile_idc;
+  for (uint32_t j = 0; j < 32; j++) {
+    hvcc->general_profile_compatibility_flags |=
+        general.profile_compatibility_flag[j] << (31 - j);
+  }
+  hvcc->general_constraint_indicator_flags =
+      PackConstraintIndicatorFlags(general);
+  hvcc->general_level_idc = sps->profile_tier_level->general_level_idc;
+
+  // format
+  hvcc->chromaFormat = sps->chroma_format_idc;
+  hvcc->bitDepthLumaMinus8 = sps->bit_depth_luma_minus8;
+  hvcc->bitDepthChromaMinus8 = sps->bit_depth_chroma_minus8;
+  hvcc->numTemporalLayers = sps->sps_max_sub_layers_minus1 + 1;
+  hvcc->temporalIdNested = sps->sps_temporal_id_nesting_flag;
+  hvcc->lengthSizeMinusOne = length_size - 1;
+
+  // avgFrameRate: VUI timing info, or else VPS timing info
+  const auto& vui = sps->vui_parameters;
+  if (sps->vui_parameters_present_flag && vui != nullptr) {
+    if (vui->bitstream_restriction_flag) {
+      hvcc->min_spatial_segmentation_idc = vui->min_spatial_segmentation_idc;
+    }
+    if (vui->vui_timing_info_present_flag) {
+      hvcc->avgFrameRate =
+          GetAvgFrameRate(vui->vui_num_units_in_tick, vui->vui_time_scale,
+                          vui->field_seq_flag);
+    }
+  }
+  auto vps = bitstream_parser_state.GetVps(sps->sps_video_parameter_set_id);
+  if (hvcc->avgFrameRate == 0 && vps != nullptr &&
+      vps->vps_timing_info_present_flag) {
+    hvcc->avgFrameRate =
+        GetAvgFrameRate(vps->vps_num_units_in_tick, vps->vps_time_scale, 0);
+  }
+
+  // parallelismType: 2 (tile-based) or 3 (wavefront-based) only if all
+  // the PPSs agree, 0 (mixed or unknown) otherwise
+  uint32_t parallelism_type = 0;
+  bool first_pps = true;
+  for (const auto& it : bitstream_parser_state.pps) {
+    if (it.second == nullptr) {
+      continue;
+    }
+    uint32_t pps_parallelism_type = 0;
+    if (it.second->tiles_enabled_flag &&
+        !it.second->entropy_coding_sync_enabled_flag) {
+      pps_parallelism_type = 2;
+    } else if (!it.second->tiles_enabled_flag &&
+               it.second->entropy_coding_sync_enabled_flag) {
+      pps_parallelism_type = 3;
+    }
+    if (first_pps) {
+      parallelism_type = pps_parallelism_type;
+      first_pps = false;
+    } else if (parallelism_type != pps_parallelism_type) {
+      parallelism_type = 0;
+    }
+  }
+  hvcc->parallelismType = parallelism_type;
+
+  // arrays (one per NAL unit type)
+  for (uint32_t nal_unit_type : kArrayNalUnitTypes) {
+    auto array = std::make_unique<HvccArrayState>();
+    array->array_completeness = 1;
+    array->NAL_unit_type = nal_unit_type;
+    for (const auto& nal_unit : nal_units) {
+      if (!nal_unit.empty() && ((nal_unit[0] >> 1) & 0x3f) == nal_unit_type) {
+        array->nal_units.push_back(nal_unit);
+      }
+    }
+    array->numNalus = array->nal_units.size();
+    if (array->numNalus > 0) {
+      hvcc->arrays.push_back(std::move(array));
+    }
+  }
+  hvcc->numOfArrays = hvcc->arrays.size();
+
+  return hvcc;
+}
+
+bool H265HvccParser::SerializeHvcc(const HvccState& hvcc,
+                                   std::vector<uint8_t>* buffer) noexcept {
+  if (hvcc.arrays.size() > 0xff || hvcc.min_spatial_segmentation_idc > 0xfff ||
+      hvcc.avgFrameRate > 0xffff || hvcc.numTemporalLayers > 7 ||
+      hvcc.chromaFormat > 3 || hvcc.bitDepthLumaMinus8 > 7 ||
+      hvcc.bitDepthChromaMinus8 > 7) {
+    return false;
+  }
+  // fixed part (23 bytes) and arrays
+  size_t size = 23;
+  for (const auto& array : hvcc.arrays) {
+    if (array->nal_units.size() > 0xffff) {
+      return false;
+    }
+    size += 3;
+    for (const auto& nal_unit : array->nal_units) {
+      if (nal_unit.size() > 0xffff) {
+        return false;
+      }
+      size += 2 + nal_unit.size();
+    }
+  }
+  buffer->assign(size, 0);
+  rtc::BitBufferWriter writer(buffer->data(), buffer->size());
+
+  writer.WriteBits(hvcc.configurationVersion, 8);
+  writer.WriteBits(hvcc.general_profile_space, 2);
+  writer.WriteBits(hvcc.general_tier_flag, 1);
+  writer.WriteBits(hvcc.general_profile_idc, 5);
+  writer.WriteBits(hvcc.general_profile_compatibility_flags, 32);
+  writer.WriteBits(hvcc.general_constraint_indicator_flags, 48);
+  writer.WriteBits(hvcc.general_level_idc, 8);
+  writer.WriteBits(0x0f, 4);
+  writer.WriteBits(hvcc.min_spatial_segmentation_idc, 12);
+  writer.WriteBits(0x3f, 6);
+  writer.WriteBits(hvcc.parallelismType, 2);
+  writer.WriteBits(0x3f, 6);
+  writer.WriteBits(hvcc.chromaFormat, 2);
+  writer.WriteBits(0x1f, 5);
+  writer.WriteBits(hvcc.bitDepthLumaMinus8, 3);
+  writer.WriteBits(0x1f, 5);
+  writer.WriteBits(hvcc.bitDepthChromaMinus8, 3);
+  writer.WriteBits(hvcc.avgFrameRate, 16);
+  writer.WriteBits(hvcc.constantFrameRate, 2);
+  writer.WriteBits(hvcc.numTemporalLayers, 3);
+  writer.WriteBits(hvcc.temporalIdNested, 1);
+  writer.WriteBits(hvcc.lengthSizeMinusOne, 2);
+  writer.WriteBits(hvcc.arrays.size(), 8);
+  for (const auto& array : hvcc.arrays) {
+    writer.WriteBits(array->array_completeness, 1);
+    writer.WriteBits(0, 1);
+    writer.WriteBits(array->NAL_unit_type, 6);
+    writer.WriteBits(array->nal_units.size(), 16);
+    for (const auto& nal_unit : array->nal_units) {
+      writer.WriteBits(nal_unit.size(), 16);
+      for (uint8_t byte : nal_unit) {
+        writer.WriteUInt8(byte);
+      }
+    }
+  }
+  return true;
+}
+
+#ifdef FDUMP_DEFINE
+void H265HvccParser::HvccArrayState::fdump(FILE* outfp,
+                                           int indent_level) const {
+  fprintf(outfp, "array {");
+  indent_level = indent_level_incr(indent_level);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "array_completeness: %i", array_completeness);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "NAL_unit_type: %i", NAL_unit_type);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "numNalus: %i", numNalus);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "nalUnitLength {");
+  for (const auto& nal_unit : nal_units) {
+    fprintf(outfp, " %zu", nal_unit.size());
+  }
+  fprintf(outfp, " }");
+
+  indent_level = indent_level_decr(indent_level);
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "}");
+}
+
+void H265HvccParser::HvccState::fdump(FILE* outfp, int indent_level) const {
+  fprintf(outfp, "hvcc {");
+  indent_level = indent_level_incr(indent_level);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "configurationVersion: %i", configurationVersion);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "general_profile_space: %i", general_profile_space);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "general_tier_flag: %i", general_tier_flag);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "general_profile_idc: %i", general_profile_idc);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "general_profile_compatibility_flags: 0x%08x",
+          general_profile_compatibility_flags);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "general_constraint_indicator_flags: 0x%012" PRIx64,
+          general_constraint_indicator_flags);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "general_level_idc: %i", general_level_idc);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "min_spatial_segmentation_idc: %i",
+          min_spatial_segmentation_idc);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "parallelismType: %i", parallelismType);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "chromaFormat: %i", chromaFormat);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "bitDepthLumaMinus8: %i", bitDepthLumaMinus8);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "bitDepthChromaMinus8: %i", bitDepthChromaMinus8);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "avgFrameRate: %i", avgFrameRate);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "constantFrameRate: %i", constantFrameRate);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "numTemporalLayers: %i", numTemporalLayers);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "temporalIdNested: %i", temporalIdNested);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "lengthSizeMinusOne: %i", lengthSizeMinusOne);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "numOfArrays: %i", numOfArrays);
+
+  for (const auto& array : arrays) {
+    fdump_indent_level(outfp, indent_level);
+    array->fdump(outfp, indent_level);
+  }
+
+  indent_level = indent_level_decr(indent_level);
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "}");
+}
+#endif  // FDUMP_DEFINE
+
+}  // namespace h265nal
@@ -0,0 +1,761 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_mcts_extractor.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+#include "h265_profile_tier_level_parser.h"
+#include "h265_sei_parser.h"
+#include "rtc_base/bit_buffer.h"
+
+namespace h265nal {
+
+// General note: this is based off the 2018/02 version of the H.265 standard.
+// You can find it on this page:
+// http://www.itu.int/rec/T-REC-H.265
+
+namespace {
+const uint8_t kStartCode[] = {0x00, 0x00, 0x00, 0x01};
+// Number of RBSP bytes unescaped on a first attempt to parse a slice
+// segment header (see ParseSliceSegmentHeaderPrefix()).
+const size_t kSliceHeaderPrefixSize = 256;
+// A rewritten NAL unit is at most this many bytes longer than the
+// original one (the new picture size, conformance window, and slice
+// segment address, plus the trailing bits).
+const size_t kMaxRewriteGrowth = 32;
+
+typedef H265SeiTemporalMotionConstrainedTileSetsParser::
+    H265SeiTemporalMotionConstrainedTileSetsState TmctsState;
+
+// Length of the ue(v) coding of `value` (Section 9.2).
+uint32_t ExpGolombLength(uint32_t value) {
+  uint32_t leading_zero_bits = 0;
+  for (uint64_t v = value + 1ull; v > 1; v >>= 1) {
+    leading_zero_bits++;
+  }
+  return 2 * leading_zero_bits + 1;
+}
+
+uint64_t GetBitOffset(rtc::BitBuffer* bit_buffer) {
+  size_t byte_offset = 0;
+  size_t bit_offset = 0;
+  bit_buffer->GetCurrentOffset(&byte_offset, &bit_offset);
+  return byte_offset * 8ull + bit_offset;
+}
+
+bool SeekBits(rtc::BitBuffer* bit_buffer, uint64_t bit_offset) {
+  return bit_buffer->Seek(bit_offset / 8, bit_offset % 8);
+}
+
+// Copy `bit_count` bits from `bit_buffer` to `writer`.
+bool CopyBits(rtc::BitBuffer* bit_buffer, rtc::BitBufferWriter* writer,
+              uint64_t bit_count) {
+  uint32_t bits_tmp;
+  while (bit_count > 0) {
+    size_t chunk_bits = static_cast<size_t>(std::min<uint64_t>(bit_count, 32));
+    if (!bit_buffer->ReadBits(chunk_bits, bits_tmp) ||
+        !writer->WriteBits(bits_tmp, chunk_bits)) {
+      return false;
+    }
+    bit_count -= chunk_bits;
+  }
+  return true;
+}
+
+// Bit offset of the rbsp_stop_one_bit of an RBSP (its last bit equal
+// to 1). Returns false if there is none.
+bool GetRbspStopBitOffset(const std::vector<uint8_t>& rbsp,
+                          uint64_t* bit_offset) {
+  for (size_t i = rbsp.size(); i > 0; i--) {
+    uint8_t byte = rbsp[i - 1];
+    if (byte == 0) {
+      continue;
+    }
+    uint32_t trailing_zero_bits = 0;
+    while ((byte & 1) == 0) {
+      byte >>= 1;
+      trailing_zero_bits++;
+    }
+    *bit_offset = i * 8ull - 1 - trailing_zero_bits;
+    return true;
+  }
+  return false;
+}
+
+// Write rbsp_trailing_bits() (or byte_alignment(), which has the same
+// syntax). Returns the length of the written buffer, in bytes.
+size_t WriteTrailingBits(rtc::BitBufferWriter* writer) {
+  // rbsp_stop_one_bit / alignment_bit_equal_to_one  f(1)
+  writer->WriteBits(1, 1);
+  size_t byte_offset = 0;
+  size_t bit_offset = 0;
+  writer->GetCurrentOffset(&byte_offset, &bit_offset);
+  // rbsp_alignment_zero_bit / alignment_bit_equal_to_zero  f(1)
+  // (the buffer is zero-initialized)
+  return byte_offset + ((bit_offset == 0) ? 0 : 1);
+}
+
+// Offset in an escaped buffer of the byte at `rbsp_offset` in its RBSP.
+size_t GetEscapedOffset(const uint8_t* data, size_t length,
+                        size_t rbsp_offset) {
+  size_t rbsp_i = 0;
+  size_t zero_count = 0;
+  size_t i = 0;
+  for (; i < length && rbsp_i < rbsp_offset; ++i) {
+    if (zero_count >= 2 && data[i] == 0x03) {
+      // skip the emulation byte
+      zero_count = 0;
+      continue;
+    }
+    zero_count = (data[i] == 0x00) ? (zero_count + 1) : 0;
+    rbsp_i++;
+  }
+  return i;
+}
+
+// Append bytes to the sub-bitstream buffer.
+void AppendBytes(const uint8_t* data, size_t length,
+                 H265MctsExtractor::SubBitstream* sub_bitstream) {
+  auto& chunks = sub_bitstream->chunks;
+  if (chunks.empty() || chunks.back().data != nullptr) {
+    H265MctsExtractor::Chunk chunk;
+    chunk.offset = sub_bitstream->buffer.size();
+    chunks.push_back(chunk);
+  }
+  sub_bitstream->buffer.insert(sub_bitstream->buffer.end(), data,
+                               data + length);
+  chunks.back().length += length;
+}
+
+// Append a NAL unit (header and RBSP) to the sub-bitstream buffer.
+void AppendNalUnit(const std::vector<uint8_t>& nal_unit, size_t length,
+                   H265MctsExtractor::SubBitstream* sub_bitstream) {
+  AppendBytes(kStartCode, sizeof(kStartCode), sub_bitstream);
+  size_t offset = sub_bitstream->buffer.size();
+  EscapeRbsp(nal_unit.data(), length, &sub_bitstream->buffer);
+  sub_bitstream->chunks.back().length += sub_bitstream->buffer.size() - offset;
+}
+
+// Append a reference to a range of the input (no copy).
+void AppendReference(const uint8_t* data, size_t length,
+                     H265MctsExtractor::SubBitstream* sub_bitstream) {
+  H265MctsExtractor::Chunk chunk;
+  chunk.data = data;
+  chunk.length = length;
+  sub_bitstream->chunks.push_back(chunk);
+}
+
+// Rewrite an SPS NAL unit for a tile: the picture size becomes the tile
+// size, and the conformance window keeps the offsets of the picture edges
+// that are also tile edges.
+bool RewriteSps(const uint8_t* data, size_t length,
+                const H265SpsParser::SpsState& sps,
+                const H265TileGeometry::TileRect& tile_rect,
+                std::vector<uint8_t>* out, size_t* out_length) {
+  std::vector<uint8_t> rbsp = UnescapeRbsp(data, length);
+  uint64_t stop_bit_offset = 0;
+  if (!GetRbspStopBitOffset(rbsp, &stop_bit_offset)) {
+    return false;
+  }
+  rtc::BitBuffer bit_buffer(rbsp.data(), rbsp.size());
+  uint32_t bits_tmp;
+  uint32_t golomb_tmp;
+
+  // Section 7.3.2.2.1 ("General sequence parameter set RBSP syntax"):
+  // skip everything before pic_width_in_luma_samples
+  // nal_unit_header(), sps_video_parameter_set_id  u(4)
+  uint32_t sps_max_sub_layers_minus1 = 0;
+  if (!bit_buffer.ConsumeBits(16 + 4) ||
+      !bit_buffer.ReadBits(3, sps_max_sub_layers_minus1) ||
+      !bit_buffer.ConsumeBits(1)) {
+    return false;
+  }
+  // profile_tier_level(1, sps_max_sub_layers_minus1)
+  if (H265ProfileTierLevelParser::ParseProfileTierLevel(
+          &bit_buffer, true, sps_max_sub_layers_minus1) == nullptr) {
+    return false;
+  }
+  // sps_seq_parameter_set_id  ue(v)
+  // chroma_format_idc  ue(v)
+  if (!bit_buffer.ReadExponentialGolomb(golomb_tmp) ||
+      !bit_buffer.ReadExponentialGolomb(golomb_tmp)) {
+    return false;
+  }
+  if (golomb_tmp == 3) {
+    // separate_colour_plane_flag  u(1)
+    if (!bit_buffer.ReadBits(1, bits_tmp)) {
+      return false;
+    }
+  }
+  uint64_t size_bit_offset = GetBitOffset(&bit_buffer);
+  // pic_width_in_luma_samples  ue(v)
+  // pic_height_in_luma_samples  ue(v)
+  // conformance_window_flag  u(1)
+  if (!bit_buffer.ReadExponentialGolomb(golomb_tmp) ||
+      !bit_buffer.ReadExponentialGolomb(golomb_tmp) ||
+      !bit_buffer.ReadBits(1, bits_tmp)) {
+    return false;
+  }
+  if (bits_tmp) {
+    // conf_win_{left,right,top,bottom}_offset  ue(v)
+    for (uint32_t i = 0; i < 4; i++) {
+      if (!bit_buffer.ReadExponentialGolomb(golomb_tmp)) {
+        return false;
+      }
+    }
+  }
+  uint64_t rest_bit_offset = GetBitOffset(&bit_buffer);
+  if (rest_bit_offset > stop_bit_offset) {
+    return false;
+  }
+
+  // Equation (7-1): the conformance window offsets are in chroma samples
+  bool left_edge = (tile_rect.x == 0);
+  bool right_edge =
+      (tile_rect.x + tile_rect.width == sps.pic_width_in_luma_samples);
+  bool top_edge = (tile_rect.y == 0);
+  bool bottom_edge =
+      (tile_rect.y + tile_rect.height == sps.pic_height_in_luma_samples);
+  uint32_t conf_win_left_offset = left_edge ? sps.conf_win_left_offset : 0;
+  uint32_t conf_win_right_offset = right_edge ? sps.conf_win_right_offset : 0;
+  uint32_t conf_win_top_offset = top_edge ? sps.conf_win_top_offset : 0;
+  uint32_t conf_win_bottom_offset =
+      bottom_edge ? sps.conf_win_bottom_offset : 0;
+  uint64_t SubWidthC = sps.derived.SubWidthC;
+  uint64_t SubHeightC = sps.derived.SubHeightC;
+  if (SubWidthC * (conf_win_left_offset + conf_win_right_offset) >=
+          tile_rect.width ||
+      SubHeightC * (conf_win_top_offset + conf_win_bottom_offset) >=
+          tile_rect.height) {
+    return false;
+  }
+  uint32_t conformance_window_flag =
+      (conf_win_left_offset | conf_win_right_offset | conf_win_top_offset |
+       conf_win_bottom_offset) != 0;
+
+  out->assign(rbsp.size() + kMaxRewriteGrowth, 0);
+  rtc::BitBufferWriter writer(out->data(), out->size());
+  if (!bit_buffer.Seek(0, 0) ||
+      !CopyBits(&bit_buffer, &writer, size_bit_offset) ||
+      !writer.WriteExponentialGolomb(tile_rect.width) ||
+      !writer.WriteExponentialGolomb(tile_rect.height) ||
+      !writer.WriteBits(conformance_window_flag, 1)) {
+    return false;
+  }
+  if (conformance_window_flag &&
+      (!writer.WriteExponentialGolomb(conf_win_left_offset) ||
+       !writer.WriteExponentialGolomb(conf_win_right_offset) ||
+       !writer.WriteExponentialGolomb(conf_win_top_offset) ||
+       !writer.WriteExponentialGolomb(conf_win_bottom_offset))) {
+    return false;
+  }
+  if (!SeekBits(&bit_buffer, rest_bit_offset) ||
+      !CopyBits(&bit_buffer, &writer, stop_bit_offset - rest_bit_offset)) {
+    return false;
+  }
+  *out_length = WriteTrailingBits(&writer);
+  return true;
+}
+
+// Rewrite a PPS NAL unit for a tile: tiles_enabled_flag becomes 0, and
+// the tile syntax is removed.
+bool RewritePps(const uint8_t* data, size_t length,
+                const H265PpsParser::PpsState& pps, std::vector<uint8_t>* out,
+                size_t* out_length) {
+  std::vector<uint8_t> rbsp = UnescapeRbsp(data, length);
+  uint64_t stop_bit_offset = 0;
+  if (!GetRbspStopBitOffset(rbsp, &stop_bit_offset)) {
+    return false;
+  }
+  rtc::BitBuffer bit_buffer(rbsp.data(), rbsp.size());
+  uint32_t bits_tmp;
+  uint32_t golomb_tmp;
+  int32_t sgolomb_tmp;
+
+  // Section 7.3.2.3.1 ("General picture parameter set RBSP syntax"):
+  // skip everything before tiles_enabled_flag
+  // nal_unit_header()
+  // pps_pic_parameter_set_id  ue(v)
+  // pps_seq_parameter_set_id  ue(v)
+  // dependent_slice_segments_enabled_flag  u(1)
+  // output_flag_present_flag  u(1)
+  // num_extra_slice_header_bits  u(3)
+  // sign_data_hiding_enabled_flag  u(1)
+  // cabac_init_present_flag  u(1)
+  // num_ref_idx_l0_default_active_minus1  ue(v)
+  // num_ref_idx_l1_default_active_minus1  ue(v)
+  // init_qp_minus26  se(v)
+  // constrained_intra_pred_flag  u(1)
+  // transform_skip_enabled_flag  u(1)
+  // cu_qp_delta_enabled_flag  u(1)
+  if (!bit_buffer.ConsumeBits(16) ||
+      !bit_buffer.ReadExponentialGolomb(golomb_tmp) ||
+      !bit_buffer.ReadExponentialGolomb(golomb_tmp) ||
+      !bit_buffer.ConsumeBits(1 + 1 + 3 + 1 + 1) ||
+      !bit_buffer.ReadExponentialGolomb(golomb_tmp) ||
+      !bit_buffer.ReadExponentialGolomb(golomb_tmp) ||
+      !bit_buffer.ReadSignedExponentialGolomb(sgolomb_tmp) ||
+      !bit_buffer.ConsumeBits(1 + 1) || !bit_buffer.ReadBits(1, bits_tmp)) {
+    return false;
+  }
+  if (bits_tmp) {
+    // diff_cu_qp_delta_depth  ue(v)
+    if (!bit_buffer.ReadExponentialGolomb(golomb_tmp)) {
+      return false;
+    }
+  }
+  // pps_cb_qp_offset  se(v)
+  // pps_cr_qp_offset  se(v)
+  // pps_slice_chroma_qp_offsets_present_flag  u(1)
+  // weighted_pred_flag  u(1)
+  // weighted_bipred_flag  u(1)
+  // transquant_bypass_enabled_flag  u(1)
+  if (!bit_buffer.ReadSignedExponentialGolomb(sgolomb_tmp) ||
+      !bit_buffer.ReadSignedExponentialGolomb(sgolomb_tmp) ||
+      !bit_buffer.ConsumeBits(1 + 1 + 1 + 1)) {
+    return false;
+  }
+  uint64_t tiles_bit_offset = GetBitOffset(&bit_buffer);
+  // tiles_enabled_flag  u(1)
+  // entropy_coding_sync_enabled_flag  u(1)
+  uint32_t tiles_enabled_flag = 0;
+  uint32_t entropy_coding_sync_enabled_flag = 0;
+  if (!bit_buffer.ReadBits(1, tiles_enabled_flag) ||
+      !bit_buffer.ReadBits(1, entropy_coding_sync_enabled_flag)) {
+    return false;
+  }
+  if (tiles_enabled_flag) {
+    // num_tile_columns_minus1  ue(v)
+    // num_tile_rows_minus1  ue(v)
+    // uniform_spacing_flag  u(1)
+    // column_width_minus1[i]  ue(v)
+    // row_height_minus1[i]  ue(v)
+    // loop_filter_across_tiles_enabled_flag  u(1)
+    uint32_t num_tile_columns_minus1 = 0;
+    uint32_t num_tile_rows_minus1 = 0;
+    if (!bit_buffer.ReadExponentialGolomb(num_tile_columns_minus1) ||
+        !bit_buffer.ReadExponentialGolomb(num_tile_rows_minus1) ||
+        !bit_buffer.ReadBits(1, bits_tmp)) {
+      return false;
+    }
+    if (num_tile_columns_minus1 != pps.num_tile_columns_minus1 ||
+        num_tile_rows_minus1 != pps.num_tile_rows_minus1) {
+      return false;
+    }
+    if (!bits_tmp) {
+      for (uint32_t i = 0; i < num_tile_columns_minus1 + num_tile_rows_minus1;
+           i++) {
+        if (!bit_buffer.ReadExponentialGolomb(golomb_tmp)) {
+          return false;
+        }
+      }
+    }
+    if (!bit_buffer.ConsumeBits(1)) {
+      return false;
+    }
+  }
+  uint64_t rest_bit_offset = GetBitOffset(&bit_buffer);
+  if (rest_bit_offset > stop_bit_offset) {
+    return false;
+  }
+
+  out->assign(rbsp.size() + kMaxRewriteGrowth, 0);
+  rtc::BitBufferWriter writer(out->data(), out->size());
+  if (!bit_buffer.Seek(0, 0) ||
+      !CopyBits(&bit_buffer, &writer, tiles_bit_offset) ||
+      !writer.WriteBits(0, 1) ||
+      !writer.WriteBits(entropy_coding_sync_enabled_flag, 1) ||
+      !SeekBits(&bit_buffer, rest_bit_offset) ||
+      !CopyBits(&bit_buffer, &writer, stop_bit_offset - rest_bit_offset)) {
+    return false;
+  }
+  *out_length = WriteTrailingBits(&writer);
+  return true;
+}
+}  // namespace
+
+size_t H265MctsExtractor::SubBitstream::size() const noexcept {
+  size_t size = 0;
+  for (const auto& chunk : chunks) {
+    size += chunk.length;
+  }
+  return size;
+}
+
+void H265MctsExtractor::SubBitstream::Write(
+    std::vector<uint8_t>* out) const noexcept {
+  out->reserve(out->size() + size());
+  for (const auto& chunk : chunks) {
+    const uint8_t* data =
+        (chunk.data != nullptr) ? chunk.data : buffer.data() + chunk.offset;
+    out->insert(out->end(), data, data + chunk.length);
+  }
+}
+
+std::unique_ptr<H265MctsExtractor> H265MctsExtractor::Extract(
+    const uint8_t* data, size_t length) noexcept {
+  auto extractor = std::make_unique<H265MctsExtractor>();
+  for (const auto& nalu_index :
+       H265BitstreamParser::FindNaluIndices(data, length)) {
+    if (!extractor->ProcessNalUnit(data + nalu_index.payload_start_offset,
+                                   nalu_index.payload_size)) {
+      return nullptr;
+    }
+  }
+  if (!extractor->Finish()) {
+    return nullptr;
+  }
+  return extractor;
+}
+
+bool H265MctsExtractor::ProcessNalUnit(const uint8_t* data,
+                                       size_t length) noexcept {
+  // nal_unit_header()
+  if (length < 2) {
+    return false;
+  }
+  uint32_t nal_unit_type = (data[0] >> 1) & 0x3f;
+  uint32_t nuh_layer_id = ((data[0] & 0x01) << 5) | (data[1] >> 3);
+  if (nuh_layer_id != 0) {
+    // only the base layer is extracted
+    return true;
+  }
+
+  if (IsSliceSegment(nal_unit_type)) {
+    return ProcessSliceSegment(data, length, nal_unit_type);
+  }
+
+  switch (nal_unit_type) {
+    case VPS_NUT:
+    case SPS_NUT:
+    case PPS_NUT: {
+      // the parameter sets are written (rewritten) right before the first
+      // slice segment that uses them
+      auto nal_unit = H265NalUnitParser::ParseNalUnit(data, length,
+                                                      &bitstream_parser_state_);
+      if (nal_unit == nullptr || nal_unit->nal_unit_payload == nullptr) {
+        return false;
+      }
+      const auto& payload = nal_unit->nal_unit_payload;
+      if (payload->vps != nullptr) {
+        vps_nal_units_[payload->vps->vps_video_parameter_set_id] =
+            std::make_pair(data, length);
+      } else if (payload->sps != nullptr) {
+        sps_nal_units_[payload->sps->sps_seq_parameter_set_id] =
+            std::make_pair(data, length);
+      } else if (payload->pps != nullptr) {
+        pps_nal_units_[payload->pps->pps_pic_parameter_set_id] =
+            std::make_pair(data, length);
+      } else {
+        return false;
+      }
+      return true;
+    }
+
+    case AUD_NUT:
+    case EOS_NUT:
+    case EOB_NUT:
+      for (auto& sub_bitstream : sub_bitstreams_) {
+        AppendBytes(kStartCode, sizeof(kStartCode), sub_bitstream.get());
+        AppendReference(data, length, sub_bitstream.get());
+      }
+      return true;
+
+    case PREFIX_SEI_NUT: {
+      H265SeiMessageFilter filter;
+      filter.AddPayloadType(SeiType::temporal_motion_constrained_tile_sets);
+      ParsingOptions parsing_options;
+      auto sei_rbsp = H265SeiRbspParser::ParseSeiRbsp(
+          data + 2, length - 2, parsing_options, &filter);
+      if (sei_rbsp == nullptr) {
+        return true;
+      }
+      for (const auto& sei_message : sei_rbsp->sei_message) {
+        if (sei_message->payload_state == nullptr) {
+          continue;
+        }
+        const auto* tmcts =
+            static_cast<const TmctsState*>(sei_message->payload_state.get());
+        each_tile_one_tile_set_ = (tmcts->each_tile_one_tile_set_flag != 0);
+      }
+      return true;
+    }
+
+    default:
+      // other non-VCL NAL units describe the full picture
+      return true;
+  }
+}
+
+bool H265MctsExtractor::ProcessSliceSegment(const uint8_t* data,
+                                            size_t length,
+                                            uint32_t nal_unit_type) noexcept {
+  // parse the slice segment header, unescaping only the first bytes of the
+  // NAL unit unless the header is longer
+  std::unique_ptr<H265SliceSegmentHeaderParser::SliceSegmentHeaderState>
+      header;
+  uint64_t header_end_bit_offset = 0;
+  size_t rbsp_length = std::min(length, kSliceHeaderPrefixSize);
+  while (true) {
+    UnescapeRbspRange(data, length, 0, rbsp_length, &rbsp_buffer_);
+    rtc::BitBuffer bit_buffer(rbsp_buffer_.data(), rbsp_buffer_.size());
+    uint32_t alignment_bit = 0;
+    if (bit_buffer.ConsumeBits(16)) {
+      header = H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
+          &bit_buffer, nal_unit_type, &bitstream_parser_state_);
+      header_end_bit_offset = GetBitOffset(&bit_buffer);
+    }
+    // byte_alignment()
+    // alignment_bit_equal_to_one  f(1)
+    if (header != nullptr && bit_buffer.ReadBits(1, alignment_bit)) {
+      if (alignment_bit != 1) {
+        return false;
+      }
+      break;
+    }
+    if (rbsp_length == length) {
+      return false;
+    }
+    // long slice segment header: retry with the full NAL unit
+    rbsp_length = length;
+  }
+  size_t slice_data_rbsp_offset = (header_end_bit_offset + 8) / 8;
+
+  // the parameter sets referenced by the (successfully parsed) header
+  auto pps = bitstream_parser_state_.GetPps(header->slice_pic_parameter_set_id);
+  auto sps = bitstream_parser_state_.GetSps(pps->pps_seq_parameter_set_id);
+  std::shared_ptr<const H265TileGeometry> geometry = H265TileGeometry::Get(
+      &bitstream_parser_state_, header->slice_pic_parameter_set_id, sps, pps);
+  if (geometry == nullptr) {
+    return false;
+  }
+  int tile_id = geometry->getTileId(header->slice_segment_address);
+  if (tile_id < 0) {
+    return false;
+  }
+  uint32_t ctb_addr_ts =
+      geometry->CtbAddrRsToTs[header->slice_segment_address];
+
+  // every slice segment must be contained in a single tile
+  if (header->first_slice_segment_in_pic_flag) {
+    if (geometry_ != nullptr && !CheckSliceSegmentEnd(0)) {
+      return false;
+    }
+  } else {
+    if (geometry_ != geometry || ctb_addr_ts <= last_ctb_addr_ts_ ||
+        !CheckSliceSegmentEnd(ctb_addr_ts)) {
+      return false;
+    }
+    // a dependent slice segment must belong to a slice of the same tile
+    if (header->dependent_slice_segment_flag && tile_id != last_tile_id_) {
+      return false;
+    }
+  }
+  geometry_ = geometry;
+  last_tile_id_ = tile_id;
+  last_ctb_addr_ts_ = ctb_addr_ts;
+
+  // the rewritten PPS only has entry points for the WPP substreams: any
+  // other entry point starts a new tile
+  bool entry_points_present =
+      pps->tiles_enabled_flag || pps->entropy_coding_sync_enabled_flag;
+  bool keep_entry_points = pps->entropy_coding_sync_enabled_flag;
+  if (!keep_entry_points && header->num_entry_point_offsets > 0) {
+    return false;
+  }
+
+  if (sub_bitstreams_.empty()) {
+    for (uint32_t i = 0; i < geometry->getNumTiles(); i++) {
+      auto sub_bitstream = std::make_unique<SubBitstream>();
+      sub_bitstream->tile_id = i;
+      sub_bitstreams_.push_back(std::move(sub_bitstream));
+    }
+  } else if (sub_bitstreams_.size() != geometry->getNumTiles()) {
+    return false;
+  }
+  SubBitstream* sub_bitstream = sub_bitstreams_[tile_id].get();
+  H265TileGeometry::TileRect tile_rect;
+  if (!geometry->getTileRect(tile_id, &tile_rect)) {
+    return false;
+  }
+  if (sub_bitstream->sps != sps || sub_bitstream->pps != pps) {
+    sub_bitstream->tile_rect = tile_rect;
+    if (!WriteParameterSets(sps, pps, sub_bitstream)) {
+      return false;
+    }
+  }
+
+  // the position of the entry points (and the header extension) is
+  // derived from their parsed values
+  uint64_t extension_bits = 0;
+  if (pps->slice_segment_header_extension_present_flag) {
+    extension_bits =
+        ExpGolombLength(header->slice_segment_header_extension_length) +
+        8ull * header->slice_segment_header_extension_length;
+  }
+  uint64_t entry_point_bits = 0;
+  if (entry_points_present) {
+    entry_point_bits = ExpGolombLength(header->num_entry_point_offsets);
+    if (header->num_entry_point_offsets > 0) {
+      entry_point_bits += ExpGolombLength(header->offset_len_minus1) +
+                          header->num_entry_point_offsets *
+                              (header->offset_len_minus1 + 1ull);
+    }
+  }
+  uint64_t entry_point_bit_offset =
+      header_end_bit_offset - extension_bits - entry_point_bits;
+
+  // Section 7.3.6.1 ("General slice segment header syntax"): rewrite the
+  // fields before (and including) slice_segment_address
+  rtc::BitBuffer bit_buffer(rbsp_buffer_.data(), rbsp_buffer_.size());
+  uint32_t golomb_tmp;
+  bool irap = (nal_unit_type >= BLA_W_LP && nal_unit_type <= RSV_IRAP_VCL23);
+  // nal_unit_header()
+  // first_slice_segment_in_pic_flag  u(1)
+  // no_output_of_prior_pics_flag  u(1)
+  // slice_pic_parameter_set_id  ue(v)
+  if (!bit_buffer.ConsumeBits(16 + 1 + (irap ? 1 : 0)) ||
+      !bit_buffer.ReadExponentialGolomb(golomb_tmp)) {
+    return false;
+  }
+  if (!header->first_slice_segment_in_pic_flag) {
+    // dependent_slice_segment_flag  u(1)
+    // slice_segment_address  u(v)
+    uint32_t address_bits =
+        (pps->dependent_slice_segments_enabled_flag ? 1 : 0) +
+        ceil_log2(sps->getPicSizeInCtbsY());
+    if (!bit_buffer.ConsumeBits(address_bits)) {
+      return false;
+    }
+  }
+  uint64_t prefix_end_bit_offset = GetBitOffset(&bit_buffer);
+  if (prefix_end_bit_offset > entry_point_bit_offset) {
+    return false;
+  }
+
+  // address of the slice segment in the tile
+  uint32_t ctb_x = header->slice_segment_address % geometry->PicWidthInCtbsY;
+  uint32_t ctb_y = header->slice_segment_address / geometry->PicWidthInCtbsY;
+  uint32_t slice_segment_address = (ctb_y - tile_rect.ctb_y) *
+                                       tile_rect.ctb_width +
+                                   (ctb_x - tile_rect.ctb_x);
+  uint32_t first_slice_segment_in_pic_flag = (slice_segment_address == 0);
+  if (first_slice_segment_in_pic_flag &&
+      header->dependent_slice_segment_flag) {
+    return false;
+  }
+
+  nal_unit_buffer_.assign(slice_data_rbsp_offset + kMaxRewriteGrowth, 0);
+  rtc::BitBufferWriter writer(nal_unit_buffer_.data(),
+                              nal_unit_buffer_.size());
+  if (!writer.WriteBits(data[0], 8) || !writer.WriteBits(data[1], 8) ||
+      !writer.WriteBits(first_slice_segment_in_pic_flag, 1)) {
+    return false;
+  }
+  if (irap && !writer.WriteBits(header->no_output_of_prior_pics_flag, 1)) {
+    return false;
+  }
+  if (!writer.WriteExponentialGolomb(header->slice_pic_parameter_set_id)) {
+    return false;
+  }
+  if (!first_slice_segment_in_pic_flag) {
+    if (pps->dependent_slice_segments_enabled_flag &&
+        !writer.WriteBits(header->dependent_slice_segment_flag, 1)) {
+      return false;
+    }
+    if (!writer.WriteBits(slice_segment_address,
+                          ceil_log2(tile_rect.ctb_width *
+                                    tile_rect.ctb_height))) {
+      return false;
+    }
+  }
+  // the rest of the header is kept, except for the entry points
+  if (!SeekBits(&bit_buffer, prefix_end_bit_offset) ||
+      !CopyBits(&bit_buffer, &writer,
+                entry_point_bit_offset - prefix_end_bit_offset)) {
+    return false;
+  }
+  if (!keep_entry_points && !bit_buffer.ConsumeBits(entry_point_bits)) {
+    return false;
+  }
+  if (!CopyBits(&bit_buffer, &writer,
+                header_end_bit_offset - GetBitOffset(&bit_buffer))) {
+    return false;
+  }
+  size_t header_length = WriteTrailingBits(&writer);
+
+  // the slice segment data starts right after a byte (the last one of the
+  // header) that is not zero, so its escaped bytes can be used as they are
+  size_t slice_data_offset =
+      GetEscapedOffset(data, length, slice_data_rbsp_offset);
+  AppendNalUnit(nal_unit_buffer_, header_length, sub_bitstream);
+  if (slice_data_offset < length) {
+    AppendReference(data + slice_data_offset, length - slice_data_offset,
+                    sub_bitstream);
+  }
+  return true;
+}
+
+bool H265MctsExtractor::CheckSliceSegmentEnd(
+    uint32_t ctb_addr_ts) const noexcept {
+  if (geometry_ == nullptr || last_tile_id_ < 0) {
+    return false;
+  }
+  // the previous slice segment ends right before `ctb_addr_ts` (or at the
+  // end of the picture when `ctb_addr_ts` is 0)
+  uint32_t last_ctb_addr_ts =
+      (ctb_addr_ts == 0) ? geometry_->CtbAddrTsToRs.size() - 1
+                         : ctb_addr_ts - 1;
+  return geometry_->TileId[last_ctb_addr_ts] ==
+         static_cast<uint32_t>(last_tile_id_);
+}
+
+bool H265MctsExtractor::WriteParameterSets(
+    const std::shared_ptr<struct H265SpsParser::SpsState>& sps,
+    const std::shared_ptr<struct H265PpsParser::PpsState>& pps,
+    SubBitstream* sub_bitstream) noexcept {
+  auto sps_nal_unit = sps_nal_units_.find(sps->sps_seq_parameter_set_id);
+  auto pps_nal_unit = pps_nal_units_.find(pps->pps_pic_parameter_set_id);
+  if (sps_nal_unit == sps_nal_units_.end() ||
+      pps_nal_unit == pps_nal_units_.end()) {
+    return false;
+  }
+  auto vps_nal_unit = vps_nal_units_.find(sps->sps_video_parameter_set_id);
+  if (vps_nal_unit != vps_nal_units_.end()) {
+    AppendBytes(kStartCode, sizeof(kStartCode), sub_bitstream);
+    AppendReference(vps_nal_unit->second.first, vps_nal_unit->second.second,
+                    sub_bitstream);
+  }
+  size_t length = 0;
+  if (!RewriteSps(sps_nal_unit->second.first, sps_nal_unit->second.second,
+                  *sps, sub_bitstream->tile_rect, &nal_unit_buffer_,
+                  &length)) {
+    return false;
+  }
+  AppendNalUnit(nal_unit_buffer_, length, sub_bitstream);
+  if (!RewritePps(pps_nal_unit->second.first, pps_nal_unit->second.second,
+                  *pps, &nal_unit_buffer_, &length)) {
+    return false;
+  }
+  AppendNalUnit(nal_unit_buffer_, length, sub_bitstream);
+  sub_bitstream->sps = sps;
+  sub_bitstream->pps = pps;
+  return true;
+}
+
+bool H265MctsExtractor::Finish() noexcept {
+  // the last slice segment must end in the last tile
+  if (geometry_ == nullptr) {
+    return true;
+  }
+  return CheckSliceSegmentEnd(0);
+}
+
+}  // namespace h265nal
@@ -0,0 +1,673 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_mp4_demuxer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <cinttypes>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "h265_common.h"
+
+namespace h265nal {
+
+// General note: this is based off the ISO/IEC 14496-12 (ISO base media
+// file format) and ISO/IEC 14496-15 (carriage of NAL unit structured
+// video) standards.
+
+namespace {
+constexpr uint32_t FourCc(const char* type) {
+  return (static_cast<uint32_t>(type[0]) << 24) |
+         (static_cast<uint32_t>(type[1]) << 16) |
+         (static_cast<uint32_t>(type[2]) << 8) | static_cast<uint32_t>(type[3]);
+}
+
+uint32_t ReadU16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+
+uint32_t ReadU32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) |
+         p[3];
+}
+
+uint64_t ReadU64(const uint8_t* p) {
+  return (static_cast<uint64_t>(ReadU32(p)) << 32) | ReadU32(p + 4);
+}
+
+// A box: [start, end) covers the whole box, and [begin, end) its payload.
+struct Box {
+  uint32_t type = 0;
+  size_t start = 0;
+  size_t begin = 0;
+  size_t end = 0;
+};
+
+// Section 4.2 of ISO/IEC 14496-12: read the box header at `offset`.
+// Returns false if the box does not fit in [offset, end).
+bool ReadBox(const uint8_t* data, size_t offset, size_t end, Box* box) {
+  if (offset + 8 > end) {
+    return false;
+  }
+  uint64_t size = ReadU32(data + offset);
+  box->type = ReadU32(data + offset + 4);
+  box->start = offset;
+  box->begin = offset + 8;
+  if (size == 1) {
+    // largesize
+    if (offset + 16 > end) {
+      return false;
+    }
+    size = ReadU64(data + offset + 8);
+    box->begin = offset + 16;
+  } else if (size == 0) {
+    // the box extends to the end of its container
+    size = end - offset;
+  }
+  if (size < box->begin - offset || size > end - offset) {
+    return false;
+  }
+  box->end = offset + size;
+  return true;
+}
+
+// The sample tables of a trak box.
+struct SampleTables {
+  uint32_t track_id = 0;
+  uint32_t timescale = 0;
+  uint32_t handler_type = 0;
+  bool is_h265 = false;
+  H265Mp4Demuxer::TrackInfo* track = nullptr;
+  // stsz/stz2
+  uint32_t sample_size = 0;
+  std::vector<uint32_t> sample_sizes;
+  uint32_t sample_count = 0;
+  // stsc: (first_chunk, samples_per_chunk)
+  std::vector<std::pair<uint32_t, uint32_t>> sample_to_chunk;
+  // stco/co64
+  std::vector<uint64_t> chunk_offsets;
+  // stts: (sample_count, sample_delta)
+  std::vector<std::pair<uint32_t, uint32_t>> time_to_sample;
+  // ctts: (sample_count, sample_offset)
+  std::vector<std::pair<uint32_t, int32_t>> composition_offsets;
+  // stss (1-based sample numbers)
+  bool has_sync_samples = false;
+  std::vector<uint32_t> sync_samples;
+};
+
+// trex defaults
+struct TrackExtends {
+  uint32_t default_sample_duration = 0;
+  uint32_t default_sample_size = 0;
+  uint32_t default_sample_flags = 0;
+};
+
+// Section 8.8.3.1 of ISO/IEC 14496-12: sample_is_non_sync_sample
+const uint32_t kSampleIsNonSyncSample = 0x00010000;
+
+// Maximum nesting of the container boxes in a trak box (trak/mdia/minf/stbl
+// is 3 levels deep).
+const int kMaxContainerDepth = 8;
+// Maximum number of samples in a track fragment run box.
+const uint32_t kMaxTrunSampleCount = 1 << 20;
+}  // namespace
+
+class H265Mp4Demuxer::BoxReader {
+ public:
+  explicit BoxReader(H265Mp4Demuxer* demuxer)
+      : demuxer_(demuxer), data_(demuxer->data_) {}
+
+  // Read the top-level boxes. Returns false if there is no H265 track.
+  bool Read() {
+    Box box;
+    for (size_t offset = 0;
+         ReadBox(data_, offset, demuxer_->length_, &box); offset = box.end) {
+      if (box.type == FourCc("moov")) {
+        ReadMoov(box);
+      } else if (box.type == FourCc("moof") && has_track_) {
+        demuxer_->track_.fragmented = true;
+        ReadMoof(box);
+      }
+    }
+    return has_track_;
+  }
+
+ private:
+  bool Has(size_t offset, size_t size, const Box& box) const {
+    return offset + size <= box.end;
+  }
+
+  void ReadMoov(const Box& moov) {
+    Box box;
+    for (size_t offset = moov.begin; ReadBox(data_, offset, moov.end, &box);
+         offset = box.end) {
+      if (box.type == FourCc("trak") && !has_track_) {
+        ReadTrak(box);
+      } else if (box.type == FourCc("mvex")) {
+        ReadMvex(box);
+      }
+    }
+  }
+
+  void ReadTrak(const Box& trak) {
+    SampleTables tables;
+    TrackInfo track;
+    tables.track = &track;
+    ReadContainer(trak, &tables, 0);
+    if (!tables.is_h265 || tables.handler_type != FourCc("vide")) {
+      return;
+    }
+    track.track_id = tables.track_id;
+    track.timescale = tables.timescale;
+    demuxer_->track_ = track;
+    has_track_ = true;
+    BuildSamples(tables);
+  }
+
+  // Read the boxes of a trak box (and its mdia/minf/stbl children).
+  // `depth` is the nesting level of `container` (0 for the trak box).
+  void ReadContainer(const Box& container, SampleTables* tables, int depth) {
+    if (depth > kMaxContainerDepth) {
+      return;
+    }
+    Box box;
+    for (size_t offset = container.begin;
+         ReadBox(data_, offset, container.end, &box); offset = box.end) {
+      const uint8_t* p = data_ + box.begin;
+      // version of full boxes
+      uint32_t version = Has(box.begin, 1, box) ? p[0] : 0;
+      if (box.type == FourCc("mdia") || box.type == FourCc("minf") ||
+          box.type == FourCc("stbl")) {
+        ReadContainer(box, tables, depth + 1);
+      } else if (box.type == FourCc("tkhd")) {
+        size_t pos = box.begin + ((version == 1) ? 20 : 12);
+        if (Has(pos, 4, box)) {
+          tables->track_id = ReadU32(data_ + pos);
+        }
+      } else if (box.type == FourCc("mdhd")) {
+        size_t pos = box.begin + ((version == 1) ? 20 : 12);
+        if (Has(pos, 4, box)) {
+          tables->timescale = ReadU32(data_ + pos);
+        }
+      } else if (box.type == FourCc("hdlr")) {
+        if (Has(box.begin + 8, 4, box)) {
+          tables->handler_type = ReadU32(p + 8);
+        }
+      } else if (box.type == FourCc("stsd")) {
+        ReadStsd(box, tables);
+      } else if (box.type == FourCc("stsz")) {
+        if (!Has(box.begin, 12, box)) {
+          continue;
+        }
+        tables->sample_size = ReadU32(p + 4);
+        tables->sample_count = ReadU32(p + 8);
+        if (tables->sample_size == 0) {
+          for (uint32_t i = 0; i < tables->sample_count &&
+                               Has(box.begin + 12 + 4 * i, 4, box);
+               i++) {
+            tables->sample_sizes.push_back(ReadU32(p + 12 + 4 * i));
+          }
+        }
+      } else if (box.type == FourCc("stz2")) {
+        if (!Has(box.begin, 12, box)) {
+          continue;
+        }
+        uint32_t field_size = p[7];
+        uint32_t sample_count = ReadU32(p + 8);
+        // field_size is 4, 8, or 16, and all the entries must be in the box
+        if ((field_size != 4 && field_size != 8 && field_size != 16) ||
+            (static_cast<uint64_t>(sample_count) * field_size + 7) / 8 >
+                box.end - (box.begin + 12)) {
+          continue;
+        }
+        tables->sample_count = sample_count;
+        for (uint32_t i = 0; i < sample_count; i++) {
+          size_t bit = 8 * (box.begin + 12) + size_t{i} * field_size;
+          const uint8_t* q = data_ + bit / 8;
+          uint32_t size = (field_size == 16)  ? ReadU16(q)
+                          : (field_size == 8) ? q[0]
+                          : ((bit % 8) ? (q[0] & 0x0f) : (q[0] >> 4));
+          tables->sample_sizes.push_back(size);
+        }
+      } else if (box.type == FourCc("stsc")) {
+        uint32_t entry_count = Has(box.begin, 8, box) ? ReadU32(p + 4) : 0;
+        for (uint32_t i = 0;
+             i < entry_count && Has(box.begin + 8 + 12 * i, 12, box); i++) {
+          tables->sample_to_chunk.emplace_back(ReadU32(p + 8 + 12 * i),
+                                               ReadU32(p + 12 + 12 * i));
+        }
+      } else if (box.type == FourCc("stco") || box.type == FourCc("co64")) {
+        size_t entry_size = (box.type == FourCc("co64")) ? 8 : 4;
+        uint32_t entry_count = Has(box.begin, 8, box) ? ReadU32(p + 4) : 0;
+        for (uint32_t i = 0; i < entry_count &&
+                             Has(box.begin + 8 + entry_size * i, entry_size,
+                                 box);
+             i++) {
+          const uint8_t* q = p + 8 + entry_size * i;
+          tables->chunk_offsets.push_back((entry_size == 8) ? ReadU64(q)
+                                                            : ReadU32(q));
+        }
+      } else if (box.type == FourCc("stts")) {
+        uint32_t entry_count = Has(box.begin, 8, box) ? ReadU32(p + 4) : 0;
+        for (uint32_t i = 0;
+             i < entry_count && Has(box.begin + 8 + 8 * i, 8, box); i++) {
+          tables->time_to_sample.emplace_back(ReadU32(p + 8 + 8 * i),
+                                              ReadU32(p + 12 + 8 * i));
+        }
+      } else if (box.type == FourCc("ctts")) {
+        uint32_t entry_count = Has(box.begin, 8, box) ? ReadU32(p + 4) : 0;
+        for (uint32_t i = 0;
+             i < entry_count && Has(box.begin + 8 + 8 * i, 8, box); i++) {
+          tables->composition_offsets.emplace_back(
+              ReadU32(p + 8 + 8 * i),
+              static_cast<int32_t>(ReadU32(p + 12 + 8 * i)));
+        }
+      } else if (box.type == FourCc("stss")) {
+        tables->has_sync_samples = true;
+        uint32_t entry_count = Has(box.begin, 8, box) ? ReadU32(p + 4) : 0;
+        for (uint32_t i = 0;
+             i < entry_count && Has(box.begin + 8 + 4 * i, 4, box); i++) {
+          tables->sync_samples.push_back(ReadU32(p + 8 + 4 * i));
+        }
+      }
+    }
+  }
+
+  // Section 8.5.2 of ISO/IEC 14496-12: the first sample description of
+  // the track.
+  void ReadStsd(const Box& stsd, SampleTables* tables) {
+    Box entry;
+    if (!ReadBox(data_, stsd.begin + 8, stsd.end, &entry)) {
+      return;
+    }
+    if (entry.type != FourCc("hvc1") && entry.type != FourCc("hev1")) {
+      return;
+    }
+    tables->is_h265 = true;
+    TrackInfo* track = tables->track;
+    for (int i = 0; i < 4; i++) {
+      track->sample_entry[i] = data_[entry.start + 4 + i];
+    }
+    // VisualSampleEntry: width and height follow the SampleEntry (8 bytes)
+    // and 16 bytes of pre-defined and reserved fields
+    const uint8_t* p = data_ + entry.begin;
+    if (!Has(entry.begin, 78, entry)) {
+      return;
+    }
+    track->width = ReadU16(p + 24);
+    track->height = ReadU16(p + 26);
+    // child boxes follow the 78-byte VisualSampleEntry
+    Box box;
+    for (size_t offset = entry.begin + 78;
+         ReadBox(data_, offset, entry.end, &box); offset = box.end) {
+      if (box.type == FourCc("hvcC")) {
+        ReadHvcc(box, track);
+      }
+    }
+  }
+
+  // Section 8.3.3.1 of ISO/IEC 14496-15: HEVCDecoderConfigurationRecord.
+  void ReadHvcc(const Box& hvcc, TrackInfo* track) {
+    // lengthSizeMinusOne is in byte 21, and numOfArrays in byte 22
+    if (!Has(hvcc.begin, 23, hvcc)) {
+      return;
+    }
+    const uint8_t* p = data_ + hvcc.begin;
+    track->length_size = (p[21] & 0x03) + 1;
+    uint32_t num_of_arrays = p[22];
+    size_t pos = hvcc.begin + 23;
+    for (uint32_t i = 0; i < num_of_arrays && Has(pos, 3, hvcc); i++) {
+      // array_completeness (1), reserved (1), NAL_unit_type (6)
+      uint32_t num_nalus = ReadU16(data_ + pos + 1);
+      pos += 3;
+      for (uint32_t j = 0; j < num_nalus && Has(pos, 2, hvcc); j++) {
+        size_t nal_unit_length = ReadU16(data_ + pos);
+        if (!Has(pos + 2, nal_unit_length, hvcc)) {
+          return;
+        }
+        track->parameter_sets.push_back({pos, pos + 2, nal_unit_length});
+        pos += 2 + nal_unit_length;
+      }
+    }
+  }
+
+  // Build the sample list from the sample tables.
+  void BuildSamples(const SampleTables& tables) {
+    std::vector<Sample>& samples = demuxer_->samples_;
+    uint32_t sample_count = tables.sample_count;
+    // sample sizes and offsets (stsz, stsc, and stco)
+    size_t stsc_index = 0;
+    for (size_t chunk = 0; chunk < tables.chunk_offsets.size() &&
+                           samples.size() < sample_count;
+         chunk++) {
+      // stsc chunk numbers are 1-based
+      while (stsc_index + 1 < tables.sample_to_chunk.size() &&
+             tables.sample_to_chunk[stsc_index + 1].first <= chunk + 1) {
+        stsc_index++;
+      }
+      if (stsc_index >= tables.sample_to_chunk.size()) {
+        break;
+      }
+      uint64_t offset = tables.chunk_offsets[chunk];
+      uint32_t samples_per_chunk = tables.sample_to_chunk[stsc_index].second;
+      for (uint32_t i = 0;
+           i < samples_per_chunk && samples.size() < sample_count; i++) {
+        Sample sample;
+        size_t index = samples.size();
+        sample.offset = offset;
+        // samples without a size entry are not in the file
+        if (tables.sample_size == 0 && index >= tables.sample_sizes.size()) {
+          return;
+        }
+        sample.size = (tables.sample_size != 0) ? tables.sample_size
+                                                : tables.sample_sizes[index];
+        sample.is_sync = !tables.has_sync_samples;
+        // the sample must be in the file (written so that a 64-bit chunk
+        // offset cannot wrap around)
+        if (offset > demuxer_->length_ ||
+            sample.size > demuxer_->length_ - offset) {
+          return;
+        }
+        offset += sample.size;
+        samples.push_back(sample);
+      }
+    }
+
+    // decode times and durations (stts)
+    uint64_t decode_time = 0;
+    size_t index = 0;
+    for (const auto& entry : tables.time_to_sample) {
+      for (uint32_t i = 0; i < entry.first && index < samples.size(); i++) {
+        samples[index].decode_time = decode_time;
+        samples[index].duration = entry.second;
+        decode_time += entry.second;
+        index++;
+      }
+    }
+    next_decode_time_ = decode_time;
+
+    // composition offsets (ctts)
+    index = 0;
+    for (const auto& entry : tables.composition_offsets) {
+      for (uint32_t i = 0; i < entry.first && index < samples.size(); i++) {
+        samples[index++].composition_offset = entry.second;
+      }
+    }
+
+    // sync samples (stss)
+    for (uint32_t sample_number : tables.sync_samples) {
+      if (sample_number >= 1 && sample_number <= samples.size()) {
+        samples[sample_number - 1].is_sync = true;
+      }
+    }
+  }
+
+  // Section 8.8.3 of ISO/IEC 14496-12: track extends box.
+  void ReadMvex(const Box& mvex) {
+    Box box;
+    for (size_t offset = mvex.begin; ReadBox(data_, offset, mvex.end, &box);
+         offset = box.end) {
+      if (box.type != FourCc("trex") || !Has(box.begin, 24, box)) {
+        continue;
+      }
+      const uint8_t* p = data_ + box.begin;
+      TrackExtends& trex = track_extends_[ReadU32(p + 4)];
+      trex.default_sample_duration = ReadU32(p + 12);
+      trex.default_sample_size = ReadU32(p + 16);
+      trex.default_sample_flags = ReadU32(p + 20);
+    }
+  }
+
+  // Section 8.8.4 of ISO/IEC 14496-12: movie fragment box.
+  void ReadMoof(const Box& moof) {
+    Box box;
+    for (size_t offset = moof.begin; ReadBox(data_, offset, moof.end, &box);
+         offset = box.end) {
+      if (box.type == FourCc("traf")) {
+        ReadTraf(box, moof);
+      }
+    }
+  }
+
+  // Section 8.8.6 of ISO/IEC 14496-12: track fragment box.
+  void ReadTraf(const Box& traf, const Box& moof) {
+    Box box;
+    // tfhd: find it first, as trun depends on it
+    bool has_tfhd = false;
+    uint64_t base_data_offset = moof.start;
+    TrackExtends defaults = track_extends_[demuxer_->track_.track_id];
+    for (size_t offset = traf.begin; ReadBox(data_, offset, traf.end, &box);
+         offset = box.end) {
+      if (box.type != FourCc("tfhd") || !Has(box.begin, 8, box)) {
+        continue;
+      }
+      const uint8_t* p = data_ + box.begin;
+      uint32_t flags = ReadU32(p) & 0x00ffffff;
+      if (ReadU32(p + 4) != demuxer_->track_.track_id) {
+        return;
+      }
+      has_tfhd = true;
+      size_t pos = box.begin + 8;
+      if (flags & 0x000001) {
+        // base-data-offset-present
+        if (!Has(pos, 8, box)) {
+          return;
+        }
+        base_data_offset = ReadU64(data_ + pos);
+        pos += 8;
+      }
+      if (flags & 0x000002) {
+        // sample-description-index-present
+        pos += 4;
+      }
+      if ((flags & 0x000008) && Has(pos, 4, box)) {
+        defaults.default_sample_duration = ReadU32(data_ + pos);
+        pos += 4;
+      }
+      if ((flags & 0x000010) && Has(pos, 4, box)) {
+        defaults.default_sample_size = ReadU32(data_ + pos);
+        pos += 4;
+      }
+      if ((flags & 0x000020) && Has(pos, 4, box)) {
+        defaults.default_sample_flags = ReadU32(data_ + pos);
+        pos += 4;
+      }
+      break;
+    }
+    if (!has_tfhd) {
+      return;
+    }
+
+    // trun data with no data_offset continues after the previous one
+    uint64_t data_offset = base_data_offset;
+    for (size_t offset = traf.begin; ReadBox(data_, offset, traf.end, &box);
+         offset = box.end) {
+      if (box.type == FourCc("tfdt") && Has(box.begin, 8, box)) {
+        const uint8_t* p = data_ + box.begin;
+        next_decode_time_ = (p[0] == 1 && Has(box.begin, 12, box))
+                                ? ReadU64(p + 4)
+                                : ReadU32(p + 4);
+      } else if (box.type == FourCc("trun")) {
+        data_offset = ReadTrun(box, defaults, base_data_offset, data_offset);
+      }
+    }
+  }
+
+  // Section 8.8.8 of ISO/IEC 14496-12: track fragment run box. Returns
+  // the offset after the run data.
+  uint64_t ReadTrun(const Box& trun, const TrackExtends& defaults,
+                    uint64_t base_data_offset, uint64_t data_offset) {
+    if (!Has(trun.begin, 8, trun)) {
+      return data_offset;
+    }
+    const uint8_t* p = data_ + trun.begin;
+    uint32_t version = p[0];
+    uint32_t flags = ReadU32(p) & 0x00ffffff;
+    uint32_t sample_count = ReadU32(p + 4);
+    size_t pos = trun.begin + 8;
+    if (flags & 0x000001) {
+      // data-offset-present
+      if (!Has(pos, 4, trun)) {
+        return data_offset;
+      }
+      data_offset =
+          base_data_offset + static_cast<int32_t>(ReadU32(data_ + pos));
+      pos += 4;
+    }
+    uint32_t first_sample_flags = defaults.default_sample_flags;
+    bool has_first_sample_flags = (flags & 0x000004) != 0;
+    if (has_first_sample_flags) {
+      if (!Has(pos, 4, trun)) {
+        return data_offset;
+      }
+      first_sample_flags = ReadU32(data_ + pos);
+      pos += 4;
+    }
+    size_t entry_size = 4 * (((flags & 0x000100) != 0) +
+                             ((flags & 0x000200) != 0) +
+                             ((flags & 0x000400) != 0) +
+                             ((flags & 0x000800) != 0));
+    // bound the sample count by the space left for the samples: their
+    // entries in the box or, without per-sample fields, their (default)
+    // sizes in the file
+    uint64_t max_sample_count = 0;
+    if (entry_size > 0) {
+      max_sample_count = (trun.end - pos) / entry_size;
+    } else if (defaults.default_sample_size > 0 &&
+               data_offset < demuxer_->length_) {
+      max_sample_count =
+          (demuxer_->length_ - data_offset) / defaults.default_sample_size;
+    }
+    if (max_sample_count > kMaxTrunSampleCount) {
+      max_sample_count = kMaxTrunSampleCount;
+    }
+    if (sample_count > max_sample_count) {
+      sample_count = static_cast<uint32_t>(max_sample_count);
+    }
+    for (uint32_t i = 0; i < sample_count; i++) {
+      Sample sample;
+      sample.duration = defaults.default_sample_duration;
+      sample.size = defaults.default_sample_size;
+      uint32_t sample_flags = (i == 0 && has_first_sample_flags)
+                                  ? first_sample_flags
+                                  : defaults.default_sample_flags;
+      if (flags & 0x000100) {
+        sample.duration = ReadU32(data_ + pos);
+        pos += 4;
+      }
+      if (flags & 0x000200) {
+        sample.size = ReadU32(data_ + pos);
+        pos += 4;
+      }
+      if (flags & 0x000400) {
+        sample_flags = ReadU32(data_ + pos);
+        pos += 4;
+      }
+      if (flags & 0x000800) {
+        // signed in version 1
+        uint32_t value = ReadU32(data_ + pos);
+        sample.composition_offset =
+            (version == 0) ? value : static_cast<int32_t>(value);
+        pos += 4;
+      }
+      sample.offset = data_offset;
+      sample.decode_time = next_decode_time_;
+      sample.is_sync = !(sample_flags & kSampleIsNonSyncSample);
+      // the sample must be in the file (base_data_offset and a negative
+      // data_offset can make data_offset wrap around)
+      if (data_offset > demuxer_->length_ ||
+          sample.size > demuxer_->length_ - data_offset) {
+        break;
+      }
+      data_offset += sample.size;
+      next_decode_time_ += sample.duration;
+      demuxer_->samples_.push_back(sample);
+    }
+    return data_offset;
+  }
+
+  H265Mp4Demuxer* demuxer_;
+  const uint8_t* data_;
+  bool has_track_ = false;
+  std::map<uint32_t, TrackExtends> track_extends_;
+  uint64_t next_decode_time_ = 0;
+};
+
+bool H265Mp4Demuxer::IsMp4(const uint8_t* data, size_t length) noexcept {
+  return length >= 8 && ReadU32(data + 4) == FourCc("ftyp");
+}
+
+std::unique_ptr<H265Mp4Demuxer> H265Mp4Demuxer::Open(const uint8_t* data,
+                                                     size_t length) noexcept {
+  // make_unique cannot use the private ctor
+  std::unique_ptr<H265Mp4Demuxer> demuxer(new H265Mp4Demuxer(data, length));
+  BoxReader box_reader(demuxer.get());
+  if (!box_reader.Read()) {
+    return nullptr;
+  }
+  return demuxer;
+}
+
+std::vector<H265BitstreamParser::NaluIndex>
+H265Mp4Demuxer::GetSampleNaluIndices(const Sample& sample) const noexcept {
+  auto nalu_indices = H265BitstreamParser::FindNaluIndicesExplicitFraming(
+      data_ + sample.offset, sample.size, track_.length_size);
+  // make the offsets relative to the file
+  for (auto& nalu_index : nalu_indices) {
+    nalu_index.start_offset += sample.offset;
+    nalu_index.payload_start_offset += sample.offset;
+  }
+  return nalu_indices;
+}
+
+std::vector<H265BitstreamParser::NaluIndex> H265Mp4Demuxer::GetNaluIndices()
+    const noexcept {
+  std::vector<H265BitstreamParser::NaluIndex> nalu_indices =
+      track_.parameter_sets;
+  for (const auto& sample : samples_) {
+    auto sample_nalu_indices = GetSampleNaluIndices(sample);
+    nalu_indices.insert(nalu_indices.end(), sample_nalu_indices.begin(),
+                        sample_nalu_indices.end());
+  }
+  return nalu_indices;
+}
+
+#ifdef FDUMP_DEFINE
+void H265Mp4Demuxer::TrackInfo::fdump(FILE* outfp, int indent_level) const {
+  fprintf(outfp, "mp4_track {");
+  indent_level = indent_level_incr(indent_level);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "track_id: %i", track_id);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "timescale: %i", timescale);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "sample_entry: %s", sample_entry);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "width: %i", width);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "height: %i", height);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "length_size: %i", length_size);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "num_parameter_sets: %zu", parameter_sets.size());
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "fragmented: %i", fragmented);
+
+  indent_level = indent_level_decr(indent_level);
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "}");
+}
+#endif  // FDUMP_DEFINE
+
+}  // namespace h265nal
@@ -11,8 +11,10 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_error_reporter.h"
 #include "h265_nal_unit_header_parser.h"
 #include "h265_nal_unit_payload_parser.h"
+#include "h265_parameter_set_interner.h"
 
 namespace h265nal {
 
@@ -20,6 +22,44 @@ namespace h265nal {
 // You can find it on this page:
 // http://www.itu.int/rec/T-REC-H.265
 
+namespace {
+// Keep the RBSP of a parameter set in its state, and intern it.
+void SetParameterSetRbsp(
+    H265NalUnitParser::NalUnitState* nal_unit, const uint8_t* data,
+    size_t length, struct H265BitstreamParserState* bitstream_parser_state) {
+  if (nal_unit == nullptr || nal_unit->nal_unit_payload == nullptr) {
+    return;
+  }
+  auto& payload = nal_unit->nal_unit_payload;
+  H265ParameterSetInterner* interner =
+      (bitstream_parser_state != nullptr)
+          ? bitstream_parser_state->parameter_set_interner
+          : nullptr;
+  if (payload->vps != nullptr) {
+    payload->vps->rbsp.assign(data, data + length);
+    if (interner != nullptr) {
+      payload->vps = interner->Intern(payload->vps);
+      bitstream_parser_state->vps[payload->vps->vps_video_parameter_set_id] =
+          payload->vps;
+    }
+  } else if (payload->sps != nullptr) {
+    payload->sps->rbsp.assign(data, data + length);
+    if (interner != nullptr) {
+      payload->sps = interner->Intern(payload->sps);
+      bitstream_parser_state->sps[payload->sps->sps_seq_parameter_set_id] =
+          payload->sps;
+    }
+  } else if (payload->pps != nullptr) {
+    payload->pps->rbsp.assign(data, data + length);
+    if (interner != nullptr) {
+      payload->pps = interner->Intern(payload->pps);
+      bitstream_parser_state->pps[payload->pps->pps_pic_parameter_set_id] =
+          payload->pps;
+    }
+  }
+}
+}  // namespace
+
 // Parse NAL Unit state from the supplied buffer (unescaped version).
 std::unique_ptr<H265NalUnitParser::NalUnitState>
 H265NalUnitParser::ParseNalUnitUnescaped(
@@ -28,7 +68,10 @@ H265NalUnitParser::ParseNalUnitUnescaped(
     ParsingOptions parsing_options) noexcept {
   rtc::BitBuffer bit_buffer(data, length);
 
-  return ParseNalUnit(&bit_buffer, bitstream_parser_state, parsing_options);
+  auto nal_unit =
+      ParseNalUnit(&bit_buffer, bitstream_parser_state, parsing_options);
+  SetParameterSetRbsp(nal_unit.get(), data, length, bitstream_parser_state);
+  return nal_unit;
 }
 
 // Unpack RBSP and parse NAL Unit state from the supplied buffer.
@@ -40,7 +83,11 @@ H265NalUnitParser::ParseNalUnit(
   std::vector<uint8_t> unpacked_buffer = UnescapeRbsp(data, length);
   rtc::BitBuffer bit_buffer(unpacked_buffer.data(), unpacked_buffer.size());
 
-  return ParseNalUnit(&bit_buffer, bitstream_parser_state, parsing_options);
+  auto nal_unit =
+      ParseNalUnit(&bit_buffer, bitstream_parser_state, parsing_options);
+  SetParameterSetRbsp(nal_unit.get(), unpacked_buffer.data(),
+                      unpacked_buffer.size(), bitstream_parser_state);
+  return nal_unit;
 }
 
 std::unique_ptr<H265NalUnitParser::NalUnitState>
@@ -69,13 +116,31 @@ H265NalUnitParser::ParseNalUnit(
     return nullptr;
   }
 
+  // errors in the payload are reported in the context of this NAL unit
+  uint32_t nal_unit_type = nal_unit->nal_unit_header->nal_unit_type;
+  H265ErrorReporter::Scope error_scope(
+      (bitstream_parser_state != nullptr)
+          ? bitstream_parser_state->error_reporter
+          : nullptr,
+      nal_unit_type);
+
   // nal_unit_payload()
   nal_unit->nal_unit_payload = H265NalUnitPayloadParser::ParseNalUnitPayload(
-      bit_buffer, nal_unit->nal_unit_header->nal_unit_type,
-      bitstream_parser_state);
+      bit_buffer, nal_unit_type, bitstream_parser_state, parsing_options);
   if (nal_unit->nal_unit_payload == nullptr) {
     return nullptr;
   }
+  // most syntax structures fail because the NAL unit ends early: report
+  // them when they did not report a more specific error
+  const char* failed_payload_structure =
+      H265NalUnitPayloadParser::GetFailedPayloadStructure(
+          nal_unit_type, *(nal_unit->nal_unit_payload));
+  if (failed_payload_structure != nullptr &&
+      H265ErrorReporter::active() != nullptr &&
+      error_scope.num_errors() == 0) {
+    ReportParseError(ParseErrorCode::kTruncated, failed_payload_structure, 0,
+                     bit_buffer);
+  }
 
   // update the parsed length
   nal_unit->parsed_length = get_current_offset(bit_buffer);
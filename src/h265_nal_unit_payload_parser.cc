@@ -23,6 +23,28 @@ namespace h265nal {
 // You can find it on this page:
 // http://www.itu.int/rec/T-REC-H.265
 
+namespace {
+// Record the SPS activated by a slice segment (through its PPS).
+void UpdateActiveSps(
+    const H265SliceSegmentLayerParser::SliceSegmentLayerState*
+        slice_segment_layer,
+    struct H265BitstreamParserState* bitstream_parser_state) {
+  if (slice_segment_layer == nullptr ||
+      slice_segment_layer->slice_segment_header == nullptr) {
+    return;
+  }
+  auto pps = bitstream_parser_state->GetPps(
+      slice_segment_layer->slice_segment_header->slice_pic_parameter_set_id);
+  if (pps == nullptr) {
+    return;
+  }
+  auto sps = bitstream_parser_state->GetSps(pps->pps_seq_parameter_set_id);
+  if (sps != nullptr) {
+    bitstream_parser_state->active_sps = sps;
+  }
+}
+}  // namespace
+
 // Unpack RBSP and parse NAL Unit payload state from the supplied buffer.
 std::unique_ptr<H265NalUnitPayloadParser::NalUnitPayloadState>
 H265NalUnitPayloadParser::ParseNalUnitPayload(
@@ -38,7 +60,8 @@ H265NalUnitPayloadParser::ParseNalUnitPayload(
 std::unique_ptr<H265NalUnitPayloadParser::NalUnitPayloadState>
 H265NalUnitPayloadParser::ParseNalUnitPayload(
     rtc::BitBuffer* bit_buffer, uint32_t nal_unit_type,
-    struct H265BitstreamParserState* bitstream_parser_state) noexcept {
+    struct H265BitstreamParserState* bitstream_parser_state,
+    ParsingOptions parsing_options) noexcept {
   // H265 NAL Unit Payload (nal_unit()) parser.
   // Section 7.3.1.1 ("General NAL unit header syntax") of the H.265
   // standard for a complete description.
@@ -60,6 +83,8 @@ H265NalUnitPayloadParser::ParseNalUnitPayload(
       nal_unit_payload->slice_segment_layer =
           H265SliceSegmentLayerParser::ParseSliceSegmentLayer(
               bit_buffer, nal_unit_type, bitstream_parser_state);
+      UpdateActiveSps(nal_unit_payload->slice_segment_layer.get(),
+                      bitstream_parser_state);
       break;
     }
     case RSV_VCL_N10:
@@ -80,6 +105,8 @@ H265NalUnitPayloadParser::ParseNalUnitPayload(
       nal_unit_payload->slice_segment_layer =
           H265SliceSegmentLayerParser::ParseSliceSegmentLayer(
               bit_buffer, nal_unit_type, bitstream_parser_state);
+      UpdateActiveSps(nal_unit_payload->slice_segment_layer.get(),
+                      bitstream_parser_state);
       break;
     }
     case RSV_IRAP_VCL22:
@@ -142,7 +169,13 @@ H265NalUnitPayloadParser::ParseNalUnitPayload(
       break;
     case PREFIX_SEI_NUT:
     case SUFFIX_SEI_NUT:
-      nal_unit_payload->sei = H265SeiMessageParser::ParseSei(bit_buffer);
+      // sei_rbsp()
+      nal_unit_payload->sei_rbsp = H265SeiRbspParser::ParseSeiRbsp(
+          bit_buffer, bitstream_parser_state, parsing_options, nullptr);
+      if (nal_unit_payload->sei_rbsp != nullptr &&
+          !nal_unit_payload->sei_rbsp->sei_message.empty()) {
+        nal_unit_payload->sei = nal_unit_payload->sei_rbsp->sei_message[0];
+      }
       break;
     case RSV_NVCL41:
     case RSV_NVCL42:
@@ -161,6 +194,36 @@ H265NalUnitPayloadParser::ParseNalUnitPayload(
   return nal_unit_payload;
 }
 
+const char* H265NalUnitPayloadParser::GetFailedPayloadStructure(
+    uint32_t nal_unit_type,
+    const NalUnitPayloadState& nal_unit_payload) noexcept {
+  if (IsSliceSegment(nal_unit_type)) {
+    return (nal_unit_payload.slice_segment_layer == nullptr)
+               ? "slice_segment_layer_rbsp"
+               : nullptr;
+  }
+  switch (nal_unit_type) {
+    case VPS_NUT:
+      return (nal_unit_payload.vps == nullptr) ? "video_parameter_set_rbsp"
+                                               : nullptr;
+    case SPS_NUT:
+      return (nal_unit_payload.sps == nullptr) ? "seq_parameter_set_rbsp"
+                                               : nullptr;
+    case PPS_NUT:
+      return (nal_unit_payload.pps == nullptr) ? "pic_parameter_set_rbsp"
+                                               : nullptr;
+    case AUD_NUT:
+      return (nal_unit_payload.aud == nullptr)
+                 ? "access_unit_delimiter_rbsp"
+                 : nullptr;
+    case PREFIX_SEI_NUT:
+    case SUFFIX_SEI_NUT:
+      return (nal_unit_payload.sei_rbsp == nullptr) ? "sei_rbsp" : nullptr;
+    default:
+      return nullptr;
+  }
+}
+
 #ifdef FDUMP_DEFINE
 void H265NalUnitPayloadParser::NalUnitPayloadState::fdump(
     FILE* outfp, int indent_level, uint32_t nal_unit_type,
@@ -248,8 +311,8 @@ void H265NalUnitPayloadParser::NalUnitPayloadState::fdump(
       break;
     case PREFIX_SEI_NUT:
     case SUFFIX_SEI_NUT:
-      if (sei) {
-        sei->fdump(outfp, indent_level);
+      if (sei_rbsp) {
+        sei_rbsp->fdump(outfp, indent_level);
       }
       break;
     case RSV_NVCL41:
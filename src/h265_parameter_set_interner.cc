@@ -0,0 +1,114 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_parameter_set_interner.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace h265nal {
+
+namespace {
+// do not bother pruning small tables
+const size_t kMinPruneSize = 64;
+
+template <typename Table>
+void EraseExpired(Table* table) {
+  for (auto it = table->begin(); it != table->end();) {
+    if (it->second.expired()) {
+      it = table->erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+}  // namespace
+
+H265ParameterSetInterner* H265ParameterSetInterner::GetGlobal() noexcept {
+  // never destroyed, so that it can be used until the process exits
+  static H265ParameterSetInterner* global = new H265ParameterSetInterner();
+  return global;
+}
+
+std::shared_ptr<struct H265VpsParser::VpsState>
+H265ParameterSetInterner::Intern(
+    const std::shared_ptr<struct H265VpsParser::VpsState>& vps) noexcept {
+  return InternInTable(&vps_, vps);
+}
+
+std::shared_ptr<struct H265SpsParser::SpsState>
+H265ParameterSetInterner::Intern(
+    const std::shared_ptr<struct H265SpsParser::SpsState>& sps) noexcept {
+  return InternInTable(&sps_, sps);
+}
+
+std::shared_ptr<struct H265PpsParser::PpsState>
+H265ParameterSetInterner::Intern(
+    const std::shared_ptr<struct H265PpsParser::PpsState>& pps) noexcept {
+  return InternInTable(&pps_, pps);
+}
+
+size_t H265ParameterSetInterner::size() const noexcept {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t size = 0;
+  for (const auto& it : vps_) {
+    size += it.second.expired() ? 0 : 1;
+  }
+  for (const auto& it : sps_) {
+    size += it.second.expired() ? 0 : 1;
+  }
+  for (const auto& it : pps_) {
+    size += it.second.expired() ? 0 : 1;
+  }
+  return size;
+}
+
+uint64_t H265ParameterSetInterner::num_hits() const noexcept {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_hits_;
+}
+
+uint64_t H265ParameterSetInterner::num_misses() const noexcept {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_misses_;
+}
+
+template <typename State>
+std::shared_ptr<State> H265ParameterSetInterner::InternInTable(
+    Table<State>* table, const std::shared_ptr<State>& state) {
+  if (state == nullptr || state->rbsp.empty()) {
+    return state;
+  }
+  std::string key(state->rbsp.begin(), state->rbsp.end());
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = table->find(key);
+  if (it != table->end()) {
+    std::shared_ptr<State> interned = it->second.lock();
+    if (interned != nullptr) {
+      num_hits_++;
+      return interned;
+    }
+    // the previous one expired
+    it->second = state;
+  } else {
+    table->emplace(std::move(key), state);
+    MaybePrune();
+  }
+  num_misses_++;
+  return state;
+}
+
+void H265ParameterSetInterner::MaybePrune() {
+  size_t total_size = vps_.size() + sps_.size() + pps_.size();
+  if (total_size < kMinPruneSize || total_size < 2 * pruned_size_) {
+    return;
+  }
+  EraseExpired(&vps_);
+  EraseExpired(&sps_);
+  EraseExpired(&pps_);
+  pruned_size_ = vps_.size() + sps_.size() + pps_.size();
+}
+
+}  // namespace h265nal
@@ -11,6 +11,7 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_error_reporter.h"
 #include "h265_pps_scc_extension_parser.h"
 #include "h265_profile_tier_level_parser.h"
 #include "h265_scaling_list_data_parser.h"
@@ -291,27 +292,24 @@ std::shared_ptr<H265PpsParser::PpsState> H265PpsParser::ParsePps(
   if (pps->pps_range_extension_flag) {
     // pps_range_extension()
     // TODO(chemag): add support for pps_range_extension()
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: unimplemented pps_range_extension() in pps\n");
-#endif  // FPRINT_ERRORS
+    ReportParseError(ParseErrorCode::kUnsupported, "pps_range_extension", 0,
+                     bit_buffer);
     return nullptr;
   }
 
   if (pps->pps_multilayer_extension_flag) {
     // pps_multilayer_extension() // specified in Annex F
     // TODO(chemag): add support for pps_multilayer_extension()
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: unimplemented pps_multilayer_extension() in pps\n");
-#endif  // FPRINT_ERRORS
+    ReportParseError(ParseErrorCode::kUnsupported, "pps_multilayer_extension",
+                     0, bit_buffer);
     return nullptr;
   }
 
   if (pps->pps_3d_extension_flag) {
     // pps_3d_extension() // specified in Annex I
     // TODO(chemag): add support for pps_3d_extension()
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: unimplemented pps_3d_extension() in pps\n");
-#endif  // FPRINT_ERRORS
+    ReportParseError(ParseErrorCode::kUnsupported, "pps_3d_extension", 0,
+                     bit_buffer);
     return nullptr;
   }
 
@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_error_reporter.h"
 
 namespace h265nal {
 
@@ -131,15 +132,10 @@ H265PpsSccExtensionParser::ParsePpsSccExtension(
                   ? (pps_scc_extension->luma_bit_depth_entry_minus8 + 8)
                   : (pps_scc_extension->chroma_bit_depth_entry_minus8 + 8);
           if (bit_depth == 0) {
-#ifdef FPRINT_ERRORS
-            fprintf(stderr,
-                    "error: invalid luma_bit_depth_entry_minus8: "
-                    "%" PRIu32
-                    " or chroma_bit_depth_entry_minus8: "
-                    "%" PRIu32 "\n",
-                    pps_scc_extension->luma_bit_depth_entry_minus8,
-                    pps_scc_extension->chroma_bit_depth_entry_minus8);
-#endif  // FPRINT_ERRORS
+            ReportParseError(ParseErrorCode::kOutOfRange,
+                             (comp == 0) ? "luma_bit_depth_entry_minus8"
+                                         : "chroma_bit_depth_entry_minus8",
+                             bit_depth, bit_buffer);
             return nullptr;
           }
           if (!bit_buffer->ReadBits(bit_depth, bits_tmp)) {
@@ -20,6 +20,13 @@ namespace h265nal {
 // You can find it on this page:
 // http://www.itu.int/rec/T-REC-H.265
 
+namespace {
+// 4 * WpOffsetHalfRangeC, with the largest WpOffsetHalfRangeC (i.e.
+// high_precision_offsets_enabled_flag equal to 1 and a 16-bit chroma
+// bit depth)
+const int32_t kMaxChromaOffset = 4 * (1 << 15);
+}  // namespace
+
 // Unpack RBSP and parse pred_weight_table state from the supplied buffer.
 std::unique_ptr<H265PredWeightTableParser::PredWeightTableState>
 H265PredWeightTableParser::ParsePredWeightTable(
@@ -46,12 +53,20 @@ H265PredWeightTableParser::ParsePredWeightTable(
   pred_weight_table->ChromaArrayType = ChromaArrayType;
   pred_weight_table->num_ref_idx_l0_active_minus1 =
       num_ref_idx_l0_active_minus1;
+  if (num_ref_idx_l0_active_minus1 >
+      h265limits::NUM_REF_IDX_ACTIVE_MINUS1_MAX) {
+    return nullptr;
+  }
 
   // luma_log2_weight_denom  ue(v)
   if (!bit_buffer->ReadExponentialGolomb(
           pred_weight_table->luma_log2_weight_denom)) {
     return nullptr;
   }
+  // Section 7.4.7.3: the value is in the range of 0 to 7
+  if (pred_weight_table->luma_log2_weight_denom > 7) {
+    return nullptr;
+  }
 
   if (pred_weight_table->ChromaArrayType != 0) {
     // delta_chroma_log2_weight_denom  se(v)
@@ -59,6 +74,14 @@ H265PredWeightTableParser::ParsePredWeightTable(
             pred_weight_table->delta_chroma_log2_weight_denom)) {
       return nullptr;
     }
+    // Section 7.4.7.3: ChromaLog2WeightDenom (luma_log2_weight_denom +
+    // delta_chroma_log2_weight_denom) is in the range of 0 to 7
+    int32_t ChromaLog2WeightDenom =
+        pred_weight_table->luma_log2_weight_denom +
+        pred_weight_table->delta_chroma_log2_weight_denom;
+    if (ChromaLog2WeightDenom < 0 || ChromaLog2WeightDenom > 7) {
+      return nullptr;
+    }
   }
 
   for (uint32_t i = 0; i <= pred_weight_table->num_ref_idx_l0_active_minus1;
@@ -69,7 +92,7 @@ H265PredWeightTableParser::ParsePredWeightTable(
     if (!bit_buffer->ReadBits(1, bits_tmp)) {
       return nullptr;
     }
-    pred_weight_table->luma_weight_l0_flag.push_back(bits_tmp);
+    pred_weight_table->luma_weight_l0_flag[i] = bits_tmp;
   }
 
   if (pred_weight_table->ChromaArrayType != 0) {
@@ -81,7 +104,7 @@ H265PredWeightTableParser::ParsePredWeightTable(
       if (!bit_buffer->ReadBits(1, bits_tmp)) {
         return nullptr;
       }
-      pred_weight_table->chroma_weight_l0_flag.push_back(bits_tmp);
+      pred_weight_table->chroma_weight_l0_flag[i] = bits_tmp;
     }
   }
 
@@ -92,31 +115,47 @@ H265PredWeightTableParser::ParsePredWeightTable(
       if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
         return nullptr;
       }
-      pred_weight_table->delta_luma_weight_l0.push_back(sgolomb_tmp);
+      // Section 7.4.7.3: the value is in the range of -128 to 127
+      if (sgolomb_tmp < INT8_MIN || sgolomb_tmp > INT8_MAX) {
+        return nullptr;
+      }
+      pred_weight_table->delta_luma_weight_l0[i] = sgolomb_tmp;
       // luma_offset_l0[i]  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
         return nullptr;
       }
-      pred_weight_table->luma_offset_l0.push_back(sgolomb_tmp);
+      // Section 7.4.7.3: the value is in the range of -WpOffsetHalfRangeY
+      // to WpOffsetHalfRangeY - 1, which is at most 2^15
+      if (sgolomb_tmp < INT16_MIN || sgolomb_tmp > INT16_MAX) {
+        return nullptr;
+      }
+      pred_weight_table->luma_offset_l0[i] = sgolomb_tmp;
     }
     if (pred_weight_table->ChromaArrayType != 0) {
       if (pred_weight_table->chroma_weight_l0_flag[i]) {
-        pred_weight_table->delta_chroma_weight_l0.emplace_back();
-        pred_weight_table->delta_chroma_offset_l0.emplace_back();
         for (int j = 0; j < 2; ++j) {
           // delta_chroma_weight_l0[i][j]  se(v)
           if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
             return nullptr;
           }
-          pred_weight_table->delta_chroma_weight_l0.back().push_back(
-              sgolomb_tmp);
+          // Section 7.4.7.3: the value is in the range of -128 to 127
+          if (sgolomb_tmp < INT8_MIN || sgolomb_tmp > INT8_MAX) {
+            return nullptr;
+          }
+          pred_weight_table->delta_chroma_weight_l0[i][j] = sgolomb_tmp;
 
           // delta_chroma_offset_l0[i][j]  se(v)
           if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
             return nullptr;
           }
-          pred_weight_table->delta_chroma_offset_l0.back().push_back(
-              sgolomb_tmp);
+          // Section 7.4.7.3: the value is in the range of
+          // -4 * WpOffsetHalfRangeC to 4 * WpOffsetHalfRangeC - 1, where
+          // WpOffsetHalfRangeC is at most 2^15
+          if (sgolomb_tmp < -kMaxChromaOffset ||
+              sgolomb_tmp > kMaxChromaOffset - 1) {
+            return nullptr;
+          }
+          pred_weight_table->delta_chroma_offset_l0[i][j] = sgolomb_tmp;
         }
       }
     }
@@ -142,54 +181,57 @@ void H265PredWeightTableParser::PredWeightTableState::fdump(
 
   fdump_indent_level(outfp, indent_level);
   fprintf(outfp, "luma_weight_l0_flag {");
-  for (const uint32_t& v : luma_weight_l0_flag) {
-    fprintf(outfp, " %i", v);
+  for (uint32_t i = 0; i <= num_ref_idx_l0_active_minus1; i++) {
+    fprintf(outfp, " %i", luma_weight_l0_flag[i]);
   }
   fprintf(outfp, " }");
 
   if (ChromaArrayType != 0) {
     fdump_indent_level(outfp, indent_level);
     fprintf(outfp, "chroma_weight_l0_flag {");
-    for (const uint32_t& v : chroma_weight_l0_flag) {
-      fprintf(outfp, " %i", v);
+    for (uint32_t i = 0; i <= num_ref_idx_l0_active_minus1; i++) {
+      fprintf(outfp, " %i", chroma_weight_l0_flag[i]);
     }
     fprintf(outfp, " }");
   }
 
+  // only the explicit weights are dumped
   fdump_indent_level(outfp, indent_level);
   fprintf(outfp, "delta_luma_weight_l0 {");
-  for (const uint32_t& v : delta_luma_weight_l0) {
-    fprintf(outfp, " %i", v);
+  for (uint32_t i = 0; i <= num_ref_idx_l0_active_minus1; i++) {
+    if (luma_weight_l0_flag[i]) {
+      fprintf(outfp, " %i", delta_luma_weight_l0[i]);
+    }
   }
   fprintf(outfp, " }");
 
   fdump_indent_level(outfp, indent_level);
   fprintf(outfp, "luma_offset_l0 {");
-  for (const uint32_t& v : luma_offset_l0) {
-    fprintf(outfp, " %i", v);
+  for (uint32_t i = 0; i <= num_ref_idx_l0_active_minus1; i++) {
+    if (luma_weight_l0_flag[i]) {
+      fprintf(outfp, " %i", luma_offset_l0[i]);
+    }
   }
   fprintf(outfp, " }");
 
   if (ChromaArrayType != 0) {
     fdump_indent_level(outfp, indent_level);
     fprintf(outfp, "delta_chroma_weight_l0 {");
-    for (const std::vector<uint32_t>& vv : delta_chroma_weight_l0) {
-      fprintf(outfp, " {");
-      for (const uint32_t& v : vv) {
-        fprintf(outfp, " %i", v);
+    for (uint32_t i = 0; i <= num_ref_idx_l0_active_minus1; i++) {
+      if (chroma_weight_l0_flag[i]) {
+        fprintf(outfp, " { %i %i }", delta_chroma_weight_l0[i][0],
+                delta_chroma_weight_l0[i][1]);
       }
-      fprintf(outfp, " }");
     }
     fprintf(outfp, " }");
 
     fdump_indent_level(outfp, indent_level);
     fprintf(outfp, "delta_chroma_offset_l0 {");
-    for (const std::vector<uint32_t>& vv : delta_chroma_offset_l0) {
-      fprintf(outfp, " {");
-      for (const uint32_t& v : vv) {
-        fprintf(outfp, " %i", v);
+    for (uint32_t i = 0; i <= num_ref_idx_l0_active_minus1; i++) {
+      if (chroma_weight_l0_flag[i]) {
+        fprintf(outfp, " { %i %i }", delta_chroma_offset_l0[i][0],
+                delta_chroma_offset_l0[i][1]);
       }
-      fprintf(outfp, " }");
     }
     fprintf(outfp, " }");
   }
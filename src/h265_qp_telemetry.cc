@@ -0,0 +1,179 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_qp_telemetry.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+#include "h265_slice_parser.h"
+
+namespace h265nal {
+
+// General note: this is based off the 2016/12 version of the H.265 standard.
+// You can find it on this page:
+// http://www.itu.int/rec/T-REC-H.265
+
+namespace {
+// Table 8-10: QpC as a function of qPi (for ChromaArrayType equal to 1)
+const int32_t kQpCTable[] = {29, 30, 31, 32, 33, 33, 34,
+                             34, 35, 35, 36, 36, 37, 37};
+}  // namespace
+
+int32_t H265QpTelemetry::GetSliceQpY(
+    const H265SliceSegmentHeaderParser::SliceSegmentHeaderState&
+        slice_segment_header,
+    const H265PpsParser::PpsState& pps) noexcept {
+  // Equation 7-54, Section 7.4.7.1
+  return 26 + pps.init_qp_minus26 + slice_segment_header.slice_qp_delta;
+}
+
+int32_t H265QpTelemetry::GetChromaQp(
+    int32_t qp_y, int32_t qp_offset,
+    const H265SpsParser::SpsState& sps) noexcept {
+  // Equations 8-257 and 8-258: qPi = Clip3(-QpBdOffsetC, 57, QpY + offsets)
+  int32_t QpBdOffsetC = 6 * static_cast<int32_t>(sps.bit_depth_chroma_minus8);
+  int32_t qPi = std::min(std::max(qp_y + qp_offset, -QpBdOffsetC), 57);
+  uint32_t ChromaArrayType =
+      sps.separate_colour_plane_flag ? 0 : sps.chroma_format_idc;
+  if (ChromaArrayType != 1) {
+    return std::min(qPi, 51);
+  }
+  if (qPi < 30) {
+    return qPi;
+  }
+  if (qPi > 43) {
+    return qPi - 6;
+  }
+  return kQpCTable[qPi - 30];
+}
+
+bool H265QpTelemetry::SliceQpParser::ParseNalUnit(const uint8_t* data,
+                                                  size_t length,
+                                                  SliceQp* slice_qp) noexcept {
+  // nal_unit_header()
+  if (length < 2) {
+    return false;
+  }
+  uint32_t nal_unit_type = (data[0] >> 1) & 0x3f;
+  uint32_t nuh_temporal_id_plus1 = data[1] & 0x07;
+
+  if (nal_unit_type == VPS_NUT || nal_unit_type == SPS_NUT ||
+      nal_unit_type == PPS_NUT) {
+    // keep the parameter sets up to date (including their RBSP, and the
+    // interning)
+    H265NalUnitParser::ParseNalUnit(data, length, bitstream_parser_state_);
+    return false;
+  }
+  if (!IsSliceSegment(nal_unit_type)) {
+    return false;
+  }
+
+  // parse the slice segment header up to the QP offsets
+  auto* slice_segment_header = &slice_segment_header_;
+  if (!H265SliceSegmentHeaderParser::ParseSliceSegmentHeaderPrefix(
+          data + 2, length - 2, nal_unit_type, bitstream_parser_state_,
+          &rbsp_buffer_, slice_segment_header)) {
+    return false;
+  }
+
+  SliceQp current;
+  if (slice_segment_header->dependent_slice_segment_flag) {
+    // dependent slice segments use the values of the preceding independent
+    // slice segment (Section 7.4.7.1)
+    if (!has_last_slice_qp_) {
+      return false;
+    }
+    current = last_slice_qp_;
+  } else {
+    // the parameter sets the slice segment header was parsed with
+    const auto& pps = slice_segment_header->pps;
+    const auto& sps = slice_segment_header->sps;
+    if (pps == nullptr || sps == nullptr) {
+      return false;
+    }
+    current.slice_type = slice_segment_header->slice_type;
+    current.qp_y = GetSliceQpY(*slice_segment_header, *pps);
+    current.qp_cb =
+        GetChromaQp(current.qp_y,
+                    pps->pps_cb_qp_offset +
+                        slice_segment_header->slice_cb_qp_offset,
+                    *sps);
+    current.qp_cr =
+        GetChromaQp(current.qp_y,
+                    pps->pps_cr_qp_offset +
+                        slice_segment_header->slice_cr_qp_offset,
+                    *sps);
+  }
+  current.temporal_id =
+      (nuh_temporal_id_plus1 > 0) ? (nuh_temporal_id_plus1 - 1) : 0;
+  current.first_slice_segment_in_pic_flag =
+      slice_segment_header->first_slice_segment_in_pic_flag;
+  current.dependent_slice_segment_flag =
+      slice_segment_header->dependent_slice_segment_flag;
+  last_slice_qp_ = current;
+  has_last_slice_qp_ = true;
+  *slice_qp = current;
+  return true;
+}
+
+bool H265QpTelemetry::ProcessNalUnit(const uint8_t* data, size_t length,
+                                     SliceQp* slice_qp) noexcept {
+  SliceQp current;
+  if (!slice_qp_parser_.ParseNalUnit(data, length, &current)) {
+    return false;
+  }
+
+  // aggregate
+  if (current.first_slice_segment_in_pic_flag) {
+    Flush();
+  }
+  if (!has_current_frame_) {
+    current_frame_ = FrameQp();
+    current_frame_.frame_index = num_frames_;
+    current_frame_.temporal_id = current.temporal_id;
+    has_current_frame_ = true;
+  }
+  current_frame_.qp_y.Add(current.qp_y);
+  current_frame_.qp_cb.Add(current.qp_cb);
+  current_frame_.qp_cr.Add(current.qp_cr);
+  current_frame_.qp_y_per_slice_type[current.slice_type % kNumSliceTypes].Add(
+      current.qp_y);
+  slice_type_stats_[current.slice_type % kNumSliceTypes].Add(current.qp_y);
+  temporal_layer_stats_[current.temporal_id % kMaxTemporalLayers].Add(
+      current.qp_y);
+
+  if (slice_qp != nullptr) {
+    *slice_qp = current;
+  }
+  return true;
+}
+
+void H265QpTelemetry::ProcessBitstream(const uint8_t* data,
+                                       size_t length) noexcept {
+  auto nalu_indices = H265BitstreamParser::FindNaluIndices(data, length);
+  for (const auto& nalu_index : nalu_indices) {
+    ProcessNalUnit(data + nalu_index.payload_start_offset,
+                   nalu_index.payload_size, nullptr);
+  }
+}
+
+void H265QpTelemetry::Flush() noexcept {
+  if (!has_current_frame_) {
+    return;
+  }
+  frames_.Push(current_frame_);
+  temporal_layer_frames_[current_frame_.temporal_id % kMaxTemporalLayers]
+      .Push(current_frame_);
+  num_frames_++;
+  has_current_frame_ = false;
+}
+
+}  // namespace h265nal
@@ -8,9 +8,13 @@
 #include <inttypes.h>
 #include <stdio.h>
 
+#include <string.h>
+
 #include <algorithm>
 #include <cstdint>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "h265_common.h"
@@ -21,6 +25,207 @@ namespace h265nal {
 // You can find it on this page:
 // http://www.itu.int/rec/T-REC-H.265
 
+namespace {
+// Table 7-6: default values of ScalingList[1..3][matrixId][i], for the
+// intra (matrixId 0 to 2) and the inter (matrixId 3 to 5) lists. The
+// sizeId 0 default values are all 16 (Table 7-5).
+const uint8_t kDefaultScalingListIntra[64] = {
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 17, 16, 17, 16, 17, 18,
+    17, 18, 18, 17, 18, 21, 19, 20, 21, 20, 19, 21, 24, 22, 22, 24,
+    24, 22, 22, 24, 25, 25, 27, 30, 27, 25, 25, 29, 31, 35, 35, 31,
+    29, 36, 41, 44, 41, 36, 47, 54, 54, 47, 65, 70, 65, 88, 88, 115};
+const uint8_t kDefaultScalingListInter[64] = {
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 17, 17, 17, 17, 17, 18,
+    18, 18, 18, 18, 18, 20, 20, 20, 20, 20, 20, 20, 24, 24, 24, 24,
+    24, 24, 24, 24, 25, 25, 25, 25, 25, 25, 25, 28, 28, 28, 28, 28,
+    28, 33, 33, 33, 33, 33, 41, 41, 41, 41, 54, 54, 54, 71, 71, 91};
+
+// offset of the ScalingFactor[sizeId] matrices
+const uint32_t kScalingFactorOffset[4] = {0, 6 * 16, 6 * (16 + 64),
+                                          6 * (16 + 64 + 256)};
+
+// do not bother pruning small caches
+const size_t kMinPruneSize = 64;
+
+uint32_t GetCoefNum(uint32_t sizeId) {
+  return std::min(64, (1 << (4 + (sizeId << 1))));
+}
+
+// Section 7.4.5: infer ScalingList[sizeId][matrixId] (and the DC
+// coefficient) from the default list.
+void SetDefaultList(
+    uint32_t sizeId, uint32_t matrixId,
+    H265ScalingListDataParser::ScalingListDataState* scaling_list_data) {
+  uint8_t* list = scaling_list_data->ScalingList[sizeId][matrixId];
+  if (sizeId == 0) {
+    memset(list, 16, GetCoefNum(sizeId));
+  } else {
+    memcpy(list,
+           (matrixId < 3) ? kDefaultScalingListIntra : kDefaultScalingListInter,
+           GetCoefNum(sizeId));
+  }
+  if (sizeId > 1) {
+    scaling_list_data->scaling_list_dc_coef_minus8[sizeId - 2][matrixId] = 8;
+  }
+}
+
+// 64-bit FNV-1a
+uint64_t HashBytes(const void* data, size_t length, uint64_t hash) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+template <typename State>
+uint64_t HashLists(const State& state) {
+  uint64_t hash = HashBytes(state.ScalingList, sizeof(state.ScalingList),
+                            0xcbf29ce484222325ull);
+  return HashBytes(state.scaling_list_dc_coef_minus8,
+                   sizeof(state.scaling_list_dc_coef_minus8), hash);
+}
+
+template <typename State0, typename State1>
+bool HaveSameLists(const State0& state0, const State1& state1) {
+  return state0.lists_hash == state1.lists_hash &&
+         memcmp(state0.ScalingList, state1.ScalingList,
+                sizeof(state0.ScalingList)) == 0 &&
+         memcmp(state0.scaling_list_dc_coef_minus8,
+                state1.scaling_list_dc_coef_minus8,
+                sizeof(state0.scaling_list_dc_coef_minus8)) == 0;
+}
+
+// Section 6.5.3: up-right diagonal scan order of a blkSize x blkSize
+// block, as (x, y) pairs.
+void GetDiagonalScan(uint32_t blkSize, uint8_t (*diagScan)[2]) {
+  uint32_t i = 0;
+  int32_t x = 0;
+  int32_t y = 0;
+  while (i < blkSize * blkSize) {
+    while (y >= 0) {
+      if (x < static_cast<int32_t>(blkSize) &&
+          y < static_cast<int32_t>(blkSize)) {
+        diagScan[i][0] = x;
+        diagScan[i][1] = y;
+        i++;
+      }
+      y--;
+      x++;
+    }
+    y = x;
+    x = 0;
+  }
+}
+
+// Section 7.4.5: derive the ScalingFactor arrays from the lists.
+void DeriveScalingFactor(
+    H265ScalingListDataParser::ScalingFactorState* scaling_factor) {
+  uint8_t scan4x4[16][2];
+  uint8_t scan8x8[64][2];
+  GetDiagonalScan(4, scan4x4);
+  GetDiagonalScan(8, scan8x8);
+  for (uint32_t sizeId = 0; sizeId < 4; sizeId++) {
+    uint32_t size = 4 << sizeId;
+    // the 4x4 lists are used as they are, the 8x8 ones are upsampled
+    const uint8_t(*scan)[2] = (sizeId == 0) ? scan4x4 : scan8x8;
+    uint32_t ratio = (sizeId == 0) ? 1 : (size / 8);
+    for (uint32_t matrixId = 0; matrixId < 6; matrixId++) {
+      // the sizeId 3 chroma matrices are derived from the sizeId 2 lists
+      uint32_t listSizeId = (sizeId == 3 && matrixId % 3 != 0) ? 2 : sizeId;
+      const uint8_t* list = scaling_factor->ScalingList[listSizeId][matrixId];
+      uint8_t* factor = scaling_factor->ScalingFactor +
+                        kScalingFactorOffset[sizeId] + matrixId * size * size;
+      for (uint32_t i = 0; i < GetCoefNum(sizeId); i++) {
+        uint32_t x = scan[i][0] * ratio;
+        uint32_t y = scan[i][1] * ratio;
+        for (uint32_t j = 0; j < ratio; j++) {
+          memset(factor + (y + j) * size + x, list[i], ratio);
+        }
+      }
+      if (sizeId > 1) {
+        factor[0] =
+            scaling_factor->scaling_list_dc_coef_minus8[listSizeId - 2]
+                                                       [matrixId] +
+            8;
+      }
+    }
+  }
+}
+
+// A process-wide cache of the ScalingFactor arrays, by lists hash. It only
+// holds weak references: the arrays are dropped once no scaling list data
+// uses them.
+class ScalingFactorCache {
+ public:
+  static ScalingFactorCache* GetGlobal() {
+    // never destroyed, so that it can be used until the process exits
+    static ScalingFactorCache* global = new ScalingFactorCache();
+    return global;
+  }
+
+  std::shared_ptr<const H265ScalingListDataParser::ScalingFactorState> Get(
+      const H265ScalingListDataParser::ScalingListDataState& lists) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entries = table_[lists.lists_hash];
+    for (const auto& entry : entries) {
+      auto scaling_factor = entry.lock();
+      if (scaling_factor != nullptr && HaveSameLists(*scaling_factor, lists)) {
+        return scaling_factor;
+      }
+    }
+    // not std::make_shared(), so that the expired entries do not keep the
+    // arrays allocated
+    std::shared_ptr<H265ScalingListDataParser::ScalingFactorState>
+        scaling_factor(new H265ScalingListDataParser::ScalingFactorState());
+    memcpy(scaling_factor->ScalingList, lists.ScalingList,
+           sizeof(lists.ScalingList));
+    memcpy(scaling_factor->scaling_list_dc_coef_minus8,
+           lists.scaling_list_dc_coef_minus8,
+           sizeof(lists.scaling_list_dc_coef_minus8));
+    scaling_factor->lists_hash = lists.lists_hash;
+    DeriveScalingFactor(scaling_factor.get());
+    entries.push_back(scaling_factor);
+    size_++;
+    MaybePrune();
+    return scaling_factor;
+  }
+
+ private:
+  using Entry =
+      std::weak_ptr<const H265ScalingListDataParser::ScalingFactorState>;
+
+  // Drop the expired entries (once the cache has doubled in size since the
+  // last time). Must be called with the mutex held.
+  void MaybePrune() {
+    if (size_ < kMinPruneSize || size_ < 2 * pruned_size_) {
+      return;
+    }
+    size_ = 0;
+    for (auto it = table_.begin(); it != table_.end();) {
+      auto& entries = it->second;
+      entries.erase(
+          std::remove_if(entries.begin(), entries.end(),
+                         [](const Entry& entry) { return entry.expired(); }),
+          entries.end());
+      size_ += entries.size();
+      if (entries.empty()) {
+        it = table_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    pruned_size_ = size_;
+  }
+
+  std::mutex mutex_;
+  std::unordered_map<uint64_t, std::vector<Entry>> table_;
+  size_t size_ = 0;
+  // cache size after the last prune
+  size_t pruned_size_ = 0;
+};
+}  // namespace
+
 // Unpack RBSP and parse scaling_list_data state from the supplied buffer.
 std::unique_ptr<H265ScalingListDataParser::ScalingListDataState>
 H265ScalingListDataParser::ParseScalingListData(const uint8_t* data,
@@ -33,58 +238,71 @@ H265ScalingListDataParser::ParseScalingListData(const uint8_t* data,
 std::unique_ptr<H265ScalingListDataParser::ScalingListDataState>
 H265ScalingListDataParser::ParseScalingListData(
     rtc::BitBuffer* bit_buffer) noexcept {
+  uint32_t bits_tmp;
+  uint32_t golomb_tmp;
+  int32_t sgolomb_tmp;
+
   // H265 scaling_list_data() NAL Unit.
   // Section 7.3.4 ("Scaling list data syntax") of the H.265
   // standard for a complete description.
   auto scaling_list_data = std::make_unique<ScalingListDataState>();
 
-  // allocate the external vectors
-  for (uint32_t sizeId = 0; sizeId < 4; sizeId++) {
-    scaling_list_data->scaling_list_pred_mode_flag.emplace_back();
-    scaling_list_data->scaling_list_pred_matrix_id_delta.emplace_back();
-    scaling_list_data->scaling_list_dc_coef_minus8.emplace_back();
-    scaling_list_data->ScalingList.emplace_back();
-    for (uint32_t matrixId = 0; matrixId < 6; matrixId += 1) {
-      scaling_list_data->scaling_list_pred_mode_flag[sizeId].emplace_back(0);
-      scaling_list_data->scaling_list_pred_matrix_id_delta[sizeId].emplace_back(
-          0);
-      scaling_list_data->scaling_list_dc_coef_minus8[sizeId].emplace_back(0);
-      scaling_list_data->ScalingList[sizeId].emplace_back();
-    }
-  }
-
-  // calculate the values
   for (uint32_t sizeId = 0; sizeId < 4; sizeId++) {
     for (uint32_t matrixId = 0; matrixId < 6;
          matrixId += (sizeId == 3) ? 3 : 1) {
       // scaling_list_pred_mode_flag[sizeId][matrixId]  u(1)
-      if (!bit_buffer->ReadBits(
-              1, scaling_list_data
-                     ->scaling_list_pred_mode_flag[sizeId][matrixId])) {
+      if (!bit_buffer->ReadBits(1, bits_tmp)) {
         return nullptr;
       }
+      scaling_list_data->scaling_list_pred_mode_flag[sizeId][matrixId] =
+          bits_tmp;
 
       if (!scaling_list_data->scaling_list_pred_mode_flag[sizeId][matrixId]) {
         // scaling_list_pred_matrix_id_delta[sizeId][matrixId]  ue(v)
-        if (!bit_buffer->ReadExponentialGolomb(
-                scaling_list_data
-                    ->scaling_list_pred_matrix_id_delta[sizeId][matrixId])) {
+        if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
           return nullptr;
         }
+        // Section 7.4.5: the value is in the range of 0 to matrixId (or
+        // matrixId / 3 when sizeId is equal to 3)
+        if (golomb_tmp > ((sizeId == 3) ? matrixId / 3 : matrixId)) {
+          return nullptr;
+        }
+        scaling_list_data->scaling_list_pred_matrix_id_delta[sizeId]
+                                                            [matrixId] =
+            golomb_tmp;
+        if (golomb_tmp == 0) {
+          // inferred from the default list
+          SetDefaultList(sizeId, matrixId, scaling_list_data.get());
+        } else {
+          // inferred from a previous list
+          uint32_t refMatrixId =
+              matrixId - golomb_tmp * ((sizeId == 3) ? 3 : 1);
+          memcpy(scaling_list_data->ScalingList[sizeId][matrixId],
+                 scaling_list_data->ScalingList[sizeId][refMatrixId],
+                 GetCoefNum(sizeId));
+          if (sizeId > 1) {
+            scaling_list_data->scaling_list_dc_coef_minus8[sizeId - 2]
+                                                          [matrixId] =
+                scaling_list_data
+                    ->scaling_list_dc_coef_minus8[sizeId - 2][refMatrixId];
+          }
+        }
 
       } else {
         uint32_t nextCoef = 8;
-        uint32_t coefNum = std::min(64, (1 << (4 + (sizeId << 1))));
+        uint32_t coefNum = GetCoefNum(sizeId);
         if (sizeId > 1) {
           // scaling_list_dc_coef_minus8[sizeId - 2][matrixId]  se(v)
-          if (!bit_buffer->ReadSignedExponentialGolomb(
-                  scaling_list_data
-                      ->scaling_list_dc_coef_minus8[sizeId - 2][matrixId])) {
+          if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
             return nullptr;
           }
-          nextCoef = scaling_list_data
-                         ->scaling_list_dc_coef_minus8[sizeId - 2][matrixId] +
-                     8;
+          // Section 7.4.5: the value is in the range of -7 to 247
+          if (sgolomb_tmp < -7 || sgolomb_tmp > 247) {
+            return nullptr;
+          }
+          scaling_list_data
+              ->scaling_list_dc_coef_minus8[sizeId - 2][matrixId] = sgolomb_tmp;
+          nextCoef = sgolomb_tmp + 8;
         }
         for (uint32_t i = 0; i < coefNum; i++) {
           // scaling_list_delta_coef  se(v)
@@ -94,15 +312,56 @@ H265ScalingListDataParser::ParseScalingListData(
             return nullptr;
           }
           nextCoef = (nextCoef + scaling_list_delta_coef + 256) % 256;
-          scaling_list_data->ScalingList[sizeId][matrixId].push_back(nextCoef);
+          scaling_list_data->ScalingList[sizeId][matrixId][i] = nextCoef;
         }
       }
     }
   }
+  scaling_list_data->lists_hash = HashLists(*scaling_list_data);
 
   return scaling_list_data;
 }
 
+std::shared_ptr<const H265ScalingListDataParser::ScalingFactorState>
+H265ScalingListDataParser::GetDefaultScalingFactor() noexcept {
+  static const ScalingListDataState* default_lists = [] {
+    auto* scaling_list_data = new ScalingListDataState();
+    for (uint32_t sizeId = 0; sizeId < 4; sizeId++) {
+      for (uint32_t matrixId = 0; matrixId < 6;
+           matrixId += (sizeId == 3) ? 3 : 1) {
+        SetDefaultList(sizeId, matrixId, scaling_list_data);
+      }
+    }
+    scaling_list_data->lists_hash = HashLists(*scaling_list_data);
+    return scaling_list_data;
+  }();
+  return default_lists->getScalingFactor();
+}
+
+std::shared_ptr<const H265ScalingListDataParser::ScalingFactorState>
+H265ScalingListDataParser::ScalingListDataState::getScalingFactor()
+    const noexcept {
+  std::call_once(scaling_factor_once_, [this]() {
+    scaling_factor_ = ScalingFactorCache::GetGlobal()->Get(*this);
+  });
+  return scaling_factor_;
+}
+
+bool H265ScalingListDataParser::ScalingListDataState::hasSameLists(
+    const ScalingListDataState& other) const noexcept {
+  return HaveSameLists(*this, other);
+}
+
+const uint8_t*
+H265ScalingListDataParser::ScalingFactorState::getScalingFactor(
+    uint32_t sizeId, uint32_t matrixId) const noexcept {
+  if (sizeId > 3 || matrixId > 5) {
+    return nullptr;
+  }
+  uint32_t size = 4 << sizeId;
+  return ScalingFactor + kScalingFactorOffset[sizeId] + matrixId * size * size;
+}
+
 #ifdef FDUMP_DEFINE
 void H265ScalingListDataParser::ScalingListDataState::fdump(
     FILE* outfp, int indent_level) const {
@@ -111,9 +370,9 @@ void H265ScalingListDataParser::ScalingListDataState::fdump(
 
   fdump_indent_level(outfp, indent_level);
   fprintf(outfp, "scaling_list_pred_mode_flag {");
-  for (const std::vector<uint32_t>& vv : scaling_list_pred_mode_flag) {
+  for (const auto& vv : scaling_list_pred_mode_flag) {
     fprintf(outfp, " {");
-    for (const uint32_t& v : vv) {
+    for (const uint8_t& v : vv) {
       fprintf(outfp, " %i", v);
     }
     fprintf(outfp, " }");
@@ -122,9 +381,9 @@ void H265ScalingListDataParser::ScalingListDataState::fdump(
 
   fdump_indent_level(outfp, indent_level);
   fprintf(outfp, "scaling_list_pred_matrix_id_delta {");
-  for (const std::vector<uint32_t>& vv : scaling_list_pred_matrix_id_delta) {
+  for (const auto& vv : scaling_list_pred_matrix_id_delta) {
     fprintf(outfp, " {");
-    for (const uint32_t& v : vv) {
+    for (const uint8_t& v : vv) {
       fprintf(outfp, " %i", v);
     }
     fprintf(outfp, " }");
@@ -133,9 +392,9 @@ void H265ScalingListDataParser::ScalingListDataState::fdump(
 
   fdump_indent_level(outfp, indent_level);
   fprintf(outfp, "scaling_list_dc_coef_minus8 {");
-  for (const std::vector<int32_t>& vv : scaling_list_dc_coef_minus8) {
+  for (const auto& vv : scaling_list_dc_coef_minus8) {
     fprintf(outfp, " {");
-    for (const int32_t& v : vv) {
+    for (const int16_t& v : vv) {
       fprintf(outfp, " %i", v);
     }
     fprintf(outfp, " }");
@@ -144,12 +403,15 @@ void H265ScalingListDataParser::ScalingListDataState::fdump(
 
   fdump_indent_level(outfp, indent_level);
   fprintf(outfp, "ScalingList {");
-  for (const std::vector<std::vector<uint32_t>>& vvv : ScalingList) {
+  for (uint32_t sizeId = 0; sizeId < 4; sizeId++) {
     fprintf(outfp, " {");
-    for (const std::vector<uint32_t>& vv : vvv) {
+    for (uint32_t matrixId = 0; matrixId < 6; matrixId++) {
       fprintf(outfp, " {");
-      for (const uint32_t& v : vv) {
-        fprintf(outfp, " %i", v);
+      // the sizeId 3 chroma lists are not coded
+      if (sizeId < 3 || matrixId % 3 == 0) {
+        for (uint32_t i = 0; i < GetCoefNum(sizeId); i++) {
+          fprintf(outfp, " %i", ScalingList[sizeId][matrixId][i]);
+        }
       }
       fprintf(outfp, " }");
     }
@@ -0,0 +1,182 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_sdp_parser.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+
+namespace h265nal {
+
+// General note: this is based off RFC 7798 ("RTP Payload Format for High
+// Efficiency Video Coding (HEVC)"), Section 7.
+
+namespace {
+// value of a base64 character (or -1)
+int Base64Value(char c) {
+  if (c >= 'A' && c <= 'Z') {
+    return c - 'A';
+  } else if (c >= 'a' && c <= 'z') {
+    return c - 'a' + 26;
+  } else if (c >= '0' && c <= '9') {
+    return c - '0' + 52;
+  } else if (c == '+') {
+    return 62;
+  } else if (c == '/') {
+    return 63;
+  }
+  return -1;
+}
+
+std::string Trim(const std::string& value) {
+  const char* kWhitespace = " \t\r\n";
+  size_t begin = value.find_first_not_of(kWhitespace);
+  if (begin == std::string::npos) {
+    return "";
+  }
+  size_t end = value.find_last_not_of(kWhitespace);
+  return value.substr(begin, end - begin + 1);
+}
+
+// the sprop parameters, in the order they are loaded
+const char* kSpropNames[] = {"sprop-vps", "sprop-sps", "sprop-pps"};
+const uint32_t kSpropNalUnitTypes[] = {NalUnitType::VPS_NUT,
+                                       NalUnitType::SPS_NUT,
+                                       NalUnitType::PPS_NUT};
+}  // namespace
+
+bool H265SdpParser::DecodeBase64(const std::string& value,
+                                 std::vector<uint8_t>* data) noexcept {
+  data->clear();
+  data->reserve(value.size() * 3 / 4);
+  uint32_t bits = 0;
+  int num_bits = 0;
+  size_t num_padding = 0;
+  for (char c : value) {
+    if (c == '=') {
+      num_padding++;
+      continue;
+    }
+    int v = Base64Value(c);
+    if (v < 0 || num_padding > 0) {
+      // invalid character, or data after the padding
+      return false;
+    }
+    bits = (bits << 6) | v;
+    num_bits += 6;
+    if (num_bits >= 8) {
+      num_bits -= 8;
+      data->push_back(static_cast<uint8_t>(bits >> num_bits));
+    }
+  }
+  // the leftover bits must be zero padding (a single leftover character
+  // is never valid)
+  return num_padding <= 2 && num_bits < 6 &&
+         (bits & ((1u << num_bits) - 1)) == 0;
+}
+
+bool H265SdpParser::DecodeSpropParameterSets(
+    const std::string& value,
+    std::vector<std::vector<uint8_t>>* nal_units) noexcept {
+  nal_units->clear();
+  size_t begin = 0;
+  while (begin <= value.size()) {
+    size_t end = value.find(',', begin);
+    if (end == std::string::npos) {
+      end = value.size();
+    }
+    std::vector<uint8_t> nal_unit;
+    if (!DecodeBase64(Trim(value.substr(begin, end - begin)), &nal_unit) ||
+        nal_unit.size() < 2) {
+      return false;
+    }
+    nal_units->push_back(std::move(nal_unit));
+    begin = end + 1;
+  }
+  return true;
+}
+
+int H265SdpParser::ParseFmtp(
+    const std::string& fmtp,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    ParsingOptions parsing_options) noexcept {
+  // skip the "a=fmtp:<pt> " prefix
+  std::string parameters = Trim(fmtp);
+  if (parameters.compare(0, 7, "a=fmtp:") == 0) {
+    size_t space = parameters.find(' ');
+    parameters = (space == std::string::npos) ? "" : parameters.substr(space);
+  }
+
+  // get the sprop values
+  std::string sprop_values[3];
+  size_t begin = 0;
+  while (begin < parameters.size()) {
+    size_t end = parameters.find(';', begin);
+    if (end == std::string::npos) {
+      end = parameters.size();
+    }
+    std::string parameter = parameters.substr(begin, end - begin);
+    size_t equal = parameter.find('=');
+    if (equal != std::string::npos) {
+      std::string name = Trim(parameter.substr(0, equal));
+      for (size_t i = 0; i < 3; i++) {
+        if (name == kSpropNames[i]) {
+          sprop_values[i] = Trim(parameter.substr(equal + 1));
+        }
+      }
+    }
+    begin = end + 1;
+  }
+
+  // parse the parameter sets into a scratch state, so that a bad sprop
+  // value has no effect
+  H265BitstreamParserState parsed;
+  parsed.vps = bitstream_parser_state->vps;
+  parsed.sps = bitstream_parser_state->sps;
+  parsed.pps = bitstream_parser_state->pps;
+  parsed.error_reporter = bitstream_parser_state->error_reporter;
+  parsed.parameter_set_interner =
+      bitstream_parser_state->parameter_set_interner;
+  int num_parameter_sets = 0;
+  for (size_t i = 0; i < 3; i++) {
+    if (sprop_values[i].empty()) {
+      continue;
+    }
+    std::vector<std::vector<uint8_t>> nal_units;
+    if (!DecodeSpropParameterSets(sprop_values[i], &nal_units)) {
+      return -1;
+    }
+    for (const auto& nal_unit : nal_units) {
+      // check the NAL unit type (nal_unit_type is u(6) after the
+      // forbidden_zero_bit) before parsing it
+      if (((nal_unit[0] >> 1) & 0x3f) != kSpropNalUnitTypes[i]) {
+        return -1;
+      }
+      auto nal_unit_state = H265NalUnitParser::ParseNalUnit(
+          nal_unit.data(), nal_unit.size(), &parsed, parsing_options);
+      if (nal_unit_state == nullptr ||
+          nal_unit_state->nal_unit_payload == nullptr) {
+        return -1;
+      }
+      const auto& payload = nal_unit_state->nal_unit_payload;
+      if (payload->vps == nullptr && payload->sps == nullptr &&
+          payload->pps == nullptr) {
+        return -1;
+      }
+      num_parameter_sets++;
+    }
+  }
+
+  bitstream_parser_state->vps.swap(parsed.vps);
+  bitstream_parser_state->sps.swap(parsed.sps);
+  bitstream_parser_state->pps.swap(parsed.pps);
+  return num_parameter_sets;
+}
+
+}  // namespace h265nal
@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_error_reporter.h"
 
 namespace h265nal {
 
@@ -19,66 +20,370 @@ namespace h265nal {
 // You can find it on this page:
 // http://www.itu.int/rec/T-REC-H.265
 
-// Unpack RBSP and parse SEI state from the supplied buffer.
-std::unique_ptr<H265SeiMessageParser::SeiMessageState>
-H265SeiMessageParser::ParseSei(const uint8_t* data, size_t length) noexcept {
-  std::vector<uint8_t> unpacked_buffer = UnescapeRbsp(data, length);
-  rtc::BitBuffer bit_buffer(unpacked_buffer.data(), unpacked_buffer.size());
-  return ParseSei(&bit_buffer);
+namespace {
+// Read (or skip, when keeping a view) the payload bytes of an SEI message.
+bool ReadPayloadBytes(rtc::BitBuffer* bit_buffer, uint32_t payload_size,
+                      bool payload_as_view, H265SeiPayloadView* payload_view,
+                      std::vector<uint8_t>* payload) {
+  size_t byte_offset = 0;
+  size_t bit_offset = 0;
+  bit_buffer->GetCurrentOffset(&byte_offset, &bit_offset);
+  payload_view->offset = byte_offset;
+  payload_view->length = payload_size;
+
+  if (payload_as_view) {
+    // skip the payload bytes altogether
+    return bit_buffer->ConsumeBytes(payload_size);
+  }
+
+  payload->resize(payload_size);
+  for (size_t i = 0; i < payload->size(); ++i) {
+    if (!bit_buffer->ReadUInt8((*payload)[i])) {
+      return false;
+    }
+  }
+  return true;
 }
 
-std::unique_ptr<H265SeiMessageParser::SeiMessageState>
-H265SeiMessageParser::ParseSei(rtc::BitBuffer* bit_buffer) noexcept {
-  // H265 SEI NAL Unit (access_unit_delimiter_rbsp()) parser.
-  // Section 7.3.5 ("Supplemental enhancement information message syntax") of
-  // the H.265 standard for a complete description.
+// Whether `count` syntax elements of (at least) `min_bits` bits each fit in
+// the rest of the buffer. Used to bound the loop counts read from the
+// bitstream before allocating anything.
+bool FitsInBuffer(rtc::BitBuffer* bit_buffer, uint64_t count,
+                  uint64_t min_bits) {
+  return count * min_bits <= bit_buffer->RemainingBitCount();
+}
 
-  uint32_t payload_type = 0;
-  uint32_t payload_size = 0;
+// Read the number of VPSs (or SPSs) in an MCTS extraction information set
+// (num_*_in_info_set_minus1[i]), and the length of each of their RBSPs
+// (*_rbsp_data_length[i][j]).
+bool ReadRbspDataLengths(rtc::BitBuffer* bit_buffer, const char* name,
+                         std::vector<uint32_t>* num_minus1,
+                         std::vector<std::vector<uint32_t>>* lengths) {
+  uint32_t golomb_tmp;
+  if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
+    return false;
+  }
+  if (!FitsInBuffer(bit_buffer, golomb_tmp + 1ull, 1)) {
+    ReportParseError(ParseErrorCode::kOutOfRange, name, golomb_tmp,
+                     bit_buffer);
+    return false;
+  }
+  num_minus1->push_back(golomb_tmp);
+  lengths->emplace_back();
+  for (uint32_t j = 0; j <= num_minus1->back(); j++) {
+    if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
+      return false;
+    }
+    lengths->back().push_back(golomb_tmp);
+  }
+  return true;
+}
+
+// Read the RBSP bytes of the parameter sets in an MCTS extraction
+// information set.
+bool ReadRbspData(rtc::BitBuffer* bit_buffer,
+                  const std::vector<uint32_t>& lengths,
+                  std::vector<std::vector<uint8_t>>* rbsp_data) {
+  for (const uint32_t& length : lengths) {
+    if (!FitsInBuffer(bit_buffer, length, 8)) {
+      return false;
+    }
+    rbsp_data->emplace_back(length);
+    for (uint32_t k = 0; k < length; k++) {
+      if (!bit_buffer->ReadUInt8(rbsp_data->back()[k])) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Read the payloadType and payloadSize of an sei_message().
+bool ReadSeiMessageHeader(rtc::BitBuffer* bit_buffer, uint32_t* payload_type,
+                          uint32_t* payload_size) {
   uint32_t ff_byte = 0xff;
-  auto sei_message_state = std::make_unique<SeiMessageState>();
 
   // ff_byte/last_payload_type_byte  f(8)
-  ff_byte = 0xff;
+  *payload_type = 0;
   while (ff_byte == 0xff) {
     if (!bit_buffer->ReadBits(8, ff_byte)) {
-      return nullptr;
+      return false;
     }
-    payload_type += ff_byte;
+    *payload_type += ff_byte;
   }
-  sei_message_state->payload_type = static_cast<SeiType>(payload_type);
 
   // ff_byte/last_payload_size_byte  f(8)
   ff_byte = 0xff;
+  *payload_size = 0;
   while (ff_byte == 0xff) {
     if (!bit_buffer->ReadBits(8, ff_byte)) {
-      return nullptr;
+      return false;
     }
-    payload_size += ff_byte;
+    *payload_size += ff_byte;
+  }
+  return true;
+}
+
+// Check whether an SEI message (whose header has just been read) is
+// selected by the filter. Does not move the bit buffer position.
+bool IsSeiMessageSelected(rtc::BitBuffer* bit_buffer, uint32_t payload_type,
+                          uint32_t payload_size,
+                          const H265SeiMessageFilter* filter) {
+  if (filter->MatchesPayloadType(payload_type)) {
+    return true;
+  }
+  if (payload_type != static_cast<uint32_t>(SeiType::user_data_unregistered) ||
+      !filter->HasUuids() || payload_size < 16) {
+    return false;
+  }
+  // peek the uuid_iso_iec_11578 u(128)
+  uint64_t uuid_iso_iec_11578_1 = 0;
+  uint64_t uuid_iso_iec_11578_2 = 0;
+  size_t byte_offset = 0;
+  size_t bit_offset = 0;
+  bit_buffer->GetCurrentOffset(&byte_offset, &bit_offset);
+  if (!bit_buffer->ReadBits(64, uuid_iso_iec_11578_1) ||
+      !bit_buffer->ReadBits(64, uuid_iso_iec_11578_2)) {
+    bit_buffer->Seek(byte_offset, bit_offset);
+    return false;
+  }
+  bit_buffer->Seek(byte_offset, bit_offset);
+  return filter->MatchesUuid(uuid_iso_iec_11578_1, uuid_iso_iec_11578_2);
+}
+
+// Get the HRD parameters of an SPS (nullptr if not present).
+const H265HrdParametersParser::HrdParametersState* GetSpsHrdParameters(
+    const H265SpsParser::SpsState* sps) {
+  if (sps == nullptr || !sps->vui_parameters_present_flag ||
+      sps->vui_parameters == nullptr ||
+      !sps->vui_parameters->vui_hrd_parameters_present_flag) {
+    return nullptr;
+  }
+  return sps->vui_parameters->hrd_parameters.get();
+}
+
+// Section D.2.1: check whether the sei_payload() has extension data
+// (payload_extension_present()) after the current position, i.e.,
+// whether there is more data before the payload_bit_equal_to_one and
+// payload_bit_equal_to_zero bits that end the payload.
+bool PayloadExtensionPresent(rtc::BitBuffer* bit_buffer,
+                             size_t payload_end_byte_offset) {
+  size_t byte_offset = 0;
+  size_t bit_offset = 0;
+  bit_buffer->GetCurrentOffset(&byte_offset, &bit_offset);
+  if (byte_offset >= payload_end_byte_offset) {
+    return false;
+  }
+  uint64_t remaining_bits =
+      (payload_end_byte_offset - byte_offset) * 8 - bit_offset;
+  if (remaining_bits > 8) {
+    return true;
+  }
+  uint32_t bits_tmp = 0;
+  if (!bit_buffer->PeekBits(remaining_bits, bits_tmp)) {
+    return false;
+  }
+  return bits_tmp != (1u << (remaining_bits - 1));
+}
+}  // namespace
+
+bool H265SeiPayloadView::Materialize(const uint8_t* data, size_t data_length,
+                                     std::vector<uint8_t>* out) const noexcept {
+  return UnescapeRbspRange(data, data_length, offset, length, out);
+}
+
+// Unpack RBSP and parse SEI state from the supplied buffer.
+std::unique_ptr<H265SeiMessageParser::SeiMessageState>
+H265SeiMessageParser::ParseSei(
+    const uint8_t* data, size_t length,
+    H265BitstreamParserState* bitstream_parser_state,
+    ParsingOptions parsing_options) noexcept {
+  std::vector<uint8_t> unpacked_buffer = UnescapeRbsp(data, length);
+  rtc::BitBuffer bit_buffer(unpacked_buffer.data(), unpacked_buffer.size());
+  return ParseSei(&bit_buffer, bitstream_parser_state, parsing_options);
+}
+
+std::unique_ptr<H265SeiMessageParser::SeiMessageState>
+H265SeiMessageParser::ParseSei(
+    rtc::BitBuffer* bit_buffer,
+    H265BitstreamParserState* bitstream_parser_state,
+    ParsingOptions parsing_options) noexcept {
+  // H265 SEI message (sei_message()) parser.
+  // Section 7.3.5 ("Supplemental enhancement information message syntax") of
+  // the H.265 standard for a complete description.
+  uint32_t payload_type = 0;
+  uint32_t payload_size = 0;
+  if (!ReadSeiMessageHeader(bit_buffer, &payload_type, &payload_size)) {
+    return nullptr;
   }
+  auto sei_message_state = std::make_unique<SeiMessageState>();
+  sei_message_state->payload_type = static_cast<SeiType>(payload_type);
   sei_message_state->payload_size = payload_size;
 
+  // sei_payload(payloadType, payloadSize)
+  sei_message_state->payload_state =
+      ParseSeiPayload(bit_buffer, payload_type, payload_size,
+                      bitstream_parser_state, parsing_options);
+  return sei_message_state;
+}
+
+std::unique_ptr<H265SeiPayloadParser::H265SeiPayloadState>
+H265SeiMessageParser::ParseSeiPayload(
+    rtc::BitBuffer* bit_buffer, uint32_t payload_type, uint32_t payload_size,
+    H265BitstreamParserState* bitstream_parser_state,
+    const struct H265SpsParser::SpsState* sps,
+    ParsingOptions parsing_options) noexcept {
   // Section D.2.1: General SEI message syntax
-  // TODO(chema): move dispatcher to a separate function
   // TODO(chema): enforce nal_unit_type check
-  // sei_payload(payloadType, payloadSize)
+  const bool payload_as_view = parsing_options.sei_payload_as_view;
   std::unique_ptr<H265SeiPayloadParser> payload_parser = nullptr;
   switch (static_cast<SeiType>(payload_type)) {
+    case SeiType::buffering_period:
+      if (bitstream_parser_state == nullptr) {
+        payload_parser =
+            std::make_unique<H265SeiUnknownParser>(payload_as_view);
+        break;
+      }
+      payload_parser = std::make_unique<H265SeiBufferingPeriodParser>(
+          bitstream_parser_state);
+      break;
+    case SeiType::pic_timing:
+      if (bitstream_parser_state == nullptr) {
+        payload_parser =
+            std::make_unique<H265SeiUnknownParser>(payload_as_view);
+        break;
+      }
+      if (sps == nullptr) {
+        sps = bitstream_parser_state->active_sps.get();
+      }
+      if (sps == nullptr) {
+        payload_parser =
+            std::make_unique<H265SeiUnknownParser>(payload_as_view);
+        break;
+      }
+      payload_parser = std::make_unique<H265SeiPicTimingParser>(sps);
+      break;
     case SeiType::user_data_registered_itu_t_t35:
-      payload_parser =
-          std::make_unique<H265SeiUserDataRegisteredItuTT35Parser>();
+      payload_parser = std::make_unique<H265SeiUserDataRegisteredItuTT35Parser>(
+          payload_as_view);
       break;
     case SeiType::user_data_unregistered:
-      payload_parser = std::make_unique<H265SeiUserDataUnregisteredParser>();
+      payload_parser =
+          std::make_unique<H265SeiUserDataUnregisteredParser>(payload_as_view);
+      break;
+    case SeiType::time_code:
+      payload_parser = std::make_unique<H265SeiTimeCodeParser>();
+      break;
+    case SeiType::mastering_display_colour_volume:
+      payload_parser =
+          std::make_unique<H265SeiMasteringDisplayColourVolumeParser>();
+      break;
+    case SeiType::content_light_level_info:
+      payload_parser = std::make_unique<H265SeiContentLightLevelInfoParser>();
+      break;
+    case SeiType::temporal_motion_constrained_tile_sets:
+      payload_parser =
+          std::make_unique<H265SeiTemporalMotionConstrainedTileSetsParser>();
+      break;
+    case SeiType::mcts_extraction_info_sets:
+      payload_parser = std::make_unique<H265SeiMctsExtractionInfoSetsParser>();
       break;
     default:
-      payload_parser = std::make_unique<H265SeiUnknownParser>();
+      payload_parser = std::make_unique<H265SeiUnknownParser>(payload_as_view);
       break;
   }
 
-  sei_message_state->payload_state =
-      payload_parser->parse_payload(bit_buffer, payload_size);
-  return sei_message_state;
+  return payload_parser->parse_payload(bit_buffer, payload_size);
+}
+
+// Unpack RBSP and parse SEI RBSP state from the supplied buffer.
+std::unique_ptr<H265SeiRbspParser::SeiRbspState>
+H265SeiRbspParser::ParseSeiRbsp(
+    const uint8_t* data, size_t length,
+    H265BitstreamParserState* bitstream_parser_state,
+    ParsingOptions parsing_options,
+    const H265SeiMessageFilter* filter) noexcept {
+  std::vector<uint8_t> unpacked_buffer = UnescapeRbsp(data, length);
+  rtc::BitBuffer bit_buffer(unpacked_buffer.data(), unpacked_buffer.size());
+  return ParseSeiRbsp(&bit_buffer, bitstream_parser_state, parsing_options,
+                      filter);
+}
+
+std::unique_ptr<H265SeiRbspParser::SeiRbspState>
+H265SeiRbspParser::ParseSeiRbsp(
+    rtc::BitBuffer* bit_buffer,
+    H265BitstreamParserState* bitstream_parser_state,
+    ParsingOptions parsing_options,
+    const H265SeiMessageFilter* filter) noexcept {
+  // H265 SEI RBSP (sei_rbsp()) parser.
+  // Section 7.3.2.4 ("Supplemental enhancement information RBSP syntax") of
+  // the H.265 standard for a complete description.
+  auto sei_rbsp = std::make_unique<SeiRbspState>();
+
+  // Section D.3.2: the buffering period SEI message refers to the SPS that
+  // is active for its associated picture. The pic_timing messages that
+  // follow it use that SPS, without activating it.
+  std::shared_ptr<struct H265SpsParser::SpsState> buffering_period_sps;
+
+  // a message that overruns the buffer ends the loop, but the messages
+  // before it (and its own header) are kept
+  do {
+    // sei_message()
+    uint32_t payload_type = 0;
+    uint32_t payload_size = 0;
+    if (!ReadSeiMessageHeader(bit_buffer, &payload_type, &payload_size)) {
+      if (sei_rbsp->sei_message.empty() &&
+          sei_rbsp->num_skipped_sei_messages == 0) {
+        return nullptr;
+      }
+      return sei_rbsp;
+    }
+    size_t payload_byte_offset = 0;
+    size_t payload_bit_offset = 0;
+    bit_buffer->GetCurrentOffset(&payload_byte_offset, &payload_bit_offset);
+
+    if (filter != nullptr &&
+        !IsSeiMessageSelected(bit_buffer, payload_type, payload_size,
+                              filter)) {
+      // skip the full payload using its size
+      if (!bit_buffer->ConsumeBytes(payload_size)) {
+        return sei_rbsp;
+      }
+      sei_rbsp->num_skipped_sei_messages++;
+      continue;
+    }
+
+    auto sei_message_state =
+        std::make_shared<H265SeiMessageParser::SeiMessageState>();
+    sei_message_state->payload_type = static_cast<SeiType>(payload_type);
+    sei_message_state->payload_size = payload_size;
+    // sei_payload(payloadType, payloadSize)
+    sei_message_state->payload_state = H265SeiMessageParser::ParseSeiPayload(
+        bit_buffer, payload_type, payload_size, bitstream_parser_state,
+        buffering_period_sps.get(), parsing_options);
+    if (sei_message_state->payload_state != nullptr &&
+        sei_message_state->payload_type == SeiType::buffering_period &&
+        bitstream_parser_state != nullptr) {
+      auto buffering_period = static_cast<
+          H265SeiBufferingPeriodParser::H265SeiBufferingPeriodState*>(
+          sei_message_state->payload_state.get());
+      buffering_period_sps = bitstream_parser_state->GetSps(
+          buffering_period->bp_seq_parameter_set_id);
+    }
+    sei_rbsp->sei_message.push_back(std::move(sei_message_state));
+
+    // make sure the next message starts right after this payload,
+    // independently of how much of it the payload parser read
+    if (!bit_buffer->Seek(payload_byte_offset + payload_size,
+                          payload_bit_offset)) {
+      return sei_rbsp;
+    }
+  } while (more_rbsp_data(bit_buffer));
+
+  // rbsp_trailing_bits()
+  rbsp_trailing_bits(bit_buffer);
+
+  return sei_rbsp;
 }
 
 std::unique_ptr<H265SeiPayloadParser::H265SeiPayloadState>
@@ -113,12 +418,11 @@ H265SeiUserDataRegisteredItuTT35Parser::parse_payload(
     remaining_payload_size--;
   }
 
-  payload_state->payload.resize(remaining_payload_size);
-  for (size_t i = 0; i < payload_state->payload.size(); ++i) {
-    // itu_t_t35_payload_byte  b(8)
-    if (!bit_buffer->ReadUInt8(payload_state->payload[i])) {
-      return nullptr;
-    }
+  // itu_t_t35_payload_byte  b(8)
+  if (!ReadPayloadBytes(bit_buffer, remaining_payload_size, payload_as_view_,
+                        &payload_state->payload_view,
+                        &payload_state->payload)) {
+    return nullptr;
   }
   return payload_state;
 }
@@ -160,107 +464,1422 @@ H265SeiUserDataUnregisteredParser::parse_payload(rtc::BitBuffer* bit_buffer,
 
   remaining_payload_size -= 16;
 
-  payload_state->payload.resize(remaining_payload_size);
-  for (size_t i = 0; i < payload_state->payload.size(); ++i) {
-    // user_data_payload_byte  b(8)
-    if (!bit_buffer->ReadUInt8(payload_state->payload[i])) {
-      return nullptr;
-    }
+  // user_data_payload_byte  b(8)
+  if (!ReadPayloadBytes(bit_buffer, remaining_payload_size, payload_as_view_,
+                        &payload_state->payload_view,
+                        &payload_state->payload)) {
+    return nullptr;
   }
   return payload_state;
 }
 
 std::unique_ptr<H265SeiPayloadParser::H265SeiPayloadState>
-H265SeiUnknownParser::parse_payload(rtc::BitBuffer* bit_buffer,
-                                    uint32_t payload_size) {
-  // We have no specific details for this sei, just keep all the bytes
-  // in a payload buffer.
-  uint32_t remaining_payload_size = payload_size;
-  if (remaining_payload_size == 0) {
+H265SeiBufferingPeriodParser::parse_payload(rtc::BitBuffer* bit_buffer,
+                                            uint32_t payload_size) {
+  // H265 SEI buffering period (buffering_period()) parser.
+  // Section D.2.2 ("Buffering period SEI message syntax") of the H.265
+  // standard for a complete description.
+  uint32_t bits_tmp;
+
+  size_t payload_byte_offset = 0;
+  size_t payload_bit_offset = 0;
+  bit_buffer->GetCurrentOffset(&payload_byte_offset, &payload_bit_offset);
+
+  auto payload_state = std::make_unique<H265SeiBufferingPeriodState>();
+
+  // bp_seq_parameter_set_id  ue(v)
+  if (!bit_buffer->ReadExponentialGolomb(
+          payload_state->bp_seq_parameter_set_id)) {
     return nullptr;
   }
-  auto payload_state = std::make_unique<H265SeiUnknownState>();
-  payload_state->payload.resize(remaining_payload_size);
-  for (size_t i = 0; i < payload_state->payload.size(); ++i) {
-    if (!bit_buffer->ReadUInt8(payload_state->payload[i])) {
+
+  // the syntax depends on the HRD parameters of the referred SPS
+  auto sps =
+      bitstream_parser_state_->GetSps(payload_state->bp_seq_parameter_set_id);
+  const auto* hrd_parameters = GetSpsHrdParameters(sps.get());
+  if (hrd_parameters == nullptr) {
+    ReportParseError(ParseErrorCode::kMissingParameterSet,
+                     "bp_seq_parameter_set_id",
+                     payload_state->bp_seq_parameter_set_id, bit_buffer);
+    return nullptr;
+  }
+  uint32_t HighestTid = sps->sps_max_sub_layers_minus1;
+  if (HighestTid >= hrd_parameters->cpb_cnt_minus1.size()) {
+    return nullptr;
+  }
+  uint32_t CpbCnt = hrd_parameters->cpb_cnt_minus1[HighestTid] + 1;
+  uint32_t au_cpb_removal_delay_length =
+      hrd_parameters->au_cpb_removal_delay_length_minus1 + 1;
+  uint32_t dpb_output_delay_length =
+      hrd_parameters->dpb_output_delay_length_minus1 + 1;
+  uint32_t initial_cpb_removal_delay_length =
+      hrd_parameters->initial_cpb_removal_delay_length_minus1 + 1;
+
+  if (!hrd_parameters->sub_pic_hrd_params_present_flag) {
+    // irap_cpb_params_present_flag  u(1)
+    if (!bit_buffer->ReadBits(1,
+                              payload_state->irap_cpb_params_present_flag)) {
+      return nullptr;
+    }
+  }
+
+  if (payload_state->irap_cpb_params_present_flag) {
+    // cpb_delay_offset  u(v)
+    if (!bit_buffer->ReadBits(au_cpb_removal_delay_length,
+                              payload_state->cpb_delay_offset)) {
+      return nullptr;
+    }
+
+    // dpb_delay_offset  u(v)
+    if (!bit_buffer->ReadBits(dpb_output_delay_length,
+                              payload_state->dpb_delay_offset)) {
+      return nullptr;
+    }
+  }
+
+  // concatenation_flag  u(1)
+  if (!bit_buffer->ReadBits(1, payload_state->concatenation_flag)) {
+    return nullptr;
+  }
+
+  // au_cpb_removal_delay_delta_minus1  u(v)
+  if (!bit_buffer->ReadBits(au_cpb_removal_delay_length,
+                            payload_state->au_cpb_removal_delay_delta_minus1)) {
+    return nullptr;
+  }
+
+  bool alt_cpb_params_present =
+      hrd_parameters->sub_pic_hrd_params_present_flag ||
+      payload_state->irap_cpb_params_present_flag;
+
+  // NalHrdBpPresentFlag and VclHrdBpPresentFlag (Section E.3.2)
+  for (uint32_t vcl = 0; vcl < 2; vcl++) {
+    if (!(vcl ? hrd_parameters->vcl_hrd_parameters_present_flag
+              : hrd_parameters->nal_hrd_parameters_present_flag)) {
+      continue;
+    }
+    auto& initial_cpb_removal_delay =
+        vcl ? payload_state->vcl_initial_cpb_removal_delay
+            : payload_state->nal_initial_cpb_removal_delay;
+    auto& initial_cpb_removal_offset =
+        vcl ? payload_state->vcl_initial_cpb_removal_offset
+            : payload_state->nal_initial_cpb_removal_offset;
+    auto& initial_alt_cpb_removal_delay =
+        vcl ? payload_state->vcl_initial_alt_cpb_removal_delay
+            : payload_state->nal_initial_alt_cpb_removal_delay;
+    auto& initial_alt_cpb_removal_offset =
+        vcl ? payload_state->vcl_initial_alt_cpb_removal_offset
+            : payload_state->nal_initial_alt_cpb_removal_offset;
+    for (uint32_t i = 0; i < CpbCnt; i++) {
+      // {nal,vcl}_initial_cpb_removal_delay[i]  u(v)
+      if (!bit_buffer->ReadBits(initial_cpb_removal_delay_length, bits_tmp)) {
+        return nullptr;
+      }
+      initial_cpb_removal_delay.push_back(bits_tmp);
+
+      // {nal,vcl}_initial_cpb_removal_offset[i]  u(v)
+      if (!bit_buffer->ReadBits(initial_cpb_removal_delay_length, bits_tmp)) {
+        return nullptr;
+      }
+      initial_cpb_removal_offset.push_back(bits_tmp);
+
+      if (alt_cpb_params_present) {
+        // {nal,vcl}_initial_alt_cpb_removal_delay[i]  u(v)
+        if (!bit_buffer->ReadBits(initial_cpb_removal_delay_length,
+                                  bits_tmp)) {
+          return nullptr;
+        }
+        initial_alt_cpb_removal_delay.push_back(bits_tmp);
+
+        // {nal,vcl}_initial_alt_cpb_removal_offset[i]  u(v)
+        if (!bit_buffer->ReadBits(initial_cpb_removal_delay_length,
+                                  bits_tmp)) {
+          return nullptr;
+        }
+        initial_alt_cpb_removal_offset.push_back(bits_tmp);
+      }
+    }
+  }
+
+  if (PayloadExtensionPresent(bit_buffer,
+                              payload_byte_offset + payload_size)) {
+    // use_alt_cpb_params_flag  u(1)
+    if (!bit_buffer->ReadBits(1, payload_state->use_alt_cpb_params_flag)) {
       return nullptr;
     }
   }
+
   return payload_state;
 }
 
-#ifdef FDUMP_DEFINE
+std::unique_ptr<H265SeiPayloadParser::H265SeiPayloadState>
+H265SeiPicTimingParser::parse_payload(rtc::BitBuffer* bit_buffer,
+                                      uint32_t payload_size) {
+  // H265 SEI picture timing (pic_timing()) parser.
+  // Section D.2.3 ("Picture timing SEI message syntax") of the H.265
+  // standard for a complete description.
+  uint32_t bits_tmp;
+  uint32_t golomb_tmp;
 
-void H265SeiMessageParser::SeiMessageState::fdump(FILE* outfp,
-                                                  int indent_level) const {
-  fprintf(outfp, "sei message {");
-  indent_level = indent_level_incr(indent_level);
+  auto payload_state = std::make_unique<H265SeiPicTimingState>();
 
-  fdump_indent_level(outfp, indent_level);
-  fprintf(outfp, "payload_type: %i", payload_type);
+  if (sps_->vui_parameters_present_flag && sps_->vui_parameters != nullptr &&
+      sps_->vui_parameters->frame_field_info_present_flag) {
+    // pic_struct  u(4)
+    if (!bit_buffer->ReadBits(4, payload_state->pic_struct)) {
+      return nullptr;
+    }
 
-  fdump_indent_level(outfp, indent_level);
-  fprintf(outfp, "payload_size: %u", payload_size);
+    // source_scan_type  u(2)
+    if (!bit_buffer->ReadBits(2, payload_state->source_scan_type)) {
+      return nullptr;
+    }
 
-  fdump_indent_level(outfp, indent_level);
-  payload_state->fdump(outfp, indent_level);
+    // duplicate_flag  u(1)
+    if (!bit_buffer->ReadBits(1, payload_state->duplicate_flag)) {
+      return nullptr;
+    }
+  }
 
-  indent_level = indent_level_decr(indent_level);
-  fdump_indent_level(outfp, indent_level);
-  fprintf(outfp, "}");
-}
+  // CpbDpbDelaysPresentFlag (Section E.3.2)
+  const auto* hrd_parameters = GetSpsHrdParameters(sps_);
+  if (hrd_parameters == nullptr ||
+      (!hrd_parameters->nal_hrd_parameters_present_flag &&
+       !hrd_parameters->vcl_hrd_parameters_present_flag)) {
+    return payload_state;
+  }
 
-void H265SeiUserDataRegisteredItuTT35Parser::
-    H265SeiUserDataRegisteredItuTT35State::fdump(FILE* outfp,
-                                                 int indent_level) const {
-  fprintf(outfp, "user_data_registered_itu_t_t35 {");
-  indent_level = indent_level_incr(indent_level);
+  // au_cpb_removal_delay_minus1  u(v)
+  if (!bit_buffer->ReadBits(
+          hrd_parameters->au_cpb_removal_delay_length_minus1 + 1,
+          payload_state->au_cpb_removal_delay_minus1)) {
+    return nullptr;
+  }
 
-  fdump_indent_level(outfp, indent_level);
-  fprintf(outfp, "itu_t_t35_country_code: %i", itu_t_t35_country_code);
+  // pic_dpb_output_delay  u(v)
+  if (!bit_buffer->ReadBits(hrd_parameters->dpb_output_delay_length_minus1 + 1,
+                            payload_state->pic_dpb_output_delay)) {
+    return nullptr;
+  }
 
-  fdump_indent_level(outfp, indent_level);
-  fprintf(outfp, "itu_t_t35_country_code_extension_byte: %i",
-          itu_t_t35_country_code_extension_byte);
+  if (hrd_parameters->sub_pic_hrd_params_present_flag) {
+    // pic_dpb_output_du_delay  u(v)
+    if (!bit_buffer->ReadBits(
+            hrd_parameters->dpb_output_delay_du_length_minus1 + 1,
+            payload_state->pic_dpb_output_du_delay)) {
+      return nullptr;
+    }
+  }
 
-  fdump_indent_level(outfp, indent_level);
-  fprintf(outfp, "payload_size: %zu", payload.size());
+  if (hrd_parameters->sub_pic_hrd_params_present_flag &&
+      hrd_parameters->sub_pic_cpb_params_in_pic_timing_sei_flag) {
+    uint32_t du_cpb_removal_delay_increment_length =
+        hrd_parameters->du_cpb_removal_delay_increment_length_minus1 + 1;
 
-  fdump_indent_level(outfp, indent_level);
-  fprintf(outfp, "payload {");
-  for (const uint8_t& v : payload) {
-    fprintf(outfp, " %u", v);
+    // num_decoding_units_minus1  ue(v)
+    if (!bit_buffer->ReadExponentialGolomb(
+            payload_state->num_decoding_units_minus1)) {
+      return nullptr;
+    }
+    // a decoding unit has at least one NAL unit, so there cannot be more
+    // decoding units than bits in the payload
+    if (payload_state->num_decoding_units_minus1 >= payload_size * 8) {
+      return nullptr;
+    }
+
+    // du_common_cpb_removal_delay_flag  u(1)
+    if (!bit_buffer->ReadBits(
+            1, payload_state->du_common_cpb_removal_delay_flag)) {
+      return nullptr;
+    }
+
+    if (payload_state->du_common_cpb_removal_delay_flag) {
+      // du_common_cpb_removal_delay_increment_minus1  u(v)
+      if (!bit_buffer->ReadBits(
+              du_cpb_removal_delay_increment_length,
+              payload_state->du_common_cpb_removal_delay_increment_minus1)) {
+        return nullptr;
+      }
+    }
+
+    for (uint32_t i = 0; i <= payload_state->num_decoding_units_minus1; i++) {
+      // num_nalus_in_du_minus1[i]  ue(v)
+      if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
+        return nullptr;
+      }
+      payload_state->num_nalus_in_du_minus1.push_back(golomb_tmp);
+
+      if (!payload_state->du_common_cpb_removal_delay_flag &&
+          i < payload_state->num_decoding_units_minus1) {
+        // du_cpb_removal_delay_increment_minus1[i]  u(v)
+        if (!bit_buffer->ReadBits(du_cpb_removal_delay_increment_length,
+                                  bits_tmp)) {
+          return nullptr;
+        }
+        payload_state->du_cpb_removal_delay_increment_minus1.push_back(
+            bits_tmp);
+      }
+    }
   }
-  fprintf(outfp, " }");
 
-  indent_level = indent_level_decr(indent_level);
-  fdump_indent_level(outfp, indent_level);
-  fprintf(outfp, "}");
+  return payload_state;
 }
 
-void H265SeiUserDataUnregisteredParser::H265SeiUserDataUnregisteredState::fdump(
-    FILE* outfp, int indent_level) const {
-  fprintf(outfp, "user_data_unregistered {");
-  indent_level = indent_level_incr(indent_level);
+std::unique_ptr<H265SeiPayloadParser::H265SeiPayloadState>
+H265SeiTimeCodeParser::parse_payload(rtc::BitBuffer* bit_buffer,
+                                     uint32_t payload_size) {
+  // H265 SEI time code (time_code()) parser.
+  // Section D.2.27 ("Time code SEI message syntax") of the H.265 standard
+  // for a complete description.
+  uint32_t bits_tmp;
 
-  fdump_indent_level(outfp, indent_level);
-  // this is an UUID: 4-2-2-2-6 structure
-  fprintf(outfp,
-          "uuid_iso_iec_11578: %08" PRIx64 "-%04" PRIx64 "-%04" PRIx64
-          "-%04" PRIx64 "-%012" PRIx64,
-          uuid_iso_iec_11578_1 >> 32, (uuid_iso_iec_11578_1 >> 8) & 0xffff,
-          (uuid_iso_iec_11578_1 >> 0) & 0xffff, uuid_iso_iec_11578_2 >> 48,
-          uuid_iso_iec_11578_2 & 0x0000ffffffffffff);
+  if (payload_size < 1) {
+    return nullptr;
+  }
+  auto payload_state = std::make_unique<H265SeiTimeCodeState>();
 
-  fdump_indent_level(outfp, indent_level);
-  fprintf(outfp, "payload_size: %zu", payload.size());
+  // num_clock_ts  u(2)
+  if (!bit_buffer->ReadBits(2, payload_state->num_clock_ts)) {
+    return nullptr;
+  }
 
-  fdump_indent_level(outfp, indent_level);
-  fprintf(outfp, "payload {");
-  for (const uint8_t& v : payload) {
-    fprintf(outfp, " %u", v);
+  for (uint32_t i = 0; i < payload_state->num_clock_ts; i++) {
+    // clock_timestamp_flag[i]  u(1)
+    if (!bit_buffer->ReadBits(1, bits_tmp)) {
+      return nullptr;
+    }
+    payload_state->clock_timestamp_flag.push_back(bits_tmp);
+
+    // unset values are kept as 0 so all the vectors have num_clock_ts
+    // elements
+    uint32_t units_field_based_flag = 0;
+    uint32_t counting_type = 0;
+    uint32_t full_timestamp_flag = 0;
+    uint32_t discontinuity_flag = 0;
+    uint32_t cnt_dropped_flag = 0;
+    uint32_t n_frames = 0;
+    uint32_t seconds_flag = 0;
+    uint32_t seconds_value = 0;
+    uint32_t minutes_flag = 0;
+    uint32_t minutes_value = 0;
+    uint32_t hours_flag = 0;
+    uint32_t hours_value = 0;
+    uint32_t time_offset_length = 0;
+    int32_t time_offset_value = 0;
+
+    if (payload_state->clock_timestamp_flag[i]) {
+      // units_field_based_flag[i]  u(1)
+      if (!bit_buffer->ReadBits(1, units_field_based_flag)) {
+        return nullptr;
+      }
+
+      // counting_type[i]  u(5)
+      if (!bit_buffer->ReadBits(5, counting_type)) {
+        return nullptr;
+      }
+
+      // full_timestamp_flag[i]  u(1)
+      if (!bit_buffer->ReadBits(1, full_timestamp_flag)) {
+        return nullptr;
+      }
+
+      // discontinuity_flag[i]  u(1)
+      if (!bit_buffer->ReadBits(1, discontinuity_flag)) {
+        return nullptr;
+      }
+
+      // cnt_dropped_flag[i]  u(1)
+      if (!bit_buffer->ReadBits(1, cnt_dropped_flag)) {
+        return nullptr;
+      }
+
+      // n_frames[i]  u(9)
+      if (!bit_buffer->ReadBits(9, n_frames)) {
+        return nullptr;
+      }
+
+      if (full_timestamp_flag) {
+        // seconds_value[i]  u(6)
+        if (!bit_buffer->ReadBits(6, seconds_value)) {
+          return nullptr;
+        }
+
+        // minutes_value[i]  u(6)
+        if (!bit_buffer->ReadBits(6, minutes_value)) {
+          return nullptr;
+        }
+
+        // hours_value[i]  u(5)
+        if (!bit_buffer->ReadBits(5, hours_value)) {
+          return nullptr;
+        }
+      } else {
+        // seconds_flag[i]  u(1)
+        if (!bit_buffer->ReadBits(1, seconds_flag)) {
+          return nullptr;
+        }
+        if (seconds_flag) {
+          // seconds_value[i]  u(6)
+          if (!bit_buffer->ReadBits(6, seconds_value)) {
+            return nullptr;
+          }
+
+          // minutes_flag[i]  u(1)
+          if (!bit_buffer->ReadBits(1, minutes_flag)) {
+            return nullptr;
+          }
+          if (minutes_flag) {
+            // minutes_value[i]  u(6)
+            if (!bit_buffer->ReadBits(6, minutes_value)) {
+              return nullptr;
+            }
+
+            // hours_flag[i]  u(1)
+            if (!bit_buffer->ReadBits(1, hours_flag)) {
+              return nullptr;
+            }
+            if (hours_flag) {
+              // hours_value[i]  u(5)
+              if (!bit_buffer->ReadBits(5, hours_value)) {
+                return nullptr;
+              }
+            }
+          }
+        }
+      }
+
+      // time_offset_length[i]  u(5)
+      if (!bit_buffer->ReadBits(5, time_offset_length)) {
+        return nullptr;
+      }
+
+      if (time_offset_length > 0) {
+        // time_offset_value[i]  i(v)
+        if (!bit_buffer->ReadBits(time_offset_length, bits_tmp)) {
+          return nullptr;
+        }
+        // sign-extend the two's complement value
+        uint32_t sign_bit = 1u << (time_offset_length - 1);
+        time_offset_value = static_cast<int32_t>(
+            static_cast<int64_t>(bits_tmp ^ sign_bit) - sign_bit);
+      }
+    }
+
+    payload_state->units_field_based_flag.push_back(units_field_based_flag);
+    payload_state->counting_type.push_back(counting_type);
+    payload_state->full_timestamp_flag.push_back(full_timestamp_flag);
+    payload_state->discontinuity_flag.push_back(discontinuity_flag);
+    payload_state->cnt_dropped_flag.push_back(cnt_dropped_flag);
+    payload_state->n_frames.push_back(n_frames);
+    payload_state->seconds_flag.push_back(seconds_flag);
+    payload_state->seconds_value.push_back(seconds_value);
+    payload_state->minutes_flag.push_back(minutes_flag);
+    payload_state->minutes_value.push_back(minutes_value);
+    payload_state->hours_flag.push_back(hours_flag);
+    payload_state->hours_value.push_back(hours_value);
+    payload_state->time_offset_length.push_back(time_offset_length);
+    payload_state->time_offset_value.push_back(time_offset_value);
+  }
+
+  return payload_state;
+}
+
+std::unique_ptr<H265SeiPayloadParser::H265SeiPayloadState>
+H265SeiMasteringDisplayColourVolumeParser::parse_payload(
+    rtc::BitBuffer* bit_buffer, uint32_t payload_size) {
+  // H265 SEI mastering display colour volume
+  // (mastering_display_colour_volume()) parser.
+  // Section D.2.28 ("Mastering display colour volume SEI message syntax")
+  // of the H.265 standard for a complete description.
+  if (payload_size < 24) {
+    return nullptr;
+  }
+  auto payload_state =
+      std::make_unique<H265SeiMasteringDisplayColourVolumeState>();
+
+  for (uint32_t c = 0; c < 3; c++) {
+    // display_primaries_x[c]  u(16)
+    if (!bit_buffer->ReadBits(16, payload_state->display_primaries_x[c])) {
+      return nullptr;
+    }
+    // display_primaries_y[c]  u(16)
+    if (!bit_buffer->ReadBits(16, payload_state->display_primaries_y[c])) {
+      return nullptr;
+    }
+  }
+
+  // white_point_x  u(16)
+  if (!bit_buffer->ReadBits(16, payload_state->white_point_x)) {
+    return nullptr;
+  }
+
+  // white_point_y  u(16)
+  if (!bit_buffer->ReadBits(16, payload_state->white_point_y)) {
+    return nullptr;
+  }
+
+  // max_display_mastering_luminance  u(32)
+  if (!bit_buffer->ReadBits(32,
+                            payload_state->max_display_mastering_luminance)) {
+    return nullptr;
+  }
+
+  // min_display_mastering_luminance  u(32)
+  if (!bit_buffer->ReadBits(32,
+                            payload_state->min_display_mastering_luminance)) {
+    return nullptr;
+  }
+
+  return payload_state;
+}
+
+std::unique_ptr<H265SeiPayloadParser::H265SeiPayloadState>
+H265SeiContentLightLevelInfoParser::parse_payload(rtc::BitBuffer* bit_buffer,
+                                                  uint32_t payload_size) {
+  // H265 SEI content light level information (content_light_level_info())
+  // parser.
+  // Section D.2.35 ("Content light level information SEI message syntax")
+  // of the H.265 standard for a complete description.
+  if (payload_size < 4) {
+    return nullptr;
+  }
+  auto payload_state = std::make_unique<H265SeiContentLightLevelInfoState>();
+
+  // max_content_light_level  u(16)
+  if (!bit_buffer->ReadBits(16, payload_state->max_content_light_level)) {
+    return nullptr;
+  }
+
+  // max_pic_average_light_level  u(16)
+  if (!bit_buffer->ReadBits(16, payload_state->max_pic_average_light_level)) {
+    return nullptr;
+  }
+
+  return payload_state;
+}
+
+std::unique_ptr<H265SeiPayloadParser::H265SeiPayloadState>
+H265SeiTemporalMotionConstrainedTileSetsParser::parse_payload(
+    rtc::BitBuffer* bit_buffer, uint32_t payload_size) {
+  // H265 SEI temporal motion-constrained tile sets
+  // (temporal_motion_constrained_tile_sets()) parser.
+  // Section D.2 ("Temporal motion-constrained tile sets SEI message
+  // syntax") of the H.265 standard for a complete description.
+  uint32_t bits_tmp;
+  uint32_t golomb_tmp;
+
+  if (payload_size < 1) {
+    return nullptr;
+  }
+  auto payload_state =
+      std::make_unique<H265SeiTemporalMotionConstrainedTileSetsState>();
+
+  // mc_all_tiles_exact_sample_value_match_flag  u(1)
+  if (!bit_buffer->ReadBits(
+          1, payload_state->mc_all_tiles_exact_sample_value_match_flag)) {
+    return nullptr;
+  }
+
+  // each_tile_one_tile_set_flag  u(1)
+  if (!bit_buffer->ReadBits(1, payload_state->each_tile_one_tile_set_flag)) {
+    return nullptr;
+  }
+
+  if (payload_state->each_tile_one_tile_set_flag) {
+    // max_mcts_tier_level_idc_present_flag  u(1)
+    if (!bit_buffer->ReadBits(
+            1, payload_state->max_mcts_tier_level_idc_present_flag)) {
+      return nullptr;
+    }
+    if (payload_state->max_mcts_tier_level_idc_present_flag) {
+      // max_mcts_tier_flag  u(1)
+      if (!bit_buffer->ReadBits(1, payload_state->max_mcts_tier_flag)) {
+        return nullptr;
+      }
+      // max_mcts_level_idc  u(8)
+      if (!bit_buffer->ReadBits(8, payload_state->max_mcts_level_idc)) {
+        return nullptr;
+      }
+    }
+    return payload_state;
+  }
+
+  // limited_tile_set_display_flag  u(1)
+  if (!bit_buffer->ReadBits(1, payload_state->limited_tile_set_display_flag)) {
+    return nullptr;
+  }
+
+  // num_sets_in_message_minus1  ue(v)
+  if (!bit_buffer->ReadExponentialGolomb(
+          payload_state->num_sets_in_message_minus1)) {
+    return nullptr;
+  }
+  if (payload_state->num_sets_in_message_minus1 >
+      h265limits::NUM_SETS_IN_MESSAGE_MINUS1_MAX) {
+    ReportParseError(ParseErrorCode::kOutOfRange,
+                     "num_sets_in_message_minus1",
+                     payload_state->num_sets_in_message_minus1, bit_buffer);
+    return nullptr;
+  }
+
+  for (uint32_t i = 0; i <= payload_state->num_sets_in_message_minus1; i++) {
+    // mcts_id[i]  ue(v)
+    if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
+      return nullptr;
+    }
+    payload_state->mcts_id.push_back(golomb_tmp);
+
+    uint32_t display_tile_set_flag = 0;
+    if (payload_state->limited_tile_set_display_flag) {
+      // display_tile_set_flag[i]  u(1)
+      if (!bit_buffer->ReadBits(1, display_tile_set_flag)) {
+        return nullptr;
+      }
+    }
+    payload_state->display_tile_set_flag.push_back(display_tile_set_flag);
+
+    // num_tile_rects_in_set_minus1[i]  ue(v)
+    if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
+      return nullptr;
+    }
+    // each tile rectangle takes (at least) 2 bits
+    if (!FitsInBuffer(bit_buffer, golomb_tmp + 1ull, 2)) {
+      ReportParseError(ParseErrorCode::kOutOfRange,
+                       "num_tile_rects_in_set_minus1", golomb_tmp, bit_buffer);
+      return nullptr;
+    }
+    payload_state->num_tile_rects_in_set_minus1.push_back(golomb_tmp);
+
+    payload_state->top_left_tile_index.emplace_back();
+    payload_state->bottom_right_tile_index.emplace_back();
+    for (uint32_t j = 0; j <= payload_state->num_tile_rects_in_set_minus1[i];
+         j++) {
+      // top_left_tile_index[i][j]  ue(v)
+      if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
+        return nullptr;
+      }
+      payload_state->top_left_tile_index[i].push_back(golomb_tmp);
+
+      // bottom_right_tile_index[i][j]  ue(v)
+      if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
+        return nullptr;
+      }
+      payload_state->bottom_right_tile_index[i].push_back(golomb_tmp);
+    }
+
+    uint32_t mc_exact_sample_value_match_flag = 0;
+    if (!payload_state->mc_all_tiles_exact_sample_value_match_flag) {
+      // mc_exact_sample_value_match_flag[i]  u(1)
+      if (!bit_buffer->ReadBits(1, mc_exact_sample_value_match_flag)) {
+        return nullptr;
+      }
+    }
+    payload_state->mc_exact_sample_value_match_flag.push_back(
+        mc_exact_sample_value_match_flag);
+
+    // mcts_tier_level_idc_present_flag[i]  u(1)
+    if (!bit_buffer->ReadBits(1, bits_tmp)) {
+      return nullptr;
+    }
+    payload_state->mcts_tier_level_idc_present_flag.push_back(bits_tmp);
+
+    uint32_t mcts_tier_flag = 0;
+    uint32_t mcts_level_idc = 0;
+    if (payload_state->mcts_tier_level_idc_present_flag[i]) {
+      // mcts_tier_flag[i]  u(1)
+      if (!bit_buffer->ReadBits(1, mcts_tier_flag)) {
+        return nullptr;
+      }
+      // mcts_level_idc[i]  u(8)
+      if (!bit_buffer->ReadBits(8, mcts_level_idc)) {
+        return nullptr;
+      }
+    }
+    payload_state->mcts_tier_flag.push_back(mcts_tier_flag);
+    payload_state->mcts_level_idc.push_back(mcts_level_idc);
+  }
+
+  return payload_state;
+}
+
+std::unique_ptr<H265SeiPayloadParser::H265SeiPayloadState>
+H265SeiMctsExtractionInfoSetsParser::parse_payload(rtc::BitBuffer* bit_buffer,
+                                                   uint32_t payload_size) {
+  // H265 SEI MCTS extraction information sets (mcts_extraction_info_sets())
+  // parser.
+  // Section D.2 ("MCTS extraction information set SEI message syntax") of
+  // the H.265 standard for a complete description.
+  uint32_t bits_tmp;
+  uint32_t golomb_tmp;
+
+  if (payload_size < 1) {
+    return nullptr;
+  }
+  auto payload_state = std::make_unique<H265SeiMctsExtractionInfoSetsState>();
+
+  // num_info_sets_minus1  ue(v)
+  if (!bit_buffer->ReadExponentialGolomb(payload_state->num_info_sets_minus1)) {
+    return nullptr;
+  }
+  // each information set takes (at least) 5 bits
+  if (!FitsInBuffer(bit_buffer, payload_state->num_info_sets_minus1 + 1ull,
+                    5)) {
+    ReportParseError(ParseErrorCode::kOutOfRange, "num_info_sets_minus1",
+                     payload_state->num_info_sets_minus1, bit_buffer);
+    return nullptr;
+  }
+
+  for (uint32_t i = 0; i <= payload_state->num_info_sets_minus1; i++) {
+    // num_mcts_sets_minus1[i]  ue(v)
+    if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
+      return nullptr;
+    }
+    if (!FitsInBuffer(bit_buffer, golomb_tmp + 1ull, 2)) {
+      ReportParseError(ParseErrorCode::kOutOfRange, "num_mcts_sets_minus1",
+                       golomb_tmp, bit_buffer);
+      return nullptr;
+    }
+    payload_state->num_mcts_sets_minus1.push_back(golomb_tmp);
+
+    payload_state->num_mcts_in_set_minus1.emplace_back();
+    payload_state->idx_of_mcts_in_set.emplace_back();
+    for (uint32_t j = 0; j <= payload_state->num_mcts_sets_minus1[i]; j++) {
+      // num_mcts_in_set_minus1[i][j]  ue(v)
+      if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
+        return nullptr;
+      }
+      if (!FitsInBuffer(bit_buffer, golomb_tmp + 1ull, 1)) {
+        ReportParseError(ParseErrorCode::kOutOfRange,
+                         "num_mcts_in_set_minus1", golomb_tmp, bit_buffer);
+        return nullptr;
+      }
+      payload_state->num_mcts_in_set_minus1[i].push_back(golomb_tmp);
+
+      payload_state->idx_of_mcts_in_set[i].emplace_back();
+      for (uint32_t k = 0; k <= payload_state->num_mcts_in_set_minus1[i][j];
+           k++) {
+        // idx_of_mcts_in_set[i][j][k]  ue(v)
+        if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
+          return nullptr;
+        }
+        payload_state->idx_of_mcts_in_set[i][j].push_back(golomb_tmp);
+      }
+    }
+
+    // slice_reordering_enabled_flag[i]  u(1)
+    if (!bit_buffer->ReadBits(1, bits_tmp)) {
+      return nullptr;
+    }
+    payload_state->slice_reordering_enabled_flag.push_back(bits_tmp);
+
+    uint32_t num_slice_segments_minus1 = 0;
+    payload_state->output_slice_segment_address.emplace_back();
+    if (payload_state->slice_reordering_enabled_flag[i]) {
+      // num_slice_segments_minus1[i]  ue(v)
+      if (!bit_buffer->ReadExponentialGolomb(num_slice_segments_minus1)) {
+        return nullptr;
+      }
+      if (!FitsInBuffer(bit_buffer, num_slice_segments_minus1 + 1ull, 1)) {
+        ReportParseError(ParseErrorCode::kOutOfRange,
+                         "num_slice_segments_minus1",
+                         num_slice_segments_minus1, bit_buffer);
+        return nullptr;
+      }
+      for (uint32_t j = 0; j <= num_slice_segments_minus1; j++) {
+        // output_slice_segment_address[i][j]  ue(v)
+        if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
+          return nullptr;
+        }
+        payload_state->output_slice_segment_address[i].push_back(golomb_tmp);
+      }
+    }
+    payload_state->num_slice_segments_minus1.push_back(
+        num_slice_segments_minus1);
+
+    // num_vps_in_info_set_minus1[i]  ue(v)
+    // vps_rbsp_data_length[i][j]  ue(v)
+    if (!ReadRbspDataLengths(bit_buffer, "num_vps_in_info_set_minus1",
+                             &payload_state->num_vps_in_info_set_minus1,
+                             &payload_state->vps_rbsp_data_length)) {
+      return nullptr;
+    }
+
+    // num_sps_in_info_set_minus1[i]  ue(v)
+    // sps_rbsp_data_length[i][j]  ue(v)
+    if (!ReadRbspDataLengths(bit_buffer, "num_sps_in_info_set_minus1",
+                             &payload_state->num_sps_in_info_set_minus1,
+                             &payload_state->sps_rbsp_data_length)) {
+      return nullptr;
+    }
+
+    // num_pps_in_info_set_minus1[i]  ue(v)
+    if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
+      return nullptr;
+    }
+    // each PPS takes (at least) 4 bits
+    if (!FitsInBuffer(bit_buffer, golomb_tmp + 1ull, 4)) {
+      ReportParseError(ParseErrorCode::kOutOfRange,
+                       "num_pps_in_info_set_minus1", golomb_tmp, bit_buffer);
+      return nullptr;
+    }
+    payload_state->num_pps_in_info_set_minus1.push_back(golomb_tmp);
+
+    payload_state->pps_nuh_temporal_id_plus1.emplace_back();
+    payload_state->pps_rbsp_data_length.emplace_back();
+    for (uint32_t j = 0; j <= payload_state->num_pps_in_info_set_minus1[i];
+         j++) {
+      // pps_nuh_temporal_id_plus1[i][j]  u(3)
+      if (!bit_buffer->ReadBits(3, bits_tmp)) {
+        return nullptr;
+      }
+      payload_state->pps_nuh_temporal_id_plus1[i].push_back(bits_tmp);
+
+      // pps_rbsp_data_length[i][j]  ue(v)
+      if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
+        return nullptr;
+      }
+      payload_state->pps_rbsp_data_length[i].push_back(golomb_tmp);
+    }
+
+    while (!byte_aligned(bit_buffer)) {
+      // mcts_alignment_bit_equal_to_zero  f(1)
+      if (!bit_buffer->ReadBits(1, bits_tmp)) {
+        return nullptr;
+      }
+    }
+
+    // vps_rbsp_data_byte[i][j][k]  u(8)
+    // sps_rbsp_data_byte[i][j][k]  u(8)
+    // pps_rbsp_data_byte[i][j][k]  u(8)
+    payload_state->vps_rbsp_data_byte.emplace_back();
+    payload_state->sps_rbsp_data_byte.emplace_back();
+    payload_state->pps_rbsp_data_byte.emplace_back();
+    if (!ReadRbspData(bit_buffer, payload_state->vps_rbsp_data_length[i],
+                      &payload_state->vps_rbsp_data_byte[i]) ||
+        !ReadRbspData(bit_buffer, payload_state->sps_rbsp_data_length[i],
+                      &payload_state->sps_rbsp_data_byte[i]) ||
+        !ReadRbspData(bit_buffer, payload_state->pps_rbsp_data_length[i],
+                      &payload_state->pps_rbsp_data_byte[i])) {
+      return nullptr;
+    }
+  }
+
+  return payload_state;
+}
+
+std::unique_ptr<H265SeiPayloadParser::H265SeiPayloadState>
+H265SeiUnknownParser::parse_payload(rtc::BitBuffer* bit_buffer,
+                                    uint32_t payload_size) {
+  // We have no specific details for this sei, just keep all the bytes
+  // in a payload buffer.
+  uint32_t remaining_payload_size = payload_size;
+  if (remaining_payload_size == 0) {
+    return nullptr;
+  }
+  auto payload_state = std::make_unique<H265SeiUnknownState>();
+  if (!ReadPayloadBytes(bit_buffer, remaining_payload_size, payload_as_view_,
+                        &payload_state->payload_view,
+                        &payload_state->payload)) {
+    return nullptr;
+  }
+  return payload_state;
+}
+
+#ifdef FDUMP_DEFINE
+
+void H265SeiMessageParser::SeiMessageState::fdump(FILE* outfp,
+                                                  int indent_level) const {
+  fprintf(outfp, "sei message {");
+  indent_level = indent_level_incr(indent_level);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "payload_type: %i", payload_type);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "payload_size: %u", payload_size);
+
+  if (payload_state != nullptr) {
+    fdump_indent_level(outfp, indent_level);
+    payload_state->fdump(outfp, indent_level);
+  }
+
+  indent_level = indent_level_decr(indent_level);
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "}");
+}
+
+void H265SeiRbspParser::SeiRbspState::fdump(FILE* outfp,
+                                           int indent_level) const {
+  for (size_t i = 0; i < sei_message.size(); ++i) {
+    if (i > 0) {
+      fdump_indent_level(outfp, indent_level);
+    }
+    sei_message[i]->fdump(outfp, indent_level);
+  }
+}
+
+void H265SeiUserDataRegisteredItuTT35Parser::
+    H265SeiUserDataRegisteredItuTT35State::fdump(FILE* outfp,
+                                                 int indent_level) const {
+  fprintf(outfp, "user_data_registered_itu_t_t35 {");
+  indent_level = indent_level_incr(indent_level);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "itu_t_t35_country_code: %i", itu_t_t35_country_code);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "itu_t_t35_country_code_extension_byte: %i",
+          itu_t_t35_country_code_extension_byte);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "payload_size: %zu", payload_view.length);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "payload {");
+  for (const uint8_t& v : payload) {
+    fprintf(outfp, " %u", v);
+  }
+  fprintf(outfp, " }");
+
+  indent_level = indent_level_decr(indent_level);
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "}");
+}
+
+void H265SeiUserDataUnregisteredParser::H265SeiUserDataUnregisteredState::fdump(
+    FILE* outfp, int indent_level) const {
+  fprintf(outfp, "user_data_unregistered {");
+  indent_level = indent_level_incr(indent_level);
+
+  fdump_indent_level(outfp, indent_level);
+  // this is an UUID: 4-2-2-2-6 structure
+  fprintf(outfp,
+          "uuid_iso_iec_11578: %08" PRIx64 "-%04" PRIx64 "-%04" PRIx64
+          "-%04" PRIx64 "-%012" PRIx64,
+          uuid_iso_iec_11578_1 >> 32, (uuid_iso_iec_11578_1 >> 8) & 0xffff,
+          (uuid_iso_iec_11578_1 >> 0) & 0xffff, uuid_iso_iec_11578_2 >> 48,
+          uuid_iso_iec_11578_2 & 0x0000ffffffffffff);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "payload_size: %zu", payload_view.length);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "payload {");
+  for (const uint8_t& v : payload) {
+    fprintf(outfp, " %u", v);
+  }
+  fprintf(outfp, " }");
+
+  indent_level = indent_level_decr(indent_level);
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "}");
+}
+
+void H265SeiBufferingPeriodParser::H265SeiBufferingPeriodState::fdump(
+    FILE* outfp, int indent_level) const {
+  fprintf(outfp, "buffering_period {");
+  indent_level = indent_level_incr(indent_level);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "bp_seq_parameter_set_id: %i", bp_seq_parameter_set_id);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "irap_cpb_params_present_flag: %i",
+          irap_cpb_params_present_flag);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "cpb_delay_offset: %i", cpb_delay_offset);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "dpb_delay_offset: %i", dpb_delay_offset);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "concatenation_flag: %i", concatenation_flag);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "au_cpb_removal_delay_delta_minus1: %i",
+          au_cpb_removal_delay_delta_minus1);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "nal_initial_cpb_removal_delay {");
+  for (const uint32_t& v : nal_initial_cpb_removal_delay) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "nal_initial_cpb_removal_offset {");
+  for (const uint32_t& v : nal_initial_cpb_removal_offset) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "nal_initial_alt_cpb_removal_delay {");
+  for (const uint32_t& v : nal_initial_alt_cpb_removal_delay) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "nal_initial_alt_cpb_removal_offset {");
+  for (const uint32_t& v : nal_initial_alt_cpb_removal_offset) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "vcl_initial_cpb_removal_delay {");
+  for (const uint32_t& v : vcl_initial_cpb_removal_delay) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "vcl_initial_cpb_removal_offset {");
+  for (const uint32_t& v : vcl_initial_cpb_removal_offset) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "vcl_initial_alt_cpb_removal_delay {");
+  for (const uint32_t& v : vcl_initial_alt_cpb_removal_delay) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "vcl_initial_alt_cpb_removal_offset {");
+  for (const uint32_t& v : vcl_initial_alt_cpb_removal_offset) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "use_alt_cpb_params_flag: %i", use_alt_cpb_params_flag);
+
+  indent_level = indent_level_decr(indent_level);
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "}");
+}
+
+void H265SeiPicTimingParser::H265SeiPicTimingState::fdump(
+    FILE* outfp, int indent_level) const {
+  fprintf(outfp, "pic_timing {");
+  indent_level = indent_level_incr(indent_level);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "pic_struct: %i", pic_struct);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "source_scan_type: %i", source_scan_type);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "duplicate_flag: %i", duplicate_flag);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "au_cpb_removal_delay_minus1: %i",
+          au_cpb_removal_delay_minus1);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "pic_dpb_output_delay: %i", pic_dpb_output_delay);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "pic_dpb_output_du_delay: %i", pic_dpb_output_du_delay);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "num_decoding_units_minus1: %i", num_decoding_units_minus1);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "du_common_cpb_removal_delay_flag: %i",
+          du_common_cpb_removal_delay_flag);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "du_common_cpb_removal_delay_increment_minus1: %i",
+          du_common_cpb_removal_delay_increment_minus1);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "num_nalus_in_du_minus1 {");
+  for (const uint32_t& v : num_nalus_in_du_minus1) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "du_cpb_removal_delay_increment_minus1 {");
+  for (const uint32_t& v : du_cpb_removal_delay_increment_minus1) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  indent_level = indent_level_decr(indent_level);
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "}");
+}
+
+void H265SeiTimeCodeParser::H265SeiTimeCodeState::fdump(
+    FILE* outfp, int indent_level) const {
+  fprintf(outfp, "time_code {");
+  indent_level = indent_level_incr(indent_level);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "num_clock_ts: %i", num_clock_ts);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "clock_timestamp_flag {");
+  for (const auto& v : clock_timestamp_flag) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "units_field_based_flag {");
+  for (const auto& v : units_field_based_flag) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "counting_type {");
+  for (const auto& v : counting_type) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "full_timestamp_flag {");
+  for (const auto& v : full_timestamp_flag) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "discontinuity_flag {");
+  for (const auto& v : discontinuity_flag) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "cnt_dropped_flag {");
+  for (const auto& v : cnt_dropped_flag) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "n_frames {");
+  for (const auto& v : n_frames) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "seconds_flag {");
+  for (const auto& v : seconds_flag) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "seconds_value {");
+  for (const auto& v : seconds_value) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "minutes_flag {");
+  for (const auto& v : minutes_flag) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "minutes_value {");
+  for (const auto& v : minutes_value) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "hours_flag {");
+  for (const auto& v : hours_flag) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "hours_value {");
+  for (const auto& v : hours_value) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "time_offset_length {");
+  for (const auto& v : time_offset_length) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "time_offset_value {");
+  for (const auto& v : time_offset_value) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  indent_level = indent_level_decr(indent_level);
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "}");
+}
+
+void H265SeiMasteringDisplayColourVolumeParser::
+    H265SeiMasteringDisplayColourVolumeState::fdump(FILE* outfp,
+                                                    int indent_level) const {
+  fprintf(outfp, "mastering_display_colour_volume {");
+  indent_level = indent_level_incr(indent_level);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "display_primaries_x {");
+  for (const uint32_t& v : display_primaries_x) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "display_primaries_y {");
+  for (const uint32_t& v : display_primaries_y) {
+    fprintf(outfp, " %i", v);
+  }
+  fprintf(outfp, " }");
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "white_point_x: %i", white_point_x);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "white_point_y: %i", white_point_y);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "max_display_mastering_luminance: %u",
+          max_display_mastering_luminance);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "min_display_mastering_luminance: %u",
+          min_display_mastering_luminance);
+
+  indent_level = indent_level_decr(indent_level);
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "}");
+}
+
+void H265SeiContentLightLevelInfoParser::H265SeiContentLightLevelInfoState::
+    fdump(FILE* outfp, int indent_level) const {
+  fprintf(outfp, "content_light_level_info {");
+  indent_level = indent_level_incr(indent_level);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "max_content_light_level: %i", max_content_light_level);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "max_pic_average_light_level: %i",
+          max_pic_average_light_level);
+
+  indent_level = indent_level_decr(indent_level);
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "}");
+}
+
+void H265SeiTemporalMotionConstrainedTileSetsParser::
+    H265SeiTemporalMotionConstrainedTileSetsState::fdump(
+        FILE* outfp, int indent_level) const {
+  fprintf(outfp, "temporal_motion_constrained_tile_sets {");
+  indent_level = indent_level_incr(indent_level);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "mc_all_tiles_exact_sample_value_match_flag: %i",
+          mc_all_tiles_exact_sample_value_match_flag);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "each_tile_one_tile_set_flag: %i",
+          each_tile_one_tile_set_flag);
+
+  if (each_tile_one_tile_set_flag) {
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "max_mcts_tier_level_idc_present_flag: %i",
+            max_mcts_tier_level_idc_present_flag);
+
+    if (max_mcts_tier_level_idc_present_flag) {
+      fdump_indent_level(outfp, indent_level);
+      fprintf(outfp, "max_mcts_tier_flag: %i", max_mcts_tier_flag);
+
+      fdump_indent_level(outfp, indent_level);
+      fprintf(outfp, "max_mcts_level_idc: %i", max_mcts_level_idc);
+    }
+  } else {
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "limited_tile_set_display_flag: %i",
+            limited_tile_set_display_flag);
+
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "num_sets_in_message_minus1: %i",
+            num_sets_in_message_minus1);
+
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "mcts_id {");
+    for (const uint32_t& v : mcts_id) {
+      fprintf(outfp, " %u", v);
+    }
+    fprintf(outfp, " }");
+
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "display_tile_set_flag {");
+    for (const uint32_t& v : display_tile_set_flag) {
+      fprintf(outfp, " %i", v);
+    }
+    fprintf(outfp, " }");
+
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "num_tile_rects_in_set_minus1 {");
+    for (const uint32_t& v : num_tile_rects_in_set_minus1) {
+      fprintf(outfp, " %i", v);
+    }
+    fprintf(outfp, " }");
+
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "top_left_tile_index {");
+    for (const auto& tile_set : top_left_tile_index) {
+      fprintf(outfp, " {");
+      for (const uint32_t& v : tile_set) {
+        fprintf(outfp, " %i", v);
+      }
+      fprintf(outfp, " }");
+    }
+    fprintf(outfp, " }");
+
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "bottom_right_tile_index {");
+    for (const auto& tile_set : bottom_right_tile_index) {
+      fprintf(outfp, " {");
+      for (const uint32_t& v : tile_set) {
+        fprintf(outfp, " %i", v);
+      }
+      fprintf(outfp, " }");
+    }
+    fprintf(outfp, " }");
+
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "mc_exact_sample_value_match_flag {");
+    for (const uint32_t& v : mc_exact_sample_value_match_flag) {
+      fprintf(outfp, " %i", v);
+    }
+    fprintf(outfp, " }");
+
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "mcts_tier_level_idc_present_flag {");
+    for (const uint32_t& v : mcts_tier_level_idc_present_flag) {
+      fprintf(outfp, " %i", v);
+    }
+    fprintf(outfp, " }");
+
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "mcts_tier_flag {");
+    for (const uint32_t& v : mcts_tier_flag) {
+      fprintf(outfp, " %i", v);
+    }
+    fprintf(outfp, " }");
+
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "mcts_level_idc {");
+    for (const uint32_t& v : mcts_level_idc) {
+      fprintf(outfp, " %i", v);
+    }
+    fprintf(outfp, " }");
+  }
+
+  indent_level = indent_level_decr(indent_level);
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "}");
+}
+
+void H265SeiMctsExtractionInfoSetsParser::H265SeiMctsExtractionInfoSetsState::
+    fdump(FILE* outfp, int indent_level) const {
+  fprintf(outfp, "mcts_extraction_info_sets {");
+  indent_level = indent_level_incr(indent_level);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "num_info_sets_minus1: %i", num_info_sets_minus1);
+
+  for (uint32_t i = 0; i < num_mcts_sets_minus1.size(); i++) {
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "info_set {");
+    indent_level = indent_level_incr(indent_level);
+
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "num_mcts_sets_minus1: %i", num_mcts_sets_minus1[i]);
+
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "idx_of_mcts_in_set {");
+    for (const auto& mcts_set : idx_of_mcts_in_set[i]) {
+      fprintf(outfp, " {");
+      for (const uint32_t& v : mcts_set) {
+        fprintf(outfp, " %i", v);
+      }
+      fprintf(outfp, " }");
+    }
+    fprintf(outfp, " }");
+
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "slice_reordering_enabled_flag: %i",
+            slice_reordering_enabled_flag[i]);
+
+    if (slice_reordering_enabled_flag[i]) {
+      fdump_indent_level(outfp, indent_level);
+      fprintf(outfp, "num_slice_segments_minus1: %i",
+              num_slice_segments_minus1[i]);
+
+      fdump_indent_level(outfp, indent_level);
+      fprintf(outfp, "output_slice_segment_address {");
+      for (const uint32_t& v : output_slice_segment_address[i]) {
+        fprintf(outfp, " %i", v);
+      }
+      fprintf(outfp, " }");
+    }
+
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "vps_rbsp_data_length {");
+    for (const uint32_t& v : vps_rbsp_data_length[i]) {
+      fprintf(outfp, " %i", v);
+    }
+    fprintf(outfp, " }");
+
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "sps_rbsp_data_length {");
+    for (const uint32_t& v : sps_rbsp_data_length[i]) {
+      fprintf(outfp, " %i", v);
+    }
+    fprintf(outfp, " }");
+
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "pps_nuh_temporal_id_plus1 {");
+    for (const uint32_t& v : pps_nuh_temporal_id_plus1[i]) {
+      fprintf(outfp, " %i", v);
+    }
+    fprintf(outfp, " }");
+
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "pps_rbsp_data_length {");
+    for (const uint32_t& v : pps_rbsp_data_length[i]) {
+      fprintf(outfp, " %i", v);
+    }
+    fprintf(outfp, " }");
+
+    indent_level = indent_level_decr(indent_level);
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "}");
   }
-  fprintf(outfp, " }");
 
   indent_level = indent_level_decr(indent_level);
   fdump_indent_level(outfp, indent_level);
@@ -273,7 +1892,7 @@ void H265SeiUnknownParser::H265SeiUnknownState::fdump(FILE* outfp,
   indent_level = indent_level_incr(indent_level);
 
   fdump_indent_level(outfp, indent_level);
-  fprintf(outfp, "payload_size: %zu ", payload.size());
+  fprintf(outfp, "payload_size: %zu ", payload_view.length);
 
   fdump_indent_level(outfp, indent_level);
   fprintf(outfp, "payload {");
@@ -0,0 +1,96 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_slice_header_parse_plan.h"
+
+#include <memory>
+
+#include "h265_common.h"
+
+namespace h265nal {
+
+// General note: this is based off the 2018/02 version of the H.265 standard.
+// You can find it on this page:
+// http://www.itu.int/rec/T-REC-H.265
+
+std::shared_ptr<const H265SliceHeaderParsePlan>
+H265SliceHeaderParsePlan::Create(
+    const std::shared_ptr<struct H265SpsParser::SpsState>& sps,
+    const std::shared_ptr<struct H265PpsParser::PpsState>& pps) noexcept {
+  auto plan = std::make_shared<H265SliceHeaderParsePlan>();
+  plan->sps = sps;
+  plan->pps = pps;
+
+  // Section 7.4.7.1: slice_segment_address is Ceil(Log2(PicSizeInCtbsY))
+  // bits
+  plan->PicSizeInCtbsY = sps->getPicSizeInCtbsY();
+  plan->slice_segment_address_len = ceil_log2(plan->PicSizeInCtbsY);
+  // slice_pic_order_cnt_lsb (and poc_lsb_lt[i]) is
+  // log2_max_pic_order_cnt_lsb_minus4 + 4 bits
+  plan->slice_pic_order_cnt_lsb_len =
+      sps->log2_max_pic_order_cnt_lsb_minus4 + 4;
+  // short_term_ref_pic_set_idx is Ceil(Log2(num_short_term_ref_pic_sets))
+  // bits
+  plan->short_term_ref_pic_set_idx_len =
+      ceil_log2(sps->num_short_term_ref_pic_sets);
+  // lt_idx_sps[i] is Ceil(Log2(num_long_term_ref_pics_sps)) bits
+  plan->lt_idx_sps_len = ceil_log2(sps->num_long_term_ref_pics_sps);
+  plan->max_num_pics_valid = sps->getMaxNumPics(&plan->max_num_pics);
+
+  // num_entry_point_offsets is only present with tiles or WPP
+  plan->entry_points_present =
+      pps->tiles_enabled_flag || pps->entropy_coding_sync_enabled_flag;
+  // Rec. ITU-T H.265 v5 (02/2018) Page 100
+  // The value of num_entry_point_offsets is constrained as follows:
+  uint32_t PicHeightInCtbsY = sps->getPicHeightInCtbsY();
+  if (pps->tiles_enabled_flag == 0 &&
+      pps->entropy_coding_sync_enabled_flag == 1) {
+    // - If tiles_enabled_flag is equal to 0 and
+    //   entropy_coding_sync_enabled_flag is equal to 1, the value of
+    //   num_entry_point_offsets shall be in the range of 0 to
+    //   PicHeightInCtbsY - 1, inclusive.
+    plan->max_num_entry_point_offsets = PicHeightInCtbsY - 1;
+  } else if (pps->tiles_enabled_flag == 1 &&
+             pps->entropy_coding_sync_enabled_flag == 0) {
+    // - Otherwise, if tiles_enabled_flag is equal to 1 and
+    //   entropy_coding_sync_enabled_flag is equal to 0, the value of
+    //   num_entry_point_offsets shall be in the range of 0 to
+    //   ( num_tile_columns_minus1 + 1 ) * ( num_tile_rows_minus1 + 1 ) - 1,
+    //   inclusive.
+    plan->max_num_entry_point_offsets =
+        (pps->num_tile_columns_minus1 + 1) * (pps->num_tile_rows_minus1 + 1) -
+        1;
+  } else if (pps->tiles_enabled_flag == 1 &&
+             pps->entropy_coding_sync_enabled_flag == 1) {
+    // - Otherwise, when tiles_enabled_flag is equal to 1 and
+    //   entropy_coding_sync_enabled_flag is equal to 1, the value of
+    //   num_entry_point_offsets shall be in the range of 0 to
+    //   ( num_tile_columns_minus1 + 1 ) * PicHeightInCtbsY - 1, inclusive.
+    plan->max_num_entry_point_offsets =
+        (pps->num_tile_columns_minus1 + 1) * (PicHeightInCtbsY - 1);
+  }
+  return plan;
+}
+
+std::shared_ptr<const H265SliceHeaderParsePlan> H265SliceHeaderParsePlan::Get(
+    struct H265BitstreamParserState* bitstream_parser_state, uint32_t pps_id,
+    const std::shared_ptr<struct H265SpsParser::SpsState>& sps,
+    const std::shared_ptr<struct H265PpsParser::PpsState>& pps) noexcept {
+  if (pps_id > h265limits::PPS_PIC_PARAMETER_SET_ID_MAX) {
+    return nullptr;
+  }
+  auto& plans = bitstream_parser_state->slice_header_parse_plans;
+  if (pps_id >= plans.size()) {
+    plans.resize(pps_id + 1);
+  }
+  auto& plan = plans[pps_id];
+  // a replaced parameter set is a different object (the plan keeps the
+  // old one alive, so its address cannot be reused)
+  if (plan == nullptr || plan->sps != sps || plan->pps != pps) {
+    plan = Create(sps, pps);
+  }
+  return plan;
+}
+
+}  // namespace h265nal
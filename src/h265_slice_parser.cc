@@ -8,13 +8,16 @@
 #include <inttypes.h>
 #include <stdio.h>
 
-#include <cmath>
+#include <algorithm>
 #include <cstdint>
 #include <memory>
+#include <new>
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_error_reporter.h"
 #include "h265_pred_weight_table_parser.h"
+#include "h265_slice_header_parse_plan.h"
 #include "h265_st_ref_pic_set_parser.h"
 
 namespace h265nal {
@@ -23,6 +26,13 @@ namespace h265nal {
 // You can find it on this page:
 // http://www.itu.int/rec/T-REC-H.265
 
+namespace {
+// Number of RBSP bytes unescaped on a first attempt to parse a slice
+// segment header prefix. Most headers are much shorter, so this avoids
+// unescaping the full slice segment data.
+const size_t kSliceHeaderPrefixSize = 256;
+}  // namespace
+
 // Unpack RBSP and parse slice segment state from the supplied buffer.
 std::unique_ptr<H265SliceSegmentLayerParser::SliceSegmentLayerState>
 H265SliceSegmentLayerParser::ParseSliceSegmentLayer(
@@ -91,17 +101,75 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
                                  bitstream_parser_state);
 }
 
+std::unique_ptr<H265SliceSegmentHeaderParser::SliceSegmentHeaderState>
+H265SliceSegmentHeaderParser::ParseSliceSegmentHeaderPrefix(
+    const uint8_t* data, size_t length, uint32_t nal_unit_type,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    std::vector<uint8_t>* rbsp_buffer) noexcept {
+  auto slice_segment_header = std::make_unique<SliceSegmentHeaderState>();
+  if (!ParseSliceSegmentHeaderPrefix(data, length, nal_unit_type,
+                                     bitstream_parser_state, rbsp_buffer,
+                                     slice_segment_header.get())) {
+    return nullptr;
+  }
+  return slice_segment_header;
+}
+
+bool H265SliceSegmentHeaderParser::ParseSliceSegmentHeaderPrefix(
+    const uint8_t* data, size_t length, uint32_t nal_unit_type,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    std::vector<uint8_t>* rbsp_buffer,
+    SliceSegmentHeaderState* slice_segment_header) noexcept {
+  // this may produce less than rbsp_length bytes near the end of the NAL
+  // unit
+  size_t rbsp_length = std::min(length, kSliceHeaderPrefixSize);
+  UnescapeRbspRange(data, length, 0, rbsp_length, rbsp_buffer);
+  slice_segment_header->Reset();
+  {
+    rtc::BitBuffer bit_buffer(rbsp_buffer->data(), rbsp_buffer->size());
+    if (ParseSliceSegmentHeader(&bit_buffer, nal_unit_type,
+                                bitstream_parser_state, true,
+                                slice_segment_header)) {
+      return true;
+    }
+    if (rbsp_length == length) {
+      return false;
+    }
+  }
+  // long slice segment header: retry with the full NAL unit
+  UnescapeRbspRange(data, length, 0, length, rbsp_buffer);
+  slice_segment_header->Reset();
+  rtc::BitBuffer bit_buffer(rbsp_buffer->data(), rbsp_buffer->size());
+  return ParseSliceSegmentHeader(&bit_buffer, nal_unit_type,
+                                 bitstream_parser_state, true,
+                                 slice_segment_header);
+}
+
 std::unique_ptr<H265SliceSegmentHeaderParser::SliceSegmentHeaderState>
 H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
     rtc::BitBuffer* bit_buffer, uint32_t nal_unit_type,
-    struct H265BitstreamParserState* bitstream_parser_state) noexcept {
+    struct H265BitstreamParserState* bitstream_parser_state,
+    bool stop_after_qp_offsets) noexcept {
+  auto slice_segment_header = std::make_unique<SliceSegmentHeaderState>();
+  if (!ParseSliceSegmentHeader(bit_buffer, nal_unit_type,
+                               bitstream_parser_state, stop_after_qp_offsets,
+                               slice_segment_header.get())) {
+    return nullptr;
+  }
+  return slice_segment_header;
+}
+
+bool H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
+    rtc::BitBuffer* bit_buffer, uint32_t nal_unit_type,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    bool stop_after_qp_offsets,
+    SliceSegmentHeaderState* slice_segment_header) noexcept {
   uint32_t bits_tmp;
   uint32_t golomb_tmp;
 
   // H265 slice segment header (slice_segment_layer_rbsp()) NAL Unit.
   // Section 7.3.6.1 ("General slice segment header syntax") of the H.265
   // standard for a complete description.
-  auto slice_segment_header = std::make_unique<SliceSegmentHeaderState>();
 
   // input parameters
   slice_segment_header->nal_unit_type = nal_unit_type;
@@ -109,7 +177,7 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
   // first_slice_segment_in_pic_flag  u(1)
   if (!bit_buffer->ReadBits(
           1, slice_segment_header->first_slice_segment_in_pic_flag)) {
-    return nullptr;
+    return false;
   }
 
   if (slice_segment_header->nal_unit_type >= BLA_W_LP &&
@@ -117,92 +185,95 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
     // no_output_of_prior_pics_flag  u(1)
     if (!bit_buffer->ReadBits(
             1, slice_segment_header->no_output_of_prior_pics_flag)) {
-      return nullptr;
+      return false;
     }
   }
 
   // slice_pic_parameter_set_id  ue(v)
   if (!bit_buffer->ReadExponentialGolomb(
           slice_segment_header->slice_pic_parameter_set_id)) {
-    return nullptr;
+    return false;
   }
   uint32_t pps_id = slice_segment_header->slice_pic_parameter_set_id;
-  if (bitstream_parser_state->pps.find(pps_id) ==
-      bitstream_parser_state->pps.end()) {
+  if (pps_id > h265limits::PPS_PIC_PARAMETER_SET_ID_MAX) {
+    ReportParseError(ParseErrorCode::kOutOfRange,
+                     "slice_pic_parameter_set_id", pps_id, bit_buffer);
+    return false;
+  }
+  auto pps_it = bitstream_parser_state->pps.find(pps_id);
+  if (pps_it == bitstream_parser_state->pps.end()) {
     // non-existent PPS id
-    return nullptr;
+    ReportParseError(ParseErrorCode::kMissingParameterSet,
+                     "slice_pic_parameter_set_id", pps_id, bit_buffer);
+    return false;
   }
-  auto& pps = bitstream_parser_state->pps[pps_id];
+  const auto& pps = pps_it->second;
 
-  uint32_t sps_id =
-      bitstream_parser_state->pps[pps_id]->pps_seq_parameter_set_id;
-  if (bitstream_parser_state->sps.find(sps_id) ==
-      bitstream_parser_state->sps.end()) {
+  uint32_t sps_id = pps->pps_seq_parameter_set_id;
+  auto sps_it = bitstream_parser_state->sps.find(sps_id);
+  if (sps_it == bitstream_parser_state->sps.end()) {
     // non-existent SPS id
-    return nullptr;
+    ReportParseError(ParseErrorCode::kMissingParameterSet,
+                     "pps_seq_parameter_set_id", sps_id, bit_buffer);
+    return false;
+  }
+  const auto& sps = sps_it->second;
+  // keep the exact parameter-set versions used by the slice segment
+  slice_segment_header->sps = sps;
+  slice_segment_header->pps = pps;
+  // the parts of the syntax that only depend on the parameter sets
+  std::shared_ptr<const H265SliceHeaderParsePlan> plan =
+      H265SliceHeaderParsePlan::Get(bitstream_parser_state, pps_id, sps, pps);
+  if (plan == nullptr) {
+    return false;
   }
-  auto& sps = bitstream_parser_state->sps[sps_id];
 
   if (!slice_segment_header->first_slice_segment_in_pic_flag) {
-    slice_segment_header->dependent_slice_segments_enabled_flag =
-        pps->dependent_slice_segments_enabled_flag;
-    if (slice_segment_header->dependent_slice_segments_enabled_flag) {
+    if (pps->dependent_slice_segments_enabled_flag) {
       // dependent_slice_segment_flag  u(1)
       if (!bit_buffer->ReadBits(
               1, slice_segment_header->dependent_slice_segment_flag)) {
-        return nullptr;
+        return false;
       }
     }
-    size_t PicSizeInCtbsY = sps->getPicSizeInCtbsY();
-    size_t slice_segment_address_len = static_cast<size_t>(
-        std::ceil(std::log2(static_cast<float>(PicSizeInCtbsY))));
-    if (slice_segment_address_len == 0) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr, "invalid slice_segment_address_len: %zu\n",
-              slice_segment_address_len);
-#endif  // FPRINT_ERRORS
-      return nullptr;
+    if (plan->slice_segment_address_len == 0) {
+      ReportParseError(ParseErrorCode::kOutOfRange, "slice_segment_address",
+                       plan->PicSizeInCtbsY, bit_buffer);
+      return false;
     }
     // range: 0 to PicSizeInCtbsY - 1
     // slice_segment_address  u(v)
-    if (!bit_buffer->ReadBits(slice_segment_address_len,
+    if (!bit_buffer->ReadBits(plan->slice_segment_address_len,
                               slice_segment_header->slice_segment_address)) {
-      return nullptr;
+      return false;
     }
   }
 
   if (!slice_segment_header->dependent_slice_segment_flag) {
-    slice_segment_header->num_extra_slice_header_bits =
-        pps->num_extra_slice_header_bits;
-    for (uint32_t i = 0; i < slice_segment_header->num_extra_slice_header_bits;
-         i++) {
+    for (uint32_t i = 0; i < pps->num_extra_slice_header_bits; i++) {
       // slice_reserved_flag[i]  u(1)
       if (!bit_buffer->ReadBits(1, bits_tmp)) {
-        return nullptr;
+        return false;
       }
       slice_segment_header->slice_reserved_flag.push_back(bits_tmp);
     }
 
     // slice_type  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(slice_segment_header->slice_type)) {
-      return nullptr;
+      return false;
     }
 
-    slice_segment_header->output_flag_present_flag =
-        pps->output_flag_present_flag;
-    if (slice_segment_header->output_flag_present_flag) {
+    if (pps->output_flag_present_flag) {
       // pic_output_flag  u(1)
       if (!bit_buffer->ReadBits(1, slice_segment_header->pic_output_flag)) {
-        return nullptr;
+        return false;
       }
     }
 
-    slice_segment_header->separate_colour_plane_flag =
-        sps->separate_colour_plane_flag;
-    if (slice_segment_header->separate_colour_plane_flag == 1) {
+    if (sps->separate_colour_plane_flag == 1) {
       // colour_plane_id  u(2)
       if (!bit_buffer->ReadBits(2, slice_segment_header->colour_plane_id)) {
-        return nullptr;
+        return false;
       }
     }
 
@@ -212,97 +283,77 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
       // log2_max_pic_order_cnt_lsb_minus4 + 4 bits. The value of the
       // slice_pic_order_cnt_lsb shall be in the range of 0 to
       // MaxPicOrderCntLsb - 1, inclusive.
-      slice_segment_header->log2_max_pic_order_cnt_lsb_minus4 =
-          sps->log2_max_pic_order_cnt_lsb_minus4;
-      size_t slice_pic_order_cnt_lsb_len =
-          slice_segment_header->log2_max_pic_order_cnt_lsb_minus4 + 4;
       // slice_pic_order_cnt_lsb  u(v)
       if (!bit_buffer->ReadBits(
-              slice_pic_order_cnt_lsb_len,
+              plan->slice_pic_order_cnt_lsb_len,
               slice_segment_header->slice_pic_order_cnt_lsb)) {
-        return nullptr;
+        return false;
       }
 
       // short_term_ref_pic_set_sps_flag  u(1)
       if (!bit_buffer->ReadBits(
               1, slice_segment_header->short_term_ref_pic_set_sps_flag)) {
-        return nullptr;
+        return false;
       }
 
-      slice_segment_header->num_short_term_ref_pic_sets =
-          sps->num_short_term_ref_pic_sets;
-      if (slice_segment_header->num_short_term_ref_pic_sets >
+      if (sps->num_short_term_ref_pic_sets >
           h265limits::NUM_SHORT_TERM_REF_PIC_SETS_MAX) {
-#ifdef FPRINT_ERRORS
-        fprintf(stderr,
-                "error: slice_segment_header->num_short_term_ref_pic_sets == "
-                "%" PRIu32 " > h265limits::NUM_SHORT_TERM_REF_PIC_SETS_MAX\n",
-                slice_segment_header->num_short_term_ref_pic_sets);
-#endif  // FPRINT_ERRORS
-        return nullptr;
+        ReportParseError(ParseErrorCode::kOutOfRange,
+                         "num_short_term_ref_pic_sets",
+                         sps->num_short_term_ref_pic_sets, bit_buffer);
+        return false;
       }
 
       if (!slice_segment_header->short_term_ref_pic_set_sps_flag) {
         // st_ref_pic_set(num_short_term_ref_pic_sets)
         const auto& st_ref_pic_set = sps->st_ref_pic_set;
-        uint32_t max_num_pics = 0;
-        if (!sps->getMaxNumPics(&max_num_pics)) {
-          return nullptr;
+        if (!plan->max_num_pics_valid) {
+          return false;
         }
         slice_segment_header->st_ref_pic_set =
             H265StRefPicSetParser::ParseStRefPicSet(
-                bit_buffer, slice_segment_header->num_short_term_ref_pic_sets,
-                slice_segment_header->num_short_term_ref_pic_sets,
-                &st_ref_pic_set, max_num_pics);
+                bit_buffer, sps->num_short_term_ref_pic_sets,
+                sps->num_short_term_ref_pic_sets, &st_ref_pic_set,
+                plan->max_num_pics);
         if (slice_segment_header->st_ref_pic_set == nullptr) {
-          return nullptr;
+          return false;
         }
 
-      } else if (slice_segment_header->num_short_term_ref_pic_sets > 1) {
+      } else if (sps->num_short_term_ref_pic_sets > 1) {
         // Ceil(Log2(num_short_term_ref_pic_sets));
-        size_t short_term_ref_pic_set_idx_len =
-            static_cast<size_t>(std::ceil(std::log2(static_cast<float>(
-                slice_segment_header->num_short_term_ref_pic_sets))));
         // short_term_ref_pic_set_idx  u(v)
         if (!bit_buffer->ReadBits(
-                short_term_ref_pic_set_idx_len,
+                plan->short_term_ref_pic_set_idx_len,
                 slice_segment_header->short_term_ref_pic_set_idx)) {
-          return nullptr;
+          return false;
         }
       }
 
-      slice_segment_header->long_term_ref_pics_present_flag =
-          sps->long_term_ref_pics_present_flag;
-      if (slice_segment_header->long_term_ref_pics_present_flag) {
-        slice_segment_header->num_long_term_ref_pics_sps =
-            sps->num_long_term_ref_pics_sps;
-        if (slice_segment_header->num_long_term_ref_pics_sps > 0) {
+      if (sps->long_term_ref_pics_present_flag) {
+        if (sps->num_long_term_ref_pics_sps > 0) {
           // num_long_term_sps  ue(v)
           if (!bit_buffer->ReadExponentialGolomb(
                   slice_segment_header->num_long_term_sps)) {
-            return nullptr;
+            return false;
           }
         }
 
         // num_long_term_pics  ue(v)
         if (!bit_buffer->ReadExponentialGolomb(
                 slice_segment_header->num_long_term_pics)) {
-          return nullptr;
+          return false;
         }
 
         for (uint32_t i = 0; i < slice_segment_header->num_long_term_sps +
                                      slice_segment_header->num_long_term_pics;
              i++) {
           if (i < slice_segment_header->num_long_term_sps) {
-            if (slice_segment_header->num_long_term_ref_pics_sps > 1) {
+            if (sps->num_long_term_ref_pics_sps > 1) {
               // lt_idx_sps[i]  u(v)
               // number of bits used to represent lt_idx_sps[i] is equal to
               // Ceil(Log2(num_long_term_ref_pics_sps)).
-              size_t lt_idx_sps_len =
-                  static_cast<size_t>(std::ceil(std::log2(static_cast<float>(
-                      slice_segment_header->num_long_term_ref_pics_sps))));
-              if (!bit_buffer->ReadBits(lt_idx_sps_len, bits_tmp)) {
-                return nullptr;
+              if (!bit_buffer->ReadBits(plan->lt_idx_sps_len, bits_tmp)) {
+                return false;
               }
               slice_segment_header->lt_idx_sps.push_back(bits_tmp);
             }
@@ -313,74 +364,56 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
             // log2_max_pic_order_cnt_lsb_minus4 + 4 bits. [...]
             // value of lt_idx_sps[i] shall be in the range of 0 to
             // num_long_term_ref_pics_sps - 1, inclusive.
-            size_t poc_lsb_lt_len =
-                slice_segment_header->log2_max_pic_order_cnt_lsb_minus4 + 4;
             // slice_pic_order_cnt_lsb  u(v)
-            if (!bit_buffer->ReadBits(poc_lsb_lt_len, bits_tmp)) {
-              return nullptr;
+            if (!bit_buffer->ReadBits(plan->slice_pic_order_cnt_lsb_len,
+                                      bits_tmp)) {
+              return false;
             }
             slice_segment_header->poc_lsb_lt.push_back(bits_tmp);
 
             // used_by_curr_pic_lt_flag[i]  u(1)
             if (!bit_buffer->ReadBits(1, bits_tmp)) {
-              return nullptr;
+              return false;
             }
             slice_segment_header->used_by_curr_pic_lt_flag.push_back(bits_tmp);
           }
 
           // delta_poc_msb_present_flag[i]  u(1)
           if (!bit_buffer->ReadBits(1, bits_tmp)) {
-            return nullptr;
+            return false;
           }
           slice_segment_header->delta_poc_msb_present_flag.push_back(bits_tmp);
 
           if (slice_segment_header->delta_poc_msb_present_flag[i]) {
             // delta_poc_msb_cycle_lt[i]  ue(v)
             if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
-              return nullptr;
+              return false;
             }
             slice_segment_header->delta_poc_msb_cycle_lt.push_back(golomb_tmp);
           }
         }
       }
 
-      slice_segment_header->sps_temporal_mvp_enabled_flag =
-          sps->sps_temporal_mvp_enabled_flag;
-      if (slice_segment_header->sps_temporal_mvp_enabled_flag) {
+      if (sps->sps_temporal_mvp_enabled_flag) {
         // slice_temporal_mvp_enabled_flag  u(1)
         if (!bit_buffer->ReadBits(
                 1, slice_segment_header->slice_temporal_mvp_enabled_flag)) {
-          return nullptr;
+          return false;
         }
       }
     }
 
-    slice_segment_header->sample_adaptive_offset_enabled_flag =
-        sps->sample_adaptive_offset_enabled_flag;
-    if (slice_segment_header->sample_adaptive_offset_enabled_flag) {
+    if (sps->sample_adaptive_offset_enabled_flag) {
       // slice_sao_luma_flag  u(1)
       if (!bit_buffer->ReadBits(1, slice_segment_header->slice_sao_luma_flag)) {
-        return nullptr;
+        return false;
       }
 
-      // Depending on the value of separate_colour_plane_flag, the value of
-      // the variable ChromaArrayType is assigned as follows:
-      // - If separate_colour_plane_flag is equal to 0, ChromaArrayType is
-      //   set equal to chroma_format_idc.
-      // - Otherwise (separate_colour_plane_flag is equal to 1),
-      //   ChromaArrayType is set equal to 0.
-      uint32_t chroma_format_idc = sps->chroma_format_idc;
-      if (slice_segment_header->separate_colour_plane_flag == 0) {
-        slice_segment_header->ChromaArrayType = chroma_format_idc;
-      } else {
-        slice_segment_header->ChromaArrayType = 0;
-      }
-
-      if (slice_segment_header->ChromaArrayType != 0) {
+      if (slice_segment_header->getChromaArrayType() != 0) {
         // slice_sao_chroma_flag  u(1)
         if (!bit_buffer->ReadBits(
                 1, slice_segment_header->slice_sao_chroma_flag)) {
-          return nullptr;
+          return false;
         }
       }
     }
@@ -390,53 +423,46 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
       // num_ref_idx_active_override_flag  u(1)
       if (!bit_buffer->ReadBits(
               1, slice_segment_header->num_ref_idx_active_override_flag)) {
-        return nullptr;
+        return false;
       }
 
       if (slice_segment_header->num_ref_idx_active_override_flag) {
         // num_ref_idx_l0_active_minus1  ue(v)
         if (!bit_buffer->ReadExponentialGolomb(
                 slice_segment_header->num_ref_idx_l0_active_minus1)) {
-          return nullptr;
+          return false;
         }
 
         if (slice_segment_header->slice_type == SliceType_B) {
           // num_ref_idx_l1_active_minus1  ue(v)
           if (!bit_buffer->ReadExponentialGolomb(
                   slice_segment_header->num_ref_idx_l1_active_minus1)) {
-            return nullptr;
+            return false;
           }
         }
       }
 
-      slice_segment_header->lists_modification_present_flag =
-          pps->lists_modification_present_flag;
       // TODO(chemag): calculate NumPicTotalCurr support (page 99)
       slice_segment_header->NumPicTotalCurr = 0;
-      if (slice_segment_header->lists_modification_present_flag &&
+      if (pps->lists_modification_present_flag &&
           slice_segment_header->NumPicTotalCurr > 1) {
         // ref_pic_lists_modification()
         // TODO(chemag): add support for ref_pic_lists_modification()
-#ifdef FPRINT_ERRORS
-        fprintf(stderr,
-                "error: unimplemented ref_pic_lists_modification in "
-                "slice_header\n");
-#endif  // FPRINT_ERRORS
+        ReportParseError(ParseErrorCode::kUnsupported,
+                         "ref_pic_lists_modification", 0, bit_buffer);
       }
 
       if (slice_segment_header->slice_type == SliceType_B) {
         // mvd_l1_zero_flag  u(1)
         if (!bit_buffer->ReadBits(1, slice_segment_header->mvd_l1_zero_flag)) {
-          return nullptr;
+          return false;
         }
       }
 
-      slice_segment_header->cabac_init_present_flag =
-          pps->cabac_init_present_flag;
-      if (slice_segment_header->cabac_init_present_flag) {
+      if (pps->cabac_init_present_flag) {
         // cabac_init_flag  u(1)
         if (!bit_buffer->ReadBits(1, slice_segment_header->cabac_init_flag)) {
-          return nullptr;
+          return false;
         }
       }
 
@@ -445,7 +471,7 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
           // collocated_from_l0_flag  u(1)
           if (!bit_buffer->ReadBits(
                   1, slice_segment_header->collocated_from_l0_flag)) {
-            return nullptr;
+            return false;
           }
         }
         if ((slice_segment_header->collocated_from_l0_flag &&
@@ -455,114 +481,96 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
           // collocated_ref_idx  ue(v)
           if (!bit_buffer->ReadExponentialGolomb(
                   slice_segment_header->collocated_ref_idx)) {
-            return nullptr;
+            return false;
           }
         }
       }
 
-      slice_segment_header->weighted_pred_flag = pps->weighted_pred_flag;
-      slice_segment_header->weighted_bipred_flag = pps->weighted_bipred_flag;
-      if ((slice_segment_header->weighted_pred_flag &&
+      if ((pps->weighted_pred_flag &&
            slice_segment_header->slice_type == SliceType_P) ||
-          (slice_segment_header->weighted_bipred_flag &&
+          (pps->weighted_bipred_flag &&
            slice_segment_header->slice_type == SliceType_B)) {
         // pred_weight_table()
         slice_segment_header->pred_weight_table =
             H265PredWeightTableParser::ParsePredWeightTable(
-                bit_buffer, slice_segment_header->ChromaArrayType,
+                bit_buffer, slice_segment_header->getChromaArrayType(),
                 slice_segment_header->num_ref_idx_l0_active_minus1);
         if (slice_segment_header->pred_weight_table == nullptr) {
-          return nullptr;
+          return false;
         }
       }
 
       // five_minus_max_num_merge_cand  ue(v)
       if (!bit_buffer->ReadExponentialGolomb(
               slice_segment_header->five_minus_max_num_merge_cand)) {
-        return nullptr;
+        return false;
       }
 
-      slice_segment_header->motion_vector_resolution_control_idc = 0;
-      if (sps->sps_scc_extension_flag) {
-        if (sps->sps_scc_extension != nullptr) {
-          slice_segment_header->motion_vector_resolution_control_idc =
-              sps->sps_scc_extension->motion_vector_resolution_control_idc;
-        }
-      }
-      if (slice_segment_header->motion_vector_resolution_control_idc == 2) {
+      if (slice_segment_header->getMotionVectorResolutionControlIdc() == 2) {
         // use_integer_mv_flag  u(1)
         if (!bit_buffer->ReadBits(1,
                                   slice_segment_header->use_integer_mv_flag)) {
-          return nullptr;
+          return false;
         }
       }
     }
     // slice_qp_delta  se(v)
     if (!bit_buffer->ReadSignedExponentialGolomb(
             slice_segment_header->slice_qp_delta)) {
-      return nullptr;
+      return false;
     }
 
-    slice_segment_header->pps_slice_chroma_qp_offsets_present_flag =
-        pps->pps_slice_chroma_qp_offsets_present_flag;
-    if (slice_segment_header->pps_slice_chroma_qp_offsets_present_flag) {
+    if (pps->pps_slice_chroma_qp_offsets_present_flag) {
       // slice_cb_qp_offset  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(
               slice_segment_header->slice_cb_qp_offset)) {
-        return nullptr;
+        return false;
       }
 
       // slice_cr_qp_offset  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(
               slice_segment_header->slice_cr_qp_offset)) {
-        return nullptr;
+        return false;
       }
     }
 
-    slice_segment_header->pps_slice_act_qp_offsets_present_flag = 0;
-    if (pps->pps_scc_extension_flag) {
-      slice_segment_header->pps_slice_act_qp_offsets_present_flag =
-          pps->pps_scc_extension->pps_slice_act_qp_offsets_present_flag;
-    }
-    if (slice_segment_header->pps_slice_act_qp_offsets_present_flag) {
+    if (slice_segment_header->getPpsSliceActQpOffsetsPresentFlag()) {
       // slice_act_y_qp_offset  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(
               slice_segment_header->slice_act_y_qp_offset)) {
-        return nullptr;
+        return false;
       }
 
       // slice_act_cb_qp_offset  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(
               slice_segment_header->slice_act_cb_qp_offset)) {
-        return nullptr;
+        return false;
       }
 
       // slice_act_cr_qp_offset  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(
               slice_segment_header->slice_act_cr_qp_offset)) {
-        return nullptr;
+        return false;
       }
     }
 
     // TODO(chemag): add support for pps_range_extension()
-    // slice_segment_header->chroma_qp_offset_list_enabled_flag =
+    // chroma_qp_offset_list_enabled_flag =
     //    pps->pps_range_extension->chroma_qp_offset_list_enabled_flag;
-    slice_segment_header->chroma_qp_offset_list_enabled_flag = 0;
-    if (slice_segment_header->chroma_qp_offset_list_enabled_flag) {
+    uint32_t chroma_qp_offset_list_enabled_flag = 0;
+    if (chroma_qp_offset_list_enabled_flag) {
       // cu_chroma_qp_offset_enabled_flag  u(1)
       if (!bit_buffer->ReadBits(
               1, slice_segment_header->cu_chroma_qp_offset_enabled_flag)) {
-        return nullptr;
+        return false;
       }
     }
 
-    slice_segment_header->deblocking_filter_override_enabled_flag =
-        pps->deblocking_filter_override_enabled_flag;
-    if (slice_segment_header->deblocking_filter_override_enabled_flag) {
+    if (pps->deblocking_filter_override_enabled_flag) {
       // deblocking_filter_override_flag  u(1)
       if (!bit_buffer->ReadBits(
               1, slice_segment_header->deblocking_filter_override_flag)) {
-        return nullptr;
+        return false;
       }
     }
 
@@ -570,27 +578,25 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
       // slice_deblocking_filter_disabled_flag  u(1)
       if (!bit_buffer->ReadBits(
               1, slice_segment_header->slice_deblocking_filter_disabled_flag)) {
-        return nullptr;
+        return false;
       }
 
       if (!slice_segment_header->slice_deblocking_filter_disabled_flag) {
         // slice_beta_offset_div2 se(v)
         if (!bit_buffer->ReadSignedExponentialGolomb(
                 slice_segment_header->slice_beta_offset_div2)) {
-          return nullptr;
+          return false;
         }
 
         // slice_tc_offset_div2 se(v)
         if (!bit_buffer->ReadSignedExponentialGolomb(
                 slice_segment_header->slice_tc_offset_div2)) {
-          return nullptr;
+          return false;
         }
       }
     }
 
-    slice_segment_header->pps_loop_filter_across_slices_enabled_flag =
-        pps->pps_loop_filter_across_slices_enabled_flag;
-    if (slice_segment_header->pps_loop_filter_across_slices_enabled_flag &&
+    if (pps->pps_loop_filter_across_slices_enabled_flag &&
         (slice_segment_header->slice_sao_luma_flag ||
          slice_segment_header->slice_sao_chroma_flag ||
          !slice_segment_header->slice_deblocking_filter_disabled_flag)) {
@@ -598,37 +604,34 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
       if (!bit_buffer->ReadBits(
               1, slice_segment_header
                      ->slice_loop_filter_across_slices_enabled_flag)) {
-        return nullptr;
+        return false;
       }
     }
   }
 
-  slice_segment_header->tiles_enabled_flag = pps->tiles_enabled_flag;
-  slice_segment_header->entropy_coding_sync_enabled_flag =
-      pps->entropy_coding_sync_enabled_flag;
-  if (slice_segment_header->tiles_enabled_flag ||
-      slice_segment_header->entropy_coding_sync_enabled_flag) {
+  if (stop_after_qp_offsets) {
+    return true;
+  }
+
+  if (plan->entry_points_present) {
     // num_entry_point_offsets  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(
             slice_segment_header->num_entry_point_offsets)) {
-      return nullptr;
+      return false;
     }
-    if (!slice_segment_header->isValidNumEntryPointOffsets(
-            slice_segment_header->num_entry_point_offsets, sps, pps)) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "error: invalid slice_segment_header->num_entry_point_offsets: "
-              "%" PRIu32 "\n",
-              slice_segment_header->num_entry_point_offsets);
-      return nullptr;
-#endif  // FPRINT_ERRORS
+    if (slice_segment_header->num_entry_point_offsets >
+        plan->max_num_entry_point_offsets) {
+      ReportParseError(ParseErrorCode::kOutOfRange, "num_entry_point_offsets",
+                       slice_segment_header->num_entry_point_offsets,
+                       bit_buffer);
+      return false;
     }
 
     if (slice_segment_header->num_entry_point_offsets > 0) {
       // offset_len_minus1  ue(v)
       if (!bit_buffer->ReadExponentialGolomb(
               slice_segment_header->offset_len_minus1)) {
-        return nullptr;
+        return false;
       }
 
       for (uint32_t i = 0; i < slice_segment_header->num_entry_point_offsets;
@@ -636,26 +639,24 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
         // entry_point_offset_minus1[i]  u(v)
         if (!bit_buffer->ReadBits(slice_segment_header->offset_len_minus1 + 1,
                                   bits_tmp)) {
-          return nullptr;
+          return false;
         }
         slice_segment_header->entry_point_offset_minus1.push_back(bits_tmp);
       }
     }
   }
 
-  slice_segment_header->slice_segment_header_extension_present_flag =
-      pps->slice_segment_header_extension_present_flag;
-  if (slice_segment_header->slice_segment_header_extension_present_flag) {
+  if (pps->slice_segment_header_extension_present_flag) {
     // slice_segment_header_extension_length  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(
             slice_segment_header->slice_segment_header_extension_length)) {
-      return nullptr;
+      return false;
     }
     for (uint32_t i = 0;
          i < slice_segment_header->slice_segment_header_extension_length; i++) {
       // slice_segment_header_extension_data_byte[i]  u(8)
       if (!bit_buffer->ReadBits(8, bits_tmp)) {
-        return nullptr;
+        return false;
       }
       slice_segment_header->slice_segment_header_extension_data_byte.push_back(
           bits_tmp);
@@ -665,49 +666,46 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
   // TODO(chemag): implement byte_alignment()
   // byte_alignment()
 
-  return slice_segment_header;
+  return true;
 }
 
-bool H265SliceSegmentHeaderParser::SliceSegmentHeaderState::
-    isValidNumEntryPointOffsets(
-        uint32_t num_entry_point_offsets_value,
-        std::shared_ptr<struct H265SpsParser::SpsState> sps,
-        std::shared_ptr<struct H265PpsParser::PpsState> pps) noexcept {
-  // Rec. ITU-T H.265 v5 (02/2018) Page 100
-  // The value of num_entry_point_offsets is constrained as follows:
-  // - If tiles_enabled_flag is equal to 0 and entropy_coding_sync_enabled_flag
-  //   is equal to 1, the value of num_entry_point_offsets shall be in the
-  //   range of 0 to PicHeightInCtbsY - 1, inclusive.
-  if (tiles_enabled_flag == 0 && entropy_coding_sync_enabled_flag == 1) {
-    return (num_entry_point_offsets_value <= (sps->getPicHeightInCtbsY() - 1));
-  }
+void H265SliceSegmentHeaderParser::SliceSegmentHeaderState::Reset() noexcept {
+  // re-construct the state in place (it has no const or reference
+  // members), so that new fields are always reset too
+  this->~SliceSegmentHeaderState();
+  new (this) SliceSegmentHeaderState();
+}
 
-  // - Otherwise, if tiles_enabled_flag is equal to 1 and
-  //   entropy_coding_sync_enabled_flag is equal to 0, the value of
-  //   num_entry_point_offsets shall be in the range of 0 to
-  //   ( num_tile_columns_minus1 + 1 ) * ( num_tile_rows_minus1 + 1 ) - 1,
-  //   inclusive.
-  if (tiles_enabled_flag == 1 && entropy_coding_sync_enabled_flag == 0) {
-    uint32_t max_num_entry_point_offsets =
-        ((pps->num_tile_columns_minus1 + 1) * (pps->num_tile_rows_minus1 + 1) -
-         1);
-    return (num_entry_point_offsets_value <= max_num_entry_point_offsets);
+uint32_t H265SliceSegmentHeaderParser::SliceSegmentHeaderState::
+    getChromaArrayType() const noexcept {
+  if (sps == nullptr) {
+    return 0;
   }
+  // Depending on the value of separate_colour_plane_flag, the value of
+  // the variable ChromaArrayType is assigned as follows:
+  // - If separate_colour_plane_flag is equal to 0, ChromaArrayType is
+  //   set equal to chroma_format_idc.
+  // - Otherwise (separate_colour_plane_flag is equal to 1),
+  //   ChromaArrayType is set equal to 0.
+  return (sps->separate_colour_plane_flag == 0) ? sps->chroma_format_idc : 0;
+}
 
-  // - Otherwise, when tiles_enabled_flag is equal to 1 and
-  //   entropy_coding_sync_enabled_flag is equal to 1, the value of
-  //   num_entry_point_offsets shall be in the range of 0 to
-  // ( num_tile_columns_minus1 + 1 ) * PicHeightInCtbsY - 1, inclusive.
-  if (tiles_enabled_flag == 1 && entropy_coding_sync_enabled_flag == 1) {
-    uint32_t max_num_entry_point_offsets =
-        ((pps->num_tile_columns_minus1 + 1) * (sps->getPicHeightInCtbsY() - 1));
-    return (num_entry_point_offsets_value <= max_num_entry_point_offsets);
+uint32_t H265SliceSegmentHeaderParser::SliceSegmentHeaderState::
+    getMotionVectorResolutionControlIdc() const noexcept {
+  if (sps == nullptr || !sps->sps_scc_extension_flag ||
+      sps->sps_scc_extension == nullptr) {
+    return 0;
   }
+  return sps->sps_scc_extension->motion_vector_resolution_control_idc;
+}
 
-  // TODO(chemag): not clear what to do in other cases. As the same paragraph
-  // contains "When not present, the value of num_entry_point_offsets is
-  // inferred to be equal to 0.", we will check for zero here.
-  return (num_entry_point_offsets_value == 0);
+uint32_t H265SliceSegmentHeaderParser::SliceSegmentHeaderState::
+    getPpsSliceActQpOffsetsPresentFlag() const noexcept {
+  if (pps == nullptr || !pps->pps_scc_extension_flag ||
+      pps->pps_scc_extension == nullptr) {
+    return 0;
+  }
+  return pps->pps_scc_extension->pps_slice_act_qp_offsets_present_flag;
 }
 
 #ifdef FDUMP_DEFINE
@@ -716,6 +714,14 @@ void H265SliceSegmentHeaderParser::SliceSegmentHeaderState::fdump(
   fprintf(outfp, "slice_segment_header {");
   indent_level = indent_level_incr(indent_level);
 
+  if (sps == nullptr || pps == nullptr) {
+    // the syntax depends on the referenced parameter sets
+    indent_level = indent_level_decr(indent_level);
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "}");
+    return;
+  }
+
   fdump_indent_level(outfp, indent_level);
   fprintf(outfp, "first_slice_segment_in_pic_flag: %i",
           first_slice_segment_in_pic_flag);
@@ -765,14 +771,14 @@ void H265SliceSegmentHeaderParser::SliceSegmentHeaderState::fdump(
         if (st_ref_pic_set) {
           st_ref_pic_set->fdump(outfp, indent_level);
         }
-      } else if (num_short_term_ref_pic_sets > 1) {
+      } else if (sps->num_short_term_ref_pic_sets > 1) {
         fdump_indent_level(outfp, indent_level);
         fprintf(outfp, "short_term_ref_pic_set_idx: %i",
                 short_term_ref_pic_set_idx);
       }
 
-      if (long_term_ref_pics_present_flag) {
-        if (num_long_term_ref_pics_sps > 0) {
+      if (sps->long_term_ref_pics_present_flag) {
+        if (sps->num_long_term_ref_pics_sps > 0) {
           fdump_indent_level(outfp, indent_level);
           fprintf(outfp, "num_long_term_sps: %i", num_long_term_sps);
         }
@@ -782,7 +788,7 @@ void H265SliceSegmentHeaderParser::SliceSegmentHeaderState::fdump(
 
         for (uint32_t i = 0; i < num_long_term_sps + num_long_term_pics; i++) {
           if (i < num_long_term_sps) {
-            if (num_long_term_ref_pics_sps > 1) {
+            if (sps->num_long_term_ref_pics_sps > 1) {
               fdump_indent_level(outfp, indent_level);
               fprintf(outfp, "lt_idx_sps {");
               for (const uint32_t& v : lt_idx_sps) {
@@ -823,18 +829,18 @@ void H265SliceSegmentHeaderParser::SliceSegmentHeaderState::fdump(
         }
       }
 
-      if (sps_temporal_mvp_enabled_flag) {
+      if (sps->sps_temporal_mvp_enabled_flag) {
         fdump_indent_level(outfp, indent_level);
         fprintf(outfp, "slice_temporal_mvp_enabled_flag: %i",
                 slice_temporal_mvp_enabled_flag);
       }
     }
 
-    if (sample_adaptive_offset_enabled_flag) {
+    if (sps->sample_adaptive_offset_enabled_flag) {
       fdump_indent_level(outfp, indent_level);
       fprintf(outfp, "slice_sao_luma_flag: %i", slice_sao_luma_flag);
 
-      if (ChromaArrayType != 0) {
+      if (getChromaArrayType() != 0) {
         fdump_indent_level(outfp, indent_level);
         fprintf(outfp, "slice_sao_chroma_flag: %i", slice_sao_chroma_flag);
       }
@@ -857,7 +863,7 @@ void H265SliceSegmentHeaderParser::SliceSegmentHeaderState::fdump(
         }
       }
 
-      if (lists_modification_present_flag && NumPicTotalCurr > 1) {
+      if (pps->lists_modification_present_flag && NumPicTotalCurr > 1) {
         // TODO(chemag): add support for ref_pic_lists_modification()
       }
 
@@ -866,7 +872,7 @@ void H265SliceSegmentHeaderParser::SliceSegmentHeaderState::fdump(
         fprintf(outfp, "mvd_l1_zero_flag: %i", mvd_l1_zero_flag);
       }
 
-      if (cabac_init_present_flag) {
+      if (pps->cabac_init_present_flag) {
         fdump_indent_level(outfp, indent_level);
         fprintf(outfp, "cabac_init_flag: %i", cabac_init_flag);
       }
@@ -885,8 +891,8 @@ void H265SliceSegmentHeaderParser::SliceSegmentHeaderState::fdump(
         }
       }
 
-      if ((weighted_pred_flag && slice_type == SliceType_P) ||
-          (weighted_bipred_flag && slice_type == SliceType_B)) {
+      if ((pps->weighted_pred_flag && slice_type == SliceType_P) ||
+          (pps->weighted_bipred_flag && slice_type == SliceType_B)) {
         fdump_indent_level(outfp, indent_level);
         pred_weight_table->fdump(outfp, indent_level);
       }
@@ -895,7 +901,7 @@ void H265SliceSegmentHeaderParser::SliceSegmentHeaderState::fdump(
       fprintf(outfp, "five_minus_max_num_merge_cand: %i",
               five_minus_max_num_merge_cand);
 
-      if (motion_vector_resolution_control_idc == 2) {
+      if (getMotionVectorResolutionControlIdc() == 2) {
         fdump_indent_level(outfp, indent_level);
         fprintf(outfp, "use_integer_mv_flag: %i", use_integer_mv_flag);
       }
@@ -904,7 +910,7 @@ void H265SliceSegmentHeaderParser::SliceSegmentHeaderState::fdump(
     fdump_indent_level(outfp, indent_level);
     fprintf(outfp, "slice_qp_delta: %i", slice_qp_delta);
 
-    if (pps_slice_chroma_qp_offsets_present_flag) {
+    if (pps->pps_slice_chroma_qp_offsets_present_flag) {
       fdump_indent_level(outfp, indent_level);
       fprintf(outfp, "slice_cb_qp_offset: %i", slice_cb_qp_offset);
 
@@ -912,7 +918,7 @@ void H265SliceSegmentHeaderParser::SliceSegmentHeaderState::fdump(
       fprintf(outfp, "slice_cr_qp_offset: %i", slice_cr_qp_offset);
     }
 
-    if (pps_slice_act_qp_offsets_present_flag) {
+    if (getPpsSliceActQpOffsetsPresentFlag()) {
       fdump_indent_level(outfp, indent_level);
       fprintf(outfp, "slice_act_y_qp_offset: %i", slice_act_y_qp_offset);
 
@@ -923,13 +929,15 @@ void H265SliceSegmentHeaderParser::SliceSegmentHeaderState::fdump(
       fprintf(outfp, "slice_act_cr_qp_offset: %i", slice_act_cr_qp_offset);
     }
 
+    // TODO(chemag): add support for pps_range_extension()
+    uint32_t chroma_qp_offset_list_enabled_flag = 0;
     if (chroma_qp_offset_list_enabled_flag) {
       fdump_indent_level(outfp, indent_level);
       fprintf(outfp, "cu_chroma_qp_offset_enabled_flag: %i",
               cu_chroma_qp_offset_enabled_flag);
     }
 
-    if (deblocking_filter_override_enabled_flag) {
+    if (pps->deblocking_filter_override_enabled_flag) {
       fdump_indent_level(outfp, indent_level);
       fprintf(outfp, "deblocking_filter_override_flag: %i",
               deblocking_filter_override_flag);
@@ -949,7 +957,7 @@ void H265SliceSegmentHeaderParser::SliceSegmentHeaderState::fdump(
       }
     }
 
-    if (pps_loop_filter_across_slices_enabled_flag &&
+    if (pps->pps_loop_filter_across_slices_enabled_flag &&
         (slice_sao_luma_flag || slice_sao_chroma_flag ||
          !slice_deblocking_filter_disabled_flag)) {
       fdump_indent_level(outfp, indent_level);
@@ -958,7 +966,7 @@ void H265SliceSegmentHeaderParser::SliceSegmentHeaderState::fdump(
     }
   }
 
-  if (tiles_enabled_flag || entropy_coding_sync_enabled_flag) {
+  if (pps->tiles_enabled_flag || pps->entropy_coding_sync_enabled_flag) {
     fdump_indent_level(outfp, indent_level);
     fprintf(outfp, "num_entry_point_offsets: %i", num_entry_point_offsets);
 
@@ -975,7 +983,7 @@ void H265SliceSegmentHeaderParser::SliceSegmentHeaderState::fdump(
     }
   }
 
-  if (slice_segment_header_extension_present_flag) {
+  if (pps->slice_segment_header_extension_present_flag) {
     fdump_indent_level(outfp, indent_level);
     fprintf(outfp, "slice_segment_header_extension_length: %i",
             slice_segment_header_extension_length);
@@ -8,12 +8,12 @@
 #include <inttypes.h>
 #include <stdio.h>
 
-#include <cmath>
 #include <cstdint>
 #include <memory>
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_error_reporter.h"
 #include "h265_profile_tier_level_parser.h"
 #include "h265_scaling_list_data_parser.h"
 #include "h265_vui_parameters_parser.h"
@@ -74,14 +74,8 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   }
   if (sps->sps_seq_parameter_set_id < kSpsSeqParameterSetIdMin ||
       sps->sps_seq_parameter_set_id > kSpsSeqParameterSetIdMax) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "invalid sps_seq_parameter_set_id: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
-            sps->sps_seq_parameter_set_id, kSpsSeqParameterSetIdMin,
-            kSpsSeqParameterSetIdMax);
-#endif  // FPRINT_ERRORS
+    ReportParseError(ParseErrorCode::kOutOfRange, "sps_seq_parameter_set_id",
+                     sps->sps_seq_parameter_set_id, bit_buffer);
     return nullptr;
   }
 
@@ -91,13 +85,8 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   }
   if (sps->chroma_format_idc < kChromaFormatIdcMin ||
       sps->chroma_format_idc > kChromaFormatIdcMax) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "invalid chroma_format_idc: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
-            sps->chroma_format_idc, kChromaFormatIdcMin, kChromaFormatIdcMax);
-#endif  // FPRINT_ERRORS
+    ReportParseError(ParseErrorCode::kOutOfRange, "chroma_format_idc",
+                     sps->chroma_format_idc, bit_buffer);
     return nullptr;
   }
 
@@ -114,27 +103,21 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   }
   if (sps->pic_width_in_luma_samples < kPicWidthInLumaSamplesMin ||
       sps->pic_width_in_luma_samples > kPicWidthInLumaSamplesMax) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "invalid pic_width_in_luma_samples: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
-            sps->pic_width_in_luma_samples, kPicWidthInLumaSamplesMin,
-            kPicWidthInLumaSamplesMax);
-#endif  // FPRINT_ERRORS
+    ReportParseError(ParseErrorCode::kOutOfRange, "pic_width_in_luma_samples",
+                     sps->pic_width_in_luma_samples, bit_buffer);
     return nullptr;
   }
   // Rec. ITU-T H.265 v5 (02/2018) Page 78
   // "pic_width_in_luma_samples shall not be equal to 0 and shall be an
   // integer multiple of MinCbSizeY."
-  uint32_t MinCbSizeY = sps->getMinCbSizeY();
+  // (log2_min_luma_coding_block_size_minus3 is only parsed later, so this
+  // checks against the smallest MinCbSizeY)
+  uint32_t MinCbSizeY = 1 << (sps->log2_min_luma_coding_block_size_minus3 + 3);
   if ((sps->pic_width_in_luma_samples == 0) ||
       ((MinCbSizeY * (sps->pic_width_in_luma_samples / MinCbSizeY)) !=
        sps->pic_width_in_luma_samples)) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: invalid sps->pic_width_in_luma_samples: %i\n",
-            sps->pic_width_in_luma_samples);
-#endif  // FPRINT_ERRORS
+    ReportParseError(ParseErrorCode::kOutOfRange, "pic_width_in_luma_samples",
+                     sps->pic_width_in_luma_samples, bit_buffer);
     return nullptr;
   }
 
@@ -144,14 +127,8 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   }
   if (sps->pic_height_in_luma_samples < kPicHeightInLumaSamplesMin ||
       sps->pic_height_in_luma_samples > kPicHeightInLumaSamplesMax) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "invalid pic_height_in_luma_samples: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
-            sps->pic_height_in_luma_samples, kPicHeightInLumaSamplesMin,
-            kPicHeightInLumaSamplesMax);
-#endif  // FPRINT_ERRORS
+    ReportParseError(ParseErrorCode::kOutOfRange, "pic_height_in_luma_samples",
+                     sps->pic_height_in_luma_samples, bit_buffer);
     return nullptr;
   }
   // Rec. ITU-T H.265 v5 (02/2018) Page 78
@@ -160,10 +137,8 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   if ((sps->pic_height_in_luma_samples == 0) ||
       ((MinCbSizeY * (sps->pic_height_in_luma_samples / MinCbSizeY)) !=
        sps->pic_height_in_luma_samples)) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: invalid sps->pic_height_in_luma_samples: %i\n",
-            sps->pic_height_in_luma_samples);
-#endif  // FPRINT_ERRORS
+    ReportParseError(ParseErrorCode::kOutOfRange, "pic_height_in_luma_samples",
+                     sps->pic_height_in_luma_samples, bit_buffer);
     return nullptr;
   }
 
@@ -179,13 +154,8 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
     }
     if (sps->conf_win_left_offset < 0 ||
         sps->conf_win_left_offset > sps->pic_width_in_luma_samples) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid conf_win_left_offset: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              sps->conf_win_left_offset, 0, sps->pic_width_in_luma_samples);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange, "conf_win_left_offset",
+                       sps->conf_win_left_offset, bit_buffer);
       return nullptr;
     }
     // conf_win_right_offset  ue(v)
@@ -194,13 +164,8 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
     }
     if (sps->conf_win_right_offset < 0 ||
         sps->conf_win_right_offset > sps->pic_width_in_luma_samples) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid conf_win_right_offset: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              sps->conf_win_right_offset, 0, sps->pic_width_in_luma_samples);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange, "conf_win_right_offset",
+                       sps->conf_win_right_offset, bit_buffer);
       return nullptr;
     }
     // conf_win_top_offset  ue(v)
@@ -209,13 +174,8 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
     }
     if (sps->conf_win_top_offset < 0 ||
         sps->conf_win_top_offset > sps->pic_height_in_luma_samples) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid conf_win_top_offset: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              sps->conf_win_top_offset, 0, sps->pic_height_in_luma_samples);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange, "conf_win_top_offset",
+                       sps->conf_win_top_offset, bit_buffer);
       return nullptr;
     }
     // conf_win_bottom_offset  ue(v)
@@ -224,13 +184,8 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
     }
     if (sps->conf_win_bottom_offset < 0 ||
         sps->conf_win_bottom_offset > sps->pic_height_in_luma_samples) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid conf_win_bottom_offset: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              sps->conf_win_bottom_offset, 0, sps->pic_height_in_luma_samples);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange, "conf_win_bottom_offset",
+                       sps->conf_win_bottom_offset, bit_buffer);
       return nullptr;
     }
   }
@@ -241,14 +196,8 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   }
   if (sps->bit_depth_luma_minus8 < kBitDepthLumaMinus8Min ||
       sps->bit_depth_luma_minus8 > kBitDepthLumaMinus8Max) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "invalid bit_depth_luma_minus8: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
-            sps->bit_depth_luma_minus8, kBitDepthLumaMinus8Min,
-            kBitDepthLumaMinus8Max);
-#endif  // FPRINT_ERRORS
+    ReportParseError(ParseErrorCode::kOutOfRange, "bit_depth_luma_minus8",
+                     sps->bit_depth_luma_minus8, bit_buffer);
     return nullptr;
   }
   // bit_depth_chroma_minus8  ue(v)
@@ -257,14 +206,8 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   }
   if (sps->bit_depth_chroma_minus8 < kBitDepthChromaMinus8Min ||
       sps->bit_depth_chroma_minus8 > kBitDepthChromaMinus8Max) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "invalid bit_depth_chroma_minus8: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
-            sps->bit_depth_chroma_minus8, kBitDepthChromaMinus8Min,
-            kBitDepthChromaMinus8Max);
-#endif  // FPRINT_ERRORS
+    ReportParseError(ParseErrorCode::kOutOfRange, "bit_depth_chroma_minus8",
+                     sps->bit_depth_chroma_minus8, bit_buffer);
     return nullptr;
   }
   // log2_max_pic_order_cnt_lsb_minus4  ue(v)
@@ -276,14 +219,9 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
           kLog2MaxPicOrderCntLsbMinus4Min ||
       sps->log2_max_pic_order_cnt_lsb_minus4 >
           kLog2MaxPicOrderCntLsbMinus4Max) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "invalid log2_max_pic_order_cnt_lsb_minus4: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
-            sps->log2_max_pic_order_cnt_lsb_minus4,
-            kLog2MaxPicOrderCntLsbMinus4Min, kLog2MaxPicOrderCntLsbMinus4Max);
-#endif  // FPRINT_ERRORS
+    ReportParseError(ParseErrorCode::kOutOfRange,
+                     "log2_max_pic_order_cnt_lsb_minus4",
+                     sps->log2_max_pic_order_cnt_lsb_minus4, bit_buffer);
     return nullptr;
   }
 
@@ -431,12 +369,8 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   }
   if (sps->num_short_term_ref_pic_sets >
       h265limits::NUM_SHORT_TERM_REF_PIC_SETS_MAX) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "error: sps->num_short_term_ref_pic_sets == %" PRIu32
-            " > h265limits::NUM_SHORT_TERM_REF_PIC_SETS_MAX\n",
-            sps->num_short_term_ref_pic_sets);
-#endif  // FPRINT_ERRORS
+    ReportParseError(ParseErrorCode::kOutOfRange, "num_short_term_ref_pic_sets",
+                     sps->num_short_term_ref_pic_sets, bit_buffer);
     return nullptr;
   }
 
@@ -587,6 +521,7 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
 
   rbsp_trailing_bits(bit_buffer);
 
+  sps->computeDerived();
   return sps;
 }
 
@@ -877,115 +812,80 @@ bool H265SpsParser::SpsState::getMaxNumPics(
   return true;
 }
 
-uint32_t H265SpsParser::SpsState::getMinCbLog2SizeY() const noexcept {
-  // Rec. ITU-T H.265 v5 (02/2018) Page 79, Equation (7-10)
-  return log2_min_luma_coding_block_size_minus3 + 3;
-}
-
-uint32_t H265SpsParser::SpsState::getCtbLog2SizeY() const noexcept {
-  // Rec. ITU-T H.265 v5 (02/2018) Page 79, Equation (7-11)
-  return getMinCbLog2SizeY() + log2_diff_max_min_luma_coding_block_size;
-}
-
-uint32_t H265SpsParser::SpsState::getMinCbSizeY() const noexcept {
-  // Rec. ITU-T H.265 v5 (02/2018) Page 79, Equation (7-12)
-  return 1 << getMinCbLog2SizeY();
-}
-
-uint32_t H265SpsParser::SpsState::getCtbSizeY() const noexcept {
-  // Rec. ITU-T H.265 v5 (02/2018) Page 79, Equation (7-13)
-  return 1 << getCtbLog2SizeY();
-}
-
-uint32_t H265SpsParser::SpsState::getPicWidthInMinCbsY() const noexcept {
-  // Rec. ITU-T H.265 v5 (02/2018) Page 79, Equation (7-14)
-  return pic_width_in_luma_samples / getMinCbSizeY();
-}
-
-uint32_t H265SpsParser::SpsState::getPicWidthInCtbsY() const noexcept {
-  // Rec. ITU-T H.265 v5 (02/2018) Page 79, Equation (7-15)
-  return static_cast<uint32_t>(
-      std::ceil(1.0 * pic_width_in_luma_samples / getCtbSizeY()));
-}
-
-uint32_t H265SpsParser::SpsState::getPicHeightInMinCbsY() const noexcept {
-  // Rec. ITU-T H.265 v5 (02/2018) Page 80, Equation (7-16)
-  return pic_height_in_luma_samples / getMinCbSizeY();
-}
-
-uint32_t H265SpsParser::SpsState::getPicHeightInCtbsY() const noexcept {
-  // Rec. ITU-T H.265 v5 (02/2018) Page 80, Equation (7-17)
-  return static_cast<uint32_t>(
-      std::ceil(1.0 * pic_height_in_luma_samples / getCtbSizeY()));
-}
+void H265SpsParser::SpsState::computeDerived() noexcept {
+  derived = DerivedValues();
 
-uint32_t H265SpsParser::SpsState::getPicSizeInMinCbsY() const noexcept {
-  // Rec. ITU-T H.265 v5 (02/2018) Page 80, Equation (7-18)
-  return getPicWidthInMinCbsY() * getPicHeightInMinCbsY();
-}
-
-uint32_t H265SpsParser::SpsState::getPicSizeInCtbsY() const noexcept {
-  // Rec. ITU-T H.265 v5 (02/2018) Page 80, Equation (7-19)
-  return getPicWidthInCtbsY() * getPicHeightInCtbsY();
-}
-
-uint32_t H265SpsParser::SpsState::getPicSizeInSamplesY() const noexcept {
-  // Rec. ITU-T H.265 v5 (02/2018) Page 80, Equation (7-20)
-  return pic_width_in_luma_samples * pic_height_in_luma_samples;
-}
-
-#if 0
-uint32_t H265SpsParser::SpsState::getPicWidthInSamplesC() const noexcept {
-  // Rec. ITU-T H.265 v5 (02/2018) Page 80, Equation (7-21)
-  return pic_width_in_luma_samples / getSubWidthC();
-}
-
-uint32_t H265SpsParser::SpsState::getPicHeightInSamplesC() const noexcept {
-  // Rec. ITU-T H.265 v5 (02/2018) Page 80, Equation (7-22)
-  return pic_height_in_luma_samples / getSubHeightC();
-}
-#endif
-
-int H265SpsParser::SpsState::getSubWidthC() const noexcept {
   // Table 6-1
-  if (chroma_format_idc == 0 && separate_colour_plane_flag == 0) {
-    // monochrome
-    return 1;
-  } else if (chroma_format_idc == 1 && separate_colour_plane_flag == 0) {
-    // 4:2:0
-    return 2;
-  } else if (chroma_format_idc == 2 && separate_colour_plane_flag == 0) {
-    // 4:2:2
-    return 2;
-  } else if (chroma_format_idc == 3 && separate_colour_plane_flag == 0) {
-    // 4:4:4
-    return 1;
-  } else if (chroma_format_idc == 3 && separate_colour_plane_flag == 1) {
-    // 4:4:0
-    return 1;
-  }
-  return -1;
-}
+  if (separate_colour_plane_flag == 0) {
+    switch (chroma_format_idc) {
+      case 0:
+        // monochrome
+        derived.SubWidthC = 1;
+        derived.SubHeightC = 1;
+        break;
+      case 1:
+        // 4:2:0
+        derived.SubWidthC = 2;
+        derived.SubHeightC = 2;
+        break;
+      case 2:
+        // 4:2:2
+        derived.SubWidthC = 2;
+        derived.SubHeightC = 1;
+        break;
+      case 3:
+        // 4:4:4
+        derived.SubWidthC = 1;
+        derived.SubHeightC = 1;
+        break;
+    }
+  } else if (chroma_format_idc == 3) {
+    // 4:4:4 coded as separate colour planes
+    derived.SubWidthC = 1;
+    derived.SubHeightC = 1;
+  }
+
+  // Section 7.4.3.2.1: resolution after the conformance window cropping
+  derived.width = pic_width_in_luma_samples;
+  derived.height = pic_height_in_luma_samples;
+  derived.width -= derived.SubWidthC * conf_win_left_offset +
+                   derived.SubWidthC * conf_win_right_offset;
+  derived.height -= derived.SubHeightC * conf_win_top_offset +
+                    derived.SubHeightC * conf_win_bottom_offset;
 
-int H265SpsParser::SpsState::getSubHeightC() const noexcept {
-  // Table 6-1
-  if (chroma_format_idc == 0 && separate_colour_plane_flag == 0) {
-    // monochrome
-    return 1;
-  } else if (chroma_format_idc == 1 && separate_colour_plane_flag == 0) {
-    // 4:2:0
-    return 2;
-  } else if (chroma_format_idc == 2 && separate_colour_plane_flag == 0) {
-    // 4:2:2
-    return 1;
-  } else if (chroma_format_idc == 3 && separate_colour_plane_flag == 0) {
-    // 4:4:4
-    return 1;
-  } else if (chroma_format_idc == 3 && separate_colour_plane_flag == 1) {
-    // 4:4:0
-    return 1;
-  }
-  return -1;
+  // Rec. ITU-T H.265 v5 (02/2018) Page 80, Equation (7-20)
+  derived.PicSizeInSamplesY =
+      pic_width_in_luma_samples * pic_height_in_luma_samples;
+
+  // Rec. ITU-T H.265 v5 (02/2018) Page 79, Equations (7-10) and (7-11)
+  uint32_t MinCbLog2SizeY = log2_min_luma_coding_block_size_minus3 + 3;
+  uint32_t CtbLog2SizeY =
+      MinCbLog2SizeY + log2_diff_max_min_luma_coding_block_size;
+  if (CtbLog2SizeY >= 32 || CtbLog2SizeY < MinCbLog2SizeY) {
+    // not a valid SPS: leave the block sizes unset
+    return;
+  }
+  derived.MinCbLog2SizeY = MinCbLog2SizeY;
+  derived.CtbLog2SizeY = CtbLog2SizeY;
+  // Equations (7-12) and (7-13)
+  derived.MinCbSizeY = 1 << MinCbLog2SizeY;
+  derived.CtbSizeY = 1 << CtbLog2SizeY;
+  // Equations (7-14) to (7-17)
+  derived.PicWidthInMinCbsY = pic_width_in_luma_samples >> MinCbLog2SizeY;
+  derived.PicHeightInMinCbsY = pic_height_in_luma_samples >> MinCbLog2SizeY;
+  // (Ceil(pic_{width,height}_in_luma_samples / CtbSizeY))
+  uint64_t width_rounded_up =
+      static_cast<uint64_t>(pic_width_in_luma_samples) + derived.CtbSizeY - 1;
+  uint64_t height_rounded_up =
+      static_cast<uint64_t>(pic_height_in_luma_samples) + derived.CtbSizeY - 1;
+  derived.PicWidthInCtbsY =
+      static_cast<uint32_t>(width_rounded_up >> CtbLog2SizeY);
+  derived.PicHeightInCtbsY =
+      static_cast<uint32_t>(height_rounded_up >> CtbLog2SizeY);
+  // Equations (7-18) and (7-19)
+  derived.PicSizeInMinCbsY =
+      derived.PicWidthInMinCbsY * derived.PicHeightInMinCbsY;
+  derived.PicSizeInCtbsY = derived.PicWidthInCtbsY * derived.PicHeightInCtbsY;
 }
 
 int H265SpsParser::SpsState::getResolution(int* width,
@@ -993,15 +893,8 @@ int H265SpsParser::SpsState::getResolution(int* width,
   if (width == nullptr || height == nullptr) {
     return -1;
   }
-  // Section 7.4.3.2.1
-  int SubWidthC = getSubWidthC();
-  int SubHeightC = getSubHeightC();
-  *width = pic_width_in_luma_samples;
-  *height = pic_height_in_luma_samples;
-  *width -=
-      (SubWidthC * conf_win_left_offset + SubWidthC * conf_win_right_offset);
-  *height -= (SubHeightC * conf_win_top_offset) +
-             (SubHeightC * conf_win_bottom_offset);
+  *width = derived.width;
+  *height = derived.height;
   return 0;
 }
 }  // namespace h265nal
@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_error_reporter.h"
 
 namespace h265nal {
 
@@ -61,14 +62,8 @@ H265SpsSccExtensionParser::ParseSpsSccExtension(
     }
     if (sps_scc_extension->palette_max_size < kPaletteMaxSizeMin ||
         sps_scc_extension->palette_max_size > kPaletteMaxSizeMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid palette_max_size: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              sps_scc_extension->palette_max_size, kPaletteMaxSizeMin,
-              kPaletteMaxSizeMax);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange, "palette_max_size",
+                       sps_scc_extension->palette_max_size, bit_buffer);
       return nullptr;
     }
 
@@ -81,15 +76,10 @@ H265SpsSccExtensionParser::ParseSpsSccExtension(
             kDeltaPaletteMaxPredictorSizeMin ||
         sps_scc_extension->delta_palette_max_predictor_size >
             kDeltaPaletteMaxPredictorSizeMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid delta_palette_max_predictor_size: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              sps_scc_extension->delta_palette_max_predictor_size,
-              kDeltaPaletteMaxPredictorSizeMin,
-              kDeltaPaletteMaxPredictorSizeMax);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange,
+                       "delta_palette_max_predictor_size",
+                       sps_scc_extension->delta_palette_max_predictor_size,
+                       bit_buffer);
       return nullptr;
     }
 
@@ -111,16 +101,11 @@ H265SpsSccExtensionParser::ParseSpsSccExtension(
               kSpsNumPalettePredictorInitializersMinus1Min ||
           sps_scc_extension->sps_num_palette_predictor_initializers_minus1 >
               kSpsNumPalettePredictorInitializersMinus1Max) {
-#ifdef FPRINT_ERRORS
-        fprintf(
-            stderr,
-            "invalid sps_num_palette_predictor_initializers_minus1: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
+        ReportParseError(
+            ParseErrorCode::kOutOfRange,
+            "sps_num_palette_predictor_initializers_minus1",
             sps_scc_extension->sps_num_palette_predictor_initializers_minus1,
-            kSpsNumPalettePredictorInitializersMinus1Min,
-            kSpsNumPalettePredictorInitializersMinus1Max);
-#endif  // FPRINT_ERRORS
+            bit_buffer);
         return nullptr;
       }
 
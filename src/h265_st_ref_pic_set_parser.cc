@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_error_reporter.h"
 
 namespace h265nal {
 
@@ -136,12 +137,8 @@ H265StRefPicSetParser::ParseStRefPicSet(
 
   if (num_short_term_ref_pic_sets >
       h265limits::NUM_SHORT_TERM_REF_PIC_SETS_MAX) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "error: num_short_term_ref_pic_sets == %" PRIu32
-            " > h265limits::NUM_SHORT_TERM_REF_PIC_SETS_MAX\n",
-            num_short_term_ref_pic_sets);
-#endif  // FPRINT_ERRORS
+    ReportParseError(ParseErrorCode::kOutOfRange, "num_short_term_ref_pic_sets",
+                     num_short_term_ref_pic_sets, bit_buffer);
     return nullptr;
   }
 
@@ -171,14 +168,8 @@ H265StRefPicSetParser::ParseStRefPicSet(
     }
     if (st_ref_pic_set->delta_idx_minus1 < kDeltaIdxMinus1Min ||
         st_ref_pic_set->delta_idx_minus1 > (st_ref_pic_set->stRpsIdx - 1)) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid delta_idx_minus1: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              st_ref_pic_set->delta_idx_minus1, kDeltaIdxMinus1Min,
-              st_ref_pic_set->stRpsIdx - 1);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange, "delta_idx_minus1",
+                       st_ref_pic_set->delta_idx_minus1, bit_buffer);
       return nullptr;
     }
 
@@ -194,14 +185,8 @@ H265StRefPicSetParser::ParseStRefPicSet(
     }
     if (st_ref_pic_set->abs_delta_rps_minus1 < kAbsDeltaRpsMinus1Min ||
         st_ref_pic_set->abs_delta_rps_minus1 > kAbsDeltaRpsMinus1Max) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid abs_delta_rps_minus1: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              st_ref_pic_set->abs_delta_rps_minus1, kAbsDeltaRpsMinus1Min,
-              kAbsDeltaRpsMinus1Max);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange, "abs_delta_rps_minus1",
+                       st_ref_pic_set->abs_delta_rps_minus1, bit_buffer);
       return nullptr;
     }
 
@@ -248,14 +233,8 @@ H265StRefPicSetParser::ParseStRefPicSet(
     }
     if (st_ref_pic_set->num_negative_pics < kNumNegativePicsMin ||
         st_ref_pic_set->num_negative_pics > max_num_pics) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid num_negative_pics: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              st_ref_pic_set->num_negative_pics, kNumNegativePicsMin,
-              max_num_pics);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange, "num_negative_pics",
+                       st_ref_pic_set->num_negative_pics, bit_buffer);
       return nullptr;
     }
 
@@ -266,14 +245,8 @@ H265StRefPicSetParser::ParseStRefPicSet(
     if (st_ref_pic_set->num_positive_pics < kNumPositivePicsMin ||
         st_ref_pic_set->num_positive_pics >
             (max_num_pics - st_ref_pic_set->num_negative_pics)) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid num_positive_pics: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              st_ref_pic_set->num_positive_pics, kNumPositivePicsMin,
-              max_num_pics - st_ref_pic_set->num_negative_pics);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange, "num_positive_pics",
+                       st_ref_pic_set->num_positive_pics, bit_buffer);
       return nullptr;
     }
 
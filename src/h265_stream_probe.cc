@@ -0,0 +1,314 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_stream_probe.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <memory>
+
+#include "h265_common.h"
+#include "h265_hdr_metadata_tracker.h"
+#include "h265_pps_parser.h"
+#include "h265_sps_parser.h"
+#include "h265_vps_parser.h"
+
+namespace h265nal {
+
+// General note: this is based off the 2016/12 version of the H.265 standard.
+// You can find it on this page:
+// http://www.itu.int/rec/T-REC-H.265
+
+namespace {
+// Section E.3.1 (Table E.4): transfer_characteristics values of the
+// SMPTE ST 2084 (PQ) and ARIB STD-B67 (HLG) transfer functions
+const uint32_t kTransferCharacteristicsPq = 16;
+const uint32_t kTransferCharacteristicsHlg = 18;
+
+// Returns the offset of the next 3-byte start code prefix (0x000001) in
+// [begin, end), or end if there is none.
+size_t FindStartCode(const uint8_t* data, size_t begin, size_t end) {
+  for (size_t i = begin; i + 3 <= end; i++) {
+    if (data[i + 2] > 1) {
+      // no start code can end at i + 2
+      i += 2;
+    } else if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+      return i;
+    }
+  }
+  return end;
+}
+
+// Get the 48 bits starting with general_progressive_source_flag (Section
+// 7.3.3). Fields not present in the bitstream are zero, so the alternative
+// layouts of the 43 constraint bits can be or'ed together.
+uint64_t GetConstraintIndicatorFlags(
+    const H265ProfileInfoParser::ProfileInfoState& profile_info) {
+  uint64_t flags = 0;
+  flags |= static_cast<uint64_t>(profile_info.progressive_source_flag) << 47;
+  flags |= static_cast<uint64_t>(profile_info.interlaced_source_flag) << 46;
+  flags |= static_cast<uint64_t>(profile_info.non_packed_constraint_flag)
+           << 45;
+  flags |= static_cast<uint64_t>(profile_info.frame_only_constraint_flag)
+           << 44;
+  flags |= static_cast<uint64_t>(profile_info.max_12bit_constraint_flag)
+           << 43;
+  flags |= static_cast<uint64_t>(profile_info.max_10bit_constraint_flag)
+           << 42;
+  flags |= static_cast<uint64_t>(profile_info.max_8bit_constraint_flag) << 41;
+  flags |= static_cast<uint64_t>(profile_info.max_422chroma_constraint_flag)
+           << 40;
+  flags |= static_cast<uint64_t>(profile_info.max_420chroma_constraint_flag)
+           << 39;
+  flags |= static_cast<uint64_t>(profile_info.max_monochrome_constraint_flag)
+           << 38;
+  flags |= static_cast<uint64_t>(profile_info.intra_constraint_flag) << 37;
+  flags |= static_cast<uint64_t>(profile_info.reserved_zero_7bits) << 37;
+  flags |=
+      static_cast<uint64_t>(profile_info.one_picture_only_constraint_flag)
+      << 36;
+  flags |= static_cast<uint64_t>(profile_info.lower_bit_rate_constraint_flag)
+           << 35;
+  flags |= static_cast<uint64_t>(profile_info.max_14bit_constraint_flag)
+           << 34;
+  flags |= profile_info.reserved_zero_33bits << 1;
+  flags |= profile_info.reserved_zero_34bits << 1;
+  flags |= profile_info.reserved_zero_35bits << 1;
+  flags |= profile_info.reserved_zero_43bits << 1;
+  flags |= profile_info.inbld_flag;
+  flags |= profile_info.reserved_zero_bit;
+  return flags;
+}
+
+void FillSpsValues(const H265SpsParser::SpsState& sps,
+                   const H265StreamProbe::ProbeOptions& options,
+                   H265StreamProbe::ProbeResult* result) {
+  sps.getResolution(&result->width, &result->height);
+  result->chroma_format_idc = sps.chroma_format_idc;
+  result->bit_depth_luma = sps.bit_depth_luma_minus8 + 8;
+  result->bit_depth_chroma = sps.bit_depth_chroma_minus8 + 8;
+
+  if (sps.profile_tier_level != nullptr &&
+      sps.profile_tier_level->general != nullptr) {
+    const auto& general = *(sps.profile_tier_level->general);
+    result->profile_space = general.profile_space;
+    result->tier_flag = general.tier_flag;
+    result->profile_idc = general.profile_idc;
+    result->profile_compatibility_flags = 0;
+    for (uint32_t j = 0; j < 32; j++) {
+      result->profile_compatibility_flags |=
+          (general.profile_compatibility_flag[j] & 0x01) << j;
+    }
+    result->level_idc = sps.profile_tier_level->general_level_idc;
+    uint64_t flags = GetConstraintIndicatorFlags(general);
+    for (int i = 0; i < 6; i++) {
+      result->constraint_indicator_flags[i] = (flags >> (40 - 8 * i)) & 0xff;
+    }
+    H265StreamProbe::GetCodecsString(*(sps.profile_tier_level),
+                                     options.sample_entry, result->codecs,
+                                     sizeof(result->codecs));
+  }
+
+  if (!sps.vui_parameters_present_flag || sps.vui_parameters == nullptr) {
+    return;
+  }
+  const auto& vui = *(sps.vui_parameters);
+  if (vui.colour_description_present_flag) {
+    result->colour_primaries = vui.colour_primaries;
+    result->transfer_characteristics = vui.transfer_characteristics;
+    result->matrix_coeffs = vui.matrix_coeffs;
+    result->hdr =
+        (vui.transfer_characteristics == kTransferCharacteristicsPq ||
+         vui.transfer_characteristics == kTransferCharacteristicsHlg);
+  }
+  if (vui.vui_timing_info_present_flag && vui.vui_num_units_in_tick > 0) {
+    // Section E.3.1: a clock tick is num_units_in_tick / time_scale seconds
+    result->has_frame_rate = true;
+    result->num_units_in_tick = vui.vui_num_units_in_tick;
+    result->time_scale = vui.vui_time_scale;
+    result->frame_rate =
+        static_cast<double>(vui.vui_time_scale) / vui.vui_num_units_in_tick;
+  }
+}
+
+void FillSeiValues(const H265HdrMetadataTracker& hdr_metadata_tracker,
+                   H265StreamProbe::ProbeResult* result) {
+  auto mastering_display_colour_volume =
+      hdr_metadata_tracker.mastering_display_colour_volume();
+  if (mastering_display_colour_volume != nullptr) {
+    result->has_mastering_display_colour_volume = true;
+    result->max_display_mastering_luminance =
+        mastering_display_colour_volume->max_display_mastering_luminance;
+    result->min_display_mastering_luminance =
+        mastering_display_colour_volume->min_display_mastering_luminance;
+  }
+  auto content_light_level_info =
+      hdr_metadata_tracker.content_light_level_info();
+  if (content_light_level_info != nullptr) {
+    result->has_content_light_level_info = true;
+    result->max_content_light_level =
+        content_light_level_info->max_content_light_level;
+    result->max_pic_average_light_level =
+        content_light_level_info->max_pic_average_light_level;
+  }
+}
+}  // namespace
+
+int H265StreamProbe::GetCodecsString(
+    const H265ProfileTierLevelParser::ProfileTierLevelState&
+        profile_tier_level,
+    const char* sample_entry, char* codecs, size_t size) noexcept {
+  // ISO/IEC 14496-15, Section E.3: the codecs parameter is the sample
+  // entry 4CC followed by the general profile_space and profile_idc, the
+  // profile compatibility flags (in reverse bit order, in hex), the tier
+  // and level, and the constraint indicator bytes (in hex), where trailing
+  // zero bytes may be omitted
+  if (profile_tier_level.general == nullptr || codecs == nullptr ||
+      size == 0) {
+    return -1;
+  }
+  const auto& general = *(profile_tier_level.general);
+  static const char* kProfileSpace[] = {"", "A", "B", "C"};
+  uint32_t profile_compatibility_flags = 0;
+  for (uint32_t j = 0; j < 32; j++) {
+    profile_compatibility_flags |=
+        (general.profile_compatibility_flag[j] & 0x01) << j;
+  }
+  int len = snprintf(codecs, size, "%s.%s%u.%X.%c%u", sample_entry,
+                     kProfileSpace[general.profile_space & 0x03],
+                     general.profile_idc, profile_compatibility_flags,
+                     general.tier_flag ? 'H' : 'L',
+                     profile_tier_level.general_level_idc);
+  if (len < 0 || static_cast<size_t>(len) >= size) {
+    return -1;
+  }
+  uint64_t flags = GetConstraintIndicatorFlags(general);
+  int num_bytes = 6;
+  while (num_bytes > 0 && ((flags >> (48 - 8 * num_bytes)) & 0xff) == 0) {
+    num_bytes--;
+  }
+  for (int i = 0; i < num_bytes; i++) {
+    int n = snprintf(codecs + len, size - len, ".%X",
+                     static_cast<uint32_t>((flags >> (40 - 8 * i)) & 0xff));
+    if (n < 0 || static_cast<size_t>(len + n) >= size) {
+      return -1;
+    }
+    len += n;
+  }
+  return len;
+}
+
+H265StreamProbe::ProbeResult H265StreamProbe::Probe(
+    const uint8_t* data, size_t length, const ProbeOptions& options) noexcept {
+  ProbeResult result;
+  H265HdrMetadataTracker hdr_metadata_tracker;
+  size_t end = std::min(length, options.max_bytes);
+
+  size_t start_code = FindStartCode(data, 0, end);
+  while (start_code < end) {
+    size_t nal_start = start_code + 3;
+    size_t next_start_code = FindStartCode(data, nal_start, end);
+    if (next_start_code == end && end < length) {
+      // the NAL unit may go past the byte budget
+      break;
+    }
+    // remove the trailing_zero_8bits (and the leading zero of a 4-byte
+    // start code)
+    size_t nal_end = next_start_code;
+    while (nal_end > nal_start && data[nal_end - 1] == 0x00) {
+      nal_end--;
+    }
+    if (nal_end - nal_start >= 2 &&
+        IsNalUnitTypeVcl((data[nal_start] >> 1) & 0x3f)) {
+      // never parse slices: the parameter sets (and prefix SEIs) of the
+      // first access unit come before its first VCL NAL unit
+      break;
+    }
+    result.bytes_scanned = (next_start_code == end) ? end : nal_end;
+    start_code = next_start_code;
+    if (nal_end - nal_start < 2) {
+      continue;
+    }
+
+    // nal_unit_header()
+    const uint8_t* nal_unit = data + nal_start;
+    uint32_t nal_unit_type = (nal_unit[0] >> 1) & 0x3f;
+    const uint8_t* payload = nal_unit + 2;
+    size_t payload_length = nal_end - nal_start - 2;
+    if (nal_unit_type == VPS_NUT && !result.has_vps) {
+      result.has_vps = (H265VpsParser::ParseVps(payload, payload_length) !=
+                        nullptr);
+    } else if (nal_unit_type == SPS_NUT && !result.has_sps) {
+      auto sps = H265SpsParser::ParseSps(payload, payload_length);
+      if (sps != nullptr) {
+        result.has_sps = true;
+        FillSpsValues(*sps, options, &result);
+      }
+    } else if (nal_unit_type == PPS_NUT && !result.has_pps) {
+      result.has_pps = (H265PpsParser::ParsePps(payload, payload_length) !=
+                        nullptr);
+    } else if (nal_unit_type == PREFIX_SEI_NUT && options.wait_for_sei &&
+               !result.has_sei) {
+      hdr_metadata_tracker.ProcessSeiRbsp(payload, payload_length);
+      FillSeiValues(hdr_metadata_tracker, &result);
+      result.has_sei = true;
+    }
+
+    result.complete = result.has_vps && result.has_sps && result.has_pps;
+    if (result.complete && (!options.wait_for_sei || result.has_sei)) {
+      break;
+    }
+  }
+  return result;
+}
+
+#ifdef FDUMP_DEFINE
+void H265StreamProbe::ProbeResult::fdump(FILE* outfp,
+                                         int indent_level) const {
+  fprintf(outfp, "probe_result {");
+  indent_level = indent_level_incr(indent_level);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "complete: %i", complete);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "bytes_scanned: %zu", bytes_scanned);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "codecs: %s", codecs);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "width: %i", width);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "height: %i", height);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "chroma_format_idc: %i", chroma_format_idc);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "bit_depth_luma: %i", bit_depth_luma);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "bit_depth_chroma: %i", bit_depth_chroma);
+
+  if (has_frame_rate) {
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "frame_rate: %f", frame_rate);
+  }
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "transfer_characteristics: %i", transfer_characteristics);
+
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "hdr: %i", hdr);
+
+  indent_level = indent_level_decr(indent_level);
+  fdump_indent_level(outfp, indent_level);
+  fprintf(outfp, "}");
+}
+#endif  // FDUMP_DEFINE
+
+}  // namespace h265nal
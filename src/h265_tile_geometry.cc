@@ -0,0 +1,191 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_tile_geometry.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "h265_common.h"
+
+namespace h265nal {
+
+// General note: this is based off the 2018/02 version of the H.265 standard.
+// You can find it on this page:
+// http://www.itu.int/rec/T-REC-H.265
+
+namespace {
+// the tile tables use 16-bit CTB counts and tile indices
+const uint32_t kMaxTileTableValue = 0xffff;
+
+// Equations (6-3) and (6-4): width of the tile columns (or height of the
+// tile rows). Returns false if the explicit sizes do not fit the picture.
+bool GetTileSizes(uint32_t num_tiles, uint32_t pic_size_in_ctbs,
+                  uint32_t uniform_spacing_flag,
+                  const std::vector<uint32_t>& size_minus1,
+                  std::vector<uint16_t>* sizes) {
+  sizes->resize(num_tiles);
+  if (uniform_spacing_flag) {
+    for (uint32_t i = 0; i < num_tiles; i++) {
+      (*sizes)[i] = ((i + 1) * pic_size_in_ctbs) / num_tiles -
+                    (i * pic_size_in_ctbs) / num_tiles;
+    }
+    return true;
+  }
+  if (size_minus1.size() + 1 < num_tiles) {
+    return false;
+  }
+  uint32_t remaining = pic_size_in_ctbs;
+  for (uint32_t i = 0; i + 1 < num_tiles; i++) {
+    if (size_minus1[i] >= remaining) {
+      return false;
+    }
+    (*sizes)[i] = size_minus1[i] + 1;
+    remaining -= size_minus1[i] + 1;
+  }
+  (*sizes)[num_tiles - 1] = remaining;
+  return true;
+}
+
+// Equations (6-5) and (6-6): the tile boundaries.
+void GetTileBoundaries(const std::vector<uint16_t>& sizes,
+                       std::vector<uint16_t>* boundaries) {
+  boundaries->resize(sizes.size() + 1);
+  (*boundaries)[0] = 0;
+  for (size_t i = 0; i < sizes.size(); i++) {
+    (*boundaries)[i + 1] = (*boundaries)[i] + sizes[i];
+  }
+}
+}  // namespace
+
+std::shared_ptr<const H265TileGeometry> H265TileGeometry::Create(
+    const std::shared_ptr<struct H265SpsParser::SpsState>& sps,
+    const std::shared_ptr<struct H265PpsParser::PpsState>& pps) noexcept {
+  auto geometry = std::make_shared<H265TileGeometry>();
+  geometry->sps = sps;
+  geometry->pps = pps;
+  geometry->PicWidthInCtbsY = sps->getPicWidthInCtbsY();
+  geometry->PicHeightInCtbsY = sps->getPicHeightInCtbsY();
+  uint32_t width = geometry->PicWidthInCtbsY;
+  uint32_t height = geometry->PicHeightInCtbsY;
+  if (width == 0 || height == 0 || width > kMaxTileTableValue ||
+      height > kMaxTileTableValue) {
+    return nullptr;
+  }
+
+  // Section 7.4.3.3.1: num_tile_columns_minus1 is in the range of 0 to
+  // PicWidthInCtbsY - 1 (and num_tile_rows_minus1 to PicHeightInCtbsY - 1)
+  if (pps->tiles_enabled_flag) {
+    if (pps->num_tile_columns_minus1 >= width ||
+        pps->num_tile_rows_minus1 >= height) {
+      return nullptr;
+    }
+    geometry->num_tile_columns = pps->num_tile_columns_minus1 + 1;
+    geometry->num_tile_rows = pps->num_tile_rows_minus1 + 1;
+  } else {
+    geometry->num_tile_columns = 1;
+    geometry->num_tile_rows = 1;
+  }
+  if (geometry->getNumTiles() > kMaxTileTableValue) {
+    return nullptr;
+  }
+  if (!GetTileSizes(geometry->num_tile_columns, width,
+                    pps->uniform_spacing_flag || !pps->tiles_enabled_flag,
+                    pps->column_width_minus1, &geometry->colWidth) ||
+      !GetTileSizes(geometry->num_tile_rows, height,
+                    pps->uniform_spacing_flag || !pps->tiles_enabled_flag,
+                    pps->row_height_minus1, &geometry->rowHeight)) {
+    return nullptr;
+  }
+  GetTileBoundaries(geometry->colWidth, &geometry->colBd);
+  GetTileBoundaries(geometry->rowHeight, &geometry->rowBd);
+
+  // Equations (6-7) to (6-9). Walking the tiles in order visits the CTBs
+  // in tile scan, which produces the three tables in one pass.
+  uint32_t pic_size_in_ctbs = width * height;
+  geometry->CtbAddrRsToTs.resize(pic_size_in_ctbs);
+  geometry->CtbAddrTsToRs.resize(pic_size_in_ctbs);
+  geometry->TileId.resize(pic_size_in_ctbs);
+  uint32_t ctb_addr_ts = 0;
+  uint32_t tile_id = 0;
+  for (uint32_t j = 0; j < geometry->num_tile_rows; j++) {
+    for (uint32_t i = 0; i < geometry->num_tile_columns; i++, tile_id++) {
+      for (uint32_t y = geometry->rowBd[j]; y < geometry->rowBd[j + 1]; y++) {
+        for (uint32_t x = geometry->colBd[i]; x < geometry->colBd[i + 1];
+             x++, ctb_addr_ts++) {
+          uint32_t ctb_addr_rs = y * width + x;
+          geometry->CtbAddrRsToTs[ctb_addr_rs] = ctb_addr_ts;
+          geometry->CtbAddrTsToRs[ctb_addr_ts] = ctb_addr_rs;
+          geometry->TileId[ctb_addr_ts] = tile_id;
+        }
+      }
+    }
+  }
+  return geometry;
+}
+
+std::shared_ptr<const H265TileGeometry> H265TileGeometry::Get(
+    struct H265BitstreamParserState* bitstream_parser_state, uint32_t pps_id,
+    const std::shared_ptr<struct H265SpsParser::SpsState>& sps,
+    const std::shared_ptr<struct H265PpsParser::PpsState>& pps) noexcept {
+  if (pps_id > h265limits::PPS_PIC_PARAMETER_SET_ID_MAX) {
+    return nullptr;
+  }
+  auto& geometries = bitstream_parser_state->tile_geometries;
+  if (pps_id >= geometries.size()) {
+    geometries.resize(pps_id + 1);
+  }
+  auto& geometry = geometries[pps_id];
+  // a replaced parameter set is a different object (the geometry keeps
+  // the old one alive, so its address cannot be reused)
+  if (geometry == nullptr || geometry->sps != sps || geometry->pps != pps) {
+    geometry = Create(sps, pps);
+  }
+  return geometry;
+}
+
+int H265TileGeometry::getTileId(uint32_t ctb_addr_rs) const noexcept {
+  if (ctb_addr_rs >= CtbAddrRsToTs.size()) {
+    return -1;
+  }
+  return TileId[CtbAddrRsToTs[ctb_addr_rs]];
+}
+
+bool H265TileGeometry::getTileRect(uint32_t tile_id,
+                                   TileRect* tile_rect) const noexcept {
+  if (tile_rect == nullptr || tile_id >= getNumTiles()) {
+    return false;
+  }
+  tile_rect->tile_id = tile_id;
+  tile_rect->column = tile_id % num_tile_columns;
+  tile_rect->row = tile_id / num_tile_columns;
+  tile_rect->ctb_x = colBd[tile_rect->column];
+  tile_rect->ctb_y = rowBd[tile_rect->row];
+  tile_rect->ctb_width = colWidth[tile_rect->column];
+  tile_rect->ctb_height = rowHeight[tile_rect->row];
+  // the last column and row may extend beyond the picture
+  uint32_t CtbLog2SizeY = sps->getCtbLog2SizeY();
+  tile_rect->x = tile_rect->ctb_x << CtbLog2SizeY;
+  tile_rect->y = tile_rect->ctb_y << CtbLog2SizeY;
+  tile_rect->width =
+      std::min(tile_rect->ctb_width << CtbLog2SizeY,
+               sps->pic_width_in_luma_samples - tile_rect->x);
+  tile_rect->height =
+      std::min(tile_rect->ctb_height << CtbLog2SizeY,
+               sps->pic_height_in_luma_samples - tile_rect->y);
+  return true;
+}
+
+bool H265TileGeometry::getSliceSegmentTileRect(
+    uint32_t slice_segment_address, TileRect* tile_rect) const noexcept {
+  // slice_segment_address is a CTB raster scan address
+  int tile_id = getTileId(slice_segment_address);
+  if (tile_id < 0) {
+    return false;
+  }
+  return getTileRect(tile_id, tile_rect);
+}
+
+}  // namespace h265nal
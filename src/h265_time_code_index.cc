@@ -0,0 +1,167 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_time_code_index.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "h265_sei_parser.h"
+
+namespace h265nal {
+
+namespace {
+// Section 7.4.2.4.4: NAL units that start a new access unit when they
+// follow the last VCL NAL unit of the previous one.
+bool IsFirstNalUnitOfAccessUnit(uint32_t nal_unit_type) {
+  return nal_unit_type == AUD_NUT || nal_unit_type == VPS_NUT ||
+         nal_unit_type == SPS_NUT || nal_unit_type == PPS_NUT ||
+         nal_unit_type == PREFIX_SEI_NUT ||
+         (nal_unit_type >= RSV_NVCL41 && nal_unit_type <= RSV_NVCL44) ||
+         (nal_unit_type >= AP && nal_unit_type <= UNSPEC55);
+}
+
+bool KeyLess(const H265TimeCodeIndex::Entry& entry, uint64_t key) {
+  return entry.key() < key;
+}
+
+bool KeyGreater(uint64_t key, const H265TimeCodeIndex::Entry& entry) {
+  return key < entry.key();
+}
+}  // namespace
+
+std::unique_ptr<H265TimeCodeIndex> H265TimeCodeIndex::Build(
+    const uint8_t* data, size_t length) noexcept {
+  auto index = std::make_unique<H265TimeCodeIndex>();
+
+  H265SeiMessageFilter filter;
+  filter.AddPayloadType(SeiType::time_code);
+  ParsingOptions parsing_options;
+
+  // access unit tracking
+  size_t au_offset = 0;
+  bool au_has_vcl = false;
+  size_t au_first_entry = 0;
+  size_t irap_offset = 0;
+  bool has_irap = false;
+  // last time code, used to infer the values not present in the SEI
+  Entry last;
+
+  auto nalu_indices = H265BitstreamParser::FindNaluIndices(data, length);
+  for (const auto& nalu_index : nalu_indices) {
+    const uint8_t* nalu = data + nalu_index.payload_start_offset;
+    size_t nalu_length = nalu_index.payload_size;
+    // nal_unit_header() plus the first slice segment byte
+    if (nalu_length < 2) {
+      continue;
+    }
+    uint32_t nal_unit_type = (nalu[0] >> 1) & 0x3f;
+    bool is_vcl = IsNalUnitTypeVcl(nal_unit_type);
+    // first_slice_segment_in_pic_flag  u(1)
+    bool first_slice_segment_in_pic =
+        is_vcl && nalu_length > 2 && (nalu[2] & 0x80);
+
+    if (au_has_vcl && (IsFirstNalUnitOfAccessUnit(nal_unit_type) ||
+                       first_slice_segment_in_pic)) {
+      // new access unit
+      au_offset = nalu_index.start_offset;
+      au_has_vcl = false;
+      au_first_entry = index->entries_.size();
+    }
+
+    if (is_vcl && !au_has_vcl) {
+      au_has_vcl = true;
+      if (nal_unit_type >= BLA_W_LP && nal_unit_type <= RSV_IRAP_VCL23) {
+        irap_offset = au_offset;
+        has_irap = true;
+      }
+      // the entries of this access unit were added before its first VCL
+      // NAL unit
+      for (size_t i = au_first_entry; i < index->entries_.size(); i++) {
+        index->entries_[i].irap_offset = irap_offset;
+        index->entries_[i].has_irap = has_irap;
+      }
+    }
+
+    if (nal_unit_type != PREFIX_SEI_NUT && nal_unit_type != SUFFIX_SEI_NUT) {
+      continue;
+    }
+    auto sei_rbsp = H265SeiRbspParser::ParseSeiRbsp(
+        nalu + 2, nalu_length - 2, parsing_options, &filter);
+    if (sei_rbsp == nullptr) {
+      continue;
+    }
+    for (const auto& sei_message : sei_rbsp->sei_message) {
+      if (sei_message->payload_type != SeiType::time_code ||
+          sei_message->payload_state == nullptr) {
+        continue;
+      }
+      const auto* time_code =
+          static_cast<const H265SeiTimeCodeParser::H265SeiTimeCodeState*>(
+              sei_message->payload_state.get());
+      // use the first clock timestamp of the picture
+      for (uint32_t i = 0; i < time_code->num_clock_ts; i++) {
+        if (!time_code->clock_timestamp_flag[i]) {
+          continue;
+        }
+        Entry entry;
+        bool full = time_code->full_timestamp_flag[i];
+        entry.n_frames = time_code->n_frames[i];
+        entry.seconds = (full || time_code->seconds_flag[i])
+                            ? time_code->seconds_value[i]
+                            : last.seconds;
+        entry.minutes = (full || time_code->minutes_flag[i])
+                            ? time_code->minutes_value[i]
+                            : last.minutes;
+        entry.hours = (full || time_code->hours_flag[i])
+                          ? time_code->hours_value[i]
+                          : last.hours;
+        entry.discontinuity_flag = time_code->discontinuity_flag[i];
+        entry.offset = au_offset;
+        // suffix SEIs follow the VCL NAL units of their access unit
+        entry.irap_offset = irap_offset;
+        entry.has_irap = au_has_vcl && has_irap;
+        index->entries_.push_back(entry);
+        last = entry;
+        break;
+      }
+    }
+  }
+
+  std::stable_sort(index->entries_.begin(), index->entries_.end(),
+                   [](const Entry& a, const Entry& b) {
+                     return a.key() < b.key();
+                   });
+  return index;
+}
+
+const H265TimeCodeIndex::Entry* H265TimeCodeIndex::Find(
+    uint32_t hours, uint32_t minutes, uint32_t seconds,
+    uint32_t n_frames) const noexcept {
+  uint64_t key = TimeCodeKey(hours, minutes, seconds, n_frames);
+  auto it = std::lower_bound(entries_.begin(), entries_.end(), key, KeyLess);
+  if (it == entries_.end() || it->key() != key) {
+    return nullptr;
+  }
+  return &(*it);
+}
+
+const H265TimeCodeIndex::Entry* H265TimeCodeIndex::FindFloor(
+    uint32_t hours, uint32_t minutes, uint32_t seconds,
+    uint32_t n_frames) const noexcept {
+  uint64_t key = TimeCodeKey(hours, minutes, seconds, n_frames);
+  auto it =
+      std::upper_bound(entries_.begin(), entries_.end(), key, KeyGreater);
+  if (it == entries_.begin()) {
+    return nullptr;
+  }
+  return &(*(it - 1));
+}
+
+}  // namespace h265nal
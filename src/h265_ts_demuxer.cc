@@ -0,0 +1,296 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_ts_demuxer.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace h265nal {
+
+// General note: this is based off the ISO/IEC 13818-1 (MPEG-2 systems)
+// standard.
+
+namespace {
+// Table 2-3 of ISO/IEC 13818-1: PID values
+const uint16_t kPatPid = 0x0000;
+const uint16_t kNullPid = 0x1fff;
+// Table 2-31 of ISO/IEC 13818-1: table_id values
+const uint8_t kPatTableId = 0x00;
+const uint8_t kPmtTableId = 0x02;
+// PES header bytes up to (and including) PES_header_data_length
+const size_t kPesHeaderSize = 9;
+
+// Section 2.4.3.7 of ISO/IEC 13818-1: a 33-bit PTS or DTS.
+uint64_t ReadTimestamp(const uint8_t* p) {
+  return (static_cast<uint64_t>((p[0] >> 1) & 0x07) << 30) | (p[1] << 22) |
+         ((p[2] >> 1) << 15) | (p[3] << 7) | (p[4] >> 1);
+}
+}  // namespace
+
+bool H265TsDemuxer::IsTs(const uint8_t* data, size_t length) noexcept {
+  return length >= 3 * kTsPacketSize && data[0] == kSyncByte &&
+         data[kTsPacketSize] == kSyncByte &&
+         data[2 * kTsPacketSize] == kSyncByte;
+}
+
+void H265TsDemuxer::ProcessData(const uint8_t* data, size_t length) noexcept {
+  size_t i = 0;
+  // complete a packet split across calls
+  if (partial_packet_size_ > 0) {
+    size_t size = std::min(kTsPacketSize - partial_packet_size_, length);
+    memcpy(partial_packet_ + partial_packet_size_, data, size);
+    partial_packet_size_ += size;
+    i += size;
+    if (partial_packet_size_ < kTsPacketSize) {
+      return;
+    }
+    // the packet buffer is reused: no views into it
+    ProcessPacket(partial_packet_, false);
+    partial_packet_size_ = 0;
+  }
+
+  while (i < length) {
+    if (data[i] != kSyncByte) {
+      // resync on the next sync byte
+      const uint8_t* next =
+          static_cast<const uint8_t*>(memchr(data + i, kSyncByte, length - i));
+      size_t skipped = (next == nullptr) ? (length - i) : (next - (data + i));
+      num_sync_losses_ += skipped;
+      i += skipped;
+      continue;
+    }
+    if (length - i < kTsPacketSize) {
+      memcpy(partial_packet_, data + i, length - i);
+      partial_packet_size_ = length - i;
+      break;
+    }
+    ProcessPacket(data + i, true);
+    i += kTsPacketSize;
+  }
+
+  // views are only valid during this call
+  for (auto& it : pes_states_) {
+    MaterializeView(&it.second);
+  }
+}
+
+void H265TsDemuxer::Flush() noexcept {
+  for (auto& it : pes_states_) {
+    if (it.second.started) {
+      EmitPes(&it.second);
+    }
+  }
+}
+
+std::vector<uint16_t> H265TsDemuxer::hevc_pids() const {
+  std::vector<uint16_t> pids;
+  for (const auto& it : pes_states_) {
+    pids.push_back(it.first);
+  }
+  return pids;
+}
+
+// Section 2.4.3.2 of ISO/IEC 13818-1: transport packet.
+void H265TsDemuxer::ProcessPacket(const uint8_t* packet,
+                                  bool allow_views) noexcept {
+  num_packets_++;
+  bool transport_error = (packet[1] & 0x80) != 0;
+  bool payload_unit_start = (packet[1] & 0x40) != 0;
+  uint16_t pid = ((packet[1] & 0x1f) << 8) | packet[2];
+  uint32_t adaptation_field_control = (packet[3] >> 4) & 0x03;
+  int continuity_counter = packet[3] & 0x0f;
+  if (transport_error || pid == kNullPid ||
+      !(adaptation_field_control & 0x01)) {
+    // no (reliable) payload
+    return;
+  }
+  size_t offset = 4;
+  if (adaptation_field_control & 0x02) {
+    // adaptation_field_length
+    offset += 1 + packet[4];
+    if (offset >= kTsPacketSize) {
+      return;
+    }
+  }
+  const uint8_t* payload = packet + offset;
+  size_t length = kTsPacketSize - offset;
+
+  if (pid == kPatPid) {
+    if (payload_unit_start) {
+      ProcessPat(payload, length);
+    }
+    return;
+  }
+  if (pmt_pids_.find(pid) != pmt_pids_.end()) {
+    if (payload_unit_start) {
+      ProcessPmt(payload, length);
+    }
+    return;
+  }
+  auto it = pes_states_.find(pid);
+  if (it == pes_states_.end()) {
+    return;
+  }
+  PesState* pes = &it->second;
+  // Section 2.4.3.3: continuity_counter (duplicate packets are ignored)
+  if (pes->continuity_counter >= 0) {
+    if (continuity_counter == pes->continuity_counter) {
+      return;
+    }
+    if (continuity_counter != ((pes->continuity_counter + 1) & 0x0f) &&
+        pes->started) {
+      // drop the PES packet being reassembled
+      num_continuity_errors_++;
+      pes->started = false;
+    }
+  }
+  pes->continuity_counter = continuity_counter;
+  ProcessPes(pes, payload, length, payload_unit_start, allow_views);
+}
+
+// Section 2.4.4.3 of ISO/IEC 13818-1: program association section.
+void H265TsDemuxer::ProcessPat(const uint8_t* payload,
+                               size_t length) noexcept {
+  // pointer_field
+  size_t offset = 1 + payload[0];
+  if (offset + 8 > length || payload[offset] != kPatTableId) {
+    return;
+  }
+  size_t section_length =
+      ((payload[offset + 1] & 0x0f) << 8) | payload[offset + 2];
+  // the program loop follows 5 bytes of section header, and is followed
+  // by the CRC_32
+  size_t end = std::min(offset + 3 + section_length, length);
+  if (end < 4) {
+    return;
+  }
+  end -= 4;
+  for (size_t i = offset + 8; i + 4 <= end; i += 4) {
+    uint16_t program_number = (payload[i] << 8) | payload[i + 1];
+    uint16_t pid = ((payload[i + 2] & 0x1f) << 8) | payload[i + 3];
+    if (program_number != 0) {
+      pmt_pids_[pid] = true;
+    }
+  }
+}
+
+// Section 2.4.4.8 of ISO/IEC 13818-1: transport stream program map section.
+void H265TsDemuxer::ProcessPmt(const uint8_t* payload,
+                               size_t length) noexcept {
+  // pointer_field
+  size_t offset = 1 + payload[0];
+  if (offset + 12 > length || payload[offset] != kPmtTableId) {
+    return;
+  }
+  size_t section_length =
+      ((payload[offset + 1] & 0x0f) << 8) | payload[offset + 2];
+  size_t end = std::min(offset + 3 + section_length, length);
+  if (end < 4) {
+    return;
+  }
+  end -= 4;
+  size_t program_info_length =
+      ((payload[offset + 10] & 0x0f) << 8) | payload[offset + 11];
+  for (size_t i = offset + 12 + program_info_length; i + 5 <= end;) {
+    uint8_t stream_type = payload[i];
+    uint16_t pid = ((payload[i + 1] & 0x1f) << 8) | payload[i + 2];
+    size_t es_info_length = ((payload[i + 3] & 0x0f) << 8) | payload[i + 4];
+    if (stream_type == kStreamTypeHevc &&
+        pes_states_.find(pid) == pes_states_.end()) {
+      pes_states_[pid].access_unit.pid = pid;
+    }
+    i += 5 + es_info_length;
+  }
+}
+
+// Section 2.4.3.6 of ISO/IEC 13818-1: PES packet.
+void H265TsDemuxer::ProcessPes(PesState* pes, const uint8_t* payload,
+                               size_t length, bool payload_unit_start,
+                               bool allow_views) noexcept {
+  if (payload_unit_start) {
+    if (pes->started) {
+      // an unbounded PES packet ends where the next one starts
+      EmitPes(pes);
+    }
+    if (length < kPesHeaderSize || payload[0] != 0x00 || payload[1] != 0x00 ||
+        payload[2] != 0x01) {
+      return;
+    }
+    pes->pes_packet_length = (payload[4] << 8) | payload[5];
+    size_t header_size = kPesHeaderSize + payload[8];
+    if (header_size > length) {
+      return;
+    }
+    uint32_t pts_dts_flags = (payload[7] >> 6) & 0x03;
+    AccessUnit& access_unit = pes->access_unit;
+    access_unit.has_pts = (pts_dts_flags & 0x02) != 0 && payload[8] >= 5;
+    access_unit.has_dts = pts_dts_flags == 0x03 && payload[8] >= 10;
+    access_unit.pts = access_unit.has_pts ? ReadTimestamp(payload + 9) : 0;
+    access_unit.dts =
+        access_unit.has_dts ? ReadTimestamp(payload + 14) : access_unit.pts;
+    pes->started = true;
+    pes->pes_received = length - 6;
+    pes->buffer.clear();
+    if (allow_views) {
+      pes->view = payload + header_size;
+      pes->view_length = length - header_size;
+    } else {
+      pes->buffer.assign(payload + header_size, payload + length);
+    }
+  } else {
+    if (!pes->started) {
+      // wait for the start of a PES packet
+      return;
+    }
+    MaterializeView(pes);
+    pes->buffer.insert(pes->buffer.end(), payload, payload + length);
+    pes->pes_received += length;
+  }
+
+  if (pes->pes_packet_length != 0 &&
+      pes->pes_received >= pes->pes_packet_length) {
+    // the PES packet is complete (drop any stuffing after it)
+    size_t extra = pes->pes_received - pes->pes_packet_length;
+    if (pes->view != nullptr) {
+      pes->view_length -= std::min(extra, pes->view_length);
+    } else {
+      pes->buffer.resize(pes->buffer.size() - std::min(extra,
+                                                       pes->buffer.size()));
+    }
+    EmitPes(pes);
+  }
+}
+
+void H265TsDemuxer::MaterializeView(PesState* pes) noexcept {
+  if (pes->view == nullptr) {
+    return;
+  }
+  pes->buffer.insert(pes->buffer.end(), pes->view,
+                     pes->view + pes->view_length);
+  pes->view = nullptr;
+  pes->view_length = 0;
+}
+
+void H265TsDemuxer::EmitPes(PesState* pes) noexcept {
+  AccessUnit& access_unit = pes->access_unit;
+  if (pes->view != nullptr) {
+    access_unit.data = pes->view;
+    access_unit.length = pes->view_length;
+  } else {
+    access_unit.data = pes->buffer.data();
+    access_unit.length = pes->buffer.size();
+  }
+  pes->started = false;
+  pes->view = nullptr;
+  pes->view_length = 0;
+  if (access_unit.length > 0 && callback_) {
+    callback_(access_unit);
+  }
+  pes->buffer.clear();
+}
+
+}  // namespace h265nal
@@ -13,6 +13,7 @@
 #include "h265_bitstream_parser.h"
 #include "h265_bitstream_parser_state.h"
 #include "h265_common.h"
+#include "h265_qp_telemetry.h"
 #ifdef RTP_DEFINE
 #include "h265_rtp_parser.h"
 #endif  // RTP_DEFINE
@@ -43,19 +44,14 @@ std::unique_ptr<int32_t> GetSliceQpYInternal(
   }
   auto& slice_header = payload->slice_segment_layer->slice_segment_header;
   auto pps_id = slice_header->slice_pic_parameter_set_id;
-  auto slice_qp_delta = slice_header->slice_qp_delta;
 
   // check the PPS exists in the bitstream parser state
   auto pps = bitstream_parser_state->GetPps(pps_id);
   if (pps == nullptr) {
     return nullptr;
   }
-  const auto init_qp_minus26 = pps->init_qp_minus26;
-
-  // Equation 7-54, Section 7.4.7.1
-  int32_t slice_qpy = 26 + init_qp_minus26 + slice_qp_delta;
-
-  return std::make_unique<int32_t>(slice_qpy);
+  return std::make_unique<int32_t>(
+      H265QpTelemetry::GetSliceQpY(*slice_header, *pps));
 }
 }  // namespace
 
@@ -98,20 +94,15 @@ std::vector<int32_t> H265Utils::GetSliceQpY(
     H265BitstreamParserState* bitstream_parser_state) noexcept {
   std::vector<int32_t> slice_qp_y_vector;
 
-  // parse the incoming bitstream
-  ParsingOptions parsing_options;
-  parsing_options.add_checksum = false;
-  auto bitstream_state = h265nal::H265BitstreamParser::ParseBitstream(
-      data, length, bitstream_parser_state, parsing_options);
-  // get all possible QP values
-  for (auto& nal_unit : bitstream_state->nal_units) {
-    uint32_t nal_unit_type = nal_unit->nal_unit_header->nal_unit_type;
-    auto& payload = nal_unit->nal_unit_payload;
-    // get the slice QP_Y value
-    auto slice_qp_y_value =
-        GetSliceQpYInternal(nal_unit_type, payload, bitstream_parser_state);
-    if (slice_qp_y_value != nullptr) {
-      slice_qp_y_vector.push_back(*slice_qp_y_value);
+  // only parse the slice segment headers up to their QP values
+  // (without the QP aggregation of H265QpTelemetry)
+  H265QpTelemetry::SliceQpParser slice_qp_parser(bitstream_parser_state);
+  auto nalu_indices = H265BitstreamParser::FindNaluIndices(data, length);
+  for (const auto& nalu_index : nalu_indices) {
+    H265QpTelemetry::SliceQp slice_qp;
+    if (slice_qp_parser.ParseNalUnit(data + nalu_index.payload_start_offset,
+                                     nalu_index.payload_size, &slice_qp)) {
+      slice_qp_y_vector.push_back(slice_qp.qp_y);
     }
   }
   return slice_qp_y_vector;
@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_error_reporter.h"
 #include "h265_hrd_parameters_parser.h"
 
 namespace h265nal {
@@ -112,10 +113,8 @@ std::shared_ptr<H265VpsParser::VpsState> H265VpsParser::ParseVps(
     return nullptr;
   }
   if (vps->vps_max_layer_id > h265limits::VPS_MAX_LAYER_ID_MAX) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: vps->vps_max_layer_id value too large: %i\n",
-            vps->vps_max_layer_id);
-#endif  // FPRINT_ERRORS
+    ReportParseError(ParseErrorCode::kOutOfRange, "vps_max_layer_id",
+                     vps->vps_max_layer_id, bit_buffer);
     return nullptr;
   }
 
@@ -125,24 +124,15 @@ std::shared_ptr<H265VpsParser::VpsState> H265VpsParser::ParseVps(
   }
   if (vps->vps_num_layer_sets_minus1 < kVpsNumLayerSetsMinus1Min ||
       vps->vps_num_layer_sets_minus1 > kVpsNumLayerSetsMinus1Max) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "invalid vps_num_layer_sets_minus1: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
-            vps->vps_num_layer_sets_minus1, kVpsNumLayerSetsMinus1Min,
-            kVpsNumLayerSetsMinus1Max);
-#endif  // FPRINT_ERRORS
+    ReportParseError(ParseErrorCode::kOutOfRange, "vps_num_layer_sets_minus1",
+                     vps->vps_num_layer_sets_minus1, bit_buffer);
     return nullptr;
   }
 
   if (vps->vps_num_layer_sets_minus1 >
       h265limits::VPS_NUM_LAYER_SETS_MINUS1_MAX) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "error: vps->vps_num_layer_sets_minus1 value too large: %i\n",
-            vps->vps_num_layer_sets_minus1);
-#endif  // FPRINT_ERRORS
+    ReportParseError(ParseErrorCode::kOutOfRange, "vps_num_layer_sets_minus1",
+                     vps->vps_num_layer_sets_minus1, bit_buffer);
     return nullptr;
   }
 
@@ -188,15 +178,9 @@ std::shared_ptr<H265VpsParser::VpsState> H265VpsParser::ParseVps(
               kVpsNumTicksPocDiffOneMinus1Min ||
           vps->vps_num_ticks_poc_diff_one_minus1 >
               kVpsNumTicksPocDiffOneMinus1Max) {
-#ifdef FPRINT_ERRORS
-        fprintf(stderr,
-                "invalid vps_num_ticks_poc_diff_one_minus1: %" PRIu32
-                " not in range "
-                "[%" PRIu32 ", %" PRIu32 "]\n",
-                vps->vps_num_ticks_poc_diff_one_minus1,
-                kVpsNumTicksPocDiffOneMinus1Min,
-                kVpsNumTicksPocDiffOneMinus1Max);
-#endif  // FPRINT_ERRORS
+        ReportParseError(ParseErrorCode::kOutOfRange,
+                         "vps_num_ticks_poc_diff_one_minus1",
+                         vps->vps_num_ticks_poc_diff_one_minus1, bit_buffer);
         return nullptr;
       }
     }
@@ -206,14 +190,8 @@ std::shared_ptr<H265VpsParser::VpsState> H265VpsParser::ParseVps(
     }
     if (vps->vps_num_hrd_parameters < kVpsNumHdrParameterMin ||
         vps->vps_num_hrd_parameters > vps->vps_num_layer_sets_minus1 + 1) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid vps_num_hrd_parameters: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vps->vps_num_hrd_parameters, kVpsNumHdrParameterMin,
-              vps->vps_num_layer_sets_minus1 + 1);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange, "vps_num_hrd_parameters",
+                       vps->vps_num_hrd_parameters, bit_buffer);
       return nullptr;
     }
 
@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_error_reporter.h"
 #include "h265_hrd_parameters_parser.h"
 
 namespace h265nal {
@@ -124,14 +125,9 @@ H265VuiParametersParser::ParseVuiParameters(
             kChromaSampleLocTypeTopFieldMin ||
         vui->chroma_sample_loc_type_top_field >
             kChromaSampleLocTypeTopFieldMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid chroma_sample_loc_type_top_field: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->chroma_sample_loc_type_top_field,
-              kChromaSampleLocTypeTopFieldMin, kChromaSampleLocTypeTopFieldMax);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange,
+                       "chroma_sample_loc_type_top_field",
+                       vui->chroma_sample_loc_type_top_field, bit_buffer);
       return nullptr;
     }
 
@@ -144,15 +140,9 @@ H265VuiParametersParser::ParseVuiParameters(
             kChromaSampleLocTypeBottomFieldMin ||
         vui->chroma_sample_loc_type_bottom_field >
             kChromaSampleLocTypeBottomFieldMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid chroma_sample_loc_type_bottom_field: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->chroma_sample_loc_type_bottom_field,
-              kChromaSampleLocTypeBottomFieldMin,
-              kChromaSampleLocTypeBottomFieldMax);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange,
+                       "chroma_sample_loc_type_bottom_field",
+                       vui->chroma_sample_loc_type_bottom_field, bit_buffer);
       return nullptr;
     }
   }
@@ -183,14 +173,8 @@ H265VuiParametersParser::ParseVuiParameters(
     }
     if (vui->def_disp_win_left_offset < kDefDispWinLeftOffsetMin ||
         vui->def_disp_win_left_offset > kDefDispWinLeftOffsetMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid def_disp_win_left_offset: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->def_disp_win_left_offset, kDefDispWinLeftOffsetMin,
-              kDefDispWinLeftOffsetMax);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange, "def_disp_win_left_offset",
+                       vui->def_disp_win_left_offset, bit_buffer);
       return nullptr;
     }
 
@@ -200,14 +184,8 @@ H265VuiParametersParser::ParseVuiParameters(
     }
     if (vui->def_disp_win_right_offset < kDefDispWinRightOffsetMin ||
         vui->def_disp_win_right_offset > kDefDispWinRightOffsetMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid def_disp_win_right_offset: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->def_disp_win_right_offset, kDefDispWinRightOffsetMin,
-              kDefDispWinRightOffsetMax);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange, "def_disp_win_right_offset",
+                       vui->def_disp_win_right_offset, bit_buffer);
       return nullptr;
     }
 
@@ -217,14 +195,8 @@ H265VuiParametersParser::ParseVuiParameters(
     }
     if (vui->def_disp_win_top_offset < kDefDispWinTopOffsetMin ||
         vui->def_disp_win_top_offset > kDefDispWinTopOffsetMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid def_disp_win_top_offset: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->def_disp_win_top_offset, kDefDispWinTopOffsetMin,
-              kDefDispWinTopOffsetMax);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange, "def_disp_win_top_offset",
+                       vui->def_disp_win_top_offset, bit_buffer);
       return nullptr;
     }
 
@@ -234,14 +206,9 @@ H265VuiParametersParser::ParseVuiParameters(
     }
     if (vui->def_disp_win_bottom_offset < kDefDispWinBottomOffsetMin ||
         vui->def_disp_win_bottom_offset > kDefDispWinBottomOffsetMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid def_disp_win_bottom_offset: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->def_disp_win_bottom_offset, kDefDispWinBottomOffsetMin,
-              kDefDispWinBottomOffsetMax);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange,
+                       "def_disp_win_bottom_offset",
+                       vui->def_disp_win_bottom_offset, bit_buffer);
       return nullptr;
     }
   }
@@ -273,15 +240,9 @@ H265VuiParametersParser::ParseVuiParameters(
               kVuiNumTicksPocDiffOneMinus1Min ||
           vui->vui_num_ticks_poc_diff_one_minus1 >
               kVuiNumTicksPocDiffOneMinus1Max) {
-#ifdef FPRINT_ERRORS
-        fprintf(stderr,
-                "invalid vui_num_ticks_poc_diff_one_minus1: %" PRIu32
-                " not in range "
-                "[%" PRIu32 ", %" PRIu32 "]\n",
-                vui->vui_num_ticks_poc_diff_one_minus1,
-                kVuiNumTicksPocDiffOneMinus1Min,
-                kVuiNumTicksPocDiffOneMinus1Max);
-#endif  // FPRINT_ERRORS
+        ReportParseError(ParseErrorCode::kOutOfRange,
+                         "vui_num_ticks_poc_diff_one_minus1",
+                         vui->vui_num_ticks_poc_diff_one_minus1, bit_buffer);
         return nullptr;
       }
     }
@@ -323,14 +284,9 @@ H265VuiParametersParser::ParseVuiParameters(
     }
     if (vui->min_spatial_segmentation_idc < kMinSpatialSegmentationIdcMin ||
         vui->min_spatial_segmentation_idc > kMinSpatialSegmentationIdcMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid min_spatial_segmentation_idc: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->min_spatial_segmentation_idc, kMinSpatialSegmentationIdcMin,
-              kMinSpatialSegmentationIdcMax);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange,
+                       "min_spatial_segmentation_idc",
+                       vui->min_spatial_segmentation_idc, bit_buffer);
       return nullptr;
     }
     // max_bytes_per_pic_denom  ue(v)
@@ -339,14 +295,8 @@ H265VuiParametersParser::ParseVuiParameters(
     }
     if (vui->max_bytes_per_pic_denom < kMaxBytesPerPicDenomMin ||
         vui->max_bytes_per_pic_denom > kMaxBytesPerPicDenomMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid max_bytes_per_pic_denom: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->max_bytes_per_pic_denom, kMaxBytesPerPicDenomMin,
-              kMaxBytesPerPicDenomMax);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange, "max_bytes_per_pic_denom",
+                       vui->max_bytes_per_pic_denom, bit_buffer);
       return nullptr;
     }
     // max_bits_per_min_cu_denom  ue(v)
@@ -355,14 +305,8 @@ H265VuiParametersParser::ParseVuiParameters(
     }
     if (vui->max_bits_per_min_cu_denom < kMaxBitsPerMinCuDenomMin ||
         vui->max_bits_per_min_cu_denom > kMaxBitsPerMinCuDenomMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid max_bits_per_min_cu_denom: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->max_bits_per_min_cu_denom, kMaxBitsPerMinCuDenomMin,
-              kMaxBitsPerMinCuDenomMax);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange, "max_bits_per_min_cu_denom",
+                       vui->max_bits_per_min_cu_denom, bit_buffer);
       return nullptr;
     }
     // log2_max_mv_length_horizontal  ue(v)
@@ -372,14 +316,9 @@ H265VuiParametersParser::ParseVuiParameters(
     }
     if (vui->log2_max_mv_length_horizontal < kLog2MaxMvLengthHorizontalMin ||
         vui->log2_max_mv_length_horizontal > kLog2MaxMvLengthHorizontalMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid log2_max_mv_length_horizontal: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->log2_max_mv_length_horizontal, kLog2MaxMvLengthHorizontalMin,
-              kLog2MaxMvLengthHorizontalMax);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange,
+                       "log2_max_mv_length_horizontal",
+                       vui->log2_max_mv_length_horizontal, bit_buffer);
       return nullptr;
     }
     // log2_max_mv_length_vertical  ue(v)
@@ -388,14 +327,9 @@ H265VuiParametersParser::ParseVuiParameters(
     }
     if (vui->log2_max_mv_length_vertical < kLog2MaxMvLengthVerticalMin ||
         vui->log2_max_mv_length_vertical > kLog2MaxMvLengthVerticalMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid log2_max_mv_length_vertical: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->log2_max_mv_length_vertical, kLog2MaxMvLengthVerticalMin,
-              kLog2MaxMvLengthVerticalMax);
-#endif  // FPRINT_ERRORS
+      ReportParseError(ParseErrorCode::kOutOfRange,
+                       "log2_max_mv_length_vertical",
+                       vui->log2_max_mv_length_vertical, bit_buffer);
       return nullptr;
     }
   }
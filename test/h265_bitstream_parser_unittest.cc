@@ -7,6 +7,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "h265_bitstream_parser_state.h"
 #include "h265_common.h"
 #include "h265_utils.h"
@@ -440,4 +442,226 @@ TEST_F(H265BitstreamParserTest, TestMultipleBuffersGetSliceQpY) {
   EXPECT_EQ(42, slice_qp_y_vector[0]);
 }
 
+TEST_F(H265BitstreamParserTest, TestResilientCorruptSlice) {
+  // VPS, SPS, PPS, IDR, a truncated P-frame, 2 P-frames, and VPS, SPS, PPS,
+  // IDR again
+  const uint8_t truncated_slice[] = {0x00, 0x00, 0x00, 0x01,
+                                     0x02, 0x01, 0xd0};
+  std::vector<uint8_t> stream(buffer0, buffer0 + arraysize(buffer0));
+  stream.insert(stream.end(), truncated_slice,
+                truncated_slice + arraysize(truncated_slice));
+  stream.insert(stream.end(), buffer1, buffer1 + arraysize(buffer1));
+  stream.insert(stream.end(), buffer2, buffer2 + arraysize(buffer2));
+  stream.insert(stream.end(), buffer0, buffer0 + arraysize(buffer0));
+
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  parsing_options.resilient = true;
+  auto bitstream = H265BitstreamParser::ParseBitstream(
+      stream.data(), stream.size(), &bitstream_parser_state, parsing_options);
+  ASSERT_TRUE(bitstream != nullptr);
+  ASSERT_EQ(11, bitstream->nal_units.size());
+
+  const H265StreamHealth& health = bitstream_parser_state.health;
+  EXPECT_EQ(11, health.num_nal_units);
+  EXPECT_EQ(1, health.num_failed_nal_units);
+  EXPECT_EQ(1, health.num_failed_slices);
+  EXPECT_EQ(0, health.num_failed_parameter_sets);
+  // the P-frames after the corrupt one depend on it
+  EXPECT_EQ(2, health.num_affected_slices);
+  // the IDR resyncs the stream
+  EXPECT_EQ(1, health.num_resyncs);
+  EXPECT_FALSE(health.resync_pending);
+  EXPECT_EQ(arraysize(buffer0) + 4, health.last_failure_offset);
+
+  EXPECT_FALSE(bitstream->nal_units[3]->affected);
+  EXPECT_TRUE(bitstream->nal_units[4]->affected);
+  EXPECT_TRUE(bitstream->nal_units[5]->affected);
+  EXPECT_TRUE(bitstream->nal_units[6]->affected);
+  EXPECT_FALSE(bitstream->nal_units[10]->affected);
+}
+
+TEST_F(H265BitstreamParserTest, TestResilientParameterSetFallback) {
+  // a PPS that replaces PPS 0, but refers to a missing SPS
+  const uint8_t bad_pps[] = {0x00, 0x00, 0x00, 0x01, 0x44, 0x01,
+                             0xa0, 0x3c, 0xf0, 0x00, 0x84};
+  std::vector<uint8_t> stream(buffer0, buffer0 + arraysize(buffer0));
+  stream.insert(stream.end(), bad_pps, bad_pps + arraysize(bad_pps));
+  stream.insert(stream.end(), buffer1, buffer1 + arraysize(buffer1));
+
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  parsing_options.resilient = true;
+  auto bitstream = H265BitstreamParser::ParseBitstream(
+      stream.data(), stream.size(), &bitstream_parser_state, parsing_options);
+  ASSERT_TRUE(bitstream != nullptr);
+  ASSERT_EQ(6, bitstream->nal_units.size());
+
+  // the P-frame is parsed using the last-known-good PPS
+  const H265StreamHealth& health = bitstream_parser_state.health;
+  EXPECT_EQ(1, health.num_parameter_set_fallbacks);
+  EXPECT_EQ(0, health.num_failed_nal_units);
+  EXPECT_FALSE(bitstream->nal_units[5]->affected);
+  EXPECT_EQ(0, bitstream_parser_state.pps[0]->pps_seq_parameter_set_id);
+  EXPECT_TRUE(bitstream_parser_state.last_good_pps.empty());
+}
+
+TEST_F(H265BitstreamParserTest, TestResilientParameterSetChange) {
+  // a valid PPS that replaces PPS 0 (entropy_coding_sync_enabled_flag: 1),
+  // a corrupt P-frame that only parses with the previous PPS, and a P-frame
+  const uint8_t new_pps[] = {0x00, 0x00, 0x00, 0x01, 0x44, 0x01,
+                             0xc0, 0xf3, 0xc1, 0x02, 0x10};
+  const uint8_t corrupt_slice[] = {0x00, 0x00, 0x00, 0x01, 0x02,
+                                   0x01, 0xd0, 0x0f, 0xe4, 0x16};
+  std::vector<uint8_t> stream(buffer0, buffer0 + arraysize(buffer0));
+  stream.insert(stream.end(), new_pps, new_pps + arraysize(new_pps));
+  stream.insert(stream.end(), corrupt_slice,
+                corrupt_slice + arraysize(corrupt_slice));
+  stream.insert(stream.end(), buffer1, buffer1 + arraysize(buffer1));
+
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  parsing_options.resilient = true;
+  auto bitstream = H265BitstreamParser::ParseBitstream(
+      stream.data(), stream.size(), &bitstream_parser_state, parsing_options);
+  ASSERT_TRUE(bitstream != nullptr);
+  ASSERT_EQ(7, bitstream->nal_units.size());
+
+  // the corrupt P-frame is parsed using the last-known-good PPS, but the
+  // new PPS stays the current one
+  const H265StreamHealth& health = bitstream_parser_state.health;
+  EXPECT_EQ(1, health.num_parameter_set_fallbacks);
+  EXPECT_EQ(0, health.num_failed_nal_units);
+  EXPECT_FALSE(bitstream->nal_units[5]->affected);
+  EXPECT_FALSE(bitstream->nal_units[6]->affected);
+  EXPECT_EQ(1, bitstream_parser_state.pps[0]->entropy_coding_sync_enabled_flag);
+  EXPECT_EQ(1, bitstream_parser_state.last_good_pps.size());
+}
+
+TEST_F(H265BitstreamParserTest, TestResilientNalUnitSizeCap) {
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  parsing_options.resilient = true;
+  parsing_options.resilient_max_nal_unit_size = 32;
+  auto bitstream = H265BitstreamParser::ParseBitstream(
+      buffer0, arraysize(buffer0), &bitstream_parser_state, parsing_options);
+  ASSERT_TRUE(bitstream != nullptr);
+  ASSERT_EQ(4, bitstream->nal_units.size());
+
+  // the (larger) SPS is parsed in full
+  ASSERT_TRUE(bitstream->nal_units[1]->nal_unit_payload->sps != nullptr);
+
+  // the IDR slice is truncated to its first 32 bytes, which still contain
+  // the slice header
+  const H265StreamHealth& health = bitstream_parser_state.health;
+  EXPECT_EQ(1, health.num_capped_nal_units);
+  EXPECT_EQ(0, health.num_failed_nal_units);
+  EXPECT_EQ(NalUnitType::IDR_W_RADL,
+            bitstream->nal_units[3]->nal_unit_header->nal_unit_type);
+}
+
+TEST_F(H265BitstreamParserTest, TestCheckpointRestore) {
+  // parse the parameter sets and the IDR slice
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  auto bitstream = H265BitstreamParser::ParseBitstream(
+      buffer0, arraysize(buffer0), &bitstream_parser_state, parsing_options);
+  ASSERT_TRUE(bitstream != nullptr);
+
+  std::vector<uint8_t> checkpoint;
+  ASSERT_TRUE(bitstream_parser_state.Checkpoint(&checkpoint));
+  // header, and the VPS, SPS, and PPS RBSPs (with their sizes)
+  EXPECT_EQ(8 + 3 * 4 + bitstream_parser_state.GetVps(0)->rbsp.size() +
+                bitstream_parser_state.GetSps(0)->rbsp.size() +
+                bitstream_parser_state.GetPps(0)->rbsp.size(),
+            checkpoint.size());
+
+  // restore it elsewhere
+  H265BitstreamParserState restored_state;
+  ASSERT_TRUE(restored_state.Restore(checkpoint.data(), checkpoint.size()));
+  ASSERT_EQ(1, restored_state.vps.size());
+  ASSERT_EQ(1, restored_state.sps.size());
+  ASSERT_EQ(1, restored_state.pps.size());
+  auto sps = bitstream_parser_state.GetSps(0);
+  auto restored_sps = restored_state.GetSps(0);
+  ASSERT_NE(nullptr, restored_sps);
+  EXPECT_EQ(sps->rbsp, restored_sps->rbsp);
+  EXPECT_EQ(sps->pic_width_in_luma_samples,
+            restored_sps->pic_width_in_luma_samples);
+  EXPECT_EQ(sps->pic_height_in_luma_samples,
+            restored_sps->pic_height_in_luma_samples);
+  EXPECT_EQ(sps->log2_max_pic_order_cnt_lsb_minus4,
+            restored_sps->log2_max_pic_order_cnt_lsb_minus4);
+  EXPECT_EQ(sps->num_short_term_ref_pic_sets,
+            restored_sps->num_short_term_ref_pic_sets);
+  EXPECT_EQ(bitstream_parser_state.GetPps(0)->init_qp_minus26,
+            restored_state.GetPps(0)->init_qp_minus26);
+  EXPECT_EQ(bitstream_parser_state.active_sps != nullptr,
+            restored_state.active_sps != nullptr);
+
+  // the following slices parse the same way from both states
+  for (const auto& buffer : {std::vector<uint8_t>(buffer1, buffer1 +
+                                                   arraysize(buffer1)),
+                             std::vector<uint8_t>(buffer2, buffer2 +
+                                                   arraysize(buffer2))}) {
+    auto original = H265BitstreamParser::ParseBitstream(
+        buffer.data(), buffer.size(), &bitstream_parser_state,
+        parsing_options);
+    auto from_checkpoint = H265BitstreamParser::ParseBitstream(
+        buffer.data(), buffer.size(), &restored_state, parsing_options);
+    ASSERT_TRUE(original != nullptr);
+    ASSERT_TRUE(from_checkpoint != nullptr);
+    ASSERT_EQ(1, from_checkpoint->nal_units.size());
+    const auto& header = original->nal_units[0]
+                             ->nal_unit_payload->slice_segment_layer
+                             ->slice_segment_header;
+    const auto& restored_header = from_checkpoint->nal_units[0]
+                                      ->nal_unit_payload->slice_segment_layer
+                                      ->slice_segment_header;
+    ASSERT_NE(nullptr, restored_header);
+    EXPECT_EQ(header->slice_type, restored_header->slice_type);
+    EXPECT_EQ(header->slice_pic_order_cnt_lsb,
+              restored_header->slice_pic_order_cnt_lsb);
+    EXPECT_EQ(header->slice_qp_delta, restored_header->slice_qp_delta);
+    EXPECT_EQ(header->num_entry_point_offsets,
+              restored_header->num_entry_point_offsets);
+  }
+}
+
+TEST_F(H265BitstreamParserTest, TestRestoreInvalidCheckpoint) {
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  auto bitstream = H265BitstreamParser::ParseBitstream(
+      buffer0, arraysize(buffer0), &bitstream_parser_state, parsing_options);
+  ASSERT_TRUE(bitstream != nullptr);
+  std::vector<uint8_t> checkpoint;
+  ASSERT_TRUE(bitstream_parser_state.Checkpoint(&checkpoint));
+
+  // a truncated checkpoint leaves the state untouched
+  H265BitstreamParserState restored_state;
+  ASSERT_TRUE(restored_state.Restore(checkpoint.data(), checkpoint.size()));
+  EXPECT_FALSE(restored_state.Restore(checkpoint.data(),
+                                      checkpoint.size() - 10));
+  EXPECT_EQ(1, restored_state.sps.size());
+  // bad magic
+  checkpoint[0] = 'x';
+  EXPECT_FALSE(restored_state.Restore(checkpoint.data(), checkpoint.size()));
+
+  // parameter sets without an RBSP cannot be checkpointed
+  H265BitstreamParserState manual_state;
+  manual_state.sps[0] = std::make_shared<H265SpsParser::SpsState>();
+  EXPECT_FALSE(manual_state.Checkpoint(&checkpoint));
+
+  // empty map entries are skipped
+  std::vector<uint8_t> expected_checkpoint;
+  ASSERT_TRUE(bitstream_parser_state.Checkpoint(&expected_checkpoint));
+  bitstream_parser_state.vps[1] = nullptr;
+  bitstream_parser_state.sps[1] = nullptr;
+  bitstream_parser_state.pps[1] = nullptr;
+  ASSERT_TRUE(bitstream_parser_state.Checkpoint(&checkpoint));
+  EXPECT_EQ(expected_checkpoint, checkpoint);
+  ASSERT_TRUE(restored_state.Restore(checkpoint.data(), checkpoint.size()));
+  EXPECT_EQ(1, restored_state.sps.size());
+}
+
 }  // namespace h265nal
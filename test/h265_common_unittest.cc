@@ -45,6 +45,32 @@ TEST_F(H265CommonTest, TestIsNalUnitTypeUnspecified) {
   EXPECT_FALSE(IsNalUnitTypeUnspecified(RSV_NVCL47));
 }
 
+TEST_F(H265CommonTest, TestCeilLog2) {
+  EXPECT_EQ(0, ceil_log2(0));
+  EXPECT_EQ(0, ceil_log2(1));
+  EXPECT_EQ(1, ceil_log2(2));
+  EXPECT_EQ(2, ceil_log2(3));
+  EXPECT_EQ(2, ceil_log2(4));
+  EXPECT_EQ(10, ceil_log2(920));
+  EXPECT_EQ(24, ceil_log2((1 << 24) - 1));
+  EXPECT_EQ(32, ceil_log2(0xffffffff));
+}
+
+TEST_F(H265CommonTest, TestEscapeRbsp) {
+  const uint8_t rbsp[] = {0x40, 0x00, 0x00, 0x01, 0x00, 0x00,
+                          0x00, 0x00, 0x00, 0x04, 0x00, 0x00};
+  std::vector<uint8_t> escaped = {0xaa};
+  EscapeRbsp(rbsp, arraysize(rbsp), &escaped);
+  EXPECT_THAT(escaped,
+              ::testing::ElementsAreArray({0xaa, 0x40, 0x00, 0x00, 0x03, 0x01,
+                                           0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+                                           0x00, 0x04, 0x00, 0x00, 0x03}));
+  // round trip
+  std::vector<uint8_t> unescaped =
+      UnescapeRbsp(escaped.data() + 1, escaped.size() - 1);
+  EXPECT_THAT(unescaped, ::testing::ElementsAreArray(rbsp));
+}
+
 struct H265CommonMoreRbspDataParameterTestData {
   std::string description;
   std::vector<uint8_t> buffer;
@@ -0,0 +1,116 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_error_reporter.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+#include "rtc_base/arraysize.h"
+
+namespace h265nal {
+
+class H265ErrorReporterTest : public ::testing::Test {
+ public:
+  H265ErrorReporterTest() {}
+  ~H265ErrorReporterTest() override {}
+};
+
+TEST_F(H265ErrorReporterTest, TestMissingParameterSet) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+    // slice (IDR), without its VPS/SPS/PPS
+    0x26, 0x01, 0xaf, 0x09, 0x40, 0xfb, 0x27, 0x5b,
+    0xfd, 0x5d, 0xc2, 0x4d, 0xe8, 0xb2, 0x0f, 0xcd
+  };
+  // fuzzer::conv: begin
+  H265BitstreamParserState bitstream_parser_state;
+  H265ErrorReporter error_reporter;
+  bitstream_parser_state.error_reporter = &error_reporter;
+  auto nal_unit = H265NalUnitParser::ParseNalUnit(buffer, arraysize(buffer),
+                                                  &bitstream_parser_state);
+  // fuzzer::conv: end
+
+  EXPECT_TRUE(nal_unit != nullptr);
+  EXPECT_EQ(error_reporter.num_nal_units(), 1);
+  ASSERT_EQ(error_reporter.num_errors(), 1);
+  EXPECT_EQ(error_reporter.num_errors(ParseErrorCode::kMissingParameterSet),
+            1);
+  const auto& error = error_reporter.errors().Get(0);
+  EXPECT_EQ(error.code, ParseErrorCode::kMissingParameterSet);
+  EXPECT_STREQ(error.syntax_element, "slice_pic_parameter_set_id");
+  EXPECT_EQ(error.value, 0);
+  EXPECT_EQ(error.nal_unit_type, IDR_W_RADL);
+  EXPECT_EQ(error.nal_unit_index, 0);
+  // NAL unit header (16 bits), first_slice_segment_in_pic_flag,
+  // no_output_of_prior_pics_flag, and slice_pic_parameter_set_id (1 bit)
+  EXPECT_EQ(error.bit_offset, 19);
+}
+
+TEST_F(H265ErrorReporterTest, TestTruncatedNalUnit) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+    // VPS (truncated)
+    0x40, 0x01, 0x0c, 0x01, 0xff, 0xff
+  };
+  // fuzzer::conv: begin
+  H265BitstreamParserState bitstream_parser_state;
+  H265ErrorReporter error_reporter;
+  bitstream_parser_state.error_reporter = &error_reporter;
+  auto nal_unit = H265NalUnitParser::ParseNalUnit(buffer, arraysize(buffer),
+                                                  &bitstream_parser_state);
+  // fuzzer::conv: end
+
+  EXPECT_TRUE(nal_unit != nullptr);
+  ASSERT_EQ(error_reporter.num_errors(), 1);
+  const auto& error = error_reporter.errors().Get(0);
+  EXPECT_EQ(error.code, ParseErrorCode::kTruncated);
+  EXPECT_STREQ(error.syntax_element, "video_parameter_set_rbsp");
+  EXPECT_EQ(error.nal_unit_type, VPS_NUT);
+  // no reporter is active outside of the NAL unit parsing
+  EXPECT_EQ(H265ErrorReporter::active(), nullptr);
+}
+
+TEST_F(H265ErrorReporterTest, TestRateLimitedCallback) {
+  H265ErrorReporter error_reporter;
+  std::vector<ParseError> callback_errors;
+  error_reporter.SetCallback(
+      [&callback_errors](const ParseError& error) {
+        callback_errors.push_back(error);
+      },
+      2);
+  {
+    H265ErrorReporter::Scope error_scope(&error_reporter, SPS_NUT);
+    EXPECT_EQ(H265ErrorReporter::active(), &error_reporter);
+    for (int i = 0; i < 5; i++) {
+      ReportParseError(ParseErrorCode::kOutOfRange, "chroma_format_idc", i,
+                       nullptr);
+    }
+    EXPECT_EQ(error_scope.num_errors(), 5);
+  }
+  // all errors are recorded, but only the first 2 reach the callback
+  EXPECT_EQ(error_reporter.num_errors(), 5);
+  EXPECT_EQ(error_reporter.errors().size(), 5);
+  EXPECT_EQ(error_reporter.errors().Get(0).value, 4);
+  EXPECT_EQ(error_reporter.errors().Get(0).nal_unit_type, SPS_NUT);
+  ASSERT_EQ(callback_errors.size(), 2);
+  EXPECT_EQ(callback_errors[1].value, 1);
+  EXPECT_EQ(error_reporter.num_suppressed_callbacks(), 3);
+
+  // errors reported without an active reporter are dropped
+  ReportParseError(ParseErrorCode::kOutOfRange, "chroma_format_idc", 0,
+                   nullptr);
+  EXPECT_EQ(error_reporter.num_errors(), 5);
+
+  error_reporter.Clear();
+  EXPECT_EQ(error_reporter.num_errors(), 0);
+  EXPECT_EQ(error_reporter.errors().size(), 0);
+}
+
+}  // namespace h265nal
@@ -0,0 +1,173 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_filter.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "h265_nal_unit_header_parser.h"
+#include "rtc_base/arraysize.h"
+
+namespace h265nal {
+
+class H265FilterTest : public ::testing::Test {
+ public:
+  H265FilterTest() {}
+  ~H265FilterTest() override {}
+};
+
+TEST_F(H265FilterTest, TestCompileErrors) {
+  std::string error;
+  EXPECT_TRUE(H265Filter::Compile("nal_unit_type==CRA_NUT", &error) !=
+              nullptr);
+  EXPECT_TRUE(H265Filter::Compile("foo==1", &error) == nullptr);
+  EXPECT_EQ(error, "unknown field or constant \"foo\" at position 0");
+  EXPECT_TRUE(H265Filter::Compile("(nal_unit_type==1", &error) == nullptr);
+  EXPECT_EQ(error, "missing ')' at position 17");
+  EXPECT_TRUE(H265Filter::Compile("slice_qp_delta>", &error) == nullptr);
+  EXPECT_TRUE(H265Filter::Compile("nuh_layer_id 1", &error) == nullptr);
+  EXPECT_EQ(error, "unexpected input at position 13");
+}
+
+TEST_F(H265FilterTest, TestEvaluateHeader) {
+  H265NalUnitHeaderParser::NalUnitHeaderState header;
+  header.nal_unit_type = CRA_NUT;
+  header.nuh_temporal_id_plus1 = 1;
+
+  auto filter = H265Filter::Compile(
+      "nal_unit_type==CRA_NUT || slice_qp_delta>10", nullptr);
+  ASSERT_TRUE(filter != nullptr);
+  EXPECT_EQ(filter->sources(),
+            H265Filter::kSourceHeader | H265Filter::kSourceSliceHeader);
+  EXPECT_EQ(filter->EvaluateHeader(header), H265Filter::Match::kTrue);
+  // the result depends on the slice header
+  header.nal_unit_type = TRAIL_R;
+  EXPECT_EQ(filter->EvaluateHeader(header), H265Filter::Match::kUnknown);
+
+  filter = H265Filter::Compile(
+      "nal_unit_type < 32 && slice_qp_delta > 10", nullptr);
+  ASSERT_TRUE(filter != nullptr);
+  header.nal_unit_type = SPS_NUT;
+  EXPECT_EQ(filter->EvaluateHeader(header), H265Filter::Match::kFalse);
+  // parameter sets are still needed to parse the slice headers
+  EXPECT_TRUE(filter->NeedsPayload(SPS_NUT));
+  EXPECT_TRUE(filter->NeedsPayload(TRAIL_R));
+  EXPECT_FALSE(filter->NeedsPayload(PREFIX_SEI_NUT));
+
+  filter = H265Filter::Compile("!(nuh_temporal_id_plus1 > 1)", nullptr);
+  ASSERT_TRUE(filter != nullptr);
+  EXPECT_EQ(filter->EvaluateHeader(header), H265Filter::Match::kTrue);
+  EXPECT_FALSE(filter->NeedsPayload(SPS_NUT));
+  EXPECT_FALSE(filter->NeedsPayload(TRAIL_R));
+}
+
+TEST_F(H265FilterTest, TestEvaluate) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+    // VPS
+    0x00, 0x00, 0x00, 0x01,
+    0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+    0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03,
+    0x00, 0x00, 0x03, 0x00, 0x5d, 0xac, 0x59,
+    // SPS
+    0x00, 0x00, 0x00, 0x01,
+    0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03,
+    0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+    0x00, 0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2e, 0x1f,
+    0x13, 0x96, 0xbb, 0x93, 0x24, 0xbb, 0x95, 0x82,
+    0x83, 0x03, 0x01, 0x76, 0x85, 0x09, 0x40,
+    // PPS
+    0x00, 0x00, 0x00, 0x01,
+    0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02, 0x10,
+    // slice (IDR)
+    0x00, 0x00, 0x00, 0x01,
+    0x26, 0x01, 0xaf, 0x09, 0x40, 0xfb, 0x27, 0x5b,
+    0xfd, 0x5d, 0xc2, 0x4d, 0xe8, 0xb2, 0x0f, 0xcd,
+    0x68, 0xdb, 0xc3, 0x41, 0x12, 0x2e, 0x13, 0x8d,
+    0xdf, 0x66, 0xc9, 0x1f, 0xaa, 0xd4, 0x9b, 0x8d,
+    0xdd, 0xe2, 0xa1, 0xda, 0x2e, 0xbd, 0x53, 0x74,
+    0xd1, 0xbb, 0xde, 0x54, 0x8f, 0xa5, 0xe7, 0x2f,
+    0xcc, 0xf7, 0x98, 0xd6, 0x33, 0xd5, 0x06, 0x01,
+    0x52, 0x84, 0xbc, 0xa7, 0xe6, 0x02, 0x7f, 0xe9,
+    0x50, 0x0a, 0x9a, 0x60, 0x89, 0xa0, 0xc0, 0xb4,
+    0x6d, 0x60, 0x53, 0xe5, 0xdd, 0x93, 0xde, 0x03,
+    0xff, 0xa8, 0xb0, 0x4d, 0x27, 0xa5, 0x82, 0xba,
+    0xac, 0x63, 0x8b, 0x6f, 0x69, 0x7f, 0x93, 0xb2,
+    0xe3, 0x0c, 0xfd, 0x29, 0x44, 0x42, 0xa7, 0x13,
+    0xe9, 0xec, 0x37, 0xbb, 0x93, 0xe0, 0x62, 0xa9,
+    0xa4, 0x44, 0x45, 0x59, 0x16, 0xf6, 0xb6, 0x5b,
+    0x3a, 0xdb, 0xc3,
+    // slice (P-frame)
+    0x00, 0x00, 0x00, 0x01,
+    0x02, 0x01, 0xd0, 0x0f, 0xe4, 0x16, 0x80, 0xf4,
+    0x5a, 0xb4, 0x85, 0x6b, 0x17, 0xaa, 0xc1, 0x94,
+    0xa8, 0x9f, 0x32, 0x11, 0xe4, 0x44, 0xa5, 0xfd,
+    0xe7, 0x80, 0xda, 0xea, 0x21, 0x4c, 0x08, 0x23,
+    0xea, 0x58, 0x15, 0xa3, 0x4c, 0x1a, 0xb3, 0x80,
+    0x9b, 0x63, 0x50, 0x11, 0x75, 0x9a, 0xcc, 0x06,
+    0x09, 0x69, 0x97, 0x75, 0xa0, 0x02, 0x24, 0x22,
+    0x1c, 0x06, 0xa5, 0x69, 0x6e, 0xba, 0x9c, 0x79,
+    0x58, 0x1e, 0x52, 0xa8, 0x26, 0xfe, 0x98, 0x6f,
+    0x65, 0xee, 0x57, 0x10, 0x4f, 0x67, 0xe8, 0x43,
+    0xde, 0x8e, 0xe6, 0x40, 0x28, 0x36, 0x45, 0x06,
+    0x5e, 0xe8, 0x80, 0x34, 0xc0, 0x06, 0xf2, 0x16,
+    0x4b, 0x78, 0x5f, 0x98, 0x56, 0xcc, 0xd9, 0x59,
+    0x7a, 0xf3, 0x30, 0x5d, 0xa9, 0xc7, 0x84, 0x4a,
+    0xe0, 0x16, 0xbf, 0x07, 0x24, 0x32, 0x65, 0xbd,
+    0x39, 0xe2, 0x30, 0xbf, 0x27, 0xd3, 0x61, 0x25,
+    0x02, 0xae, 0x5a, 0xa1, 0x08, 0x9b, 0x90, 0x14,
+    0x2a, 0x09, 0xd1, 0x4a,
+    // slice (P-frame)
+    0x00, 0x00, 0x00, 0x01,
+    0x02, 0x01, 0xd0, 0x17, 0xe4, 0x08, 0x20, 0xfc,
+    0xc1, 0xf5, 0x88, 0x40, 0xcf, 0xf0, 0x00, 0x00,
+    0x03, 0x00, 0x05, 0xe0, 0x46, 0x9d, 0x90, 0xa1,
+    0x98, 0x43, 0x28, 0x48, 0xe9, 0xc6, 0xf3, 0x11,
+    0xeb, 0x29, 0x19, 0xcd, 0x34, 0x85, 0x8b, 0xc5,
+    0x21, 0xf5, 0x5a, 0x46, 0xd7, 0x5a, 0xa5, 0x34,
+    0xa6, 0xad, 0x91, 0xd6, 0x5e, 0x71, 0x18, 0x94,
+    0xe9, 0x44, 0x2a, 0x84, 0x04, 0x2c, 0x80, 0xb0,
+    0xb4, 0x03, 0xf0, 0xa0, 0xe6, 0xe6, 0x14, 0xb3,
+    0xf2, 0xfa, 0x57, 0x5e, 0x29, 0xd1, 0xe1, 0x4d,
+    0x9b, 0x17, 0xea, 0xf8, 0x5c, 0xd5, 0x0a, 0x72,
+    0xe6, 0x5e, 0x42, 0xed, 0xdd, 0xbe, 0x64, 0x38,
+    0x04, 0x5d, 0x84, 0xc7, 0x02, 0xb0, 0x50, 0x21,
+    0x3f, 0x02, 0x89, 0x83
+  };
+  // fuzzer::conv: begin
+  auto bitstream = H265BitstreamParser::ParseBitstream(
+      buffer, arraysize(buffer), ParsingOptions());
+  // fuzzer::conv: end
+  ASSERT_TRUE(bitstream != nullptr);
+  ASSERT_EQ(6, bitstream->nal_units.size());
+
+  auto filter = H265Filter::Compile(
+      "nal_unit_type==IDR_W_RADL || (slice_type==P && slice_qp_delta>=16)",
+      nullptr);
+  ASSERT_TRUE(filter != nullptr);
+  std::vector<bool> matches;
+  for (const auto& nal_unit : bitstream->nal_units) {
+    matches.push_back(filter->Evaluate(*nal_unit));
+  }
+  EXPECT_THAT(matches, ::testing::ElementsAre(false, false, false, true,
+                                              false, true));
+
+  // absent fields make comparisons false
+  filter = H265Filter::Compile("pic_width_in_luma_samples != 1280", nullptr);
+  ASSERT_TRUE(filter != nullptr);
+  matches.clear();
+  for (const auto& nal_unit : bitstream->nal_units) {
+    matches.push_back(filter->Evaluate(*nal_unit));
+  }
+  EXPECT_THAT(matches, ::testing::ElementsAre(false, false, false, false,
+                                              false, false));
+}
+
+}  // namespace h265nal
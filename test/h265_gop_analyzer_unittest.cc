@@ -0,0 +1,230 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_gop_analyzer.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_slice_parser.h"
+#include "rtc_base/arraysize.h"
+
+namespace h265nal {
+
+class H265GopAnalyzerTest : public ::testing::Test {
+ public:
+  H265GopAnalyzerTest() {}
+  ~H265GopAnalyzerTest() override {}
+};
+
+TEST_F(H265GopAnalyzerTest, TestClosedGops) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+    // VPS
+    0x00, 0x00, 0x00, 0x01,
+    0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+    0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03,
+    0x00, 0x00, 0x03, 0x00, 0x5d, 0xac, 0x59,
+    // SPS
+    0x00, 0x00, 0x00, 0x01,
+    0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03,
+    0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+    0x00, 0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2e, 0x1f,
+    0x13, 0x96, 0xbb, 0x93, 0x24, 0xbb, 0x95, 0x82,
+    0x83, 0x03, 0x01, 0x76, 0x85, 0x09, 0x40,
+    // PPS
+    0x00, 0x00, 0x00, 0x01,
+    0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02, 0x10,
+    // slice (IDR)
+    0x00, 0x00, 0x00, 0x01,
+    0x26, 0x01, 0xaf, 0x09, 0x40, 0xfb, 0x27, 0x5b,
+    0xfd, 0x5d, 0xc2, 0x4d, 0xe8, 0xb2, 0x0f, 0xcd,
+    0x68, 0xdb, 0xc3, 0x41, 0x12, 0x2e, 0x13, 0x8d,
+    0xdf, 0x66, 0xc9, 0x1f, 0xaa, 0xd4, 0x9b, 0x8d,
+    0xdd, 0xe2, 0xa1, 0xda, 0x2e, 0xbd, 0x53, 0x74,
+    0xd1, 0xbb, 0xde, 0x54, 0x8f, 0xa5, 0xe7, 0x2f,
+    0xcc, 0xf7, 0x98, 0xd6, 0x33, 0xd5, 0x06, 0x01,
+    0x52, 0x84, 0xbc, 0xa7, 0xe6, 0x02, 0x7f, 0xe9,
+    0x50, 0x0a, 0x9a, 0x60, 0x89, 0xa0, 0xc0, 0xb4,
+    0x6d, 0x60, 0x53, 0xe5, 0xdd, 0x93, 0xde, 0x03,
+    0xff, 0xa8, 0xb0, 0x4d, 0x27, 0xa5, 0x82, 0xba,
+    0xac, 0x63, 0x8b, 0x6f, 0x69, 0x7f, 0x93, 0xb2,
+    0xe3, 0x0c, 0xfd, 0x29, 0x44, 0x42, 0xa7, 0x13,
+    0xe9, 0xec, 0x37, 0xbb, 0x93, 0xe0, 0x62, 0xa9,
+    0xa4, 0x44, 0x45, 0x59, 0x16, 0xf6, 0xb6, 0x5b,
+    0x3a, 0xdb, 0xc3,
+    // slice (P-frame)
+    0x00, 0x00, 0x00, 0x01,
+    0x02, 0x01, 0xd0, 0x0f, 0xe4, 0x16, 0x80, 0xf4,
+    0x5a, 0xb4, 0x85, 0x6b, 0x17, 0xaa, 0xc1, 0x94,
+    0xa8, 0x9f, 0x32, 0x11, 0xe4, 0x44, 0xa5, 0xfd,
+    0xe7, 0x80, 0xda, 0xea, 0x21, 0x4c, 0x08, 0x23,
+    0xea, 0x58, 0x15, 0xa3, 0x4c, 0x1a, 0xb3, 0x80,
+    0x9b, 0x63, 0x50, 0x11, 0x75, 0x9a, 0xcc, 0x06,
+    0x09, 0x69, 0x97, 0x75, 0xa0, 0x02, 0x24, 0x22,
+    0x1c, 0x06, 0xa5, 0x69, 0x6e, 0xba, 0x9c, 0x79,
+    0x58, 0x1e, 0x52, 0xa8, 0x26, 0xfe, 0x98, 0x6f,
+    0x65, 0xee, 0x57, 0x10, 0x4f, 0x67, 0xe8, 0x43,
+    0xde, 0x8e, 0xe6, 0x40, 0x28, 0x36, 0x45, 0x06,
+    0x5e, 0xe8, 0x80, 0x34, 0xc0, 0x06, 0xf2, 0x16,
+    0x4b, 0x78, 0x5f, 0x98, 0x56, 0xcc, 0xd9, 0x59,
+    0x7a, 0xf3, 0x30, 0x5d, 0xa9, 0xc7, 0x84, 0x4a,
+    0xe0, 0x16, 0xbf, 0x07, 0x24, 0x32, 0x65, 0xbd,
+    0x39, 0xe2, 0x30, 0xbf, 0x27, 0xd3, 0x61, 0x25,
+    0x02, 0xae, 0x5a, 0xa1, 0x08, 0x9b, 0x90, 0x14,
+    0x2a, 0x09, 0xd1, 0x4a,
+    // slice (P-frame)
+    0x00, 0x00, 0x00, 0x01,
+    0x02, 0x01, 0xd0, 0x17, 0xe4, 0x08, 0x20, 0xfc,
+    0xc1, 0xf5, 0x88, 0x40, 0xcf, 0xf0, 0x00, 0x00,
+    0x03, 0x00, 0x05, 0xe0, 0x46, 0x9d, 0x90, 0xa1,
+    0x98, 0x43, 0x28, 0x48, 0xe9, 0xc6, 0xf3, 0x11,
+    0xeb, 0x29, 0x19, 0xcd, 0x34, 0x85, 0x8b, 0xc5,
+    0x21, 0xf5, 0x5a, 0x46, 0xd7, 0x5a, 0xa5, 0x34,
+    0xa6, 0xad, 0x91, 0xd6, 0x5e, 0x71, 0x18, 0x94,
+    0xe9, 0x44, 0x2a, 0x84, 0x04, 0x2c, 0x80, 0xb0,
+    0xb4, 0x03, 0xf0, 0xa0, 0xe6, 0xe6, 0x14, 0xb3,
+    0xf2, 0xfa, 0x57, 0x5e, 0x29, 0xd1, 0xe1, 0x4d,
+    0x9b, 0x17, 0xea, 0xf8, 0x5c, 0xd5, 0x0a, 0x72,
+    0xe6, 0x5e, 0x42, 0xed, 0xdd, 0xbe, 0x64, 0x38,
+    0x04, 0x5d, 0x84, 0xc7, 0x02, 0xb0, 0x50, 0x21,
+    0x3f, 0x02, 0x89, 0x83,
+    // slice (IDR)
+    0x00, 0x00, 0x00, 0x01,
+    0x26, 0x01, 0xaf, 0x09, 0x40, 0xfb, 0x27, 0x5b,
+    0xfd, 0x5d, 0xc2, 0x4d, 0xe8, 0xb2, 0x0f, 0xcd,
+    0x68, 0xdb, 0xc3, 0x41, 0x12, 0x2e, 0x13, 0x8d,
+    0xdf, 0x66, 0xc9, 0x1f, 0xaa, 0xd4, 0x9b, 0x8d,
+    0xdd, 0xe2, 0xa1, 0xda, 0x2e, 0xbd, 0x53, 0x74,
+    0xd1, 0xbb, 0xde, 0x54, 0x8f, 0xa5, 0xe7, 0x2f,
+    0xcc, 0xf7, 0x98, 0xd6, 0x33, 0xd5, 0x06, 0x01,
+    0x52, 0x84, 0xbc, 0xa7, 0xe6, 0x02, 0x7f, 0xe9,
+    0x50, 0x0a, 0x9a, 0x60, 0x89, 0xa0, 0xc0, 0xb4,
+    0x6d, 0x60, 0x53, 0xe5, 0xdd, 0x93, 0xde, 0x03,
+    0xff, 0xa8, 0xb0, 0x4d, 0x27, 0xa5, 0x82, 0xba,
+    0xac, 0x63, 0x8b, 0x6f, 0x69, 0x7f, 0x93, 0xb2,
+    0xe3, 0x0c, 0xfd, 0x29, 0x44, 0x42, 0xa7, 0x13,
+    0xe9, 0xec, 0x37, 0xbb, 0x93, 0xe0, 0x62, 0xa9,
+    0xa4, 0x44, 0x45, 0x59, 0x16, 0xf6, 0xb6, 0x5b,
+    0x3a, 0xdb, 0xc3,
+    // slice (P-frame)
+    0x00, 0x00, 0x00, 0x01,
+    0x02, 0x01, 0xd0, 0x0f, 0xe4, 0x16, 0x80, 0xf4,
+    0x5a, 0xb4, 0x85, 0x6b, 0x17, 0xaa, 0xc1, 0x94,
+    0xa8, 0x9f, 0x32, 0x11, 0xe4, 0x44, 0xa5, 0xfd,
+    0xe7, 0x80, 0xda, 0xea, 0x21, 0x4c, 0x08, 0x23,
+    0xea, 0x58, 0x15, 0xa3, 0x4c, 0x1a, 0xb3, 0x80,
+    0x9b, 0x63, 0x50, 0x11, 0x75, 0x9a, 0xcc, 0x06,
+    0x09, 0x69, 0x97, 0x75, 0xa0, 0x02, 0x24, 0x22,
+    0x1c, 0x06, 0xa5, 0x69, 0x6e, 0xba, 0x9c, 0x79,
+    0x58, 0x1e, 0x52, 0xa8, 0x26, 0xfe, 0x98, 0x6f,
+    0x65, 0xee, 0x57, 0x10, 0x4f, 0x67, 0xe8, 0x43,
+    0xde, 0x8e, 0xe6, 0x40, 0x28, 0x36, 0x45, 0x06,
+    0x5e, 0xe8, 0x80, 0x34, 0xc0, 0x06, 0xf2, 0x16,
+    0x4b, 0x78, 0x5f, 0x98, 0x56, 0xcc, 0xd9, 0x59,
+    0x7a, 0xf3, 0x30, 0x5d, 0xa9, 0xc7, 0x84, 0x4a,
+    0xe0, 0x16, 0xbf, 0x07, 0x24, 0x32, 0x65, 0xbd,
+    0x39, 0xe2, 0x30, 0xbf, 0x27, 0xd3, 0x61, 0x25,
+    0x02, 0xae, 0x5a, 0xa1, 0x08, 0x9b, 0x90, 0x14,
+    0x2a, 0x09, 0xd1, 0x4a,
+    // slice (P-frame)
+    0x00, 0x00, 0x00, 0x01,
+    0x02, 0x01, 0xd0, 0x17, 0xe4, 0x08, 0x20, 0xfc,
+    0xc1, 0xf5, 0x88, 0x40, 0xcf, 0xf0, 0x00, 0x00,
+    0x03, 0x00, 0x05, 0xe0, 0x46, 0x9d, 0x90, 0xa1,
+    0x98, 0x43, 0x28, 0x48, 0xe9, 0xc6, 0xf3, 0x11,
+    0xeb, 0x29, 0x19, 0xcd, 0x34, 0x85, 0x8b, 0xc5,
+    0x21, 0xf5, 0x5a, 0x46, 0xd7, 0x5a, 0xa5, 0x34,
+    0xa6, 0xad, 0x91, 0xd6, 0x5e, 0x71, 0x18, 0x94,
+    0xe9, 0x44, 0x2a, 0x84, 0x04, 0x2c, 0x80, 0xb0,
+    0xb4, 0x03, 0xf0, 0xa0, 0xe6, 0xe6, 0x14, 0xb3,
+    0xf2, 0xfa, 0x57, 0x5e, 0x29, 0xd1, 0xe1, 0x4d,
+    0x9b, 0x17, 0xea, 0xf8, 0x5c, 0xd5, 0x0a, 0x72,
+    0xe6, 0x5e, 0x42, 0xed, 0xdd, 0xbe, 0x64, 0x38,
+    0x04, 0x5d, 0x84, 0xc7, 0x02, 0xb0, 0x50, 0x21,
+    0x3f, 0x02, 0x89, 0x83
+  };
+  // fuzzer::conv: begin
+  H265BitstreamParserState bitstream_parser_state;
+  // 3 fps (the SPS has no timing info), 1 second reports
+  auto gop_analyzer =
+      std::make_unique<H265GopAnalyzer>(&bitstream_parser_state, 1.0, 3.0);
+  std::vector<H265GopAnalyzer::Report> reports;
+  gop_analyzer->ProcessBitstream(buffer, arraysize(buffer), &reports);
+  H265GopAnalyzer::Report last_report;
+  bool has_last_report = gop_analyzer->Flush(&last_report);
+  // fuzzer::conv: end
+
+  EXPECT_EQ(gop_analyzer->num_frames(), 6);
+  const auto& frames = gop_analyzer->frames();
+  EXPECT_EQ(frames.size(), 6);
+  // most recent frame first
+  EXPECT_EQ(frames.Get(0).frame_index, 5);
+  EXPECT_EQ(frames.Get(0).slice_type, SliceType_P);
+  EXPECT_EQ(frames.Get(0).size_bytes, 108);
+  EXPECT_EQ(frames.Get(1).size_bytes, 140);
+  EXPECT_EQ(frames.Get(2).nal_unit_type, IDR_W_RADL);
+  EXPECT_EQ(frames.Get(2).slice_type, SliceType_I);
+  EXPECT_EQ(frames.Get(2).size_bytes, 123);
+
+  // GOPs
+  EXPECT_EQ(gop_analyzer->num_gops(), 2);
+  const auto& gop = gop_analyzer->gops().Get(0);
+  EXPECT_EQ(gop.first_frame_index, 3);
+  EXPECT_EQ(gop.irap_nal_unit_type, IDR_W_RADL);
+  EXPECT_EQ(gop.num_frames, 3);
+  EXPECT_EQ(gop.max_temporal_id, 0);
+  EXPECT_FALSE(gop.IsOpen());
+  EXPECT_EQ(gop.size_bytes, 123 + 140 + 108);
+  EXPECT_EQ(gop.frame_size[SliceType_I].count, 1);
+  EXPECT_EQ(gop.frame_size[SliceType_P].count, 2);
+  EXPECT_EQ(gop.frame_size[SliceType_P].min, 108);
+  EXPECT_EQ(gop.frame_size[SliceType_P].max, 140);
+  EXPECT_EQ(gop.frame_size[SliceType_B].count, 0);
+
+  // the first report closes after 3 frames (1 second), before the first
+  // GOP ends
+  ASSERT_EQ(reports.size(), 1);
+  EXPECT_EQ(reports[0].report_index, 0);
+  EXPECT_DOUBLE_EQ(reports[0].start_time, 0.0);
+  EXPECT_DOUBLE_EQ(reports[0].end_time, 1.0);
+  EXPECT_EQ(reports[0].num_frames, 3);
+  EXPECT_EQ(reports[0].num_gops, 0);
+  EXPECT_EQ(reports[0].size_bytes, 123 + 140 + 108);
+  EXPECT_DOUBLE_EQ(reports[0].GetBitrate(),
+                   (123 + 140 + 108) * 8.0);
+  // the flushed report gets both GOPs
+  ASSERT_TRUE(has_last_report);
+  EXPECT_EQ(last_report.report_index, 1);
+  EXPECT_DOUBLE_EQ(last_report.start_time, 1.0);
+  EXPECT_DOUBLE_EQ(last_report.end_time, 2.0);
+  EXPECT_EQ(last_report.num_frames, 3);
+  EXPECT_EQ(last_report.num_gops, 2);
+  EXPECT_EQ(last_report.num_closed_gops, 2);
+  EXPECT_EQ(last_report.num_open_gops, 0);
+  EXPECT_EQ(last_report.gop_length.min, 3);
+  EXPECT_EQ(last_report.gop_length.max, 3);
+  EXPECT_EQ(last_report.frame_size[SliceType_I].min, 123);
+  // nothing left
+  EXPECT_FALSE(gop_analyzer->Flush(&last_report));
+}
+
+TEST_F(H265GopAnalyzerTest, TestOpenGop) {
+  H265GopAnalyzer::GopInfo gop;
+  gop.irap_nal_unit_type = CRA_NUT;
+  EXPECT_FALSE(gop.IsOpen());
+  gop.num_rasl_frames = 2;
+  EXPECT_TRUE(gop.IsOpen());
+  gop.irap_nal_unit_type = BLA_W_LP;
+  EXPECT_TRUE(gop.IsOpen());
+  gop.irap_nal_unit_type = IDR_W_RADL;
+  EXPECT_FALSE(gop.IsOpen());
+}
+
+}  // namespace h265nal
@@ -0,0 +1,85 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_hdr_metadata_tracker.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "h265_common.h"
+#include "h265_sei_parser.h"
+#include "rtc_base/arraysize.h"
+
+namespace h265nal {
+
+class H265HdrMetadataTrackerTest : public ::testing::Test {
+ public:
+  H265HdrMetadataTrackerTest() {}
+  ~H265HdrMetadataTrackerTest() override {}
+};
+
+TEST_F(H265HdrMetadataTrackerTest, TestChangeDetection) {
+  // mastering_display_colour_volume + content_light_level_info
+  const uint8_t buffer1[] = {
+      // sei_message: user_data_unregistered (payload_size: 17)
+      0x05, 0x11, 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99,
+      0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x01,
+      // sei_message: mastering_display_colour_volume (payload_size: 24)
+      0x89, 0x18, 0x21, 0x34, 0x9b, 0xaa, 0x19, 0x96, 0x08, 0xfc, 0x8a, 0x48,
+      0x39, 0x08, 0x3d, 0x13, 0x40, 0x42, 0x00, 0x98, 0x96, 0x80, 0x00, 0x00,
+      0x03, 0x00, 0x32,
+      // sei_message: content_light_level_info (payload_size: 4)
+      0x90, 0x04, 0x03, 0xe8, 0x01, 0x90,
+      // rbsp_trailing_bits()
+      0x80};
+  // same mastering_display_colour_volume, new content_light_level_info
+  const uint8_t buffer2[] = {
+      // sei_message: mastering_display_colour_volume (payload_size: 24)
+      0x89, 0x18, 0x21, 0x34, 0x9b, 0xaa, 0x19, 0x96, 0x08, 0xfc, 0x8a, 0x48,
+      0x39, 0x08, 0x3d, 0x13, 0x40, 0x42, 0x00, 0x98, 0x96, 0x80, 0x00, 0x00,
+      0x03, 0x00, 0x32,
+      // sei_message: content_light_level_info (payload_size: 4)
+      0x90, 0x04, 0x02, 0x58, 0x00, 0xc8,
+      // rbsp_trailing_bits()
+      0x80};
+
+  H265HdrMetadataTracker tracker;
+  EXPECT_TRUE(tracker.mastering_display_colour_volume() == nullptr);
+  EXPECT_TRUE(tracker.content_light_level_info() == nullptr);
+
+  // first sighting reports both
+  EXPECT_EQ(tracker.ProcessSeiRbsp(buffer1, arraysize(buffer1)),
+            H265HdrMetadataTracker::kMasteringDisplayColourVolumeChanged |
+                H265HdrMetadataTracker::kContentLightLevelInfoChanged);
+  const auto* mdcv = tracker.mastering_display_colour_volume();
+  EXPECT_TRUE(mdcv != nullptr);
+  EXPECT_EQ(mdcv->max_display_mastering_luminance, 10000000);
+  EXPECT_EQ(tracker.content_light_level_info()->max_content_light_level, 1000);
+
+  // a repeat is not a change
+  EXPECT_EQ(tracker.ProcessSeiRbsp(buffer1, arraysize(buffer1)),
+            H265HdrMetadataTracker::kNoChange);
+
+  // only content_light_level_info changed
+  EXPECT_EQ(tracker.ProcessSeiRbsp(buffer2, arraysize(buffer2)),
+            H265HdrMetadataTracker::kContentLightLevelInfoChanged);
+  EXPECT_EQ(tracker.content_light_level_info()->max_content_light_level, 600);
+  EXPECT_EQ(tracker.content_light_level_info()->max_pic_average_light_level,
+            200);
+
+  // a parsed SEI RBSP can be fed directly
+  auto sei_rbsp = H265SeiRbspParser::ParseSeiRbsp(buffer2, arraysize(buffer2));
+  EXPECT_TRUE(sei_rbsp != nullptr);
+  EXPECT_EQ(tracker.ProcessSeiRbsp(*sei_rbsp),
+            H265HdrMetadataTracker::kNoChange);
+
+  // a reset forgets everything
+  tracker.Reset();
+  EXPECT_TRUE(tracker.mastering_display_colour_volume() == nullptr);
+  EXPECT_EQ(tracker.ProcessSeiRbsp(*sei_rbsp),
+            H265HdrMetadataTracker::kMasteringDisplayColourVolumeChanged |
+                H265HdrMetadataTracker::kContentLightLevelInfoChanged);
+}
+
+}  // namespace h265nal
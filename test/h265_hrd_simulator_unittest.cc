@@ -0,0 +1,149 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_hrd_simulator.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "h265_sei_parser.h"
+
+namespace h265nal {
+
+class H265HrdSimulatorTest : public ::testing::Test {
+ public:
+  H265HrdSimulatorTest() {}
+  ~H265HrdSimulatorTest() override {}
+};
+
+TEST_F(H265HrdSimulatorTest, TestCbrStream) {
+  // 1024 kbps CBR, 32 fps, 0.5 s initial delay, 32 kbit pictures: the
+  // CPB stays exactly at 512 kbit before each removal
+  H265HrdSimulator::HrdConfig config;
+  config.bit_rate = 1024000;
+  config.cpb_size = 512000;
+  config.cbr = true;
+  config.clock_tick = 1.0 / 32;
+  config.dpb_size = 2;
+  H265HrdSimulator simulator(config, false);
+
+  H265SeiBufferingPeriodParser::H265SeiBufferingPeriodState buffering_period;
+  buffering_period.nal_initial_cpb_removal_delay.push_back(45000);
+  buffering_period.nal_initial_cpb_removal_offset.push_back(0);
+  H265SeiPicTimingParser::H265SeiPicTimingState pic_timing;
+  pic_timing.pic_dpb_output_delay = 1;
+
+  std::vector<H265HrdSimulator::AccessUnitTiming> timing;
+  H265HrdSimulator::AccessUnit access_unit;
+  access_unit.size_bits = 32000;
+  // the first access unit needs a buffering period
+  EXPECT_FALSE(simulator.AddAccessUnit(access_unit, &timing));
+
+  access_unit.buffering_period = &buffering_period;
+  access_unit.pic_timing = &pic_timing;
+  EXPECT_TRUE(simulator.AddAccessUnit(access_unit, &timing));
+  access_unit.buffering_period = nullptr;
+  for (uint32_t n = 1; n < 32; n++) {
+    pic_timing.au_cpb_removal_delay_minus1 = n - 1;
+    EXPECT_TRUE(simulator.AddAccessUnit(access_unit, &timing));
+  }
+  // access units are reported once no later one can affect them
+  EXPECT_LT(timing.size(), 32);
+  simulator.Flush(&timing);
+  EXPECT_EQ(timing.size(), 32);
+
+  for (uint32_t n = 0; n < 32; n++) {
+    EXPECT_EQ(timing[n].index, n);
+    EXPECT_DOUBLE_EQ(timing[n].initial_arrival_time, n / 32.0);
+    EXPECT_DOUBLE_EQ(timing[n].final_arrival_time, (n + 1) / 32.0);
+    EXPECT_DOUBLE_EQ(timing[n].removal_time, 0.5 + n / 32.0);
+    EXPECT_DOUBLE_EQ(timing[n].dpb_output_time, 0.5 + (n + 1) / 32.0);
+    if (n < 16) {
+      // the tail of the stream drains the CPB
+      EXPECT_DOUBLE_EQ(timing[n].cpb_fullness, 512000);
+    }
+    EXPECT_FALSE(timing[n].cpb_overflow);
+    EXPECT_FALSE(timing[n].cpb_underflow);
+    EXPECT_FALSE(timing[n].dpb_overflow);
+  }
+  EXPECT_EQ(simulator.stats().num_access_units, 32);
+  EXPECT_EQ(simulator.stats().num_cpb_overflows, 0);
+  EXPECT_EQ(simulator.stats().num_cpb_underflows, 0);
+  EXPECT_DOUBLE_EQ(simulator.stats().max_cpb_fullness, 512000);
+  EXPECT_EQ(simulator.stats().max_dpb_fullness, 1);
+}
+
+TEST_F(H265HrdSimulatorTest, TestOverflowAndUnderflow) {
+  H265HrdSimulator::HrdConfig config;
+  config.bit_rate = 1024000;
+  config.cpb_size = 256000;
+  config.cbr = true;
+  config.clock_tick = 1.0 / 32;
+  H265HrdSimulator simulator(config, false);
+
+  H265SeiBufferingPeriodParser::H265SeiBufferingPeriodState buffering_period;
+  buffering_period.nal_initial_cpb_removal_delay.push_back(45000);
+  buffering_period.nal_initial_cpb_removal_offset.push_back(0);
+  H265SeiPicTimingParser::H265SeiPicTimingState pic_timing;
+
+  std::vector<H265HrdSimulator::AccessUnitTiming> timing;
+  H265HrdSimulator::AccessUnit access_unit;
+  access_unit.buffering_period = &buffering_period;
+  access_unit.pic_timing = &pic_timing;
+  for (uint32_t n = 0; n < 8; n++) {
+    // access unit 4 is too big to arrive before its removal time
+    access_unit.size_bits = (n == 4) ? 1024000 : 32000;
+    pic_timing.au_cpb_removal_delay_minus1 = n - 1;
+    EXPECT_TRUE(simulator.AddAccessUnit(access_unit, &timing));
+    access_unit.buffering_period = nullptr;
+  }
+  simulator.Flush(&timing);
+  EXPECT_EQ(timing.size(), 8);
+
+  // 0.5 s of 1024 kbps do not fit in a 256 kbit CPB
+  EXPECT_TRUE(timing[0].cpb_overflow);
+  EXPECT_FALSE(timing[0].cpb_underflow);
+  EXPECT_TRUE(timing[4].cpb_underflow);
+  EXPECT_DOUBLE_EQ(timing[4].final_arrival_time, 4 / 32.0 + 1.0);
+  EXPECT_GT(simulator.stats().num_cpb_overflows, 0);
+  EXPECT_GT(simulator.stats().num_cpb_underflows, 0);
+}
+
+TEST_F(H265HrdSimulatorTest, TestInvalidConfig) {
+  H265HrdSimulator::HrdConfig config;
+  config.bit_rate = 1024000;
+  config.cpb_size = 512000;
+  config.clock_tick = 1.0 / 32;
+  EXPECT_TRUE(H265HrdSimulator::IsValidConfig(config));
+  EXPECT_TRUE(H265HrdSimulator::Create(config, false) != nullptr);
+
+  // a zero bit rate (the arrival times divide by it)
+  config.bit_rate = 0;
+  EXPECT_FALSE(H265HrdSimulator::IsValidConfig(config));
+  EXPECT_TRUE(H265HrdSimulator::Create(config, false) == nullptr);
+  H265HrdSimulator simulator(config, false);
+  EXPECT_FALSE(simulator.valid());
+
+  H265SeiBufferingPeriodParser::H265SeiBufferingPeriodState buffering_period;
+  buffering_period.nal_initial_cpb_removal_delay.push_back(45000);
+  buffering_period.nal_initial_cpb_removal_offset.push_back(0);
+  H265SeiPicTimingParser::H265SeiPicTimingState pic_timing;
+  H265HrdSimulator::AccessUnit access_unit;
+  access_unit.size_bits = 32000;
+  access_unit.buffering_period = &buffering_period;
+  access_unit.pic_timing = &pic_timing;
+  std::vector<H265HrdSimulator::AccessUnitTiming> timing;
+  EXPECT_FALSE(simulator.AddAccessUnit(access_unit, &timing));
+  simulator.Flush(&timing);
+  EXPECT_TRUE(timing.empty());
+
+  // a zero CPB size
+  config.bit_rate = 1024000;
+  config.cpb_size = 0;
+  EXPECT_FALSE(H265HrdSimulator::IsValidConfig(config));
+}
+
+}  // namespace h265nal
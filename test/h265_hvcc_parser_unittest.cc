@@ -0,0 +1,170 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_hvcc_parser.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+#include "rtc_base/arraysize.h"
+
+namespace h265nal {
+
+namespace {
+// VPS
+const uint8_t kVps[] = {
+    0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+    0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03,
+    0x00, 0x00, 0x03, 0x00, 0x5d, 0xac, 0x59
+};
+
+// SPS
+const uint8_t kSps[] = {
+    0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03,
+    0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+    0x00, 0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2e, 0x1f,
+    0x13, 0x96, 0xbb, 0x93, 0x24, 0xbb, 0x95, 0x82,
+    0x83, 0x03, 0x01, 0x76, 0x85, 0x09, 0x40
+};
+
+// PPS
+const uint8_t kPps[] = {
+    0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02, 0x10
+};
+}  // namespace
+
+class H265HvccParserTest : public ::testing::Test {
+ public:
+  H265HvccParserTest() {}
+  ~H265HvccParserTest() override {}
+
+  void SetUp() override {
+    nal_units_ = {std::vector<uint8_t>(kPps, kPps + arraysize(kPps)),
+                  std::vector<uint8_t>(kSps, kSps + arraysize(kSps)),
+                  std::vector<uint8_t>(kVps, kVps + arraysize(kVps))};
+    for (const auto& nal_unit : nal_units_) {
+      ASSERT_NE(nullptr, H265NalUnitParser::ParseNalUnit(
+                             nal_unit.data(), nal_unit.size(),
+                             &bitstream_parser_state_));
+    }
+  }
+
+  std::vector<std::vector<uint8_t>> nal_units_;
+  H265BitstreamParserState bitstream_parser_state_;
+};
+
+TEST_F(H265HvccParserTest, TestGenerateHvcc) {
+  auto hvcc = H265HvccParser::GenerateHvcc(bitstream_parser_state_,
+                                           nal_units_, 4);
+  ASSERT_NE(nullptr, hvcc);
+
+  EXPECT_EQ(1, hvcc->configurationVersion);
+  EXPECT_EQ(0, hvcc->general_profile_space);
+  EXPECT_EQ(0, hvcc->general_tier_flag);
+  EXPECT_EQ(1, hvcc->general_profile_idc);
+  EXPECT_EQ(0x60000000, hvcc->general_profile_compatibility_flags);
+  // progressive_source_flag, non_packed_constraint_flag, and
+  // frame_only_constraint_flag
+  EXPECT_EQ(0xb00000000000, hvcc->general_constraint_indicator_flags);
+  EXPECT_EQ(93, hvcc->general_level_idc);
+  EXPECT_EQ(0, hvcc->parallelismType);
+  EXPECT_EQ(1, hvcc->chromaFormat);
+  EXPECT_EQ(0, hvcc->bitDepthLumaMinus8);
+  EXPECT_EQ(0, hvcc->bitDepthChromaMinus8);
+  EXPECT_EQ(1, hvcc->numTemporalLayers);
+  EXPECT_EQ(1, hvcc->temporalIdNested);
+  EXPECT_EQ(3, hvcc->lengthSizeMinusOne);
+
+  // arrays are sorted by NAL unit type
+  ASSERT_EQ(3, hvcc->numOfArrays);
+  ASSERT_EQ(3, hvcc->arrays.size());
+  EXPECT_EQ(NalUnitType::VPS_NUT, hvcc->arrays[0]->NAL_unit_type);
+  EXPECT_EQ(NalUnitType::SPS_NUT, hvcc->arrays[1]->NAL_unit_type);
+  EXPECT_EQ(NalUnitType::PPS_NUT, hvcc->arrays[2]->NAL_unit_type);
+  for (const auto& array : hvcc->arrays) {
+    EXPECT_EQ(1, array->array_completeness);
+    EXPECT_EQ(1, array->numNalus);
+  }
+  EXPECT_EQ(nal_units_[2], hvcc->arrays[0]->nal_units[0]);
+  EXPECT_EQ(nal_units_[1], hvcc->arrays[1]->nal_units[0]);
+  EXPECT_EQ(nal_units_[0], hvcc->arrays[2]->nal_units[0]);
+
+  // no SPS
+  H265BitstreamParserState empty_state;
+  EXPECT_EQ(nullptr, H265HvccParser::GenerateHvcc(empty_state, nal_units_, 4));
+  // invalid length size
+  EXPECT_EQ(nullptr, H265HvccParser::GenerateHvcc(bitstream_parser_state_,
+                                                  nal_units_, 3));
+}
+
+TEST_F(H265HvccParserTest, TestRoundTrip) {
+  auto hvcc = H265HvccParser::GenerateHvcc(bitstream_parser_state_,
+                                           nal_units_, 2);
+  ASSERT_NE(nullptr, hvcc);
+  std::vector<uint8_t> buffer;
+  ASSERT_TRUE(H265HvccParser::SerializeHvcc(*hvcc, &buffer));
+  // 23 bytes, plus 3 arrays, plus the NAL units and their lengths
+  EXPECT_EQ(23 + 3 * 3 + 3 * 2 + arraysize(kVps) + arraysize(kSps) +
+                arraysize(kPps),
+            buffer.size());
+  EXPECT_EQ(0x01, buffer[0]);
+  EXPECT_EQ(0xf0, buffer[13] & 0xf0);
+  EXPECT_EQ(0xfd, buffer[16]);
+  EXPECT_EQ(0xf8, buffer[17]);
+
+  // parse it into a new bitstream parser state
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  auto parsed = H265HvccParser::ParseHvcc(buffer.data(), buffer.size(),
+                                          &bitstream_parser_state,
+                                          parsing_options);
+  ASSERT_NE(nullptr, parsed);
+  EXPECT_EQ(hvcc->general_profile_idc, parsed->general_profile_idc);
+  EXPECT_EQ(hvcc->general_profile_compatibility_flags,
+            parsed->general_profile_compatibility_flags);
+  EXPECT_EQ(hvcc->general_constraint_indicator_flags,
+            parsed->general_constraint_indicator_flags);
+  EXPECT_EQ(hvcc->general_level_idc, parsed->general_level_idc);
+  EXPECT_EQ(hvcc->chromaFormat, parsed->chromaFormat);
+  EXPECT_EQ(1, parsed->lengthSizeMinusOne);
+  ASSERT_EQ(3, parsed->arrays.size());
+  EXPECT_EQ(nal_units_[1], parsed->arrays[1]->nal_units[0]);
+
+  // the parameter sets are ready to be used
+  auto sps = bitstream_parser_state.GetSps(0);
+  ASSERT_NE(nullptr, sps);
+  EXPECT_EQ(1280, sps->pic_width_in_luma_samples);
+  EXPECT_EQ(736, sps->pic_height_in_luma_samples);
+  EXPECT_NE(nullptr, bitstream_parser_state.GetVps(0));
+  EXPECT_NE(nullptr, bitstream_parser_state.GetPps(0));
+
+  // serializing the parsed hvcC gives the same bytes
+  std::vector<uint8_t> buffer2;
+  ASSERT_TRUE(H265HvccParser::SerializeHvcc(*parsed, &buffer2));
+  EXPECT_EQ(buffer, buffer2);
+}
+
+TEST_F(H265HvccParserTest, TestParseHvccTruncated) {
+  auto hvcc = H265HvccParser::GenerateHvcc(bitstream_parser_state_,
+                                           nal_units_, 4);
+  ASSERT_NE(nullptr, hvcc);
+  std::vector<uint8_t> buffer;
+  ASSERT_TRUE(H265HvccParser::SerializeHvcc(*hvcc, &buffer));
+  ParsingOptions parsing_options;
+  for (size_t length : {static_cast<size_t>(10), static_cast<size_t>(23),
+                        buffer.size() - 1}) {
+    H265BitstreamParserState bitstream_parser_state;
+    EXPECT_EQ(nullptr,
+              H265HvccParser::ParseHvcc(buffer.data(), length,
+                                        &bitstream_parser_state,
+                                        parsing_options));
+  }
+}
+
+}  // namespace h265nal
@@ -0,0 +1,349 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_mcts_extractor.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "rtc_base/bit_buffer.h"
+
+namespace h265nal {
+
+namespace {
+// VPS of a single-layer stream
+const uint8_t kVps[] = {0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+                        0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03,
+                        0x00, 0x00, 0x03, 0x00, 0x5d, 0xac, 0x59};
+// prefix SEI with a temporal_motion_constrained_tile_sets message
+// (each_tile_one_tile_set_flag set)
+const uint8_t kTmctsSei[] = {0x4e, 0x01, 0x8b, 0x02, 0xe5, 0xd8, 0x80};
+
+// Append a NAL unit (escaping the RBSP written by `writer`, of which only
+// the first `length` bytes are used) and raw (already escaped) bytes.
+void AppendNalUnit(const std::vector<uint8_t>& nal_unit, size_t length,
+                   const std::vector<uint8_t>& raw,
+                   std::vector<uint8_t>* stream) {
+  const uint8_t start_code[] = {0x00, 0x00, 0x00, 0x01};
+  stream->insert(stream->end(), start_code, start_code + 4);
+  EscapeRbsp(nal_unit.data(), length, stream);
+  stream->insert(stream->end(), raw.begin(), raw.end());
+}
+
+size_t FinishNalUnit(rtc::BitBufferWriter* writer) {
+  writer->WriteBits(1, 1);
+  size_t byte_offset = 0;
+  size_t bit_offset = 0;
+  writer->GetCurrentOffset(&byte_offset, &bit_offset);
+  return byte_offset + ((bit_offset == 0) ? 0 : 1);
+}
+
+// 416x240 4:2:0 picture (with a bottom conformance window of 8 luma
+// rows), with 64x64 CTBs (7x4 CTBs), no SAO, and no reference picture sets
+void AppendSps(std::vector<uint8_t>* stream) {
+  std::vector<uint8_t> sps(64, 0);
+  rtc::BitBufferWriter writer(sps.data(), sps.size());
+  writer.WriteBits(0x4201, 16);  // nal_unit_header()
+  writer.WriteBits(0, 4);        // sps_video_parameter_set_id
+  writer.WriteBits(0, 3);        // sps_max_sub_layers_minus1
+  writer.WriteBits(1, 1);        // sps_temporal_id_nesting_flag
+  // profile_tier_level(): Main profile, level 3
+  writer.WriteBits(0x01, 8);
+  writer.WriteBits(0x60000000, 32);
+  writer.WriteBits(0xb0, 8);
+  writer.WriteBits(0, 40);
+  writer.WriteBits(90, 8);
+  writer.WriteExponentialGolomb(0);    // sps_seq_parameter_set_id
+  writer.WriteExponentialGolomb(1);    // chroma_format_idc
+  writer.WriteExponentialGolomb(416);  // pic_width_in_luma_samples
+  writer.WriteExponentialGolomb(240);  // pic_height_in_luma_samples
+  writer.WriteBits(1, 1);              // conformance_window_flag
+  writer.WriteExponentialGolomb(0);    // conf_win_left_offset
+  writer.WriteExponentialGolomb(0);    // conf_win_right_offset
+  writer.WriteExponentialGolomb(0);    // conf_win_top_offset
+  writer.WriteExponentialGolomb(4);    // conf_win_bottom_offset
+  writer.WriteExponentialGolomb(0);    // bit_depth_luma_minus8
+  writer.WriteExponentialGolomb(0);    // bit_depth_chroma_minus8
+  writer.WriteExponentialGolomb(4);    // log2_max_pic_order_cnt_lsb_minus4
+  writer.WriteBits(1, 1);  // sps_sub_layer_ordering_info_present_flag
+  writer.WriteExponentialGolomb(0);  // sps_max_dec_pic_buffering_minus1
+  writer.WriteExponentialGolomb(0);  // sps_max_num_reorder_pics
+  writer.WriteExponentialGolomb(0);  // sps_max_latency_increase_plus1
+  writer.WriteExponentialGolomb(0);  // log2_min_luma_coding_block_size_minus3
+  writer.WriteExponentialGolomb(3);  // log2_diff_max_min_luma_coding_block_size
+  // log2_min_luma_transform_block_size_minus2
+  writer.WriteExponentialGolomb(0);
+  // log2_diff_max_min_luma_transform_block_size
+  writer.WriteExponentialGolomb(3);
+  writer.WriteExponentialGolomb(0);  // max_transform_hierarchy_depth_inter
+  writer.WriteExponentialGolomb(0);  // max_transform_hierarchy_depth_intra
+  writer.WriteBits(0, 1);            // scaling_list_enabled_flag
+  writer.WriteBits(0, 1);            // amp_enabled_flag
+  writer.WriteBits(0, 1);            // sample_adaptive_offset_enabled_flag
+  writer.WriteBits(0, 1);            // pcm_enabled_flag
+  writer.WriteExponentialGolomb(0);  // num_short_term_ref_pic_sets
+  writer.WriteBits(0, 1);            // long_term_ref_pics_present_flag
+  writer.WriteBits(0, 1);            // sps_temporal_mvp_enabled_flag
+  writer.WriteBits(0, 1);            // strong_intra_smoothing_enabled_flag
+  writer.WriteBits(0, 1);            // vui_parameters_present_flag
+  writer.WriteBits(0, 1);            // sps_extension_present_flag
+  AppendNalUnit(sps, FinishNalUnit(&writer), {}, stream);
+}
+
+// 2x2 uniform tiles (CTB columns {3, 4}, CTB rows {2, 2}), with dependent
+// slice segments and slice segment header extensions
+void AppendPps(std::vector<uint8_t>* stream) {
+  std::vector<uint8_t> pps(64, 0);
+  rtc::BitBufferWriter writer(pps.data(), pps.size());
+  writer.WriteBits(0x4401, 16);             // nal_unit_header()
+  writer.WriteExponentialGolomb(0);         // pps_pic_parameter_set_id
+  writer.WriteExponentialGolomb(0);         // pps_seq_parameter_set_id
+  writer.WriteBits(1, 1);  // dependent_slice_segments_enabled_flag
+  writer.WriteBits(0, 1);  // output_flag_present_flag
+  writer.WriteBits(0, 3);  // num_extra_slice_header_bits
+  writer.WriteBits(0, 1);  // sign_data_hiding_enabled_flag
+  writer.WriteBits(0, 1);  // cabac_init_present_flag
+  writer.WriteExponentialGolomb(0);  // num_ref_idx_l0_default_active_minus1
+  writer.WriteExponentialGolomb(0);  // num_ref_idx_l1_default_active_minus1
+  writer.WriteSignedExponentialGolomb(0);  // init_qp_minus26
+  writer.WriteBits(0, 1);                  // constrained_intra_pred_flag
+  writer.WriteBits(0, 1);                  // transform_skip_enabled_flag
+  writer.WriteBits(1, 1);                  // cu_qp_delta_enabled_flag
+  writer.WriteExponentialGolomb(1);        // diff_cu_qp_delta_depth
+  writer.WriteSignedExponentialGolomb(-2);  // pps_cb_qp_offset
+  writer.WriteSignedExponentialGolomb(2);   // pps_cr_qp_offset
+  writer.WriteBits(0, 1);  // pps_slice_chroma_qp_offsets_present_flag
+  writer.WriteBits(0, 1);  // weighted_pred_flag
+  writer.WriteBits(0, 1);  // weighted_bipred_flag
+  writer.WriteBits(0, 1);  // transquant_bypass_enabled_flag
+  writer.WriteBits(1, 1);  // tiles_enabled_flag
+  writer.WriteBits(0, 1);  // entropy_coding_sync_enabled_flag
+  writer.WriteExponentialGolomb(1);  // num_tile_columns_minus1
+  writer.WriteExponentialGolomb(1);  // num_tile_rows_minus1
+  writer.WriteBits(1, 1);            // uniform_spacing_flag
+  writer.WriteBits(0, 1);  // loop_filter_across_tiles_enabled_flag
+  writer.WriteBits(0, 1);  // pps_loop_filter_across_slices_enabled_flag
+  writer.WriteBits(0, 1);  // deblocking_filter_control_present_flag
+  writer.WriteBits(0, 1);  // pps_scaling_list_data_present_flag
+  writer.WriteBits(0, 1);  // lists_modification_present_flag
+  writer.WriteExponentialGolomb(0);  // log2_parallel_merge_level_minus2
+  writer.WriteBits(1, 1);  // slice_segment_header_extension_present_flag
+  writer.WriteBits(0, 1);  // pps_extension_present_flag
+  AppendNalUnit(pps, FinishNalUnit(&writer), {}, stream);
+}
+
+// The (fake) slice segment data of a slice segment: escaped bytes,
+// including an emulation prevention byte.
+std::vector<uint8_t> GetSliceData(uint32_t slice_segment_address) {
+  return {0xaa, static_cast<uint8_t>(slice_segment_address), 0x00, 0x00,
+          0x03, 0x01, 0x80};
+}
+
+// An IDR I slice segment
+void AppendSlice(uint32_t slice_segment_address,
+                 uint32_t dependent_slice_segment_flag,
+                 std::vector<uint8_t>* stream) {
+  std::vector<uint8_t> slice(64, 0);
+  rtc::BitBufferWriter writer(slice.data(), slice.size());
+  writer.WriteBits(0x2601, 16);  // nal_unit_header() (IDR_W_RADL)
+  writer.WriteBits(slice_segment_address == 0, 1);
+  writer.WriteBits(0, 1);            // no_output_of_prior_pics_flag
+  writer.WriteExponentialGolomb(0);  // slice_pic_parameter_set_id
+  if (slice_segment_address != 0) {
+    writer.WriteBits(dependent_slice_segment_flag, 1);
+    // Ceil(Log2(28))
+    writer.WriteBits(slice_segment_address, 5);
+  }
+  if (!dependent_slice_segment_flag) {
+    writer.WriteExponentialGolomb(2);        // slice_type
+    writer.WriteSignedExponentialGolomb(3);  // slice_qp_delta
+  }
+  writer.WriteExponentialGolomb(0);  // num_entry_point_offsets
+  writer.WriteExponentialGolomb(1);  // slice_segment_header_extension_length
+  writer.WriteBits(0x5a, 8);         // slice_segment_header_extension_data_byte
+  AppendNalUnit(slice, FinishNalUnit(&writer),
+                GetSliceData(slice_segment_address), stream);
+}
+
+// Parse a sub-bitstream, and return its NAL units.
+std::unique_ptr<H265BitstreamParser::BitstreamState> ParseSubBitstream(
+    const H265MctsExtractor::SubBitstream& sub_bitstream,
+    std::vector<uint8_t>* buffer) {
+  buffer->clear();
+  sub_bitstream.Write(buffer);
+  EXPECT_EQ(sub_bitstream.size(), buffer->size());
+  ParsingOptions parsing_options;
+  return H265BitstreamParser::ParseBitstream(buffer->data(), buffer->size(),
+                                             parsing_options);
+}
+}  // namespace
+
+class H265MctsExtractorTest : public ::testing::Test {
+ public:
+  H265MctsExtractorTest() {}
+  ~H265MctsExtractorTest() override {}
+
+  void SetUp() override {
+    const uint8_t start_code[] = {0x00, 0x00, 0x00, 0x01};
+    stream.insert(stream.end(), start_code, start_code + 4);
+    stream.insert(stream.end(), kVps, kVps + sizeof(kVps));
+    AppendSps(&stream);
+    AppendPps(&stream);
+  }
+
+  std::vector<uint8_t> stream;
+};
+
+TEST_F(H265MctsExtractorTest, TestExtractTiles) {
+  const uint8_t start_code[] = {0x00, 0x00, 0x00, 0x01};
+  stream.insert(stream.end(), start_code, start_code + 4);
+  stream.insert(stream.end(), kTmctsSei, kTmctsSei + sizeof(kTmctsSei));
+  // first picture: one slice per tile
+  AppendSlice(0, 0, &stream);
+  AppendSlice(3, 0, &stream);
+  AppendSlice(14, 0, &stream);
+  AppendSlice(17, 0, &stream);
+  // second picture: the first tile has a dependent slice segment starting
+  // at its second CTB row
+  AppendSlice(0, 0, &stream);
+  AppendSlice(7, 1, &stream);
+  AppendSlice(3, 0, &stream);
+  AppendSlice(14, 0, &stream);
+  AppendSlice(17, 0, &stream);
+
+  auto extractor = H265MctsExtractor::Extract(stream.data(), stream.size());
+  ASSERT_NE(nullptr, extractor);
+  EXPECT_TRUE(extractor->each_tile_one_tile_set());
+  const auto& sub_bitstreams = extractor->sub_bitstreams();
+  ASSERT_EQ(4, sub_bitstreams.size());
+
+  // tile sizes (the last column and row are cropped to the picture)
+  const uint32_t kWidth[] = {192, 224, 192, 224};
+  const uint32_t kHeight[] = {128, 128, 112, 112};
+  // address of the last slice segment of each tile
+  const uint32_t kLastAddress[] = {7, 3, 14, 17};
+  std::vector<uint8_t> buffer;
+  for (uint32_t tile_id = 0; tile_id < 4; tile_id++) {
+    const auto& sub_bitstream = *sub_bitstreams[tile_id];
+    EXPECT_EQ(tile_id, sub_bitstream.tile_id);
+    auto bitstream = ParseSubBitstream(sub_bitstream, &buffer);
+    ASSERT_NE(nullptr, bitstream);
+    // VPS, SPS, PPS, and the slice segments of both pictures
+    size_t num_slices = (tile_id == 0) ? 3 : 2;
+    ASSERT_EQ(3 + num_slices, bitstream->nal_units.size());
+
+    const auto& sps = bitstream->nal_units[1]->nal_unit_payload->sps;
+    ASSERT_NE(nullptr, sps);
+    EXPECT_EQ(kWidth[tile_id], sps->pic_width_in_luma_samples);
+    EXPECT_EQ(kHeight[tile_id], sps->pic_height_in_luma_samples);
+    // only the bottom tiles keep the conformance window
+    EXPECT_EQ(tile_id >= 2 ? 1 : 0, sps->conformance_window_flag);
+    EXPECT_EQ(tile_id >= 2 ? 4 : 0, sps->conf_win_bottom_offset);
+    EXPECT_EQ(3, sps->log2_diff_max_min_luma_coding_block_size);
+
+    const auto& pps = bitstream->nal_units[2]->nal_unit_payload->pps;
+    ASSERT_NE(nullptr, pps);
+    EXPECT_EQ(0, pps->tiles_enabled_flag);
+    EXPECT_EQ(1, pps->diff_cu_qp_delta_depth);
+    EXPECT_EQ(-2, pps->pps_cb_qp_offset);
+    EXPECT_EQ(2, pps->pps_cr_qp_offset);
+    EXPECT_EQ(1, pps->slice_segment_header_extension_present_flag);
+
+    for (size_t i = 3; i < bitstream->nal_units.size(); i++) {
+      const auto& slice_segment_header =
+          bitstream->nal_units[i]
+              ->nal_unit_payload->slice_segment_layer->slice_segment_header;
+      ASSERT_NE(nullptr, slice_segment_header);
+      bool dependent = (tile_id == 0 && i == 5);
+      EXPECT_EQ(dependent ? 0 : 1,
+                slice_segment_header->first_slice_segment_in_pic_flag);
+      EXPECT_EQ(dependent ? 1 : 0,
+                slice_segment_header->dependent_slice_segment_flag);
+      // second CTB row of a 3-CTB wide tile
+      EXPECT_EQ(dependent ? 3 : 0,
+                slice_segment_header->slice_segment_address);
+      if (!dependent) {
+        EXPECT_EQ(2, slice_segment_header->slice_type);
+        EXPECT_EQ(3, slice_segment_header->slice_qp_delta);
+      }
+      EXPECT_EQ(1,
+                slice_segment_header->slice_segment_header_extension_length);
+      EXPECT_THAT(
+          slice_segment_header->slice_segment_header_extension_data_byte,
+          ::testing::ElementsAreArray({0x5a}));
+    }
+
+    // the slice segment data is referenced in the input stream
+    const auto& last_chunk = sub_bitstream.chunks.back();
+    ASSERT_NE(nullptr, last_chunk.data);
+    EXPECT_GE(last_chunk.data, stream.data());
+    EXPECT_LT(last_chunk.data, stream.data() + stream.size());
+    EXPECT_THAT(std::vector<uint8_t>(last_chunk.data,
+                                     last_chunk.data + last_chunk.length),
+                ::testing::ElementsAreArray(
+                    GetSliceData(kLastAddress[tile_id])));
+  }
+}
+
+TEST_F(H265MctsExtractorTest, TestRepeatedPps) {
+  // a PPS repeated before the second picture replaces the cached tile
+  // geometry of the first one
+  AppendSlice(0, 0, &stream);
+  AppendSlice(3, 0, &stream);
+  AppendSlice(14, 0, &stream);
+  AppendSlice(17, 0, &stream);
+  AppendPps(&stream);
+  AppendSlice(0, 0, &stream);
+  AppendSlice(3, 0, &stream);
+  AppendSlice(14, 0, &stream);
+  AppendSlice(17, 0, &stream);
+
+  auto extractor = H265MctsExtractor::Extract(stream.data(), stream.size());
+  ASSERT_NE(nullptr, extractor);
+  const auto& sub_bitstreams = extractor->sub_bitstreams();
+  ASSERT_EQ(4, sub_bitstreams.size());
+  std::vector<uint8_t> buffer;
+  for (uint32_t tile_id = 0; tile_id < 4; tile_id++) {
+    auto bitstream = ParseSubBitstream(*sub_bitstreams[tile_id], &buffer);
+    ASSERT_NE(nullptr, bitstream);
+    size_t num_slices = 0;
+    for (const auto& nal_unit : bitstream->nal_units) {
+      if (nal_unit->nal_unit_payload->slice_segment_layer != nullptr) {
+        num_slices++;
+      }
+    }
+    EXPECT_EQ(2, num_slices);
+  }
+}
+
+TEST_F(H265MctsExtractorTest, TestSliceSpanningTiles) {
+  // the first slice segment covers the first two tiles
+  AppendSlice(0, 0, &stream);
+  AppendSlice(14, 0, &stream);
+  AppendSlice(17, 0, &stream);
+  EXPECT_EQ(nullptr, H265MctsExtractor::Extract(stream.data(), stream.size()));
+}
+
+TEST_F(H265MctsExtractorTest, TestIncompletePicture) {
+  // the last slice segment is in the first tile
+  AppendSlice(0, 0, &stream);
+  H265MctsExtractor extractor;
+  auto nalu_indices =
+      H265BitstreamParser::FindNaluIndices(stream.data(), stream.size());
+  for (const auto& nalu_index : nalu_indices) {
+    EXPECT_TRUE(extractor.ProcessNalUnit(
+        stream.data() + nalu_index.payload_start_offset,
+        nalu_index.payload_size));
+  }
+  EXPECT_FALSE(extractor.each_tile_one_tile_set());
+  EXPECT_EQ(4, extractor.sub_bitstreams().size());
+  EXPECT_FALSE(extractor.Finish());
+}
+
+}  // namespace h265nal
@@ -0,0 +1,573 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_mp4_demuxer.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_nal_unit_payload_parser.h"
+#include "rtc_base/arraysize.h"
+
+namespace h265nal {
+
+namespace {
+// NAL units of a 1280x720 stream (VPS, SPS, PPS, and 3 frames).
+// VPS
+const uint8_t kVps[] = {
+    0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+    0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03,
+    0x00, 0x00, 0x03, 0x00, 0x5d, 0xac, 0x59
+};
+
+// SPS
+const uint8_t kSps[] = {
+    0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03,
+    0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+    0x00, 0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2e, 0x1f,
+    0x13, 0x96, 0xbb, 0x93, 0x24, 0xbb, 0x95, 0x82,
+    0x83, 0x03, 0x01, 0x76, 0x85, 0x09, 0x40
+};
+
+// PPS
+const uint8_t kPps[] = {
+    0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02, 0x10
+};
+
+// slice (IDR)
+const uint8_t kIdrSlice[] = {
+    0x26, 0x01, 0xaf, 0x09, 0x40, 0xfb, 0x27, 0x5b,
+    0xfd, 0x5d, 0xc2, 0x4d, 0xe8, 0xb2, 0x0f, 0xcd,
+    0x68, 0xdb, 0xc3, 0x41, 0x12, 0x2e, 0x13, 0x8d,
+    0xdf, 0x66, 0xc9, 0x1f, 0xaa, 0xd4, 0x9b, 0x8d,
+    0xdd, 0xe2, 0xa1, 0xda, 0x2e, 0xbd, 0x53, 0x74,
+    0xd1, 0xbb, 0xde, 0x54, 0x8f, 0xa5, 0xe7, 0x2f,
+    0xcc, 0xf7, 0x98, 0xd6, 0x33, 0xd5, 0x06, 0x01,
+    0x52, 0x84, 0xbc, 0xa7, 0xe6, 0x02, 0x7f, 0xe9,
+    0x50, 0x0a, 0x9a, 0x60, 0x89, 0xa0, 0xc0, 0xb4,
+    0x6d, 0x60, 0x53, 0xe5, 0xdd, 0x93, 0xde, 0x03,
+    0xff, 0xa8, 0xb0, 0x4d, 0x27, 0xa5, 0x82, 0xba,
+    0xac, 0x63, 0x8b, 0x6f, 0x69, 0x7f, 0x93, 0xb2,
+    0xe3, 0x0c, 0xfd, 0x29, 0x44, 0x42, 0xa7, 0x13,
+    0xe9, 0xec, 0x37, 0xbb, 0x93, 0xe0, 0x62, 0xa9,
+    0xa4, 0x44, 0x45, 0x59, 0x16, 0xf6, 0xb6, 0x5b,
+    0x3a, 0xdb, 0xc3
+};
+
+// slice (P-frame)
+const uint8_t kPSlice1[] = {
+    0x02, 0x01, 0xd0, 0x0f, 0xe4, 0x16, 0x80, 0xf4,
+    0x5a, 0xb4, 0x85, 0x6b, 0x17, 0xaa, 0xc1, 0x94,
+    0xa8, 0x9f, 0x32, 0x11, 0xe4, 0x44, 0xa5, 0xfd,
+    0xe7, 0x80, 0xda, 0xea, 0x21, 0x4c, 0x08, 0x23,
+    0xea, 0x58, 0x15, 0xa3, 0x4c, 0x1a, 0xb3, 0x80,
+    0x9b, 0x63, 0x50, 0x11, 0x75, 0x9a, 0xcc, 0x06,
+    0x09, 0x69, 0x97, 0x75, 0xa0, 0x02, 0x24, 0x22,
+    0x1c, 0x06, 0xa5, 0x69, 0x6e, 0xba, 0x9c, 0x79,
+    0x58, 0x1e, 0x52, 0xa8, 0x26, 0xfe, 0x98, 0x6f,
+    0x65, 0xee, 0x57, 0x10, 0x4f, 0x67, 0xe8, 0x43,
+    0xde, 0x8e, 0xe6, 0x40, 0x28, 0x36, 0x45, 0x06,
+    0x5e, 0xe8, 0x80, 0x34, 0xc0, 0x06, 0xf2, 0x16,
+    0x4b, 0x78, 0x5f, 0x98, 0x56, 0xcc, 0xd9, 0x59,
+    0x7a, 0xf3, 0x30, 0x5d, 0xa9, 0xc7, 0x84, 0x4a,
+    0xe0, 0x16, 0xbf, 0x07, 0x24, 0x32, 0x65, 0xbd,
+    0x39, 0xe2, 0x30, 0xbf, 0x27, 0xd3, 0x61, 0x25,
+    0x02, 0xae, 0x5a, 0xa1, 0x08, 0x9b, 0x90, 0x14,
+    0x2a, 0x09, 0xd1, 0x4a
+};
+
+// slice (P-frame)
+const uint8_t kPSlice2[] = {
+    0x02, 0x01, 0xd0, 0x17, 0xe4, 0x08, 0x20, 0xfc,
+    0xc1, 0xf5, 0x88, 0x40, 0xcf, 0xf0, 0x00, 0x00,
+    0x03, 0x00, 0x05, 0xe0, 0x46, 0x9d, 0x90, 0xa1,
+    0x98, 0x43, 0x28, 0x48, 0xe9, 0xc6, 0xf3, 0x11,
+    0xeb, 0x29, 0x19, 0xcd, 0x34, 0x85, 0x8b, 0xc5,
+    0x21, 0xf5, 0x5a, 0x46, 0xd7, 0x5a, 0xa5, 0x34,
+    0xa6, 0xad, 0x91, 0xd6, 0x5e, 0x71, 0x18, 0x94,
+    0xe9, 0x44, 0x2a, 0x84, 0x04, 0x2c, 0x80, 0xb0,
+    0xb4, 0x03, 0xf0, 0xa0, 0xe6, 0xe6, 0x14, 0xb3,
+    0xf2, 0xfa, 0x57, 0x5e, 0x29, 0xd1, 0xe1, 0x4d,
+    0x9b, 0x17, 0xea, 0xf8, 0x5c, 0xd5, 0x0a, 0x72,
+    0xe6, 0x5e, 0x42, 0xed, 0xdd, 0xbe, 0x64, 0x38,
+    0x04, 0x5d, 0x84, 0xc7, 0x02, 0xb0, 0x50, 0x21,
+    0x3f, 0x02, 0x89, 0x83
+};
+
+typedef std::vector<uint8_t> Bytes;
+
+void AppendU16(Bytes* bytes, uint32_t value) {
+  bytes->push_back(value >> 8);
+  bytes->push_back(value);
+}
+
+void AppendU32(Bytes* bytes, uint32_t value) {
+  AppendU16(bytes, value >> 16);
+  AppendU16(bytes, value);
+}
+
+void Append(Bytes* bytes, const Bytes& other) {
+  bytes->insert(bytes->end(), other.begin(), other.end());
+}
+
+Bytes MakeBox(const char* type, const Bytes& payload) {
+  Bytes box;
+  AppendU32(&box, 8 + payload.size());
+  box.insert(box.end(), type, type + 4);
+  Append(&box, payload);
+  return box;
+}
+
+Bytes MakeFullBox(const char* type, uint32_t version, uint32_t flags,
+                  const Bytes& payload) {
+  Bytes full_box;
+  AppendU32(&full_box, (version << 24) | flags);
+  Append(&full_box, payload);
+  return MakeBox(type, full_box);
+}
+
+// A sample: NAL units with 4-byte size fields.
+Bytes MakeSample(const uint8_t* nal_unit, size_t length) {
+  Bytes sample;
+  AppendU32(&sample, length);
+  sample.insert(sample.end(), nal_unit, nal_unit + length);
+  return sample;
+}
+
+// An hvc1 sample entry, with an hvcC box containing the parameter sets.
+Bytes MakeStsd() {
+  Bytes hvcc(23, 0);
+  hvcc[0] = 1;
+  // lengthSizeMinusOne: 3
+  hvcc[21] = 0xff;
+  hvcc[22] = 3;
+  const struct {
+    const uint8_t* data;
+    size_t length;
+  } parameter_sets[] = {{kVps, arraysize(kVps)},
+                        {kSps, arraysize(kSps)},
+                        {kPps, arraysize(kPps)}};
+  for (const auto& parameter_set : parameter_sets) {
+    // array_completeness and NAL_unit_type
+    hvcc.push_back(0x80 | (parameter_set.data[0] >> 1));
+    AppendU16(&hvcc, 1);
+    AppendU16(&hvcc, parameter_set.length);
+    hvcc.insert(hvcc.end(), parameter_set.data,
+                parameter_set.data + parameter_set.length);
+  }
+  Bytes hvc1(78, 0);
+  // data_reference_index
+  hvc1[7] = 1;
+  // width and height
+  hvc1[24] = 1280 >> 8;
+  hvc1[25] = 1280 & 0xff;
+  hvc1[26] = 720 >> 8;
+  hvc1[27] = 720 & 0xff;
+  Append(&hvc1, MakeBox("hvcC", hvcc));
+  Bytes stsd;
+  AppendU32(&stsd, 1);
+  Append(&stsd, MakeBox("hvc1", hvc1));
+  return MakeFullBox("stsd", 0, 0, stsd);
+}
+
+// A trak box, with the sample tables in `stbl`.
+Bytes MakeTrak(const Bytes& stbl) {
+  Bytes tkhd(20, 0);
+  // track_ID
+  tkhd[11] = 1;
+  Bytes mdhd(16, 0);
+  // timescale: 15360
+  mdhd[10] = 15360 >> 8;
+  Bytes hdlr(20, 0);
+  hdlr[4] = 'v';
+  hdlr[5] = 'i';
+  hdlr[6] = 'd';
+  hdlr[7] = 'e';
+  Bytes mdia;
+  Append(&mdia, MakeFullBox("mdhd", 0, 0, mdhd));
+  Append(&mdia, MakeFullBox("hdlr", 0, 0, hdlr));
+  Append(&mdia, MakeBox("minf", MakeBox("stbl", stbl)));
+  Bytes trak;
+  Append(&trak, MakeFullBox("tkhd", 0, 3, tkhd));
+  Append(&trak, MakeBox("mdia", mdia));
+  return MakeBox("trak", trak);
+}
+
+Bytes MakeFtyp() {
+  const char kFtyp[] = "isom\0\0\0\0isomhvc1";
+  return MakeBox("ftyp", Bytes(kFtyp, kFtyp + 16));
+}
+}  // namespace
+
+class H265Mp4DemuxerTest : public ::testing::Test {
+ public:
+  H265Mp4DemuxerTest() {}
+  ~H265Mp4DemuxerTest() override {}
+};
+
+TEST_F(H265Mp4DemuxerTest, TestSampleTables) {
+  // ftyp, moov, and mdat (2 chunks: 2 samples, and 1 sample)
+  Bytes samples[] = {MakeSample(kIdrSlice, arraysize(kIdrSlice)),
+                     MakeSample(kPSlice1, arraysize(kPSlice1)),
+                     MakeSample(kPSlice2, arraysize(kPSlice2))};
+  Bytes file = MakeFtyp();
+  // the moov box size does not depend on the chunk offsets
+  for (int pass = 0; pass < 2; pass++) {
+    size_t mdat_offset = (pass == 0) ? 0 : file.size();
+    Bytes stts, stss, stsc, stsz, stco;
+    AppendU32(&stts, 1);
+    AppendU32(&stts, 3);
+    AppendU32(&stts, 512);
+    AppendU32(&stss, 1);
+    AppendU32(&stss, 1);
+    AppendU32(&stsc, 1);
+    AppendU32(&stsc, 1);
+    AppendU32(&stsc, 2);
+    AppendU32(&stsc, 1);
+    AppendU32(&stsz, 0);
+    AppendU32(&stsz, 3);
+    for (const auto& sample : samples) {
+      AppendU32(&stsz, sample.size());
+    }
+    AppendU32(&stco, 2);
+    AppendU32(&stco, mdat_offset + 8);
+    AppendU32(&stco, mdat_offset + 8 + samples[0].size() + samples[1].size());
+    Bytes stbl = MakeStsd();
+    Append(&stbl, MakeFullBox("stts", 0, 0, stts));
+    Append(&stbl, MakeFullBox("stss", 0, 0, stss));
+    Append(&stbl, MakeFullBox("stsc", 0, 0, stsc));
+    Append(&stbl, MakeFullBox("stsz", 0, 0, stsz));
+    Append(&stbl, MakeFullBox("stco", 0, 0, stco));
+    Bytes moov = MakeBox("moov", MakeTrak(stbl));
+    if (pass == 1) {
+      file.resize(MakeFtyp().size());
+    }
+    Append(&file, moov);
+  }
+  Bytes mdat;
+  for (const auto& sample : samples) {
+    Append(&mdat, sample);
+  }
+  Append(&file, MakeBox("mdat", mdat));
+
+  ASSERT_TRUE(H265Mp4Demuxer::IsMp4(file.data(), file.size()));
+  auto demuxer = H265Mp4Demuxer::Open(file.data(), file.size());
+  ASSERT_TRUE(demuxer != nullptr);
+
+  const auto& track = demuxer->track();
+  EXPECT_EQ(track.track_id, 1);
+  EXPECT_EQ(track.timescale, 15360);
+  EXPECT_STREQ(track.sample_entry, "hvc1");
+  EXPECT_EQ(track.width, 1280);
+  EXPECT_EQ(track.height, 720);
+  EXPECT_EQ(track.length_size, 4);
+  EXPECT_EQ(track.parameter_sets.size(), 3);
+  EXPECT_FALSE(track.fragmented);
+
+  const auto& mp4_samples = demuxer->samples();
+  ASSERT_EQ(mp4_samples.size(), 3);
+  for (size_t i = 0; i < mp4_samples.size(); i++) {
+    EXPECT_EQ(mp4_samples[i].size, samples[i].size());
+    EXPECT_EQ(mp4_samples[i].decode_time, 512 * i);
+    EXPECT_EQ(mp4_samples[i].duration, 512);
+    EXPECT_EQ(mp4_samples[i].is_sync, i == 0);
+  }
+  // samples are views into the file
+  EXPECT_EQ(demuxer->GetSampleData(mp4_samples[2])[4], kPSlice2[0]);
+  auto sample_nalu_indices = demuxer->GetSampleNaluIndices(mp4_samples[1]);
+  ASSERT_EQ(sample_nalu_indices.size(), 1);
+  EXPECT_EQ(sample_nalu_indices[0].payload_start_offset,
+            mp4_samples[1].offset + 4);
+  EXPECT_EQ(sample_nalu_indices[0].payload_size, arraysize(kPSlice1));
+
+  // parse the whole track
+  H265BitstreamParserState bitstream_parser_state;
+  auto bitstream = H265BitstreamParser::ParseBitstream(
+      file.data(), file.size(), demuxer->GetNaluIndices(),
+      &bitstream_parser_state, ParsingOptions());
+  ASSERT_TRUE(bitstream != nullptr);
+  ASSERT_EQ(bitstream->nal_units.size(), 6);
+  const uint32_t kNalUnitTypes[] = {VPS_NUT,    SPS_NUT, PPS_NUT,
+                                    IDR_W_RADL, TRAIL_R, TRAIL_R};
+  for (size_t i = 0; i < bitstream->nal_units.size(); i++) {
+    const auto& nal_unit = bitstream->nal_units[i];
+    EXPECT_EQ(nal_unit->nal_unit_header->nal_unit_type, kNalUnitTypes[i]);
+    EXPECT_EQ(H265NalUnitPayloadParser::GetFailedPayloadStructure(
+                  kNalUnitTypes[i], *(nal_unit->nal_unit_payload)),
+              nullptr);
+  }
+}
+
+TEST_F(H265Mp4DemuxerTest, TestOutOfRangeChunkOffsets) {
+  // ftyp, moov (1 chunk: 1 sample, with a 64-bit chunk offset), and mdat
+  Bytes sample = MakeSample(kIdrSlice, arraysize(kIdrSlice));
+  auto make_file = [&sample](uint64_t chunk_offset) {
+    Bytes stts, stsc, stsz, co64;
+    AppendU32(&stts, 1);
+    AppendU32(&stts, 1);
+    AppendU32(&stts, 512);
+    AppendU32(&stsc, 1);
+    AppendU32(&stsc, 1);
+    AppendU32(&stsc, 1);
+    AppendU32(&stsc, 1);
+    AppendU32(&stsz, sample.size());
+    AppendU32(&stsz, 1);
+    AppendU32(&co64, 1);
+    AppendU32(&co64, chunk_offset >> 32);
+    AppendU32(&co64, chunk_offset);
+    Bytes stbl = MakeStsd();
+    Append(&stbl, MakeFullBox("stts", 0, 0, stts));
+    Append(&stbl, MakeFullBox("stsc", 0, 0, stsc));
+    Append(&stbl, MakeFullBox("stsz", 0, 0, stsz));
+    Append(&stbl, MakeFullBox("co64", 0, 0, co64));
+    Bytes file = MakeFtyp();
+    Append(&file, MakeBox("moov", MakeTrak(stbl)));
+    Append(&file, MakeBox("mdat", sample));
+    return file;
+  };
+  // the moov size does not depend on the chunk offset
+  const uint64_t sample_offset = make_file(0).size() - sample.size();
+
+  // a chunk offset in the file
+  Bytes file = make_file(sample_offset);
+  auto demuxer = H265Mp4Demuxer::Open(file.data(), file.size());
+  ASSERT_TRUE(demuxer != nullptr);
+  ASSERT_EQ(demuxer->samples().size(), 1);
+  EXPECT_EQ(demuxer->samples()[0].offset, sample_offset);
+
+  // a sample truncated by the end of the file
+  file = make_file(sample_offset + 4);
+  demuxer = H265Mp4Demuxer::Open(file.data(), file.size());
+  ASSERT_TRUE(demuxer != nullptr);
+  EXPECT_EQ(demuxer->samples().size(), 0);
+
+  // a chunk offset that wraps around when the sample size is added
+  file = make_file(0xfffffffffffffff8ull);
+  demuxer = H265Mp4Demuxer::Open(file.data(), file.size());
+  ASSERT_TRUE(demuxer != nullptr);
+  EXPECT_EQ(demuxer->samples().size(), 0);
+}
+
+TEST_F(H265Mp4DemuxerTest, TestCompactSampleSizes) {
+  // ftyp, moov (1 chunk: 1 sample, with an stz2 box), and mdat
+  Bytes sample = MakeSample(kIdrSlice, arraysize(kIdrSlice));
+  auto make_file = [&sample](uint32_t field_size, uint32_t sample_count) {
+    Bytes stts, stsc, stz2, stco;
+    AppendU32(&stts, 1);
+    AppendU32(&stts, 1);
+    AppendU32(&stts, 512);
+    AppendU32(&stsc, 1);
+    AppendU32(&stsc, 1);
+    AppendU32(&stsc, 1);
+    AppendU32(&stsc, 1);
+    // reserved (24 bits), field_size (8 bits), and 1 16-bit entry
+    AppendU32(&stz2, field_size);
+    AppendU32(&stz2, sample_count);
+    AppendU16(&stz2, sample.size());
+    AppendU32(&stco, 1);
+    AppendU32(&stco, 0);
+    Bytes stbl = MakeStsd();
+    Append(&stbl, MakeFullBox("stts", 0, 0, stts));
+    Append(&stbl, MakeFullBox("stsc", 0, 0, stsc));
+    Append(&stbl, MakeFullBox("stz2", 0, 0, stz2));
+    Append(&stbl, MakeFullBox("stco", 0, 0, stco));
+    Bytes file = MakeFtyp();
+    Append(&file, MakeBox("moov", MakeTrak(stbl)));
+    // patch the chunk offset (the last 4 bytes of the moov box)
+    uint32_t chunk_offset = file.size() + 8;
+    for (int i = 0; i < 4; i++) {
+      file[file.size() - 1 - i] = chunk_offset >> (8 * i);
+    }
+    Append(&file, MakeBox("mdat", sample));
+    return file;
+  };
+
+  Bytes file = make_file(16, 1);
+  auto demuxer = H265Mp4Demuxer::Open(file.data(), file.size());
+  ASSERT_TRUE(demuxer != nullptr);
+  ASSERT_EQ(demuxer->samples().size(), 1);
+  EXPECT_EQ(demuxer->samples()[0].size, sample.size());
+
+  // field_size must be 4, 8, or 16
+  file = make_file(12, 1);
+  demuxer = H265Mp4Demuxer::Open(file.data(), file.size());
+  ASSERT_TRUE(demuxer != nullptr);
+  EXPECT_EQ(demuxer->samples().size(), 0);
+
+  // more entries than the box holds
+  file = make_file(16, 0xffffffff);
+  demuxer = H265Mp4Demuxer::Open(file.data(), file.size());
+  ASSERT_TRUE(demuxer != nullptr);
+  EXPECT_EQ(demuxer->samples().size(), 0);
+}
+
+TEST_F(H265Mp4DemuxerTest, TestContainerDepth) {
+  Bytes empty_table;
+  AppendU32(&empty_table, 0);
+  Bytes stbl = MakeStsd();
+  Append(&stbl, MakeFullBox("stts", 0, 0, empty_table));
+
+  // the sample tables at their usual depth
+  Bytes file = MakeFtyp();
+  Append(&file, MakeBox("moov", MakeTrak(stbl)));
+  EXPECT_TRUE(H265Mp4Demuxer::Open(file.data(), file.size()) != nullptr);
+
+  // the sample tables nested too deep are ignored
+  Bytes nested = MakeBox("stbl", stbl);
+  for (int i = 0; i < 16; i++) {
+    nested = MakeBox("minf", nested);
+  }
+  file = MakeFtyp();
+  Append(&file, MakeBox("moov", MakeTrak(nested)));
+  EXPECT_TRUE(H265Mp4Demuxer::Open(file.data(), file.size()) == nullptr);
+}
+
+TEST_F(H265Mp4DemuxerTest, TestFragments) {
+  // ftyp, moov (with empty sample tables), and moof/mdat
+  Bytes empty_table;
+  AppendU32(&empty_table, 0);
+  Bytes empty_stsz;
+  AppendU32(&empty_stsz, 0);
+  AppendU32(&empty_stsz, 0);
+  Bytes stbl = MakeStsd();
+  Append(&stbl, MakeFullBox("stts", 0, 0, empty_table));
+  Append(&stbl, MakeFullBox("stsc", 0, 0, empty_table));
+  Append(&stbl, MakeFullBox("stsz", 0, 0, empty_stsz));
+  Append(&stbl, MakeFullBox("stco", 0, 0, empty_table));
+  Bytes trex;
+  // track_ID, default_sample_description_index, default_sample_duration,
+  // default_sample_size, and default_sample_flags (non-sync)
+  AppendU32(&trex, 1);
+  AppendU32(&trex, 1);
+  AppendU32(&trex, 512);
+  AppendU32(&trex, 0);
+  AppendU32(&trex, 0x00010000);
+  Bytes moov = MakeTrak(stbl);
+  Append(&moov, MakeBox("mvex", MakeFullBox("trex", 0, 0, trex)));
+  Bytes file = MakeFtyp();
+  Append(&file, MakeBox("moov", moov));
+
+  Bytes samples[] = {MakeSample(kIdrSlice, arraysize(kIdrSlice)),
+                     MakeSample(kPSlice1, arraysize(kPSlice1))};
+  Bytes moof;
+  for (int pass = 0; pass < 2; pass++) {
+    Bytes tfhd, tfdt, trun;
+    // default-base-is-moof
+    AppendU32(&tfhd, 1);
+    // baseMediaDecodeTime (64 bits)
+    AppendU32(&tfdt, 0);
+    AppendU32(&tfdt, 1024);
+    // data-offset, first-sample-flags, and sample-size
+    AppendU32(&trun, 2);
+    AppendU32(&trun, (pass == 0) ? 0 : moof.size() + 8);
+    AppendU32(&trun, 0x02000000);
+    for (const auto& sample : samples) {
+      AppendU32(&trun, sample.size());
+    }
+    Bytes traf = MakeFullBox("tfhd", 0, 0x020000, tfhd);
+    Append(&traf, MakeFullBox("tfdt", 1, 0, tfdt));
+    Append(&traf, MakeFullBox("trun", 0, 0x000205, trun));
+    Bytes mfhd;
+    AppendU32(&mfhd, 1);
+    moof = MakeFullBox("mfhd", 0, 0, mfhd);
+    Append(&moof, MakeBox("traf", traf));
+    moof = MakeBox("moof", moof);
+  }
+  size_t moof_offset = file.size();
+  Append(&file, moof);
+  Bytes mdat;
+  for (const auto& sample : samples) {
+    Append(&mdat, sample);
+  }
+  Append(&file, MakeBox("mdat", mdat));
+
+  auto demuxer = H265Mp4Demuxer::Open(file.data(), file.size());
+  ASSERT_TRUE(demuxer != nullptr);
+  EXPECT_TRUE(demuxer->track().fragmented);
+  const auto& mp4_samples = demuxer->samples();
+  ASSERT_EQ(mp4_samples.size(), 2);
+  EXPECT_EQ(mp4_samples[0].offset, moof_offset + moof.size() + 8);
+  EXPECT_EQ(mp4_samples[0].size, samples[0].size());
+  EXPECT_EQ(mp4_samples[0].decode_time, 1024);
+  EXPECT_EQ(mp4_samples[0].duration, 512);
+  EXPECT_TRUE(mp4_samples[0].is_sync);
+  EXPECT_EQ(mp4_samples[1].offset, mp4_samples[0].offset + samples[0].size());
+  EXPECT_EQ(mp4_samples[1].decode_time, 1536);
+  EXPECT_FALSE(mp4_samples[1].is_sync);
+
+  // hvcC parameter sets, and 2 slices
+  EXPECT_EQ(demuxer->GetNaluIndices().size(), 5);
+}
+
+TEST_F(H265Mp4DemuxerTest, TestTrunSampleCount) {
+  // ftyp, moov (with empty sample tables), and a moof/mdat with a trun
+  // box without per-sample fields, and a huge sample_count
+  Bytes sample = MakeSample(kIdrSlice, arraysize(kIdrSlice));
+  auto make_file = [&sample](uint32_t default_sample_size) {
+    Bytes empty_table;
+    AppendU32(&empty_table, 0);
+    Bytes empty_stsz;
+    AppendU32(&empty_stsz, 0);
+    AppendU32(&empty_stsz, 0);
+    Bytes stbl = MakeStsd();
+    Append(&stbl, MakeFullBox("stts", 0, 0, empty_table));
+    Append(&stbl, MakeFullBox("stsc", 0, 0, empty_table));
+    Append(&stbl, MakeFullBox("stsz", 0, 0, empty_stsz));
+    Append(&stbl, MakeFullBox("stco", 0, 0, empty_table));
+    Bytes trex;
+    AppendU32(&trex, 1);
+    AppendU32(&trex, 1);
+    AppendU32(&trex, 512);
+    AppendU32(&trex, default_sample_size);
+    AppendU32(&trex, 0);
+    Bytes moov = MakeTrak(stbl);
+    Append(&moov, MakeBox("mvex", MakeFullBox("trex", 0, 0, trex)));
+    Bytes file = MakeFtyp();
+    Append(&file, MakeBox("moov", moov));
+
+    Bytes tfhd, trun, mfhd;
+    // default-base-is-moof
+    AppendU32(&tfhd, 1);
+    // sample_count, and data-offset: after the moof box (header, mfhd,
+    // traf header, tfhd, and trun) and the mdat header
+    AppendU32(&trun, 0xffffffff);
+    AppendU32(&trun, 8 + 16 + 8 + 16 + 20 + 8);
+    Bytes traf = MakeFullBox("tfhd", 0, 0x020000, tfhd);
+    Append(&traf, MakeFullBox("trun", 0, 0x000001, trun));
+    AppendU32(&mfhd, 1);
+    Bytes moof = MakeFullBox("mfhd", 0, 0, mfhd);
+    Append(&moof, MakeBox("traf", traf));
+    Append(&file, MakeBox("moof", moof));
+    Append(&file, MakeBox("mdat", sample));
+    return file;
+  };
+
+  // the samples are bounded by the file size
+  Bytes file = make_file(sample.size());
+  auto demuxer = H265Mp4Demuxer::Open(file.data(), file.size());
+  ASSERT_TRUE(demuxer != nullptr);
+  ASSERT_EQ(demuxer->samples().size(), 1);
+  EXPECT_EQ(demuxer->samples()[0].offset, file.size() - sample.size());
+
+  // empty samples are not added
+  file = make_file(0);
+  demuxer = H265Mp4Demuxer::Open(file.data(), file.size());
+  ASSERT_TRUE(demuxer != nullptr);
+  EXPECT_EQ(demuxer->samples().size(), 0);
+}
+
+TEST_F(H265Mp4DemuxerTest, TestNoH265Track) {
+  Bytes file = MakeFtyp();
+  Append(&file, MakeBox("moov", Bytes()));
+  EXPECT_TRUE(H265Mp4Demuxer::IsMp4(file.data(), file.size()));
+  EXPECT_TRUE(H265Mp4Demuxer::Open(file.data(), file.size()) == nullptr);
+  EXPECT_FALSE(H265Mp4Demuxer::IsMp4(kVps, arraysize(kVps)));
+}
+
+}  // namespace h265nal
@@ -124,6 +124,38 @@ TEST_F(H265NalUnitParserTest, TestSampleNalUnit) {
   EXPECT_EQ(0, vps->vps_extension_data_flag);
 }
 
+TEST_F(H265NalUnitParserTest, TestSeiNalUnit) {
+  // prefix SEI with a user_data_unregistered message, and a message whose
+  // payload overruns the NAL unit
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+      0x4e, 0x01,
+      // sei_message: user_data_unregistered (payload_size: 17)
+      0x05, 0x11, 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99,
+      0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x01,
+      // sei_message: unknown (payload_type: 200, payload_size: 50)
+      0xc8, 0x32, 0x01, 0x02, 0x03};
+  // fuzzer::conv: begin
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  auto nal_unit = H265NalUnitParser::ParseNalUnit(buffer, arraysize(buffer),
+                                                  &bitstream_parser_state,
+                                                  parsing_options);
+  // fuzzer::conv: end
+
+  ASSERT_TRUE(nal_unit != nullptr);
+  const auto& payload = nal_unit->nal_unit_payload;
+  // the message before the overrunning one is kept
+  ASSERT_TRUE(payload->sei_rbsp != nullptr);
+  ASSERT_EQ(2, payload->sei_rbsp->sei_message.size());
+  EXPECT_TRUE(payload->sei_rbsp->sei_message[0]->payload_state != nullptr);
+  EXPECT_EQ(50, payload->sei_rbsp->sei_message[1]->payload_size);
+  // the deprecated `sei` field is the first message
+  ASSERT_TRUE(payload->sei != nullptr);
+  EXPECT_EQ(payload->sei_rbsp->sei_message[0], payload->sei);
+  EXPECT_EQ(SeiType::user_data_unregistered, payload->sei->payload_type);
+}
+
 TEST_F(H265NalUnitParserTest, TestEmptyNalUnit) {
   const uint8_t buffer[] = {};
   H265BitstreamParserState bitstream_parser_state;
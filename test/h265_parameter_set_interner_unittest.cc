@@ -0,0 +1,140 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_parameter_set_interner.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "rtc_base/arraysize.h"
+
+namespace h265nal {
+
+namespace {
+// VPS, SPS, and PPS of a 1280x720 stream
+const uint8_t kParameterSets[] = {
+    0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01,
+    0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+    0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+    0x5d, 0xac, 0x59, 0x00, 0x00, 0x00, 0x01, 0x42,
+    0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+    0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+    0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2e, 0x1f, 0x13,
+    0x96, 0xbb, 0x93, 0x24, 0xbb, 0x95, 0x82, 0x83,
+    0x03, 0x01, 0x76, 0x85, 0x09, 0x40, 0x00, 0x00,
+    0x00, 0x01, 0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02,
+    0x10
+};
+
+// a PPS with a different constrained_intra_pred_flag
+const uint8_t kOtherPps[] = {
+    0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc0, 0xfb,
+    0xc0, 0x02, 0x10
+};
+}  // namespace
+
+class H265ParameterSetInternerTest : public ::testing::Test {
+ public:
+  H265ParameterSetInternerTest() {}
+  ~H265ParameterSetInternerTest() override {}
+
+  void Parse(const uint8_t* data, size_t length,
+             H265BitstreamParserState* bitstream_parser_state) {
+    ParsingOptions parsing_options;
+    auto bitstream = H265BitstreamParser::ParseBitstream(
+        data, length, bitstream_parser_state, parsing_options);
+    ASSERT_NE(nullptr, bitstream);
+  }
+};
+
+TEST_F(H265ParameterSetInternerTest, TestSharedParameterSets) {
+  H265ParameterSetInterner interner;
+  H265BitstreamParserState state0;
+  H265BitstreamParserState state1;
+  state0.parameter_set_interner = &interner;
+  state1.parameter_set_interner = &interner;
+  Parse(kParameterSets, arraysize(kParameterSets), &state0);
+  Parse(kParameterSets, arraysize(kParameterSets), &state1);
+
+  // both streams share the same parsed parameter sets
+  ASSERT_NE(nullptr, state0.GetSps(0));
+  EXPECT_EQ(state0.GetVps(0).get(), state1.GetVps(0).get());
+  EXPECT_EQ(state0.GetSps(0).get(), state1.GetSps(0).get());
+  EXPECT_EQ(state0.GetPps(0).get(), state1.GetPps(0).get());
+  EXPECT_EQ(3, interner.size());
+  EXPECT_EQ(3, interner.num_hits());
+  EXPECT_EQ(3, interner.num_misses());
+
+  // repeated parameter sets in the same stream
+  Parse(kParameterSets, arraysize(kParameterSets), &state0);
+  EXPECT_EQ(state0.GetSps(0).get(), state1.GetSps(0).get());
+  EXPECT_EQ(6, interner.num_hits());
+
+  // a different PPS is not shared
+  Parse(kOtherPps, arraysize(kOtherPps), &state1);
+  EXPECT_NE(state0.GetPps(0).get(), state1.GetPps(0).get());
+  EXPECT_EQ(0, state0.GetPps(0)->constrained_intra_pred_flag);
+  EXPECT_EQ(1, state1.GetPps(0)->constrained_intra_pred_flag);
+  EXPECT_EQ(4, interner.size());
+}
+
+TEST_F(H265ParameterSetInternerTest, TestWithoutInterner) {
+  H265BitstreamParserState state0;
+  H265BitstreamParserState state1;
+  Parse(kParameterSets, arraysize(kParameterSets), &state0);
+  Parse(kParameterSets, arraysize(kParameterSets), &state1);
+  EXPECT_NE(state0.GetSps(0).get(), state1.GetSps(0).get());
+}
+
+TEST_F(H265ParameterSetInternerTest, TestExpiry) {
+  H265ParameterSetInterner interner;
+  {
+    H265BitstreamParserState state;
+    state.parameter_set_interner = &interner;
+    Parse(kParameterSets, arraysize(kParameterSets), &state);
+    EXPECT_EQ(3, interner.size());
+  }
+  // no stream uses the parameter sets anymore
+  EXPECT_EQ(0, interner.size());
+  H265BitstreamParserState state;
+  state.parameter_set_interner = &interner;
+  Parse(kParameterSets, arraysize(kParameterSets), &state);
+  EXPECT_EQ(3, interner.size());
+  EXPECT_EQ(0, interner.num_hits());
+}
+
+TEST_F(H265ParameterSetInternerTest, TestConcurrentStreams) {
+  H265ParameterSetInterner* interner = H265ParameterSetInterner::GetGlobal();
+  const int kNumStreams = 8;
+  std::vector<std::unique_ptr<H265BitstreamParserState>> states;
+  for (int i = 0; i < kNumStreams; i++) {
+    states.emplace_back(new H265BitstreamParserState());
+    states.back()->parameter_set_interner = interner;
+  }
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumStreams; i++) {
+    threads.emplace_back([this, &states, i]() {
+      for (int j = 0; j < 50; j++) {
+        Parse(kParameterSets, arraysize(kParameterSets), states[i].get());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& state : states) {
+    ASSERT_NE(nullptr, state->GetSps(0));
+    EXPECT_EQ(states[0]->GetSps(0).get(), state->GetSps(0).get());
+    EXPECT_EQ(states[0]->GetPps(0).get(), state->GetPps(0).get());
+  }
+}
+
+}  // namespace h265nal
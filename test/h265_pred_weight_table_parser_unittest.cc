@@ -7,6 +7,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "h265_common.h"
 #include "rtc_base/arraysize.h"
 #include "rtc_base/bit_buffer.h"
@@ -32,10 +34,8 @@ TEST_F(H265PredWeightTableParserTest, TestSamplePredWeightTable1) {
 
   EXPECT_EQ(7, pred_weight_table->luma_log2_weight_denom);
   EXPECT_EQ(-1, pred_weight_table->delta_chroma_log2_weight_denom);
-  EXPECT_THAT(pred_weight_table->luma_weight_l0_flag,
-              ::testing::ElementsAreArray({0}));
-  EXPECT_THAT(pred_weight_table->chroma_weight_l0_flag,
-              ::testing::ElementsAreArray({0}));
+  EXPECT_EQ(0, pred_weight_table->luma_weight_l0_flag[0]);
+  EXPECT_EQ(0, pred_weight_table->chroma_weight_l0_flag[0]);
 }
 
 TEST_F(H265PredWeightTableParserTest, TestSamplePredWeightTable2) {
@@ -51,10 +51,105 @@ TEST_F(H265PredWeightTableParserTest, TestSamplePredWeightTable2) {
 
   EXPECT_EQ(7, pred_weight_table->luma_log2_weight_denom);
   EXPECT_EQ(-1, pred_weight_table->delta_chroma_log2_weight_denom);
-  EXPECT_THAT(pred_weight_table->luma_weight_l0_flag,
-              ::testing::ElementsAreArray({0, 0, 0}));
-  EXPECT_THAT(pred_weight_table->chroma_weight_l0_flag,
-              ::testing::ElementsAreArray({0, 0, 0}));
+  for (uint32_t i = 0; i < 3; i++) {
+    EXPECT_EQ(0, pred_weight_table->luma_weight_l0_flag[i]);
+    EXPECT_EQ(0, pred_weight_table->chroma_weight_l0_flag[i]);
+  }
+}
+
+TEST_F(H265PredWeightTableParserTest, TestExplicitWeights) {
+  std::vector<uint8_t> buffer(32);
+  rtc::BitBufferWriter writer(buffer.data(), buffer.size());
+  writer.WriteExponentialGolomb(6);         // luma_log2_weight_denom
+  writer.WriteSignedExponentialGolomb(-2);  // delta_chroma_log2_weight_denom
+  writer.WriteBits(0, 1);                   // luma_weight_l0_flag[0]
+  writer.WriteBits(1, 1);                   // luma_weight_l0_flag[1]
+  writer.WriteBits(1, 1);                   // chroma_weight_l0_flag[0]
+  writer.WriteBits(0, 1);                   // chroma_weight_l0_flag[1]
+  // delta_chroma_weight_l0[0][j] and delta_chroma_offset_l0[0][j]
+  writer.WriteSignedExponentialGolomb(-3);
+  writer.WriteSignedExponentialGolomb(5);
+  writer.WriteSignedExponentialGolomb(7);
+  writer.WriteSignedExponentialGolomb(-200);
+  writer.WriteSignedExponentialGolomb(-128);  // delta_luma_weight_l0[1]
+  writer.WriteSignedExponentialGolomb(-300);  // luma_offset_l0[1]
+
+  auto pred_weight_table = H265PredWeightTableParser::ParsePredWeightTable(
+      buffer.data(), buffer.size(), 1, 1);
+  ASSERT_TRUE(pred_weight_table != nullptr);
+
+  EXPECT_EQ(6, pred_weight_table->luma_log2_weight_denom);
+  EXPECT_EQ(-2, pred_weight_table->delta_chroma_log2_weight_denom);
+  EXPECT_EQ(0, pred_weight_table->luma_weight_l0_flag[0]);
+  EXPECT_EQ(1, pred_weight_table->luma_weight_l0_flag[1]);
+  EXPECT_EQ(1, pred_weight_table->chroma_weight_l0_flag[0]);
+  EXPECT_EQ(0, pred_weight_table->chroma_weight_l0_flag[1]);
+  // the entries are indexed by reference index
+  EXPECT_EQ(0, pred_weight_table->delta_luma_weight_l0[0]);
+  EXPECT_EQ(0, pred_weight_table->luma_offset_l0[0]);
+  EXPECT_EQ(-128, pred_weight_table->delta_luma_weight_l0[1]);
+  EXPECT_EQ(-300, pred_weight_table->luma_offset_l0[1]);
+  EXPECT_THAT(pred_weight_table->delta_chroma_weight_l0[0],
+              ::testing::ElementsAreArray({-3, 7}));
+  EXPECT_THAT(pred_weight_table->delta_chroma_offset_l0[0],
+              ::testing::ElementsAreArray({5, -200}));
+  EXPECT_THAT(pred_weight_table->delta_chroma_weight_l0[1],
+              ::testing::ElementsAreArray({0, 0}));
+}
+
+TEST_F(H265PredWeightTableParserTest, TestInvalidPredWeightTable) {
+  const uint8_t buffer[] = {0x10, 0xc0, 0x60, 0x00};
+  // num_ref_idx_l0_active_minus1 out of range
+  EXPECT_EQ(nullptr, H265PredWeightTableParser::ParsePredWeightTable(
+                         buffer, arraysize(buffer), 1, 15));
+
+  // delta_luma_weight_l0[0] out of range
+  std::vector<uint8_t> other_buffer(32);
+  rtc::BitBufferWriter writer(other_buffer.data(), other_buffer.size());
+  writer.WriteExponentialGolomb(6);          // luma_log2_weight_denom
+  writer.WriteBits(1, 1);                    // luma_weight_l0_flag[0]
+  writer.WriteSignedExponentialGolomb(128);  // delta_luma_weight_l0[0]
+  writer.WriteSignedExponentialGolomb(0);    // luma_offset_l0[0]
+  EXPECT_EQ(nullptr, H265PredWeightTableParser::ParsePredWeightTable(
+                         other_buffer.data(), other_buffer.size(), 0, 0));
+
+  // luma_log2_weight_denom out of range
+  std::vector<uint8_t> denom_buffer(32);
+  rtc::BitBufferWriter denom_writer(denom_buffer.data(), denom_buffer.size());
+  denom_writer.WriteExponentialGolomb(8);  // luma_log2_weight_denom
+  denom_writer.WriteBits(0, 1);            // luma_weight_l0_flag[0]
+  EXPECT_EQ(nullptr, H265PredWeightTableParser::ParsePredWeightTable(
+                         denom_buffer.data(), denom_buffer.size(), 0, 0));
+
+  // ChromaLog2WeightDenom out of range
+  std::vector<uint8_t> chroma_denom_buffer(32);
+  rtc::BitBufferWriter chroma_denom_writer(chroma_denom_buffer.data(),
+                                           chroma_denom_buffer.size());
+  // luma_log2_weight_denom and delta_chroma_log2_weight_denom
+  chroma_denom_writer.WriteExponentialGolomb(6);
+  chroma_denom_writer.WriteSignedExponentialGolomb(2);
+  chroma_denom_writer.WriteBits(0, 2);  // luma and chroma_weight_l0_flag[0]
+  EXPECT_EQ(nullptr, H265PredWeightTableParser::ParsePredWeightTable(
+                         chroma_denom_buffer.data(),
+                         chroma_denom_buffer.size(), 1, 0));
+
+  // delta_chroma_offset_l0[0][0] out of range
+  std::vector<uint8_t> offset_buffer(32);
+  rtc::BitBufferWriter offset_writer(offset_buffer.data(),
+                                     offset_buffer.size());
+  // luma_log2_weight_denom and delta_chroma_log2_weight_denom
+  offset_writer.WriteExponentialGolomb(6);
+  offset_writer.WriteSignedExponentialGolomb(0);
+  offset_writer.WriteBits(0, 1);  // luma_weight_l0_flag[0]
+  offset_writer.WriteBits(1, 1);  // chroma_weight_l0_flag[0]
+  // delta_chroma_weight_l0[0][0] and delta_chroma_offset_l0[0][0]
+  offset_writer.WriteSignedExponentialGolomb(0);
+  offset_writer.WriteSignedExponentialGolomb(4 * 32768);
+  // delta_chroma_weight_l0[0][1] and delta_chroma_offset_l0[0][1]
+  offset_writer.WriteSignedExponentialGolomb(0);
+  offset_writer.WriteSignedExponentialGolomb(0);
+  EXPECT_EQ(nullptr, H265PredWeightTableParser::ParsePredWeightTable(
+                         offset_buffer.data(), offset_buffer.size(), 1, 0));
 }
 
 }  // namespace h265nal
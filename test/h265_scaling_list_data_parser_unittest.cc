@@ -7,12 +7,68 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "h265_common.h"
 #include "rtc_base/arraysize.h"
 #include "rtc_base/bit_buffer.h"
 
 namespace h265nal {
 
+namespace {
+// Table 7-6, in up-right diagonal order
+const uint8_t kDefaultIntra[] = {
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 17, 16, 17, 16, 17, 18,
+    17, 18, 18, 17, 18, 21, 19, 20, 21, 20, 19, 21, 24, 22, 22, 24,
+    24, 22, 22, 24, 25, 25, 27, 30, 27, 25, 25, 29, 31, 35, 35, 31,
+    29, 36, 41, 44, 41, 36, 47, 54, 54, 47, 65, 70, 65, 88, 88, 115};
+const uint8_t kDefaultInter[] = {
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 17, 17, 17, 17, 17, 18,
+    18, 18, 18, 18, 18, 20, 20, 20, 20, 20, 20, 20, 24, 24, 24, 24,
+    24, 24, 24, 24, 25, 25, 25, 25, 25, 25, 25, 28, 28, 28, 28, 28,
+    28, 33, 33, 33, 33, 33, 41, 41, 41, 41, 54, 54, 54, 71, 71, 91};
+
+// the coded coefficients of ScalingList[sizeId][matrixId]
+std::vector<uint8_t> GetList(
+    const H265ScalingListDataParser::ScalingListDataState& scaling_list_data,
+    uint32_t sizeId, uint32_t matrixId) {
+  const uint8_t* list = scaling_list_data.ScalingList[sizeId][matrixId];
+  return std::vector<uint8_t>(list, list + ((sizeId == 0) ? 16 : 64));
+}
+
+std::vector<uint8_t> GetScalingFactor(
+    const H265ScalingListDataParser::ScalingFactorState& scaling_factor,
+    uint32_t sizeId, uint32_t matrixId) {
+  const uint8_t* factor = scaling_factor.getScalingFactor(sizeId, matrixId);
+  uint32_t size = 4 << sizeId;
+  return std::vector<uint8_t>(factor, factor + size * size);
+}
+
+// a list predicted from the default or a previous list
+void WritePredictedList(rtc::BitBufferWriter* writer,
+                        uint32_t scaling_list_pred_matrix_id_delta) {
+  writer->WriteBits(0, 1);  // scaling_list_pred_mode_flag
+  writer->WriteExponentialGolomb(scaling_list_pred_matrix_id_delta);
+}
+
+// an explicit list, starting at `first_coef` and then incremented by
+// `scaling_list_delta_coef`
+void WriteExplicitList(rtc::BitBufferWriter* writer, uint32_t sizeId,
+                       int32_t scaling_list_dc_coef_minus8, int32_t first_coef,
+                       int32_t scaling_list_delta_coef) {
+  writer->WriteBits(1, 1);  // scaling_list_pred_mode_flag
+  int32_t nextCoef = 8;
+  if (sizeId > 1) {
+    writer->WriteSignedExponentialGolomb(scaling_list_dc_coef_minus8);
+    nextCoef = scaling_list_dc_coef_minus8 + 8;
+  }
+  writer->WriteSignedExponentialGolomb(first_coef - nextCoef);
+  for (uint32_t i = 1; i < ((sizeId == 0) ? 16u : 64u); i++) {
+    writer->WriteSignedExponentialGolomb(scaling_list_delta_coef);
+  }
+}
+}  // namespace
+
 class H265ScalingListDataParserTest : public ::testing::Test {
  public:
   H265ScalingListDataParserTest() {}
@@ -64,7 +120,6 @@ TEST_F(H265ScalingListDataParserTest, TestSampleScalingListData01) {
   EXPECT_TRUE(scaling_list_data != nullptr);
 
   // scaling_list_pred_mode_flag
-  EXPECT_EQ(4, scaling_list_data->scaling_list_pred_mode_flag.size());
   EXPECT_THAT(scaling_list_data->scaling_list_pred_mode_flag[0],
               ::testing::ElementsAreArray({1, 1, 1, 1, 1, 1}));
   EXPECT_THAT(scaling_list_data->scaling_list_pred_mode_flag[1],
@@ -75,7 +130,6 @@ TEST_F(H265ScalingListDataParserTest, TestSampleScalingListData01) {
               ::testing::ElementsAreArray({1, 0, 0, 1, 0, 0}));
 
   // scaling_list_pred_matrix_id_delta[]
-  EXPECT_EQ(4, scaling_list_data->scaling_list_pred_matrix_id_delta.size());
   EXPECT_THAT(scaling_list_data->scaling_list_pred_matrix_id_delta[0],
               ::testing::ElementsAreArray({0, 0, 0, 0, 0, 0}));
   EXPECT_THAT(scaling_list_data->scaling_list_pred_matrix_id_delta[1],
@@ -86,79 +140,240 @@ TEST_F(H265ScalingListDataParserTest, TestSampleScalingListData01) {
               ::testing::ElementsAreArray({0, 0, 0, 0, 0, 0}));
 
   // scaling_list_dc_coef_minus8[]
-  EXPECT_EQ(4, scaling_list_data->scaling_list_dc_coef_minus8.size());
   EXPECT_THAT(scaling_list_data->scaling_list_dc_coef_minus8[0],
               ::testing::ElementsAreArray({0, 0, 0, 0, 0, 0}));
   EXPECT_THAT(scaling_list_data->scaling_list_dc_coef_minus8[1],
               ::testing::ElementsAreArray({0, 0, 0, 0, 0, 0}));
-  EXPECT_THAT(scaling_list_data->scaling_list_dc_coef_minus8[2],
-              ::testing::ElementsAreArray({0, 0, 0, 0, 0, 0}));
-  EXPECT_THAT(scaling_list_data->scaling_list_dc_coef_minus8[3],
-              ::testing::ElementsAreArray({0, 0, 0, 0, 0, 0}));
-
-  // ScalingList[]
-  EXPECT_EQ(4, scaling_list_data->ScalingList.size());
 
   // ScalingList[0]
-  EXPECT_EQ(6, scaling_list_data->ScalingList[0].size());
   for (uint32_t matrixId = 0; matrixId < 6; matrixId += 1) {
-    EXPECT_THAT(scaling_list_data->ScalingList[0][matrixId],
+    EXPECT_THAT(GetList(*scaling_list_data, 0, matrixId),
                 ::testing::ElementsAreArray({8, 8, 8, 8, 8, 8, 8, 8,
                                              8, 8, 8, 8, 8, 8, 8, 8}));
   }
 
-  // ScalingList[1]
-  EXPECT_EQ(6, scaling_list_data->ScalingList[1].size());
-  for (uint32_t matrixId = 0; matrixId < 6; matrixId += 1) {
-    EXPECT_THAT(scaling_list_data->ScalingList[1][matrixId],
-                ::testing::ElementsAreArray({8, 8, 8, 8, 8, 8, 8, 8,
-                                             8, 8, 8, 8, 8, 8, 8, 8,
-                                             8, 8, 8, 8, 8, 8, 8, 8,
-                                             8, 8, 8, 8, 8, 8, 8, 8,
-                                             8, 8, 8, 8, 8, 8, 8, 8,
-                                             8, 8, 8, 8, 8, 8, 8, 8,
-                                             8, 8, 8, 8, 8, 8, 8, 8,
-                                             8, 8, 8, 8, 8, 8, 8, 8}));
+  // ScalingList[1] and ScalingList[2]
+  for (uint32_t sizeId = 1; sizeId < 3; sizeId += 1) {
+    for (uint32_t matrixId = 0; matrixId < 6; matrixId += 1) {
+      EXPECT_THAT(GetList(*scaling_list_data, sizeId, matrixId),
+                  ::testing::Each(8));
+    }
   }
 
-  // ScalingList[2]
-  EXPECT_EQ(6, scaling_list_data->ScalingList[2].size());
-  for (uint32_t matrixId = 0; matrixId < 6; matrixId += 1) {
-    EXPECT_THAT(scaling_list_data->ScalingList[2][matrixId],
-                ::testing::ElementsAreArray({8, 8, 8, 8, 8, 8, 8, 8,
-                                             8, 8, 8, 8, 8, 8, 8, 8,
-                                             8, 8, 8, 8, 8, 8, 8, 8,
-                                             8, 8, 8, 8, 8, 8, 8, 8,
-                                             8, 8, 8, 8, 8, 8, 8, 8,
-                                             8, 8, 8, 8, 8, 8, 8, 8,
-                                             8, 8, 8, 8, 8, 8, 8, 8,
-                                             8, 8, 8, 8, 8, 8, 8, 8}));
+  // ScalingList[3]
+  EXPECT_THAT(GetList(*scaling_list_data, 3, 0), ::testing::Each(8));
+  EXPECT_THAT(GetList(*scaling_list_data, 3, 1), ::testing::Each(0));
+  EXPECT_THAT(GetList(*scaling_list_data, 3, 2), ::testing::Each(0));
+  EXPECT_THAT(GetList(*scaling_list_data, 3, 3), ::testing::Each(8));
+  EXPECT_THAT(GetList(*scaling_list_data, 3, 4), ::testing::Each(0));
+  EXPECT_THAT(GetList(*scaling_list_data, 3, 5), ::testing::Each(0));
+
+  // flat ScalingFactor arrays
+  auto scaling_factor = scaling_list_data->getScalingFactor();
+  ASSERT_NE(nullptr, scaling_factor);
+  for (uint32_t sizeId = 0; sizeId < 4; sizeId += 1) {
+    for (uint32_t matrixId = 0; matrixId < 6; matrixId += 1) {
+      EXPECT_THAT(GetScalingFactor(*scaling_factor, sizeId, matrixId),
+                  ::testing::Each(8));
+    }
   }
+}
 
-  // ScalingList[3]
-  EXPECT_EQ(6, scaling_list_data->ScalingList[3].size());
-  EXPECT_THAT(scaling_list_data->ScalingList[3][0],
-              ::testing::ElementsAreArray({8, 8, 8, 8, 8, 8, 8, 8,
-                                           8, 8, 8, 8, 8, 8, 8, 8,
-                                           8, 8, 8, 8, 8, 8, 8, 8,
-                                           8, 8, 8, 8, 8, 8, 8, 8,
-                                           8, 8, 8, 8, 8, 8, 8, 8,
-                                           8, 8, 8, 8, 8, 8, 8, 8,
-                                           8, 8, 8, 8, 8, 8, 8, 8,
-                                           8, 8, 8, 8, 8, 8, 8, 8}));
-  EXPECT_EQ(0, scaling_list_data->ScalingList[3][1].size());
-  EXPECT_EQ(0, scaling_list_data->ScalingList[3][2].size());
-  EXPECT_THAT(scaling_list_data->ScalingList[3][3],
-              ::testing::ElementsAreArray({8, 8, 8, 8, 8, 8, 8, 8,
-                                           8, 8, 8, 8, 8, 8, 8, 8,
-                                           8, 8, 8, 8, 8, 8, 8, 8,
-                                           8, 8, 8, 8, 8, 8, 8, 8,
-                                           8, 8, 8, 8, 8, 8, 8, 8,
-                                           8, 8, 8, 8, 8, 8, 8, 8,
-                                           8, 8, 8, 8, 8, 8, 8, 8,
-                                           8, 8, 8, 8, 8, 8, 8, 8}));
-  EXPECT_EQ(0, scaling_list_data->ScalingList[3][4].size());
-  EXPECT_EQ(0, scaling_list_data->ScalingList[3][5].size());
+TEST_F(H265ScalingListDataParserTest, TestPredictedScalingListData) {
+  std::vector<uint8_t> buffer(1024);
+  rtc::BitBufferWriter writer(buffer.data(), buffer.size());
+  // sizeId 0: an explicit list (8 + 1 + i), and 5 copies of it
+  WriteExplicitList(&writer, 0, 0, 9, 1);
+  for (uint32_t matrixId = 1; matrixId < 6; matrixId++) {
+    WritePredictedList(&writer, 1);
+  }
+  // sizeId 1: the default lists
+  for (uint32_t matrixId = 0; matrixId < 6; matrixId++) {
+    WritePredictedList(&writer, 0);
+  }
+  // sizeId 2: the default list, a flat list (4) with a DC of 20, a copy of
+  // it, and the default lists
+  WritePredictedList(&writer, 0);
+  WriteExplicitList(&writer, 2, 12, 4, 0);
+  WritePredictedList(&writer, 1);
+  for (uint32_t matrixId = 3; matrixId < 6; matrixId++) {
+    WritePredictedList(&writer, 0);
+  }
+  // sizeId 3: the default intra list, and a copy of it
+  WritePredictedList(&writer, 0);
+  WritePredictedList(&writer, 1);
+
+  auto scaling_list_data = H265ScalingListDataParser::ParseScalingListData(
+      buffer.data(), buffer.size());
+  ASSERT_NE(nullptr, scaling_list_data);
+
+  EXPECT_THAT(scaling_list_data->scaling_list_pred_mode_flag[0],
+              ::testing::ElementsAreArray({1, 0, 0, 0, 0, 0}));
+  EXPECT_THAT(scaling_list_data->scaling_list_pred_matrix_id_delta[0],
+              ::testing::ElementsAreArray({0, 1, 1, 1, 1, 1}));
+  EXPECT_THAT(scaling_list_data->scaling_list_pred_mode_flag[2],
+              ::testing::ElementsAreArray({0, 1, 0, 0, 0, 0}));
+  EXPECT_THAT(scaling_list_data->scaling_list_pred_matrix_id_delta[3],
+              ::testing::ElementsAreArray({0, 0, 0, 1, 0, 0}));
+  // inferred DC coefficients
+  EXPECT_THAT(scaling_list_data->scaling_list_dc_coef_minus8[0],
+              ::testing::ElementsAreArray({8, 12, 12, 8, 8, 8}));
+  EXPECT_THAT(scaling_list_data->scaling_list_dc_coef_minus8[1],
+              ::testing::ElementsAreArray({8, 0, 0, 8, 0, 0}));
+
+  // inferred lists
+  for (uint32_t matrixId = 0; matrixId < 6; matrixId++) {
+    EXPECT_THAT(GetList(*scaling_list_data, 0, matrixId),
+                ::testing::ElementsAreArray({9, 10, 11, 12, 13, 14, 15, 16,
+                                             17, 18, 19, 20, 21, 22, 23, 24}));
+  }
+  EXPECT_THAT(GetList(*scaling_list_data, 1, 2),
+              ::testing::ElementsAreArray(kDefaultIntra, 64));
+  EXPECT_THAT(GetList(*scaling_list_data, 1, 3),
+              ::testing::ElementsAreArray(kDefaultInter, 64));
+  EXPECT_THAT(GetList(*scaling_list_data, 2, 2), ::testing::Each(4));
+  EXPECT_THAT(GetList(*scaling_list_data, 3, 3),
+              ::testing::ElementsAreArray(kDefaultIntra, 64));
+
+  auto scaling_factor = scaling_list_data->getScalingFactor();
+  ASSERT_NE(nullptr, scaling_factor);
+  // ScalingFactor[0][matrixId][x][y] is at (y * 4 + x), and the lists are
+  // in up-right diagonal order
+  EXPECT_THAT(GetScalingFactor(*scaling_factor, 0, 5),
+              ::testing::ElementsAreArray({9, 11, 14, 18,    //
+                                           10, 13, 17, 21,   //
+                                           12, 16, 20, 23,   //
+                                           15, 19, 22, 24}));
+  // 16x16 and 32x32 matrices (the sizeId 3 chroma ones are derived from
+  // the sizeId 2 lists)
+  for (uint32_t sizeId = 2; sizeId < 4; sizeId++) {
+    auto factor = GetScalingFactor(*scaling_factor, sizeId, 2);
+    EXPECT_EQ(20, factor[0]);
+    EXPECT_THAT(std::vector<uint8_t>(factor.begin() + 1, factor.end()),
+                ::testing::Each(4));
+  }
+  EXPECT_EQ(nullptr, scaling_factor->getScalingFactor(4, 0));
+  EXPECT_EQ(nullptr, scaling_factor->getScalingFactor(0, 6));
+}
+
+TEST_F(H265ScalingListDataParserTest, TestDefaultScalingFactor) {
+  auto scaling_factor = H265ScalingListDataParser::GetDefaultScalingFactor();
+  ASSERT_NE(nullptr, scaling_factor);
+  EXPECT_EQ(scaling_factor,
+            H265ScalingListDataParser::GetDefaultScalingFactor());
+
+  // the default 8x8 matrices, in raster order
+  const uint8_t kIntra8x8[] = {
+      16, 16, 16, 16, 17, 18, 21, 24,  16, 16, 16, 16, 17, 19, 22, 25,
+      16, 16, 17, 18, 20, 22, 25, 29,  16, 16, 18, 21, 24, 27, 31, 36,
+      17, 17, 20, 24, 30, 35, 41, 47,  18, 19, 22, 27, 35, 44, 54, 65,
+      21, 22, 25, 31, 41, 54, 70, 88,  24, 25, 29, 36, 47, 65, 88, 115};
+  const uint8_t kInter8x8[] = {
+      16, 16, 16, 16, 17, 18, 20, 24,  16, 16, 16, 17, 18, 20, 24, 25,
+      16, 16, 17, 18, 20, 24, 25, 28,  16, 17, 18, 20, 24, 25, 28, 33,
+      17, 18, 20, 24, 25, 28, 33, 41,  18, 20, 24, 25, 28, 33, 41, 54,
+      20, 24, 25, 28, 33, 41, 54, 71,  24, 25, 28, 33, 41, 54, 71, 91};
+  for (uint32_t matrixId = 0; matrixId < 6; matrixId++) {
+    EXPECT_THAT(GetScalingFactor(*scaling_factor, 0, matrixId),
+                ::testing::Each(16));
+    EXPECT_THAT(GetScalingFactor(*scaling_factor, 1, matrixId),
+                ::testing::ElementsAreArray(
+                    (matrixId < 3) ? kIntra8x8 : kInter8x8, 64));
+  }
+  // the 16x16 matrices are upsampled 8x8 ones, with a DC value of 16
+  auto factor = GetScalingFactor(*scaling_factor, 2, 3);
+  for (uint32_t y = 0; y < 16; y++) {
+    for (uint32_t x = 0; x < 16; x++) {
+      EXPECT_EQ((x == 0 && y == 0) ? 16 : kInter8x8[(y / 2) * 8 + x / 2],
+                factor[y * 16 + x]);
+    }
+  }
+
+  // explicitly signalled default lists share the default matrices
+  std::vector<uint8_t> buffer(64);
+  rtc::BitBufferWriter writer(buffer.data(), buffer.size());
+  for (uint32_t i = 0; i < 20; i++) {
+    WritePredictedList(&writer, 0);
+  }
+  auto scaling_list_data = H265ScalingListDataParser::ParseScalingListData(
+      buffer.data(), buffer.size());
+  ASSERT_NE(nullptr, scaling_list_data);
+  EXPECT_EQ(scaling_factor, scaling_list_data->getScalingFactor());
+}
+
+TEST_F(H265ScalingListDataParserTest, TestSharedScalingFactor) {
+  // two parameter sets with the same lists
+  std::vector<uint8_t> buffer(1024);
+  rtc::BitBufferWriter writer(buffer.data(), buffer.size());
+  WriteExplicitList(&writer, 0, 0, 10, 2);
+  WritePredictedList(&writer, 1);
+  for (uint32_t i = 2; i < 20; i++) {
+    WritePredictedList(&writer, 0);
+  }
+  auto scaling_list_data0 = H265ScalingListDataParser::ParseScalingListData(
+      buffer.data(), buffer.size());
+  auto scaling_list_data1 = H265ScalingListDataParser::ParseScalingListData(
+      buffer.data(), buffer.size());
+  ASSERT_NE(nullptr, scaling_list_data0);
+  ASSERT_NE(nullptr, scaling_list_data1);
+  EXPECT_EQ(scaling_list_data0->lists_hash, scaling_list_data1->lists_hash);
+  EXPECT_TRUE(scaling_list_data0->hasSameLists(*scaling_list_data1));
+  auto scaling_factor = scaling_list_data0->getScalingFactor();
+  ASSERT_NE(nullptr, scaling_factor);
+  EXPECT_EQ(scaling_factor, scaling_list_data0->getScalingFactor());
+  EXPECT_EQ(scaling_factor, scaling_list_data1->getScalingFactor());
+  EXPECT_NE(H265ScalingListDataParser::GetDefaultScalingFactor(),
+            scaling_factor);
+
+  // the same lists, coded differently (the second list is not predicted)
+  std::vector<uint8_t> same_buffer(1024);
+  rtc::BitBufferWriter same_writer(same_buffer.data(), same_buffer.size());
+  WriteExplicitList(&same_writer, 0, 0, 10, 2);
+  WriteExplicitList(&same_writer, 0, 0, 10, 2);
+  for (uint32_t i = 2; i < 20; i++) {
+    WritePredictedList(&same_writer, 0);
+  }
+  auto same_scaling_list_data =
+      H265ScalingListDataParser::ParseScalingListData(same_buffer.data(),
+                                                      same_buffer.size());
+  ASSERT_NE(nullptr, same_scaling_list_data);
+  EXPECT_TRUE(scaling_list_data0->hasSameLists(*same_scaling_list_data));
+  EXPECT_EQ(scaling_factor, same_scaling_list_data->getScalingFactor());
+
+  // other lists
+  std::vector<uint8_t> other_buffer(1024);
+  rtc::BitBufferWriter other_writer(other_buffer.data(), other_buffer.size());
+  WriteExplicitList(&other_writer, 0, 0, 10, 3);
+  WritePredictedList(&other_writer, 1);
+  for (uint32_t i = 2; i < 20; i++) {
+    WritePredictedList(&other_writer, 0);
+  }
+  auto other_scaling_list_data =
+      H265ScalingListDataParser::ParseScalingListData(other_buffer.data(),
+                                                      other_buffer.size());
+  ASSERT_NE(nullptr, other_scaling_list_data);
+  EXPECT_FALSE(scaling_list_data0->hasSameLists(*other_scaling_list_data));
+  EXPECT_NE(scaling_factor, other_scaling_list_data->getScalingFactor());
+}
+
+TEST_F(H265ScalingListDataParserTest, TestInvalidScalingListData) {
+  // scaling_list_pred_matrix_id_delta[0][0] refers to a list before the
+  // first one
+  std::vector<uint8_t> buffer(64);
+  rtc::BitBufferWriter writer(buffer.data(), buffer.size());
+  WritePredictedList(&writer, 1);
+  EXPECT_EQ(nullptr, H265ScalingListDataParser::ParseScalingListData(
+                         buffer.data(), buffer.size()));
+
+  // scaling_list_dc_coef_minus8[0][0] out of range
+  std::vector<uint8_t> other_buffer(1024);
+  rtc::BitBufferWriter other_writer(other_buffer.data(), other_buffer.size());
+  for (uint32_t matrixId = 0; matrixId < 12; matrixId++) {
+    WritePredictedList(&other_writer, 0);
+  }
+  WriteExplicitList(&other_writer, 2, 248, 16, 0);
+  EXPECT_EQ(nullptr, H265ScalingListDataParser::ParseScalingListData(
+                         other_buffer.data(), other_buffer.size()));
 }
 
 }  // namespace h265nal
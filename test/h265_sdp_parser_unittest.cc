@@ -0,0 +1,133 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_sdp_parser.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+#include "rtc_base/arraysize.h"
+
+namespace h265nal {
+
+namespace {
+// fmtp of a 1280x720 stream (VPS, SPS, and PPS)
+const char kFmtp[] =
+    "a=fmtp:96 profile-id=1; "
+    "sprop-pps=RAHA88ACEA==; "
+    "sprop-sps=QgEBAWAAAAMAsAAAAwAAAwBdoAKAgC4fE5a7kyS7lYKDAwF2hQlA; "
+    "sprop-vps=QAEMAf//AWAAAAMAsAAAAwAAAwBdrFk=";
+
+// the first bytes of an IDR slice of the same stream
+const uint8_t kIdrSlice[] = {
+    0x26, 0x01, 0xaf, 0x09, 0x40, 0xfb, 0x27, 0x5b,
+    0xfd, 0x5d, 0xc2, 0x4d, 0xe8, 0xb2, 0x0f, 0xcd
+};
+}  // namespace
+
+class H265SdpParserTest : public ::testing::Test {
+ public:
+  H265SdpParserTest() {}
+  ~H265SdpParserTest() override {}
+};
+
+TEST_F(H265SdpParserTest, TestDecodeBase64) {
+  std::vector<uint8_t> data;
+  EXPECT_TRUE(H265SdpParser::DecodeBase64("RAHA88ACEA==", &data));
+  EXPECT_THAT(data, ::testing::ElementsAre(0x44, 0x01, 0xc0, 0xf3, 0xc0,
+                                           0x02, 0x10));
+  // padding is optional
+  EXPECT_TRUE(H265SdpParser::DecodeBase64("RAHA88ACEA", &data));
+  EXPECT_EQ(7, data.size());
+  EXPECT_TRUE(H265SdpParser::DecodeBase64("", &data));
+  EXPECT_TRUE(data.empty());
+  // invalid characters, data after padding, and a dangling character
+  EXPECT_FALSE(H265SdpParser::DecodeBase64("RAH*", &data));
+  EXPECT_FALSE(H265SdpParser::DecodeBase64("RA==HA", &data));
+  EXPECT_FALSE(H265SdpParser::DecodeBase64("RAHA8", &data));
+}
+
+TEST_F(H265SdpParserTest, TestDecodeSpropParameterSets) {
+  std::vector<std::vector<uint8_t>> nal_units;
+  EXPECT_TRUE(H265SdpParser::DecodeSpropParameterSets(
+      "RAHA88ACEA==,RAHA88ACEA==", &nal_units));
+  ASSERT_EQ(2, nal_units.size());
+  EXPECT_EQ(nal_units[0], nal_units[1]);
+  // empty NAL units
+  EXPECT_FALSE(
+      H265SdpParser::DecodeSpropParameterSets("RAHA88ACEA==,", &nal_units));
+}
+
+TEST_F(H265SdpParserTest, TestParseFmtp) {
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+
+  // without the out-of-band parameter sets, the slice cannot be parsed
+  auto nal_unit = H265NalUnitParser::ParseNalUnit(
+      kIdrSlice, arraysize(kIdrSlice), &bitstream_parser_state,
+      parsing_options);
+  EXPECT_TRUE(nal_unit == nullptr ||
+              nal_unit->nal_unit_payload->slice_segment_layer == nullptr);
+
+  EXPECT_EQ(3, H265SdpParser::ParseFmtp(kFmtp, &bitstream_parser_state,
+                                        parsing_options));
+  ASSERT_NE(nullptr, bitstream_parser_state.GetVps(0));
+  ASSERT_NE(nullptr, bitstream_parser_state.GetSps(0));
+  ASSERT_NE(nullptr, bitstream_parser_state.GetPps(0));
+  EXPECT_EQ(1280, bitstream_parser_state.GetSps(0)->pic_width_in_luma_samples);
+
+  // the first slice of the session can now be parsed
+  nal_unit = H265NalUnitParser::ParseNalUnit(
+      kIdrSlice, arraysize(kIdrSlice), &bitstream_parser_state,
+      parsing_options);
+  ASSERT_NE(nullptr, nal_unit);
+  ASSERT_NE(nullptr, nal_unit->nal_unit_payload->slice_segment_layer);
+  const auto& header =
+      nal_unit->nal_unit_payload->slice_segment_layer->slice_segment_header;
+  ASSERT_NE(nullptr, header);
+  EXPECT_EQ(0, header->slice_pic_parameter_set_id);
+  EXPECT_EQ(9, header->slice_qp_delta);
+}
+
+TEST_F(H265SdpParserTest, TestParseFmtpParametersOnly) {
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  // no "a=fmtp:" prefix, and no sprop parameters
+  EXPECT_EQ(0, H265SdpParser::ParseFmtp("profile-id=1;level-id=93",
+                                        &bitstream_parser_state,
+                                        parsing_options));
+  EXPECT_EQ(1, H265SdpParser::ParseFmtp(
+                   "sprop-vps=QAEMAf//AWAAAAMAsAAAAwAAAwBdrFk=",
+                   &bitstream_parser_state, parsing_options));
+  EXPECT_NE(nullptr, bitstream_parser_state.GetVps(0));
+}
+
+TEST_F(H265SdpParserTest, TestParseFmtpErrors) {
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  // malformed base64
+  EXPECT_EQ(-1, H265SdpParser::ParseFmtp("sprop-pps=RA*A",
+                                         &bitstream_parser_state,
+                                         parsing_options));
+  // a PPS in sprop-sps
+  EXPECT_EQ(-1, H265SdpParser::ParseFmtp("sprop-sps=RAHA88ACEA==",
+                                         &bitstream_parser_state,
+                                         parsing_options));
+  EXPECT_EQ(nullptr, bitstream_parser_state.GetPps(0));
+  // a valid VPS, and a PPS in sprop-sps: nothing is loaded
+  EXPECT_EQ(-1, H265SdpParser::ParseFmtp(
+                    "sprop-vps=QAEMAf//AWAAAAMAsAAAAwAAAwBdrFk=; "
+                    "sprop-sps=RAHA88ACEA==",
+                    &bitstream_parser_state, parsing_options));
+  EXPECT_EQ(nullptr, bitstream_parser_state.GetVps(0));
+  EXPECT_EQ(nullptr, bitstream_parser_state.GetPps(0));
+}
+
+}  // namespace h265nal
@@ -71,4 +71,425 @@ TEST_F(H265SeiParserTest, TestUserDataUnregisteredSei) {
   EXPECT_EQ(user_data_sei->uuid_iso_iec_11578_2, 0xbb55a4fe7fc2fc4e);
 }
 
+TEST_F(H265SeiParserTest, TestUserDataUnregisteredSeiAsView) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+      0x05, 0x38, 0x2c, 0xa2, 0xde, 0x09, 0xb5, 0x17, 0x47, 0xdb, 0xbb,
+      0x55, 0xa4, 0xfe, 0x7f, 0xc2, 0xfc, 0x4e, 0x78, 0x32, 0x36, 0x35,
+      0x20, 0x28, 0x62, 0x75, 0x69, 0x6c, 0x64, 0x20, 0x33, 0x31, 0x29,
+      0x20, 0x2d, 0x20, 0x31, 0x2e, 0x33, 0x2b, 0x32, 0x30, 0x2d, 0x36,
+      0x65, 0x36, 0x37, 0x35, 0x36, 0x66, 0x39, 0x34, 0x62, 0x32, 0x37,
+      0x3a, 0x5b, 0x57, 0x69};
+  ParsingOptions parsing_options;
+  parsing_options.sei_payload_as_view = true;
+  // fuzzer::conv: begin
+  auto sei_message = H265SeiMessageParser::ParseSei(
+      buffer, arraysize(buffer), parsing_options);
+  // fuzzer::conv: end
+
+  EXPECT_TRUE(sei_message != nullptr);
+  auto user_data_sei = dynamic_cast<
+      H265SeiUserDataUnregisteredParser::H265SeiUserDataUnregisteredState*>(
+      sei_message->payload_state.get());
+  EXPECT_TRUE(user_data_sei != nullptr);
+  EXPECT_EQ(user_data_sei->uuid_iso_iec_11578_1, 0x2ca2de09b51747db);
+  EXPECT_EQ(user_data_sei->uuid_iso_iec_11578_2, 0xbb55a4fe7fc2fc4e);
+  // payload bytes are not copied
+  EXPECT_TRUE(user_data_sei->payload.empty());
+  EXPECT_EQ(user_data_sei->payload_view.offset, 18);
+  EXPECT_EQ(user_data_sei->payload_view.length, 40);
+
+  // materialize the payload from the original buffer
+  std::vector<uint8_t> payload;
+  EXPECT_TRUE(user_data_sei->payload_view.Materialize(
+      buffer, arraysize(buffer), &payload));
+  EXPECT_THAT(payload,
+              ::testing::ElementsAreArray(buffer + 18, 40));
+}
+
+TEST_F(H265SeiParserTest, TestUnknownSeiAsViewWithEmulationPrevention) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {0x81, 0x06, 0x01, 0x00, 0x00,
+                            0x03, 0x01, 0x02, 0x03, 0x80};
+  ParsingOptions parsing_options;
+  parsing_options.sei_payload_as_view = true;
+  // fuzzer::conv: begin
+  auto sei_message = H265SeiMessageParser::ParseSei(
+      buffer, arraysize(buffer), parsing_options);
+  // fuzzer::conv: end
+
+  EXPECT_TRUE(sei_message != nullptr);
+  EXPECT_EQ(sei_message->payload_size, 6);
+  auto unknown_sei = dynamic_cast<H265SeiUnknownParser::H265SeiUnknownState*>(
+      sei_message->payload_state.get());
+  EXPECT_TRUE(unknown_sei != nullptr);
+  EXPECT_TRUE(unknown_sei->payload.empty());
+  EXPECT_EQ(unknown_sei->payload_view.offset, 2);
+  EXPECT_EQ(unknown_sei->payload_view.length, 6);
+
+  // the emulation prevention byte is dropped when materializing
+  std::vector<uint8_t> payload;
+  EXPECT_TRUE(unknown_sei->payload_view.Materialize(buffer, arraysize(buffer),
+                                                    &payload));
+  EXPECT_THAT(payload, ::testing::ElementsAreArray(
+                           {0x01, 0x00, 0x00, 0x01, 0x02, 0x03}));
+}
+
+TEST_F(H265SeiParserTest, TestTimeCodeSei) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {0x88, 0x06, 0x60, 0x40, 0x20,
+                            0x61, 0x04, 0x10, 0x80};
+  // fuzzer::conv: begin
+  auto sei_message =
+      H265SeiMessageParser::ParseSei(buffer, arraysize(buffer));
+  // fuzzer::conv: end
+
+  EXPECT_TRUE(sei_message != nullptr);
+  EXPECT_EQ(sei_message->payload_type, h265nal::SeiType::time_code);
+  EXPECT_EQ(sei_message->payload_size, 6);
+  auto time_code_sei =
+      dynamic_cast<H265SeiTimeCodeParser::H265SeiTimeCodeState*>(
+          sei_message->payload_state.get());
+  EXPECT_TRUE(time_code_sei != nullptr);
+  EXPECT_EQ(time_code_sei->num_clock_ts, 1);
+  EXPECT_THAT(time_code_sei->clock_timestamp_flag,
+              ::testing::ElementsAreArray({1}));
+  EXPECT_THAT(time_code_sei->full_timestamp_flag,
+              ::testing::ElementsAreArray({1}));
+  EXPECT_THAT(time_code_sei->n_frames, ::testing::ElementsAreArray({4}));
+  EXPECT_THAT(time_code_sei->seconds_value, ::testing::ElementsAreArray({3}));
+  EXPECT_THAT(time_code_sei->minutes_value, ::testing::ElementsAreArray({2}));
+  EXPECT_THAT(time_code_sei->hours_value, ::testing::ElementsAreArray({1}));
+  EXPECT_THAT(time_code_sei->time_offset_length,
+              ::testing::ElementsAreArray({0}));
+}
+
+TEST_F(H265SeiParserTest, TestMasteringDisplayColourVolumeSei) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {0x89, 0x18, 0x21, 0x34, 0x9b, 0xaa, 0x19, 0x96,
+                            0x08, 0xfc, 0x8a, 0x48, 0x39, 0x08, 0x3d, 0x13,
+                            0x40, 0x42, 0x00, 0x98, 0x96, 0x80, 0x00, 0x00,
+                            0x03, 0x00, 0x32, 0x80};
+  // fuzzer::conv: begin
+  auto sei_message =
+      H265SeiMessageParser::ParseSei(buffer, arraysize(buffer));
+  // fuzzer::conv: end
+
+  EXPECT_TRUE(sei_message != nullptr);
+  EXPECT_EQ(sei_message->payload_type,
+            h265nal::SeiType::mastering_display_colour_volume);
+  EXPECT_EQ(sei_message->payload_size, 24);
+  auto mdcv_sei = dynamic_cast<H265SeiMasteringDisplayColourVolumeParser::
+                                   H265SeiMasteringDisplayColourVolumeState*>(
+      sei_message->payload_state.get());
+  EXPECT_TRUE(mdcv_sei != nullptr);
+  EXPECT_THAT(mdcv_sei->display_primaries_x,
+              ::testing::ElementsAreArray({8500, 6550, 35400}));
+  EXPECT_THAT(mdcv_sei->display_primaries_y,
+              ::testing::ElementsAreArray({39850, 2300, 14600}));
+  EXPECT_EQ(mdcv_sei->white_point_x, 15635);
+  EXPECT_EQ(mdcv_sei->white_point_y, 16450);
+  EXPECT_EQ(mdcv_sei->max_display_mastering_luminance, 10000000);
+  EXPECT_EQ(mdcv_sei->min_display_mastering_luminance, 50);
+}
+
+TEST_F(H265SeiParserTest, TestContentLightLevelInfoSei) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {0x90, 0x04, 0x03, 0xe8, 0x01, 0x90, 0x80};
+  // fuzzer::conv: begin
+  auto sei_message =
+      H265SeiMessageParser::ParseSei(buffer, arraysize(buffer));
+  // fuzzer::conv: end
+
+  EXPECT_TRUE(sei_message != nullptr);
+  EXPECT_EQ(sei_message->payload_type,
+            h265nal::SeiType::content_light_level_info);
+  EXPECT_EQ(sei_message->payload_size, 4);
+  auto cll_sei = dynamic_cast<
+      H265SeiContentLightLevelInfoParser::H265SeiContentLightLevelInfoState*>(
+      sei_message->payload_state.get());
+  EXPECT_TRUE(cll_sei != nullptr);
+  EXPECT_EQ(cll_sei->max_content_light_level, 1000);
+  EXPECT_EQ(cll_sei->max_pic_average_light_level, 400);
+}
+
+TEST_F(H265SeiParserTest, TestTemporalMotionConstrainedTileSetsSeiEachTile) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {0x8b, 0x02, 0xe5, 0xd8, 0x80};
+  // fuzzer::conv: begin
+  auto sei_message =
+      H265SeiMessageParser::ParseSei(buffer, arraysize(buffer));
+  // fuzzer::conv: end
+
+  EXPECT_TRUE(sei_message != nullptr);
+  EXPECT_EQ(sei_message->payload_type,
+            h265nal::SeiType::temporal_motion_constrained_tile_sets);
+  EXPECT_EQ(sei_message->payload_size, 2);
+  auto mcts_sei = dynamic_cast<
+      H265SeiTemporalMotionConstrainedTileSetsParser::
+          H265SeiTemporalMotionConstrainedTileSetsState*>(
+      sei_message->payload_state.get());
+  ASSERT_TRUE(mcts_sei != nullptr);
+  EXPECT_EQ(mcts_sei->mc_all_tiles_exact_sample_value_match_flag, 1);
+  EXPECT_EQ(mcts_sei->each_tile_one_tile_set_flag, 1);
+  EXPECT_EQ(mcts_sei->max_mcts_tier_level_idc_present_flag, 1);
+  EXPECT_EQ(mcts_sei->max_mcts_tier_flag, 0);
+  EXPECT_EQ(mcts_sei->max_mcts_level_idc, 93);
+  EXPECT_TRUE(mcts_sei->mcts_id.empty());
+}
+
+TEST_F(H265SeiParserTest, TestTemporalMotionConstrainedTileSetsSei) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {0x8b, 0x07, 0x2b, 0xd6, 0x3c, 0x31,
+                            0x36, 0x43, 0x10, 0x80};
+  // fuzzer::conv: begin
+  auto sei_message =
+      H265SeiMessageParser::ParseSei(buffer, arraysize(buffer));
+  // fuzzer::conv: end
+
+  EXPECT_TRUE(sei_message != nullptr);
+  EXPECT_EQ(sei_message->payload_size, 7);
+  auto mcts_sei = dynamic_cast<
+      H265SeiTemporalMotionConstrainedTileSetsParser::
+          H265SeiTemporalMotionConstrainedTileSetsState*>(
+      sei_message->payload_state.get());
+  ASSERT_TRUE(mcts_sei != nullptr);
+  EXPECT_EQ(mcts_sei->mc_all_tiles_exact_sample_value_match_flag, 0);
+  EXPECT_EQ(mcts_sei->each_tile_one_tile_set_flag, 0);
+  EXPECT_EQ(mcts_sei->limited_tile_set_display_flag, 1);
+  EXPECT_EQ(mcts_sei->num_sets_in_message_minus1, 1);
+  EXPECT_THAT(mcts_sei->mcts_id, ::testing::ElementsAreArray({0, 5}));
+  EXPECT_THAT(mcts_sei->display_tile_set_flag,
+              ::testing::ElementsAreArray({1, 0}));
+  EXPECT_THAT(mcts_sei->num_tile_rects_in_set_minus1,
+              ::testing::ElementsAreArray({0, 1}));
+  ASSERT_EQ(2, mcts_sei->top_left_tile_index.size());
+  EXPECT_THAT(mcts_sei->top_left_tile_index[0],
+              ::testing::ElementsAreArray({0}));
+  EXPECT_THAT(mcts_sei->bottom_right_tile_index[0],
+              ::testing::ElementsAreArray({1}));
+  EXPECT_THAT(mcts_sei->top_left_tile_index[1],
+              ::testing::ElementsAreArray({2, 3}));
+  EXPECT_THAT(mcts_sei->bottom_right_tile_index[1],
+              ::testing::ElementsAreArray({2, 5}));
+  EXPECT_THAT(mcts_sei->mc_exact_sample_value_match_flag,
+              ::testing::ElementsAreArray({1, 0}));
+  EXPECT_THAT(mcts_sei->mcts_tier_level_idc_present_flag,
+              ::testing::ElementsAreArray({1, 0}));
+  EXPECT_THAT(mcts_sei->mcts_tier_flag, ::testing::ElementsAreArray({0, 0}));
+  EXPECT_THAT(mcts_sei->mcts_level_idc, ::testing::ElementsAreArray({60, 0}));
+}
+
+TEST_F(H265SeiParserTest, TestMctsExtractionInfoSetsSei) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {0x9e, 0x0c, 0xd5, 0x54, 0x97, 0x52, 0x40,
+                            0x0c, 0x01, 0x01, 0xc0, 0xf3, 0xc0, 0x80,
+                            0x80};
+  // fuzzer::conv: begin
+  auto sei_message =
+      H265SeiMessageParser::ParseSei(buffer, arraysize(buffer));
+  // fuzzer::conv: end
+
+  EXPECT_TRUE(sei_message != nullptr);
+  EXPECT_EQ(sei_message->payload_type,
+            h265nal::SeiType::mcts_extraction_info_sets);
+  EXPECT_EQ(sei_message->payload_size, 12);
+  auto eis_sei = dynamic_cast<H265SeiMctsExtractionInfoSetsParser::
+                                  H265SeiMctsExtractionInfoSetsState*>(
+      sei_message->payload_state.get());
+  ASSERT_TRUE(eis_sei != nullptr);
+  EXPECT_EQ(eis_sei->num_info_sets_minus1, 0);
+  EXPECT_THAT(eis_sei->num_mcts_sets_minus1, ::testing::ElementsAreArray({0}));
+  ASSERT_EQ(1, eis_sei->idx_of_mcts_in_set.size());
+  ASSERT_EQ(1, eis_sei->idx_of_mcts_in_set[0].size());
+  EXPECT_THAT(eis_sei->idx_of_mcts_in_set[0][0],
+              ::testing::ElementsAreArray({0, 1}));
+  EXPECT_THAT(eis_sei->slice_reordering_enabled_flag,
+              ::testing::ElementsAreArray({1}));
+  EXPECT_THAT(eis_sei->num_slice_segments_minus1,
+              ::testing::ElementsAreArray({1}));
+  EXPECT_THAT(eis_sei->output_slice_segment_address[0],
+              ::testing::ElementsAreArray({0, 3}));
+  EXPECT_THAT(eis_sei->pps_nuh_temporal_id_plus1[0],
+              ::testing::ElementsAreArray({1}));
+  ASSERT_EQ(1, eis_sei->vps_rbsp_data_byte[0].size());
+  EXPECT_THAT(eis_sei->vps_rbsp_data_byte[0][0],
+              ::testing::ElementsAreArray({0x0c, 0x01}));
+  ASSERT_EQ(1, eis_sei->sps_rbsp_data_byte[0].size());
+  EXPECT_THAT(eis_sei->sps_rbsp_data_byte[0][0],
+              ::testing::ElementsAreArray({0x01}));
+  ASSERT_EQ(1, eis_sei->pps_rbsp_data_byte[0].size());
+  EXPECT_THAT(eis_sei->pps_rbsp_data_byte[0][0],
+              ::testing::ElementsAreArray({0xc0, 0xf3, 0xc0}));
+}
+
+TEST_F(H265SeiParserTest, TestMctsExtractionInfoSetsSeiTruncated) {
+  // the RBSP lengths point past the end of the payload
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {0x9e, 0x07, 0xd5, 0x54, 0x97, 0x52, 0x40,
+                            0x0c, 0x01, 0x80};
+  // fuzzer::conv: begin
+  auto sei_message =
+      H265SeiMessageParser::ParseSei(buffer, arraysize(buffer));
+  // fuzzer::conv: end
+
+  ASSERT_TRUE(sei_message != nullptr);
+  EXPECT_EQ(nullptr, sei_message->payload_state);
+}
+
+TEST_F(H265SeiParserTest, TestBufferingPeriodAndPicTimingSei) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+      // sei_message: buffering_period (payload_size: 10)
+      0x00, 0x0a, 0xa0, 0x00, 0x00, 0x03, 0x00, 0x15, 0xf9, 0x00, 0x00, 0x03,
+      0x00, 0x10,
+      // sei_message: pic_timing (payload_size: 6)
+      0x01, 0x06, 0x00, 0x00, 0x03, 0x01, 0x00, 0x00, 0x03, 0x02,
+      // rbsp_trailing_bits()
+      0x80};
+  // SPS with NAL HRD parameters (24-bit delays, 1 CPB)
+  H265BitstreamParserState bitstream_parser_state;
+  auto sps = std::make_shared<H265SpsParser::SpsState>();
+  sps->vui_parameters_present_flag = 1;
+  sps->vui_parameters =
+      std::make_unique<H265VuiParametersParser::VuiParametersState>();
+  sps->vui_parameters->vui_hrd_parameters_present_flag = 1;
+  sps->vui_parameters->hrd_parameters =
+      std::make_unique<H265HrdParametersParser::HrdParametersState>();
+  auto& hrd_parameters = *sps->vui_parameters->hrd_parameters;
+  hrd_parameters.nal_hrd_parameters_present_flag = 1;
+  hrd_parameters.initial_cpb_removal_delay_length_minus1 = 23;
+  hrd_parameters.au_cpb_removal_delay_length_minus1 = 23;
+  hrd_parameters.dpb_output_delay_length_minus1 = 23;
+  hrd_parameters.cpb_cnt_minus1.push_back(0);
+  bitstream_parser_state.sps[0] = sps;
+  ParsingOptions parsing_options;
+  // fuzzer::conv: begin
+  auto sei_rbsp = H265SeiRbspParser::ParseSeiRbsp(
+      buffer, arraysize(buffer), &bitstream_parser_state, parsing_options,
+      nullptr);
+  // fuzzer::conv: end
+
+  EXPECT_TRUE(sei_rbsp != nullptr);
+  EXPECT_EQ(sei_rbsp->sei_message.size(), 2);
+  auto buffering_period = dynamic_cast<
+      H265SeiBufferingPeriodParser::H265SeiBufferingPeriodState*>(
+      sei_rbsp->sei_message[0]->payload_state.get());
+  EXPECT_TRUE(buffering_period != nullptr);
+  EXPECT_EQ(buffering_period->bp_seq_parameter_set_id, 0);
+  EXPECT_EQ(buffering_period->irap_cpb_params_present_flag, 0);
+  EXPECT_EQ(buffering_period->concatenation_flag, 1);
+  EXPECT_EQ(buffering_period->au_cpb_removal_delay_delta_minus1, 0);
+  EXPECT_THAT(buffering_period->nal_initial_cpb_removal_delay,
+              ::testing::ElementsAreArray({45000}));
+  EXPECT_THAT(buffering_period->nal_initial_cpb_removal_offset,
+              ::testing::ElementsAreArray({0}));
+  EXPECT_TRUE(buffering_period->nal_initial_alt_cpb_removal_delay.empty());
+  EXPECT_TRUE(buffering_period->vcl_initial_cpb_removal_delay.empty());
+  EXPECT_EQ(buffering_period->use_alt_cpb_params_flag, 0);
+  // the pic_timing message uses the SPS of the buffering period, which
+  // does not activate it
+  EXPECT_EQ(bitstream_parser_state.active_sps, nullptr);
+
+  auto pic_timing =
+      dynamic_cast<H265SeiPicTimingParser::H265SeiPicTimingState*>(
+          sei_rbsp->sei_message[1]->payload_state.get());
+  EXPECT_TRUE(pic_timing != nullptr);
+  EXPECT_EQ(pic_timing->au_cpb_removal_delay_minus1, 1);
+  EXPECT_EQ(pic_timing->pic_dpb_output_delay, 2);
+
+  // without parser state the messages are kept as unknown payloads
+  sei_rbsp = H265SeiRbspParser::ParseSeiRbsp(buffer, arraysize(buffer));
+  EXPECT_TRUE(sei_rbsp != nullptr);
+  EXPECT_EQ(sei_rbsp->sei_message.size(), 2);
+  EXPECT_TRUE(dynamic_cast<H265SeiUnknownParser::H265SeiUnknownState*>(
+                  sei_rbsp->sei_message[0]->payload_state.get()) != nullptr);
+}
+
+TEST_F(H265SeiParserTest, TestSeiRbspMultipleMessages) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+      // sei_message: user_data_unregistered (payload_size: 18)
+      0x05, 0x12, 0x2c, 0xa2, 0xde, 0x09, 0xb5, 0x17, 0x47, 0xdb, 0xbb, 0x55,
+      0xa4, 0xfe, 0x7f, 0xc2, 0xfc, 0x4e, 0x78, 0x32,
+      // sei_message: user_data_unregistered (payload_size: 17)
+      0x05, 0x11, 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99,
+      0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x01,
+      // sei_message: unknown (payload_type: 200, payload_size: 3)
+      0xc8, 0x03, 0x01, 0x02, 0x03,
+      // rbsp_trailing_bits()
+      0x80};
+  // fuzzer::conv: begin
+  auto sei_rbsp = H265SeiRbspParser::ParseSeiRbsp(buffer, arraysize(buffer));
+  // fuzzer::conv: end
+
+  EXPECT_TRUE(sei_rbsp != nullptr);
+  EXPECT_EQ(sei_rbsp->sei_message.size(), 3);
+  EXPECT_EQ(sei_rbsp->num_skipped_sei_messages, 0);
+  EXPECT_EQ(sei_rbsp->sei_message[0]->payload_type,
+            h265nal::SeiType::user_data_unregistered);
+  EXPECT_EQ(sei_rbsp->sei_message[0]->payload_size, 18);
+  EXPECT_EQ(sei_rbsp->sei_message[1]->payload_type,
+            h265nal::SeiType::user_data_unregistered);
+  EXPECT_EQ(sei_rbsp->sei_message[1]->payload_size, 17);
+  EXPECT_EQ(sei_rbsp->sei_message[2]->payload_type,
+            h265nal::SeiType::sei_manifest);
+  EXPECT_EQ(sei_rbsp->sei_message[2]->payload_size, 3);
+  auto unknown_sei = dynamic_cast<H265SeiUnknownParser::H265SeiUnknownState*>(
+      sei_rbsp->sei_message[2]->payload_state.get());
+  EXPECT_TRUE(unknown_sei != nullptr);
+  EXPECT_THAT(unknown_sei->payload, ::testing::ElementsAreArray({1, 2, 3}));
+}
+
+TEST_F(H265SeiParserTest, TestSeiRbspFilter) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+      // sei_message: user_data_unregistered (payload_size: 18)
+      0x05, 0x12, 0x2c, 0xa2, 0xde, 0x09, 0xb5, 0x17, 0x47, 0xdb, 0xbb, 0x55,
+      0xa4, 0xfe, 0x7f, 0xc2, 0xfc, 0x4e, 0x78, 0x32,
+      // sei_message: user_data_unregistered (payload_size: 17)
+      0x05, 0x11, 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99,
+      0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x01,
+      // sei_message: unknown (payload_type: 200, payload_size: 3)
+      0xc8, 0x03, 0x01, 0x02, 0x03,
+      // rbsp_trailing_bits()
+      0x80};
+  ParsingOptions parsing_options;
+
+  // select a single user_data_unregistered uuid
+  H265SeiMessageFilter uuid_filter;
+  uuid_filter.AddUuid(0x0011223344556677, 0x8899aabbccddeeff);
+  auto sei_rbsp = H265SeiRbspParser::ParseSeiRbsp(
+      buffer, arraysize(buffer), parsing_options, &uuid_filter);
+  EXPECT_TRUE(sei_rbsp != nullptr);
+  EXPECT_EQ(sei_rbsp->sei_message.size(), 1);
+  EXPECT_EQ(sei_rbsp->num_skipped_sei_messages, 2);
+  auto user_data_sei = dynamic_cast<
+      H265SeiUserDataUnregisteredParser::H265SeiUserDataUnregisteredState*>(
+      sei_rbsp->sei_message[0]->payload_state.get());
+  EXPECT_TRUE(user_data_sei != nullptr);
+  EXPECT_EQ(user_data_sei->uuid_iso_iec_11578_1, 0x0011223344556677);
+  EXPECT_EQ(user_data_sei->uuid_iso_iec_11578_2, 0x8899aabbccddeeff);
+  EXPECT_THAT(user_data_sei->payload, ::testing::ElementsAreArray({0x01}));
+
+  // select a payload type
+  H265SeiMessageFilter type_filter;
+  type_filter.AddPayloadType(SeiType::sei_manifest);
+  sei_rbsp = H265SeiRbspParser::ParseSeiRbsp(buffer, arraysize(buffer),
+                                             parsing_options, &type_filter);
+  EXPECT_TRUE(sei_rbsp != nullptr);
+  EXPECT_EQ(sei_rbsp->sei_message.size(), 1);
+  EXPECT_EQ(sei_rbsp->num_skipped_sei_messages, 2);
+  EXPECT_EQ(sei_rbsp->sei_message[0]->payload_type,
+            h265nal::SeiType::sei_manifest);
+
+  // an empty filter skips everything
+  H265SeiMessageFilter empty_filter;
+  sei_rbsp = H265SeiRbspParser::ParseSeiRbsp(buffer, arraysize(buffer),
+                                             parsing_options, &empty_filter);
+  EXPECT_TRUE(sei_rbsp != nullptr);
+  EXPECT_EQ(sei_rbsp->sei_message.size(), 0);
+  EXPECT_EQ(sei_rbsp->num_skipped_sei_messages, 3);
+}
+
 }  // namespace h265nal
@@ -0,0 +1,130 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_slice_header_parse_plan.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "h265_bitstream_parser.h"
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "rtc_base/arraysize.h"
+
+namespace h265nal {
+
+namespace {
+// VPS, SPS, and PPS of a 1280x720 stream
+const uint8_t kParameterSets[] = {
+    0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01,
+    0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+    0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+    0x5d, 0xac, 0x59, 0x00, 0x00, 0x00, 0x01, 0x42,
+    0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+    0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+    0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2e, 0x1f, 0x13,
+    0x96, 0xbb, 0x93, 0x24, 0xbb, 0x95, 0x82, 0x83,
+    0x03, 0x01, 0x76, 0x85, 0x09, 0x40, 0x00, 0x00,
+    0x00, 0x01, 0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02,
+    0x10
+};
+
+// a PPS with a different constrained_intra_pred_flag
+const uint8_t kOtherPps[] = {
+    0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc0, 0xfb,
+    0xc0, 0x02, 0x10
+};
+}  // namespace
+
+class H265SliceHeaderParsePlanTest : public ::testing::Test {
+ public:
+  H265SliceHeaderParsePlanTest() {}
+  ~H265SliceHeaderParsePlanTest() override {}
+
+  void Parse(const uint8_t* data, size_t length,
+             H265BitstreamParserState* bitstream_parser_state) {
+    ParsingOptions parsing_options;
+    auto bitstream = H265BitstreamParser::ParseBitstream(
+        data, length, bitstream_parser_state, parsing_options);
+    ASSERT_NE(nullptr, bitstream);
+  }
+};
+
+TEST_F(H265SliceHeaderParsePlanTest, TestCreate) {
+  H265BitstreamParserState bitstream_parser_state;
+  Parse(kParameterSets, arraysize(kParameterSets), &bitstream_parser_state);
+  auto sps = bitstream_parser_state.GetSps(0);
+  auto pps = bitstream_parser_state.GetPps(0);
+  ASSERT_NE(nullptr, sps);
+  ASSERT_NE(nullptr, pps);
+
+  auto plan = H265SliceHeaderParsePlan::Create(sps, pps);
+  ASSERT_NE(nullptr, plan);
+  EXPECT_EQ(sps->getPicSizeInCtbsY(), plan->PicSizeInCtbsY);
+  EXPECT_EQ(ceil_log2(sps->getPicSizeInCtbsY()),
+            plan->slice_segment_address_len);
+  EXPECT_EQ(sps->log2_max_pic_order_cnt_lsb_minus4 + 4,
+            plan->slice_pic_order_cnt_lsb_len);
+  EXPECT_TRUE(plan->max_num_pics_valid);
+  EXPECT_FALSE(plan->entry_points_present);
+  EXPECT_EQ(0, plan->max_num_entry_point_offsets);
+}
+
+TEST_F(H265SliceHeaderParsePlanTest, TestCodeLengths) {
+  auto sps = std::make_shared<H265SpsParser::SpsState>();
+  sps->pic_width_in_luma_samples = 1920;
+  sps->pic_height_in_luma_samples = 1080;
+  sps->log2_min_luma_coding_block_size_minus3 = 0;
+  sps->log2_diff_max_min_luma_coding_block_size = 3;
+  sps->log2_max_pic_order_cnt_lsb_minus4 = 4;
+  sps->num_short_term_ref_pic_sets = 5;
+  sps->num_long_term_ref_pics_sps = 2;
+  sps->computeDerived();
+  auto pps = std::make_shared<H265PpsParser::PpsState>();
+  pps->tiles_enabled_flag = 1;
+  pps->num_tile_columns_minus1 = 1;
+  pps->num_tile_rows_minus1 = 2;
+
+  auto plan = H265SliceHeaderParsePlan::Create(sps, pps);
+  ASSERT_NE(nullptr, plan);
+  // 30x17 CTBs of 64x64
+  EXPECT_EQ(510, plan->PicSizeInCtbsY);
+  EXPECT_EQ(9, plan->slice_segment_address_len);
+  EXPECT_EQ(8, plan->slice_pic_order_cnt_lsb_len);
+  EXPECT_EQ(3, plan->short_term_ref_pic_set_idx_len);
+  EXPECT_EQ(1, plan->lt_idx_sps_len);
+  EXPECT_TRUE(plan->entry_points_present);
+  EXPECT_EQ(5, plan->max_num_entry_point_offsets);
+}
+
+TEST_F(H265SliceHeaderParsePlanTest, TestCacheInvalidation) {
+  H265BitstreamParserState bitstream_parser_state;
+  Parse(kParameterSets, arraysize(kParameterSets), &bitstream_parser_state);
+  auto sps = bitstream_parser_state.GetSps(0);
+  auto pps = bitstream_parser_state.GetPps(0);
+
+  // the plan is computed once per (SPS, PPS) pair
+  auto plan0 =
+      H265SliceHeaderParsePlan::Get(&bitstream_parser_state, 0, sps, pps);
+  auto plan1 =
+      H265SliceHeaderParsePlan::Get(&bitstream_parser_state, 0, sps, pps);
+  ASSERT_NE(nullptr, plan0);
+  EXPECT_EQ(plan0, plan1);
+  EXPECT_EQ(pps.get(), plan0->pps.get());
+  EXPECT_EQ(1, bitstream_parser_state.slice_header_parse_plans.size());
+
+  // a new PPS with the same id invalidates the plan
+  Parse(kOtherPps, arraysize(kOtherPps), &bitstream_parser_state);
+  auto other_pps = bitstream_parser_state.GetPps(0);
+  ASSERT_NE(pps.get(), other_pps.get());
+  auto plan2 = H265SliceHeaderParsePlan::Get(&bitstream_parser_state, 0, sps,
+                                             other_pps);
+  ASSERT_NE(nullptr, plan2);
+  EXPECT_EQ(other_pps.get(), plan2->pps.get());
+  EXPECT_EQ(1, bitstream_parser_state.slice_header_parse_plans.size());
+}
+
+}  // namespace h265nal
@@ -94,6 +94,7 @@ TEST_F(H265SliceSegmentLayerParserTest, TestSampleSlice2) {
   sps->log2_diff_max_min_luma_coding_block_size = 2;
   sps->pic_width_in_luma_samples = 1280;
   sps->pic_height_in_luma_samples = 736;
+  sps->computeDerived();
   bitstream_parser_state.sps[0] = sps;
   auto pps = std::make_shared<H265PpsParser::PpsState>();
   bitstream_parser_state.pps[0] = pps;
@@ -161,6 +162,7 @@ TEST_F(H265SliceSegmentLayerParserTest, TestSampleSlicePpsId15) {
   sps->log2_diff_max_min_luma_coding_block_size = 2;
   sps->pic_width_in_luma_samples = 1280;
   sps->pic_height_in_luma_samples = 736;
+  sps->computeDerived();
   bitstream_parser_state.sps[0] = sps;
   auto pps = std::make_shared<H265PpsParser::PpsState>();
   bitstream_parser_state.pps[15] = pps;
@@ -231,4 +233,45 @@ TEST_F(H265SliceSegmentLayerParserTest, TestSliceContainsShortTermRefPicSet) {
   EXPECT_EQ(39, slice_segment_header->num_entry_point_offsets);
 }
 
+TEST_F(H265SliceSegmentLayerParserTest, TestSliceReferencesParameterSets) {
+  const uint8_t buffer[] = {
+      0xaf, 0x09, 0x40, 0xf3, 0xb8, 0xd5, 0x39, 0xba,
+      0x1f, 0xe4, 0xa6, 0x08, 0x5c, 0x6e, 0xb1, 0x8f,
+      0x00, 0x38, 0xf1, 0xa6, 0xfc, 0xf1, 0x40, 0x04,
+      0x3a, 0x86, 0xcb, 0x90, 0x74, 0xce, 0xf0, 0x46,
+      0x61, 0x93, 0x72, 0xd6, 0xfc, 0x35, 0xe3, 0xc5
+  };
+
+  H265BitstreamParserState bitstream_parser_state;
+  auto vps = std::make_shared<H265VpsParser::VpsState>();
+  bitstream_parser_state.vps[0] = vps;
+  auto sps = std::make_shared<H265SpsParser::SpsState>();
+  sps->sample_adaptive_offset_enabled_flag = 1;
+  sps->chroma_format_idc = 1;
+  bitstream_parser_state.sps[0] = sps;
+  auto pps = std::make_shared<H265PpsParser::PpsState>();
+  bitstream_parser_state.pps[0] = pps;
+
+  auto slice_segment_layer =
+      H265SliceSegmentLayerParser::ParseSliceSegmentLayer(
+          buffer, arraysize(buffer), NalUnitType::IDR_W_RADL,
+          &bitstream_parser_state);
+  ASSERT_TRUE(slice_segment_layer != nullptr);
+  auto& slice_segment_header = slice_segment_layer->slice_segment_header;
+
+  // the header shares the parameter sets instead of copying their fields
+  EXPECT_EQ(sps.get(), slice_segment_header->sps.get());
+  EXPECT_EQ(pps.get(), slice_segment_header->pps.get());
+  EXPECT_EQ(1, slice_segment_header->getChromaArrayType());
+  EXPECT_EQ(0, slice_segment_header->getMotionVectorResolutionControlIdc());
+  EXPECT_EQ(0, slice_segment_header->getPpsSliceActQpOffsetsPresentFlag());
+
+  // replacing the parameter sets in the state does not affect the header
+  bitstream_parser_state.sps[0] = std::make_shared<H265SpsParser::SpsState>();
+  bitstream_parser_state.pps[0] = std::make_shared<H265PpsParser::PpsState>();
+  EXPECT_EQ(sps.get(), slice_segment_header->sps.get());
+  EXPECT_EQ(1, slice_segment_header->sps->sample_adaptive_offset_enabled_flag);
+  EXPECT_EQ(pps.get(), slice_segment_header->pps.get());
+}
+
 }  // namespace h265nal
@@ -7,6 +7,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <memory>
+
 #include "h265_common.h"
 #include "rtc_base/arraysize.h"
 #include "rtc_base/bit_buffer.h"
@@ -156,7 +158,51 @@ TEST_F(H265SpsParserTest, TestSampleSPS) {
 #endif
 
   // derived values
+  EXPECT_EQ(3, sps->getMinCbLog2SizeY());
+  EXPECT_EQ(5, sps->getCtbLog2SizeY());
+  EXPECT_EQ(32, sps->getCtbSizeY());
+  EXPECT_EQ(40, sps->getPicWidthInCtbsY());
+  EXPECT_EQ(23, sps->getPicHeightInCtbsY());
   EXPECT_EQ(920, sps->getPicSizeInCtbsY());
+  EXPECT_EQ(160 * 92, sps->getPicSizeInMinCbsY());
+  EXPECT_EQ(2, sps->getSubWidthC());
+  EXPECT_EQ(2, sps->getSubHeightC());
+  int width = -1;
+  int height = -1;
+  EXPECT_EQ(0, sps->getResolution(&width, &height));
+  EXPECT_EQ(1280, width);
+  EXPECT_EQ(720, height);
+}
+
+TEST_F(H265SpsParserTest, TestDerivedValues) {
+  auto sps = std::make_shared<H265SpsParser::SpsState>();
+  sps->chroma_format_idc = 2;
+  sps->pic_width_in_luma_samples = 1928;
+  sps->pic_height_in_luma_samples = 1080;
+  sps->log2_min_luma_coding_block_size_minus3 = 0;
+  sps->log2_diff_max_min_luma_coding_block_size = 3;
+  sps->conf_win_right_offset = 4;
+  // the derived values are only updated by computeDerived()
+  EXPECT_EQ(0, sps->getPicSizeInCtbsY());
+  sps->computeDerived();
+
+  EXPECT_EQ(8, sps->getMinCbSizeY());
+  EXPECT_EQ(64, sps->getCtbSizeY());
+  EXPECT_EQ(241, sps->getPicWidthInMinCbsY());
+  EXPECT_EQ(135, sps->getPicHeightInMinCbsY());
+  // Ceil(1928 / 64) x Ceil(1080 / 64)
+  EXPECT_EQ(31, sps->getPicWidthInCtbsY());
+  EXPECT_EQ(17, sps->getPicHeightInCtbsY());
+  EXPECT_EQ(527, sps->getPicSizeInCtbsY());
+  EXPECT_EQ(1928 * 1080, sps->getPicSizeInSamplesY());
+  // 4:2:2
+  EXPECT_EQ(2, sps->getSubWidthC());
+  EXPECT_EQ(1, sps->getSubHeightC());
+  int width = -1;
+  int height = -1;
+  EXPECT_EQ(0, sps->getResolution(&width, &height));
+  EXPECT_EQ(1920, width);
+  EXPECT_EQ(1080, height);
 }
 
 TEST_F(H265SpsParserTest, TestSPSBadWidth) {
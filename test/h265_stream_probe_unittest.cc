@@ -0,0 +1,123 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_stream_probe.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "h265_common.h"
+#include "h265_profile_tier_level_parser.h"
+#include "rtc_base/arraysize.h"
+
+namespace h265nal {
+
+class H265StreamProbeTest : public ::testing::Test {
+ public:
+  H265StreamProbeTest() {}
+  ~H265StreamProbeTest() override {}
+};
+
+// fuzzer::conv: data
+const uint8_t kProbeBuffer[] = {
+    // VPS
+    0x00, 0x00, 0x00, 0x01,
+    0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+    0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03,
+    0x00, 0x00, 0x03, 0x00, 0x5d, 0xac, 0x59,
+    // SPS
+    0x00, 0x00, 0x00, 0x01,
+    0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03,
+    0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+    0x00, 0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2e, 0x1f,
+    0x13, 0x96, 0xbb, 0x93, 0x24, 0xbb, 0x95, 0x82,
+    0x83, 0x03, 0x01, 0x76, 0x85, 0x09, 0x40,
+    // PPS
+    0x00, 0x00, 0x00, 0x01,
+    0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02, 0x10,
+    // slice (IDR)
+    0x00, 0x00, 0x00, 0x01,
+    0x26, 0x01, 0xaf, 0x09, 0x40, 0xfb, 0x27, 0x5b,
+    0xfd, 0x5d, 0xc2, 0x4d, 0xe8, 0xb2, 0x0f, 0xcd
+};
+
+TEST_F(H265StreamProbeTest, TestProbe) {
+  // fuzzer::conv: begin
+  auto result = H265StreamProbe::Probe(kProbeBuffer, arraysize(kProbeBuffer));
+  // fuzzer::conv: end
+
+  EXPECT_TRUE(result.complete);
+  EXPECT_TRUE(result.has_vps);
+  EXPECT_TRUE(result.has_sps);
+  EXPECT_TRUE(result.has_pps);
+  EXPECT_FALSE(result.has_sei);
+  // stops right after the PPS
+  EXPECT_EQ(result.bytes_scanned, 81);
+  EXPECT_EQ(result.width, 1280);
+  EXPECT_EQ(result.height, 720);
+  EXPECT_EQ(result.chroma_format_idc, 1);
+  EXPECT_EQ(result.bit_depth_luma, 8);
+  EXPECT_EQ(result.bit_depth_chroma, 8);
+  EXPECT_EQ(result.profile_space, 0);
+  EXPECT_EQ(result.tier_flag, 0);
+  EXPECT_EQ(result.profile_idc, 1);
+  EXPECT_EQ(result.profile_compatibility_flags, 0x6);
+  EXPECT_EQ(result.level_idc, 93);
+  EXPECT_EQ(result.constraint_indicator_flags[0], 0xb0);
+  EXPECT_EQ(result.constraint_indicator_flags[1], 0x00);
+  EXPECT_FALSE(result.has_frame_rate);
+  EXPECT_FALSE(result.hdr);
+  EXPECT_STREQ(result.codecs, "hvc1.1.6.L93.B0");
+}
+
+TEST_F(H265StreamProbeTest, TestProbeWaitForSei) {
+  H265StreamProbe::ProbeOptions options;
+  options.wait_for_sei = true;
+  options.sample_entry = "hev1";
+  auto result =
+      H265StreamProbe::Probe(kProbeBuffer, arraysize(kProbeBuffer), options);
+  // there is no SEI: the probe stops at the first slice
+  EXPECT_TRUE(result.complete);
+  EXPECT_FALSE(result.has_sei);
+  EXPECT_EQ(result.bytes_scanned, 81);
+  EXPECT_STREQ(result.codecs, "hev1.1.6.L93.B0");
+}
+
+TEST_F(H265StreamProbeTest, TestProbeByteBudget) {
+  H265StreamProbe::ProbeOptions options;
+  // VPS and the start of the SPS
+  options.max_bytes = 40;
+  auto result =
+      H265StreamProbe::Probe(kProbeBuffer, arraysize(kProbeBuffer), options);
+  EXPECT_FALSE(result.complete);
+  EXPECT_TRUE(result.has_vps);
+  EXPECT_FALSE(result.has_sps);
+  EXPECT_EQ(result.bytes_scanned, 27);
+  EXPECT_STREQ(result.codecs, "");
+}
+
+TEST_F(H265StreamProbeTest, TestCodecsString) {
+  H265ProfileTierLevelParser::ProfileTierLevelState profile_tier_level;
+  profile_tier_level.general =
+      std::make_unique<H265ProfileInfoParser::ProfileInfoState>();
+  profile_tier_level.general->profile_compatibility_flag.fill(0);
+  // Main 10, High tier, level 5.1
+  profile_tier_level.general->profile_idc = 2;
+  profile_tier_level.general->profile_compatibility_flag[2] = 1;
+  profile_tier_level.general->tier_flag = 1;
+  profile_tier_level.general->progressive_source_flag = 1;
+  profile_tier_level.general->frame_only_constraint_flag = 1;
+  profile_tier_level.general_level_idc = 153;
+  char codecs[H265StreamProbe::kCodecsStringSize];
+  EXPECT_EQ(H265StreamProbe::GetCodecsString(profile_tier_level, "hvc1",
+                                             codecs, sizeof(codecs)),
+            16);
+  EXPECT_STREQ(codecs, "hvc1.2.4.H153.90");
+  // too small
+  EXPECT_EQ(H265StreamProbe::GetCodecsString(profile_tier_level, "hvc1",
+                                             codecs, 8),
+            -1);
+}
+
+}  // namespace h265nal
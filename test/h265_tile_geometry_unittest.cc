@@ -0,0 +1,146 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_tile_geometry.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+
+namespace h265nal {
+
+class H265TileGeometryTest : public ::testing::Test {
+ public:
+  H265TileGeometryTest() {}
+  ~H265TileGeometryTest() override {}
+
+  void SetUp() override {
+    // 1920x1080, with 64x64 CTBs (30x17 CTBs)
+    sps = std::make_shared<H265SpsParser::SpsState>();
+    sps->chroma_format_idc = 1;
+    sps->pic_width_in_luma_samples = 1920;
+    sps->pic_height_in_luma_samples = 1080;
+    sps->log2_min_luma_coding_block_size_minus3 = 0;
+    sps->log2_diff_max_min_luma_coding_block_size = 3;
+    sps->computeDerived();
+    pps = std::make_shared<H265PpsParser::PpsState>();
+  }
+
+  std::shared_ptr<H265SpsParser::SpsState> sps;
+  std::shared_ptr<H265PpsParser::PpsState> pps;
+};
+
+TEST_F(H265TileGeometryTest, TestNoTiles) {
+  auto geometry = H265TileGeometry::Create(sps, pps);
+  ASSERT_NE(nullptr, geometry);
+  EXPECT_EQ(1, geometry->getNumTiles());
+  EXPECT_THAT(geometry->colBd, ::testing::ElementsAreArray({0, 30}));
+  EXPECT_THAT(geometry->rowBd, ::testing::ElementsAreArray({0, 17}));
+  ASSERT_EQ(510, geometry->CtbAddrRsToTs.size());
+  for (uint32_t i = 0; i < 510; i++) {
+    EXPECT_EQ(i, geometry->CtbAddrRsToTs[i]);
+    EXPECT_EQ(i, geometry->CtbAddrTsToRs[i]);
+    EXPECT_EQ(0, geometry->TileId[i]);
+  }
+  EXPECT_EQ(-1, geometry->getTileId(510));
+}
+
+TEST_F(H265TileGeometryTest, TestUniformTiles) {
+  pps->tiles_enabled_flag = 1;
+  pps->num_tile_columns_minus1 = 2;
+  pps->num_tile_rows_minus1 = 1;
+  pps->uniform_spacing_flag = 1;
+  auto geometry = H265TileGeometry::Create(sps, pps);
+  ASSERT_NE(nullptr, geometry);
+  EXPECT_EQ(6, geometry->getNumTiles());
+  EXPECT_THAT(geometry->colWidth, ::testing::ElementsAreArray({10, 10, 10}));
+  EXPECT_THAT(geometry->rowHeight, ::testing::ElementsAreArray({8, 9}));
+  EXPECT_THAT(geometry->colBd, ::testing::ElementsAreArray({0, 10, 20, 30}));
+  EXPECT_THAT(geometry->rowBd, ::testing::ElementsAreArray({0, 8, 17}));
+
+  // the first CTB of the second tile follows the 10x8 CTBs of the first one
+  EXPECT_EQ(80, geometry->CtbAddrRsToTs[10]);
+  EXPECT_EQ(10, geometry->CtbAddrTsToRs[80]);
+  // the second CTB row of the first tile
+  EXPECT_EQ(10, geometry->CtbAddrRsToTs[30]);
+  for (uint32_t i = 0; i < 510; i++) {
+    EXPECT_EQ(i, geometry->CtbAddrTsToRs[geometry->CtbAddrRsToTs[i]]);
+  }
+  EXPECT_EQ(0, geometry->getTileId(0));
+  EXPECT_EQ(1, geometry->getTileId(10));
+  EXPECT_EQ(2, geometry->getTileId(29));
+  EXPECT_EQ(3, geometry->getTileId(8 * 30));
+  EXPECT_EQ(5, geometry->getTileId(509));
+
+  H265TileGeometry::TileRect tile_rect;
+  ASSERT_TRUE(geometry->getSliceSegmentTileRect(8 * 30 + 25, &tile_rect));
+  EXPECT_EQ(5, tile_rect.tile_id);
+  EXPECT_EQ(2, tile_rect.column);
+  EXPECT_EQ(1, tile_rect.row);
+  EXPECT_EQ(20, tile_rect.ctb_x);
+  EXPECT_EQ(8, tile_rect.ctb_y);
+  EXPECT_EQ(10, tile_rect.ctb_width);
+  EXPECT_EQ(9, tile_rect.ctb_height);
+  EXPECT_EQ(1280, tile_rect.x);
+  EXPECT_EQ(512, tile_rect.y);
+  EXPECT_EQ(640, tile_rect.width);
+  // cropped to the picture height
+  EXPECT_EQ(568, tile_rect.height);
+  EXPECT_FALSE(geometry->getTileRect(6, &tile_rect));
+  EXPECT_FALSE(geometry->getSliceSegmentTileRect(510, &tile_rect));
+}
+
+TEST_F(H265TileGeometryTest, TestExplicitTiles) {
+  pps->tiles_enabled_flag = 1;
+  pps->num_tile_columns_minus1 = 2;
+  pps->num_tile_rows_minus1 = 0;
+  pps->uniform_spacing_flag = 0;
+  pps->column_width_minus1 = {4, 9};
+  auto geometry = H265TileGeometry::Create(sps, pps);
+  ASSERT_NE(nullptr, geometry);
+  EXPECT_THAT(geometry->colWidth, ::testing::ElementsAreArray({5, 10, 15}));
+  EXPECT_THAT(geometry->rowHeight, ::testing::ElementsAreArray({17}));
+  EXPECT_EQ(1, geometry->getTileId(5));
+  EXPECT_EQ(2, geometry->getTileId(15));
+
+  // the explicit column widths do not fit the picture
+  pps->column_width_minus1 = {29, 0};
+  EXPECT_EQ(nullptr, H265TileGeometry::Create(sps, pps));
+  // more tile columns than CTB columns
+  pps->num_tile_columns_minus1 = 30;
+  pps->uniform_spacing_flag = 1;
+  EXPECT_EQ(nullptr, H265TileGeometry::Create(sps, pps));
+}
+
+TEST_F(H265TileGeometryTest, TestCache) {
+  H265BitstreamParserState bitstream_parser_state;
+  auto geometry0 = H265TileGeometry::Get(&bitstream_parser_state, 3, sps, pps);
+  auto geometry1 = H265TileGeometry::Get(&bitstream_parser_state, 3, sps, pps);
+  ASSERT_NE(nullptr, geometry0);
+  EXPECT_EQ(geometry0, geometry1);
+  EXPECT_EQ(4, bitstream_parser_state.tile_geometries.size());
+
+  // a new PPS with the same id invalidates the geometry
+  auto other_pps = std::make_shared<H265PpsParser::PpsState>();
+  other_pps->tiles_enabled_flag = 1;
+  other_pps->num_tile_columns_minus1 = 1;
+  other_pps->uniform_spacing_flag = 1;
+  auto geometry2 =
+      H265TileGeometry::Get(&bitstream_parser_state, 3, sps, other_pps);
+  ASSERT_NE(nullptr, geometry2);
+  EXPECT_EQ(other_pps.get(), geometry2->pps.get());
+  EXPECT_EQ(2, geometry2->getNumTiles());
+  // the replaced geometry is still usable
+  EXPECT_EQ(pps.get(), geometry0->pps.get());
+  EXPECT_EQ(1, geometry0->getNumTiles());
+
+  EXPECT_EQ(nullptr,
+            H265TileGeometry::Get(&bitstream_parser_state, 64, sps, pps));
+}
+
+}  // namespace h265nal
@@ -0,0 +1,76 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_time_code_index.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "rtc_base/arraysize.h"
+
+namespace h265nal {
+
+class H265TimeCodeIndexTest : public ::testing::Test {
+ public:
+  H265TimeCodeIndexTest() {}
+  ~H265TimeCodeIndexTest() override {}
+};
+
+TEST_F(H265TimeCodeIndexTest, TestBuildAndLookup) {
+  const uint8_t buffer[] = {
+      // AU 0 (offset: 0): time_code 01:02:03:04, IDR_W_RADL
+      0x00, 0x00, 0x00, 0x01, 0x4e, 0x01, 0x88, 0x06, 0x60, 0x40, 0x20, 0x61,
+      0x04, 0x10, 0x80, 0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0xaf,
+      // AU 1 (offset: 22): time_code (n_frames only) 5, TRAIL_R
+      0x00, 0x00, 0x00, 0x01, 0x4e, 0x01, 0x88, 0x04, 0x60, 0x00, 0x28, 0x10,
+      0x80, 0x00, 0x00, 0x00, 0x01, 0x02, 0x01, 0xd0,
+      // AU 2 (offset: 42): time_code 00:59:59:00, TRAIL_R
+      0x00, 0x00, 0x00, 0x01, 0x4e, 0x01, 0x88, 0x06, 0x60, 0x40, 0x07, 0x7d,
+      0x80, 0x10, 0x80, 0x00, 0x00, 0x00, 0x01, 0x02, 0x01, 0xd0,
+      // AU 3 (offset: 64): time_code 01:02:03:06, CRA_NUT
+      0x00, 0x00, 0x00, 0x01, 0x4e, 0x01, 0x88, 0x06, 0x60, 0x40, 0x30, 0x61,
+      0x04, 0x10, 0x80, 0x00, 0x00, 0x00, 0x01, 0x2a, 0x01, 0xaf};
+
+  auto index = H265TimeCodeIndex::Build(buffer, arraysize(buffer));
+  EXPECT_TRUE(index != nullptr);
+  EXPECT_EQ(index->entries().size(), 4);
+
+  // entries are sorted by time code
+  EXPECT_EQ(index->entries()[0].hours, 0);
+  EXPECT_EQ(index->entries()[0].minutes, 59);
+  EXPECT_EQ(index->entries()[0].seconds, 59);
+  EXPECT_EQ(index->entries()[0].offset, 42);
+
+  // exact lookup
+  const auto* entry = index->Find(1, 2, 3, 4);
+  EXPECT_TRUE(entry != nullptr);
+  EXPECT_EQ(entry->offset, 0);
+  EXPECT_TRUE(entry->has_irap);
+  EXPECT_EQ(entry->irap_offset, 0);
+
+  // the missing hours/minutes/seconds are inferred
+  entry = index->Find(1, 2, 3, 5);
+  EXPECT_TRUE(entry != nullptr);
+  EXPECT_EQ(entry->offset, 22);
+  EXPECT_TRUE(entry->has_irap);
+  EXPECT_EQ(entry->irap_offset, 0);
+
+  entry = index->Find(1, 2, 3, 6);
+  EXPECT_TRUE(entry != nullptr);
+  EXPECT_EQ(entry->offset, 64);
+  EXPECT_EQ(entry->irap_offset, 64);
+
+  EXPECT_TRUE(index->Find(1, 2, 3, 7) == nullptr);
+
+  // floor lookup
+  entry = index->FindFloor(1, 30, 0, 0);
+  EXPECT_TRUE(entry != nullptr);
+  EXPECT_EQ(entry->n_frames, 6);
+  entry = index->FindFloor(1, 0, 0, 0);
+  EXPECT_TRUE(entry != nullptr);
+  EXPECT_EQ(entry->offset, 42);
+  EXPECT_TRUE(index->FindFloor(0, 0, 0, 0) == nullptr);
+}
+
+}  // namespace h265nal
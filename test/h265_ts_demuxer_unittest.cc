@@ -0,0 +1,272 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_ts_demuxer.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "rtc_base/arraysize.h"
+
+namespace h265nal {
+
+namespace {
+// VPS
+const uint8_t kVps[] = {
+    0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+    0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03,
+    0x00, 0x00, 0x03, 0x00, 0x5d, 0xac, 0x59
+};
+
+// SPS
+const uint8_t kSps[] = {
+    0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03,
+    0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+    0x00, 0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2e, 0x1f,
+    0x13, 0x96, 0xbb, 0x93, 0x24, 0xbb, 0x95, 0x82,
+    0x83, 0x03, 0x01, 0x76, 0x85, 0x09, 0x40
+};
+
+// PPS
+const uint8_t kPps[] = {
+    0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02, 0x10
+};
+
+const uint16_t kPmtPid = 0x1000;
+const uint16_t kHevcPid = 0x0100;
+
+void AppendNalUnit(std::vector<uint8_t>* es, const uint8_t* data,
+                   size_t length) {
+  const uint8_t kStartCode[] = {0x00, 0x00, 0x00, 0x01};
+  es->insert(es->end(), kStartCode, kStartCode + arraysize(kStartCode));
+  es->insert(es->end(), data, data + length);
+}
+
+// A TS packet, with adaptation-field stuffing if the payload is short.
+std::vector<uint8_t> MakePacket(uint16_t pid, bool payload_unit_start,
+                                uint8_t* continuity_counter,
+                                const uint8_t* payload, size_t length) {
+  std::vector<uint8_t> packet = {
+      0x47,
+      static_cast<uint8_t>((payload_unit_start ? 0x40 : 0x00) | (pid >> 8)),
+      static_cast<uint8_t>(pid & 0xff),
+      static_cast<uint8_t>(0x10 | (*continuity_counter & 0x0f))};
+  *continuity_counter += 1;
+  if (length < 184) {
+    packet[3] |= 0x20;
+    size_t adaptation_field_length = 183 - length;
+    packet.push_back(static_cast<uint8_t>(adaptation_field_length));
+    if (adaptation_field_length > 0) {
+      // flags, and stuffing bytes
+      packet.push_back(0x00);
+      packet.insert(packet.end(), adaptation_field_length - 1, 0xff);
+    }
+  }
+  packet.insert(packet.end(), payload, payload + length);
+  return packet;
+}
+
+void Packetize(uint16_t pid, const std::vector<uint8_t>& pes,
+               uint8_t* continuity_counter, std::vector<uint8_t>* ts) {
+  for (size_t i = 0; i < pes.size(); i += 184) {
+    size_t length = std::min(static_cast<size_t>(184), pes.size() - i);
+    std::vector<uint8_t> packet =
+        MakePacket(pid, i == 0, continuity_counter, pes.data() + i, length);
+    ts->insert(ts->end(), packet.begin(), packet.end());
+  }
+}
+
+// PSI section with a pointer_field (and a dummy CRC_32).
+std::vector<uint8_t> MakeSection(uint8_t table_id, uint16_t id,
+                                 const std::vector<uint8_t>& body) {
+  size_t section_length = 5 + body.size() + 4;
+  std::vector<uint8_t> section = {
+      0x00, table_id, static_cast<uint8_t>(0xb0 | (section_length >> 8)),
+      static_cast<uint8_t>(section_length & 0xff),
+      static_cast<uint8_t>(id >> 8), static_cast<uint8_t>(id & 0xff),
+      0xc1, 0x00, 0x00};
+  section.insert(section.end(), body.begin(), body.end());
+  section.insert(section.end(), 4, 0x00);
+  return section;
+}
+
+void AppendTimestamp(std::vector<uint8_t>* pes, uint8_t prefix,
+                     uint64_t ts) {
+  pes->push_back(static_cast<uint8_t>((prefix << 4) | ((ts >> 29) & 0x0e) |
+                                      0x01));
+  pes->push_back(static_cast<uint8_t>(ts >> 22));
+  pes->push_back(static_cast<uint8_t>(((ts >> 14) & 0xfe) | 0x01));
+  pes->push_back(static_cast<uint8_t>(ts >> 7));
+  pes->push_back(static_cast<uint8_t>(((ts << 1) & 0xfe) | 0x01));
+}
+
+// A video PES packet (PES_packet_length 0, i.e. unbounded, unless
+// `bounded`).
+std::vector<uint8_t> MakePes(uint64_t pts, uint64_t dts, bool with_dts,
+                             const std::vector<uint8_t>& es, bool bounded) {
+  std::vector<uint8_t> pes = {0x00, 0x00, 0x01, 0xe0, 0x00, 0x00, 0x80,
+                              static_cast<uint8_t>(with_dts ? 0xc0 : 0x80),
+                              static_cast<uint8_t>(with_dts ? 10 : 5)};
+  AppendTimestamp(&pes, with_dts ? 0x03 : 0x02, pts);
+  if (with_dts) {
+    AppendTimestamp(&pes, 0x01, dts);
+  }
+  pes.insert(pes.end(), es.begin(), es.end());
+  if (bounded) {
+    size_t pes_packet_length = pes.size() - 6;
+    pes[4] = static_cast<uint8_t>(pes_packet_length >> 8);
+    pes[5] = static_cast<uint8_t>(pes_packet_length & 0xff);
+  }
+  return pes;
+}
+
+struct DemuxedAccessUnit {
+  uint16_t pid;
+  bool has_dts;
+  uint64_t pts;
+  uint64_t dts;
+  std::vector<uint8_t> data;
+};
+}  // namespace
+
+class H265TsDemuxerTest : public ::testing::Test {
+ public:
+  H265TsDemuxerTest() {}
+  ~H265TsDemuxerTest() override {}
+
+  void SetUp() override {
+    uint8_t pat_cc = 0;
+    uint8_t pmt_cc = 0;
+    // PAT: program 1 in kPmtPid
+    std::vector<uint8_t> pat = MakeSection(
+        0x00, 0x0001,
+        {0x00, 0x01, static_cast<uint8_t>(0xe0 | (kPmtPid >> 8)),
+         static_cast<uint8_t>(kPmtPid & 0xff)});
+    std::vector<uint8_t> packet =
+        MakePacket(0x0000, true, &pat_cc, pat.data(), pat.size());
+    ts_.insert(ts_.end(), packet.begin(), packet.end());
+    // PMT: an AAC stream (ignored) and an HEVC stream
+    std::vector<uint8_t> pmt = MakeSection(
+        0x02, 0x0001,
+        {static_cast<uint8_t>(0xe0 | (kHevcPid >> 8)),
+         static_cast<uint8_t>(kHevcPid & 0xff), 0xf0, 0x00,
+         0x0f, 0xe1, 0x01, 0xf0, 0x00,
+         H265TsDemuxer::kStreamTypeHevc,
+         static_cast<uint8_t>(0xe0 | (kHevcPid >> 8)),
+         static_cast<uint8_t>(kHevcPid & 0xff), 0xf0, 0x00});
+    packet = MakePacket(kPmtPid, true, &pmt_cc, pmt.data(), pmt.size());
+    ts_.insert(ts_.end(), packet.begin(), packet.end());
+
+    // access unit 0: parameter sets (fits in one packet)
+    AppendNalUnit(&es0_, kVps, arraysize(kVps));
+    AppendNalUnit(&es0_, kSps, arraysize(kSps));
+    AppendNalUnit(&es0_, kPps, arraysize(kPps));
+    // access unit 1: a (fake) slice spanning 3 packets
+    std::vector<uint8_t> slice = {0x02, 0x01};
+    for (int i = 0; i < 400; i++) {
+      slice.push_back(static_cast<uint8_t>(0x10 + (i % 0xe0)));
+    }
+    AppendNalUnit(&es1_, slice.data(), slice.size());
+
+    uint8_t cc = 0;
+    Packetize(kHevcPid, MakePes(183003, 180000, true, es0_, false), &cc,
+              &ts_);
+    Packetize(kHevcPid, MakePes(186006, 0, false, es1_, true), &cc, &ts_);
+  }
+
+  std::vector<DemuxedAccessUnit> Demux(size_t chunk_size) {
+    std::vector<DemuxedAccessUnit> access_units;
+    H265TsDemuxer demuxer(
+        [&access_units](const H265TsDemuxer::AccessUnit& access_unit) {
+          access_units.push_back(
+              {access_unit.pid, access_unit.has_dts, access_unit.pts,
+               access_unit.dts,
+               std::vector<uint8_t>(access_unit.data,
+                                    access_unit.data + access_unit.length)});
+        });
+    for (size_t i = 0; i < ts_.size(); i += chunk_size) {
+      demuxer.ProcessData(ts_.data() + i,
+                          std::min(chunk_size, ts_.size() - i));
+    }
+    demuxer.Flush();
+    EXPECT_THAT(demuxer.hevc_pids(), ::testing::ElementsAre(kHevcPid));
+    EXPECT_EQ(ts_.size() / H265TsDemuxer::kTsPacketSize,
+              demuxer.num_packets());
+    EXPECT_EQ(0, demuxer.num_continuity_errors());
+    return access_units;
+  }
+
+  std::vector<uint8_t> ts_;
+  std::vector<uint8_t> es0_;
+  std::vector<uint8_t> es1_;
+};
+
+TEST_F(H265TsDemuxerTest, TestIsTs) {
+  EXPECT_TRUE(H265TsDemuxer::IsTs(ts_.data(), ts_.size()));
+  EXPECT_FALSE(H265TsDemuxer::IsTs(es1_.data(), es1_.size()));
+  EXPECT_FALSE(H265TsDemuxer::IsTs(ts_.data(), 2 * 188));
+}
+
+TEST_F(H265TsDemuxerTest, TestDemux) {
+  // whole buffer, packet-aligned chunks, and unaligned chunks
+  for (size_t chunk_size : {ts_.size(), static_cast<size_t>(188),
+                            static_cast<size_t>(100)}) {
+    std::vector<DemuxedAccessUnit> access_units = Demux(chunk_size);
+    ASSERT_EQ(2, access_units.size());
+
+    EXPECT_EQ(kHevcPid, access_units[0].pid);
+    EXPECT_TRUE(access_units[0].has_dts);
+    EXPECT_EQ(183003, access_units[0].pts);
+    EXPECT_EQ(180000, access_units[0].dts);
+    EXPECT_EQ(es0_, access_units[0].data);
+
+    EXPECT_FALSE(access_units[1].has_dts);
+    EXPECT_EQ(186006, access_units[1].pts);
+    EXPECT_EQ(186006, access_units[1].dts);
+    EXPECT_EQ(es1_, access_units[1].data);
+  }
+}
+
+TEST_F(H265TsDemuxerTest, TestAnnexBSplit) {
+  std::vector<DemuxedAccessUnit> access_units = Demux(ts_.size());
+  ASSERT_EQ(2, access_units.size());
+  auto nalu_indices = H265BitstreamParser::FindNaluIndices(
+      access_units[0].data.data(), access_units[0].data.size());
+  ASSERT_EQ(3, nalu_indices.size());
+  EXPECT_EQ(arraysize(kVps), nalu_indices[0].payload_size);
+  EXPECT_EQ(arraysize(kSps), nalu_indices[1].payload_size);
+  EXPECT_EQ(arraysize(kPps), nalu_indices[2].payload_size);
+}
+
+TEST_F(H265TsDemuxerTest, TestContinuityError) {
+  // drop the second packet of the last PES packet
+  ts_.erase(ts_.end() - 2 * 188, ts_.end() - 188);
+  std::vector<DemuxedAccessUnit> access_units;
+  H265TsDemuxer demuxer(
+      [&access_units](const H265TsDemuxer::AccessUnit& access_unit) {
+        access_units.push_back({access_unit.pid, access_unit.has_dts,
+                                access_unit.pts, access_unit.dts,
+                                {}});
+      });
+  demuxer.ProcessData(ts_.data(), ts_.size());
+  demuxer.Flush();
+  EXPECT_EQ(1, demuxer.num_continuity_errors());
+  ASSERT_EQ(1, access_units.size());
+  EXPECT_EQ(183003, access_units[0].pts);
+}
+
+TEST_F(H265TsDemuxerTest, TestResync) {
+  // garbage before the first packet
+  ts_.insert(ts_.begin(), {0x00, 0x01, 0x02});
+  H265TsDemuxer demuxer(nullptr);
+  demuxer.ProcessData(ts_.data(), ts_.size());
+  EXPECT_EQ(3, demuxer.num_sync_losses());
+  EXPECT_THAT(demuxer.hevc_pids(), ::testing::ElementsAre(kHevcPid));
+}
+
+}  // namespace h265nal
@@ -4,20 +4,52 @@
  * An Annex-B Parser. It reads a full h265 (HEVC) Annex-B file, and parses
  * it using a single function (`H265BitstreamParser::ParseBitstream()`).
  * It then dumps the contents of each NALU read.
+ *
+ * MP4 (ISO-BMFF) files are also supported: the NAL units of their H265
+ * track are parsed in place (from the mmap'd file), starting with the
+ * hvcC parameter sets. MPEG-TS files are demuxed first (the HEVC PES
+ * payloads are concatenated into an Annex-B elementary stream).
+ *
+ * In batch mode (`--batch`), it parses a list of files (and/or directories)
+ * in parallel using a pool of worker threads. Each file gets its own output
+ * stream, and the results are emitted in input order, each one followed by
+ * a summary line.
+ *
+ * With `--filter <expr>`, only the NAL units matching the filter expression
+ * are dumped. NAL units that cannot match (based on their header) are not
+ * parsed at all, unless their parameter sets are needed by the filter.
  */
 
+#include <dirent.h>
 #include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
-
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
 #include <climits>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "config.h"
 #include "h265_bitstream_parser.h"
+#include "h265_bitstream_parser_state.h"
 #include "h265_common.h"
+#include "h265_filter.h"
+#include "h265_mp4_demuxer.h"
+#include "h265_nal_unit_header_parser.h"
+#include "h265_ts_demuxer.h"
 #include "rtc_base/bit_buffer.h"
 
 extern int optind;
@@ -31,8 +63,17 @@ typedef struct arg_options {
   bool add_checksum;
   bool add_resolution;
   bool add_contents;
+  bool batch;
+  int jobs;
+  char *outdir;
+  char *filter_expression;
+  // compiled filter_expression
+  const h265nal::H265Filter *filter;
   char *infile;
   char *outfile;
+  // batch mode inputs (files or directories)
+  int num_infiles;
+  char **infiles;
 } arg_options;
 
 // default option values
@@ -45,8 +86,15 @@ arg_options DEFAULTS{
     .add_checksum = false,
     .add_resolution = false,
     .add_contents = false,
+    .batch = false,
+    .jobs = 0,
+    .outdir = nullptr,
+    .filter_expression = nullptr,
+    .filter = nullptr,
     .infile = nullptr,
     .outfile = nullptr,
+    .num_infiles = 0,
+    .infiles = nullptr,
 };
 
 void usage(char *name) {
@@ -83,6 +131,18 @@ void usage(char *name) {
           DEFAULTS.add_contents ? " [default]" : "");
   fprintf(stderr, "\t--noadd-contents:\tReset add_contents flag%s\n",
           !DEFAULTS.add_contents ? " [default]" : "");
+  fprintf(stderr, "\t--batch:\tParse a list of files and/or directories%s\n",
+          DEFAULTS.batch ? " [default]" : "");
+  fprintf(stderr,
+          "\t-j <jobs>:\tNumber of batch worker threads (0 for one per core) "
+          "[default: %i]\n",
+          DEFAULTS.jobs);
+  fprintf(stderr,
+          "\t--outdir <dir>:\tWrite each batch output to "
+          "<dir>/<index>-<basename>.txt [default: stdout]\n");
+  fprintf(stderr,
+          "\t--filter <expr>:\tOnly dump the NAL units matching <expr> "
+          "(e.g. 'nal_unit_type==CRA_NUT || slice_qp_delta>10')\n");
   fprintf(stderr, "\t--version:\t\tDump version number\n");
   fprintf(stderr, "\t-h:\t\tHelp\n");
   exit(-1);
@@ -105,6 +165,9 @@ enum {
   NO_ADD_RESOLUTION_FLAG_OPTION,
   ADD_CONTENTS_FLAG_OPTION,
   NO_ADD_CONTENTS_FLAG_OPTION,
+  BATCH_FLAG_OPTION,
+  OUTDIR_OPTION,
+  FILTER_OPTION,
   VERSION_OPTION,
   HELP_OPTION
 };
@@ -123,6 +186,7 @@ arg_options *parse_args(int argc, char **argv) {
   static struct option longopts[] = {
       // matching options to short options
       {"debug", no_argument, NULL, 'd'},
+      {"jobs", required_argument, NULL, 'j'},
       // options without a short option
       {"quiet", no_argument, NULL, QUIET_OPTION},
       {"as-one-line", no_argument, NULL, AS_ONE_LINE_FLAG_OPTION},
@@ -140,12 +204,15 @@ arg_options *parse_args(int argc, char **argv) {
       {"noadd-resolution", no_argument, NULL, NO_ADD_RESOLUTION_FLAG_OPTION},
       {"add-contents", no_argument, NULL, ADD_CONTENTS_FLAG_OPTION},
       {"noadd-contents", no_argument, NULL, NO_ADD_CONTENTS_FLAG_OPTION},
+      {"batch", no_argument, NULL, BATCH_FLAG_OPTION},
+      {"outdir", required_argument, NULL, OUTDIR_OPTION},
+      {"filter", required_argument, NULL, FILTER_OPTION},
       {"version", no_argument, NULL, VERSION_OPTION},
       {"help", no_argument, NULL, HELP_OPTION},
       {NULL, 0, NULL, 0}};
 
   // parse arguments
-  while ((c = getopt_long(argc, argv, "dh", longopts, &optindex)) != -1) {
+  while ((c = getopt_long(argc, argv, "dj:h", longopts, &optindex)) != -1) {
     switch (c) {
       case 0:
         // long options that define flag
@@ -163,6 +230,10 @@ arg_options *parse_args(int argc, char **argv) {
         options.debug += 1;
         break;
 
+      case 'j':
+        options.jobs = atoi(optarg);
+        break;
+
       case QUIET_OPTION:
         options.debug = 0;
         break;
@@ -223,6 +294,18 @@ arg_options *parse_args(int argc, char **argv) {
         options.add_contents = false;
         break;
 
+      case BATCH_FLAG_OPTION:
+        options.batch = true;
+        break;
+
+      case OUTDIR_OPTION:
+        options.outdir = optarg;
+        break;
+
+      case FILTER_OPTION:
+        options.filter_expression = optarg;
+        break;
+
       case VERSION_OPTION:
         printf("version: %s\n", PROJECT_VER);
         exit(0);
@@ -238,6 +321,18 @@ arg_options *parse_args(int argc, char **argv) {
     }
   }
 
+  // batch mode requires at least 1 input
+  if (options.batch) {
+    if (argc - optind < 1) {
+      fprintf(stderr, "need at least one infile or directory\n");
+      usage(argv[0]);
+      return nullptr;
+    }
+    options.num_infiles = argc - optind;
+    options.infiles = &argv[optind];
+    return &options;
+  }
+
   // require 2 extra parameters
   if ((argc - optind != 1) && (argc - optind != 2)) {
     fprintf(stderr, "need infile (outfile is optional)\n");
@@ -252,6 +347,338 @@ arg_options *parse_args(int argc, char **argv) {
   return &options;
 }
 
+typedef h265nal::H265BitstreamParser::NaluIndex NaluIndex;
+
+// per-file parsing result
+typedef struct file_result {
+  bool ok;
+  int64_t size;
+  size_t num_nal_units;
+  // buffered output (batch mode without outdir)
+  char *output;
+  size_t output_size;
+} file_result;
+
+// A read-only memory mapping of a file.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile() {
+    if (data_ != nullptr) {
+      munmap(data_, size_);
+    }
+  }
+  // disable copy ctor, move ctor, and copy&move assignments
+  MappedFile(const MappedFile &) = delete;
+  MappedFile(MappedFile &&) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile &operator=(MappedFile &&) = delete;
+
+  bool Open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      return false;
+    }
+    size_ = st.st_size;
+    if (size_ > 0) {
+      void *data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      data_ = (data == MAP_FAILED) ? nullptr : data;
+    }
+    close(fd);
+    return size_ == 0 || data_ != nullptr;
+  }
+  const uint8_t *data() const { return static_cast<const uint8_t *>(data_); }
+  size_t size() const { return size_; }
+
+ private:
+  void *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// Parse the NAL units matching a filter. The payload of the NAL units that
+// cannot match (according to their header) is never parsed, unless they
+// are parameter sets: the matching slices need them to be parsed (and
+// dumped), even when the filter only uses header fields.
+std::unique_ptr<h265nal::H265BitstreamParser::BitstreamState>
+parse_filtered_bitstream(const h265nal::H265Filter *filter,
+                         const uint8_t *buffer,
+                         const std::vector<NaluIndex> &nalu_indices,
+                         h265nal::ParsingOptions parsing_options) {
+  auto bitstream =
+      std::make_unique<h265nal::H265BitstreamParser::BitstreamState>();
+  h265nal::H265BitstreamParserState bitstream_parser_state;
+  for (const auto &nalu_index : nalu_indices) {
+    const uint8_t *data = &buffer[nalu_index.payload_start_offset];
+    size_t length = nalu_index.payload_size;
+    // the NAL unit header is 2 bytes long
+    auto header = h265nal::H265NalUnitHeaderParser::ParseNalUnitHeader(
+        data, std::min<size_t>(length, 2));
+    if (header == nullptr) {
+      continue;
+    }
+    auto match = filter->EvaluateHeader(*header);
+    bool is_parameter_set = (header->nal_unit_type == h265nal::VPS_NUT ||
+                             header->nal_unit_type == h265nal::SPS_NUT ||
+                             header->nal_unit_type == h265nal::PPS_NUT);
+    if (match == h265nal::H265Filter::Match::kFalse && !is_parameter_set &&
+        !filter->NeedsPayload(header->nal_unit_type)) {
+      continue;
+    }
+    auto nal_unit = h265nal::H265NalUnitParser::ParseNalUnit(
+        data, length, &bitstream_parser_state, parsing_options);
+    if (nal_unit == nullptr || match == h265nal::H265Filter::Match::kFalse ||
+        (match == h265nal::H265Filter::Match::kUnknown &&
+         !filter->Evaluate(*nal_unit))) {
+      continue;
+    }
+    nal_unit->offset = nalu_index.payload_start_offset;
+    nal_unit->length = length;
+    bitstream->nal_units.push_back(std::move(nal_unit));
+  }
+  return bitstream;
+}
+
+// Parse an Annex-B (or MP4, or MPEG-TS) file, and dump its NAL units into
+// outfp (if not null).
+int parse_file(const arg_options *options, const char *infile, FILE *outfp,
+               file_result *result) {
+  result->ok = false;
+  result->size = 0;
+  result->num_nal_units = 0;
+
+  // 1. map infile into memory
+  MappedFile infile_map;
+  if (!infile_map.Open(infile)) {
+    // did not work
+    fprintf(stderr, "Could not open input file: \"%s\"\n", infile);
+    return -1;
+  }
+  const uint8_t *buffer = infile_map.data();
+  size_t size = infile_map.size();
+  result->size = size;
+
+  // an MPEG-TS file is demuxed into an Annex-B elementary stream (the
+  // NAL unit offsets refer to it)
+  std::vector<uint8_t> elementary_stream;
+  if (h265nal::H265TsDemuxer::IsTs(buffer, size)) {
+    h265nal::H265TsDemuxer demuxer(
+        [&elementary_stream](
+            const h265nal::H265TsDemuxer::AccessUnit &access_unit) {
+          elementary_stream.insert(elementary_stream.end(), access_unit.data,
+                                   access_unit.data + access_unit.length);
+        });
+    demuxer.ProcessData(buffer, size);
+    demuxer.Flush();
+    if (demuxer.hevc_pids().empty()) {
+      fprintf(stderr, "No H265 stream in MPEG-TS file: \"%s\"\n", infile);
+      return -1;
+    }
+    buffer = elementary_stream.data();
+    size = elementary_stream.size();
+  }
+
+  // find the NAL units: either Annex-B start codes, or the samples of the
+  // H265 track of an MP4 file
+  std::vector<NaluIndex> nalu_indices;
+  if (h265nal::H265Mp4Demuxer::IsMp4(buffer, size)) {
+    auto demuxer = h265nal::H265Mp4Demuxer::Open(buffer, size);
+    if (demuxer == nullptr) {
+      fprintf(stderr, "No H265 track in MP4 file: \"%s\"\n", infile);
+      return -1;
+    }
+    nalu_indices = demuxer->GetNaluIndices();
+  } else {
+    nalu_indices = h265nal::H265BitstreamParser::FindNaluIndices(buffer, size);
+  }
+
+  // 2. parse bitstream
+  h265nal::ParsingOptions parsing_options;
+  parsing_options.add_offset = options->add_offset;
+  parsing_options.add_length = options->add_length;
+  parsing_options.add_parsed_length = options->add_parsed_length;
+  parsing_options.add_checksum = options->add_checksum;
+  parsing_options.add_resolution = options->add_resolution;
+
+  std::unique_ptr<h265nal::H265BitstreamParser::BitstreamState> bitstream;
+  if (options->filter == nullptr) {
+    h265nal::H265BitstreamParserState bitstream_parser_state;
+    bitstream = h265nal::H265BitstreamParser::ParseBitstream(
+        buffer, size, nalu_indices, &bitstream_parser_state, parsing_options);
+  } else {
+    bitstream = parse_filtered_bitstream(options->filter, buffer,
+                                         nalu_indices, parsing_options);
+  }
+  if (bitstream == nullptr) {
+    return -1;
+  }
+  result->num_nal_units = bitstream->nal_units.size();
+  result->ok = true;
+
+#ifdef FDUMP_DEFINE
+  if (outfp == nullptr) {
+    return 0;
+  }
+  int indent_level = (options->as_one_line) ? -1 : 0;
+  // 3. dump the contents of each NALU
+  for (auto &nal_unit : bitstream->nal_units) {
+    nal_unit->fdump(outfp, indent_level, parsing_options);
+    if (options->add_contents) {
+      fprintf(outfp, " contents {");
+      for (size_t i = 0; i < nal_unit->length; i++) {
+        fprintf(outfp, " %02x", buffer[nal_unit->offset + i]);
+        if ((i + 1) % 16 == 0) {
+          fprintf(outfp, " ");
+        }
+      }
+      fprintf(outfp, " }");
+    }
+    fprintf(outfp, "\n");
+  }
+#endif  // FDUMP_DEFINE
+
+  return 0;
+}
+
+// Expand the batch inputs: directories are replaced by the (sorted) list
+// of regular files they contain.
+std::vector<std::string> get_batch_infiles(const arg_options *options) {
+  std::vector<std::string> infiles;
+  for (int i = 0; i < options->num_infiles; i++) {
+    std::string path = options->infiles[i];
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+      infiles.push_back(path);
+      continue;
+    }
+    DIR *dir = opendir(path.c_str());
+    if (dir == nullptr) {
+      fprintf(stderr, "Could not open input directory: \"%s\"\n",
+              path.c_str());
+      continue;
+    }
+    std::vector<std::string> entries;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+      if (entry->d_name[0] == '.') {
+        continue;
+      }
+      std::string entry_path = path + "/" + entry->d_name;
+      if (stat(entry_path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+        entries.push_back(entry_path);
+      }
+    }
+    closedir(dir);
+    std::sort(entries.begin(), entries.end());
+    infiles.insert(infiles.end(), entries.begin(), entries.end());
+  }
+  return infiles;
+}
+
+// Parse a single batch file, into either <outdir>/<index>-<basename>.txt
+// (the index keeps the names of inputs with the same basename apart) or a
+// memory buffer.
+void parse_batch_file(const arg_options *options, size_t index,
+                      const std::string &infile, file_result *result) {
+  result->output = nullptr;
+  result->output_size = 0;
+  FILE *outfp = nullptr;
+  if (options->outdir != nullptr) {
+    size_t slash = infile.rfind('/');
+    std::string basename =
+        (slash == std::string::npos) ? infile : infile.substr(slash + 1);
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "%04zu-", index);
+    std::string outfile =
+        std::string(options->outdir) + "/" + prefix + basename + ".txt";
+    outfp = fopen(outfile.c_str(), "wb");
+    if (outfp == nullptr) {
+      fprintf(stderr, "Could not open output file: \"%s\"\n", outfile.c_str());
+      result->ok = false;
+      result->size = 0;
+      result->num_nal_units = 0;
+      return;
+    }
+  } else {
+    outfp = open_memstream(&result->output, &result->output_size);
+  }
+  parse_file(options, infile.c_str(), outfp, result);
+  if (outfp != nullptr) {
+    fclose(outfp);
+  }
+}
+
+// Parse the batch inputs using a pool of worker threads. Results are
+// emitted in input order as soon as they (and all the previous ones) are
+// available. Workers do not get ahead of the first result not emitted yet
+// by more than a few files per worker, which bounds the (buffered)
+// results waiting to be emitted.
+int parse_batch(const arg_options *options) {
+  std::vector<std::string> infiles = get_batch_infiles(options);
+  size_t num_jobs = (options->jobs > 0)
+                        ? options->jobs
+                        : std::max(1u, std::thread::hardware_concurrency());
+  num_jobs = std::min(num_jobs, std::max<size_t>(infiles.size(), 1));
+
+  std::vector<file_result> results(infiles.size());
+  std::vector<bool> done(infiles.size(), false);
+  size_t num_emitted = 0;
+  const size_t max_pending = 2 * num_jobs;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::atomic<size_t> next_index(0);
+
+  // 1. start the worker pool
+  std::vector<std::thread> workers;
+  for (size_t j = 0; j < num_jobs; j++) {
+    workers.emplace_back([&]() {
+      size_t index;
+      while ((index = next_index++) < infiles.size()) {
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          cv.wait(lock, [&]() { return index < num_emitted + max_pending; });
+        }
+        file_result result;
+        parse_batch_file(options, index, infiles[index], &result);
+        std::lock_guard<std::mutex> lock(mutex);
+        results[index] = result;
+        done[index] = true;
+        cv.notify_all();
+      }
+    });
+  }
+
+  // 2. emit the results in input order
+  int num_failed = 0;
+  for (size_t index = 0; index < infiles.size(); index++) {
+    file_result result;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&]() { return done[index]; });
+      result = results[index];
+      num_emitted = index + 1;
+      cv.notify_all();
+    }
+    if (result.output != nullptr) {
+      fwrite(result.output, 1, result.output_size, stdout);
+      free(result.output);
+    }
+    printf("file: %s status: %s size: %" PRId64 " nal_units: %zu\n",
+           infiles[index].c_str(), result.ok ? "ok" : "error", result.size,
+           result.num_nal_units);
+    num_failed += result.ok ? 0 : 1;
+  }
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  return (num_failed == 0) ? 0 : -1;
+}
+
 int main(int argc, char **argv) {
   arg_options *options;
 
@@ -282,36 +709,27 @@ int main(int argc, char **argv) {
     options->add_length = true;
   }
 
-  // 1. read infile into buffer
-  // TODO(chemag): read the infile incrementally
-  FILE *infp = fopen(options->infile, "rb");
-  if (infp == nullptr) {
-    // did not work
-    fprintf(stderr, "Could not open input file: \"%s\"\n", options->infile);
-    return -1;
+  // compile the filter once
+  std::unique_ptr<h265nal::H265Filter> filter;
+  if (options->filter_expression != nullptr) {
+    std::string error;
+    filter = h265nal::H265Filter::Compile(options->filter_expression, &error);
+    if (filter == nullptr) {
+      fprintf(stderr, "Invalid filter: \"%s\": %s\n",
+              options->filter_expression, error.c_str());
+      return -1;
+    }
+    options->filter = filter.get();
   }
-  fseek(infp, 0, SEEK_END);
-  int64_t size = ftell(infp);
-  fseek(infp, 0, SEEK_SET);
-  // read file into buffer
-  std::vector<uint8_t> buffer(size);
-  fread(reinterpret_cast<char *>(buffer.data()), 1, size, infp);
 
-  // 2. parse bitstream
-  h265nal::ParsingOptions parsing_options;
-  parsing_options.add_offset = options->add_offset;
-  parsing_options.add_length = options->add_length;
-  parsing_options.add_parsed_length = options->add_parsed_length;
-  parsing_options.add_checksum = options->add_checksum;
-  parsing_options.add_resolution = options->add_resolution;
-
-  std::unique_ptr<h265nal::H265BitstreamParser::BitstreamState> bitstream =
-      h265nal::H265BitstreamParser::ParseBitstream(buffer.data(), buffer.size(),
-                                                   parsing_options);
+  if (options->batch) {
+    fflush(stdout);
+    return parse_batch(options);
+  }
 
-#ifdef FDUMP_DEFINE
   // get outfile file descriptor
-  FILE *outfp;
+  FILE *outfp = nullptr;
+#ifdef FDUMP_DEFINE
   if (options->outfile == nullptr ||
       (strlen(options->outfile) == 1 && options->outfile[0] == '-')) {
     // use stdout
@@ -324,24 +742,11 @@ int main(int argc, char **argv) {
       return -1;
     }
   }
-
-  int indent_level = (options->as_one_line) ? -1 : 0;
-  // 3. dump the contents of each NALU
-  for (auto &nal_unit : bitstream->nal_units) {
-    nal_unit->fdump(outfp, indent_level, parsing_options);
-    if (options->add_contents) {
-      fprintf(outfp, " contents {");
-      for (size_t i = 0; i < nal_unit->length; i++) {
-        fprintf(outfp, " %02x", buffer[nal_unit->offset + i]);
-        if ((i + 1) % 16 == 0) {
-          fprintf(outfp, " ");
-        }
-      }
-      fprintf(outfp, " }");
-    }
-    fprintf(outfp, "\n");
-  }
 #endif  // FDUMP_DEFINE
 
+  file_result result;
+  if (parse_file(options, options->infile, outfp, &result) != 0) {
+    return -1;
+  }
   return 0;
 }
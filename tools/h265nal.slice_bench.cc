@@ -0,0 +1,183 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * An h265 (HEVC) slice segment header benchmark. It reads a full Annex-B
+ * file, parses its parameter sets, and then parses the slice segment
+ * headers of the file repeatedly (using
+ * `H265SliceSegmentHeaderParser::ParseSliceSegmentHeaderPrefix`).
+ * It reports the slice segment headers parsed per second both with the
+ * per-PPS parse plan cache (H265SliceHeaderParsePlan), and with the cache
+ * emptied before every slice segment header (i.e., with the plan computed
+ * for every slice).
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_slice_parser.h"
+
+extern int optind;
+
+typedef struct arg_options {
+  int iterations;
+  int runs;
+  char *infile;
+} arg_options;
+
+// default option values
+arg_options DEFAULTS{
+    .iterations = 20,
+    .runs = 10,
+    .infile = nullptr,
+};
+
+void usage(char *name) {
+  fprintf(stderr, "usage: %s [options] <infile>\n", name);
+  fprintf(stderr, "where options are:\n");
+  fprintf(stderr,
+          "\t-i <iterations>:\tPasses over the file per run [default: %i]\n",
+          DEFAULTS.iterations);
+  fprintf(stderr, "\t-r <runs>:\tRuns per path (the best one is reported) "
+          "[default: %i]\n", DEFAULTS.runs);
+  fprintf(stderr, "\t-h:\t\tHelp\n");
+  exit(-1);
+}
+
+arg_options *parse_args(int argc, char **argv) {
+  int c;
+  static arg_options options;
+
+  // set default options
+  options = DEFAULTS;
+
+  while ((c = getopt(argc, argv, "i:r:h")) != -1) {
+    switch (c) {
+      case 'i':
+        options.iterations = atoi(optarg);
+        break;
+
+      case 'r':
+        options.runs = atoi(optarg);
+        break;
+
+      case 'h':
+      default:
+        usage(argv[0]);
+    }
+  }
+
+  // require an input file
+  if (optind != argc - 1 || options.iterations <= 0 || options.runs <= 0) {
+    usage(argv[0]);
+  }
+  options.infile = argv[optind];
+  return &options;
+}
+
+// Parses all the slice segment headers `iterations` times, and returns the
+// number of slice segment headers parsed per second. If `cached` is false,
+// the parse plan cache is emptied before each slice segment header.
+double slice_headers_per_second(
+    const std::vector<uint8_t> &buffer,
+    const std::vector<h265nal::H265BitstreamParser::NaluIndex> &slices,
+    h265nal::H265BitstreamParserState *bitstream_parser_state, bool cached,
+    int iterations) {
+  std::vector<uint8_t> rbsp_buffer;
+  size_t parsed = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    for (const auto &slice : slices) {
+      if (!cached) {
+        bitstream_parser_state->slice_header_parse_plans.clear();
+      }
+      const uint8_t *nal_unit = buffer.data() + slice.payload_start_offset;
+      uint32_t nal_unit_type = (nal_unit[0] >> 1) & 0x3f;
+      // skip the 2-byte NAL unit header
+      auto slice_segment_header = h265nal::H265SliceSegmentHeaderParser::
+          ParseSliceSegmentHeaderPrefix(nal_unit + 2, slice.payload_size - 2,
+                                        nal_unit_type, bitstream_parser_state,
+                                        &rbsp_buffer);
+      parsed += (slice_segment_header != nullptr);
+    }
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return parsed / elapsed.count();
+}
+
+int main(int argc, char **argv) {
+  arg_options *options = parse_args(argc, argv);
+
+  // read the file into a buffer
+  FILE *infp = fopen(options->infile, "rb");
+  if (infp == nullptr) {
+    fprintf(stderr, "error: cannot open file: %s\n", options->infile);
+    return -1;
+  }
+  std::vector<uint8_t> buffer;
+  uint8_t chunk[4096];
+  size_t read;
+  while ((read = fread(chunk, 1, sizeof(chunk), infp)) > 0) {
+    buffer.insert(buffer.end(), chunk, chunk + read);
+  }
+  fclose(infp);
+
+  // parse the whole file once, to get the parameter sets
+  h265nal::H265BitstreamParserState bitstream_parser_state;
+  h265nal::ParsingOptions parsing_options;
+  auto bitstream = h265nal::H265BitstreamParser::ParseBitstream(
+      buffer.data(), buffer.size(), &bitstream_parser_state, parsing_options);
+  if (bitstream == nullptr) {
+    fprintf(stderr, "error: cannot parse file: %s\n", options->infile);
+    return -1;
+  }
+
+  // keep the slice segment NAL units
+  std::vector<h265nal::H265BitstreamParser::NaluIndex> slices;
+  for (const auto &nalu_index :
+       h265nal::H265BitstreamParser::FindNaluIndices(buffer.data(),
+                                                     buffer.size())) {
+    if (nalu_index.payload_size <= 2) {
+      continue;
+    }
+    uint32_t nal_unit_type =
+        (buffer[nalu_index.payload_start_offset] >> 1) & 0x3f;
+    if (h265nal::IsSliceSegment(nal_unit_type)) {
+      slices.push_back(nalu_index);
+    }
+  }
+  if (slices.empty()) {
+    fprintf(stderr, "error: no slice segments in file: %s\n", options->infile);
+    return -1;
+  }
+
+  // alternate the paths, and keep the best run of each
+  double best_cached = 0;
+  double best_uncached = 0;
+  for (int run = 0; run < options->runs; run++) {
+    best_cached = std::max(
+        best_cached,
+        slice_headers_per_second(buffer, slices, &bitstream_parser_state,
+                                 true, options->iterations));
+    best_uncached = std::max(
+        best_uncached,
+        slice_headers_per_second(buffer, slices, &bitstream_parser_state,
+                                 false, options->iterations));
+  }
+
+  printf("file: %s slices: %zu\n", options->infile, slices.size());
+  printf("cached: %.0f slice headers/s\n", best_cached);
+  printf("uncached: %.0f slice headers/s\n", best_uncached);
+  printf("speedup: %.3f\n", best_cached / best_uncached);
+  return 0;
+}